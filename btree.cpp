@@ -0,0 +1,608 @@
+/***************************
+* File:     btree.cpp
+* Project:  Project 2
+*
+* Implementation of btree.h.
+***************************/
+#include "btree.h"
+
+/**
+ * Destructor, deletes all dynamic memory.
+ */
+BTree::~BTree() {
+    clear();
+}
+
+// preconditions: a key is about to be stored or searched for
+// postconditions: the first 8 bytes of key are returned packed big endian, zero padded,
+//                 so comparing two prefixes as integers orders them like the strings
+unsigned long long BTree::packPrefix(const string& key) {
+    unsigned long long prefix = 0;
+
+    for (int i = 0; i < BTREE_PREFIX_BYTES; i++) {
+        prefix <<= 8;
+        if (i < (int)key.length()) { prefix |= (unsigned char)key[i]; }
+    }
+
+    return prefix;
+}
+
+// preconditions: prefix is packPrefix(key)
+// postconditions: negative, zero, or positive as key sorts before, equal to, or after
+//                 the key at index of node
+int BTree::compareKey(unsigned long long prefix, const string& key, BNode *node, int index) {
+    if (prefix != node->_prefixes[index]) {
+        return (prefix < node->_prefixes[index]) ? -1 : 1;
+    }
+
+    // only keys sharing their first 8 bytes need the full comparison
+    return key.compare(*node->_keys[index]);
+}
+
+// preconditions: a node is being searched
+// postconditions: the index of the first key not smaller than key is returned
+int BTree::lowerBound(BNode *node, unsigned long long prefix, const string& key) {
+    int index = 0;
+    while (index < node->_numKeys && compareKey(prefix, key, node, index) > 0) { index++; }
+
+    return index;
+}
+
+// preconditions: a node is being searched
+// postconditions: the index of the first key larger than key is returned
+int BTree::upperBound(BNode *node, unsigned long long prefix, const string& key) {
+    int index = 0;
+    while (index < node->_numKeys && compareKey(prefix, key, node, index) >= 0) { index++; }
+
+    return index;
+}
+
+// preconditions: the tree is not empty
+// postconditions: the leaf key belongs in is returned, with every inner node passed
+//                 and the child slot taken from it recorded in path and slots
+BLeaf* BTree::findLeaf(unsigned long long prefix, const string& key, BInner **path, int *slots, int &depth) const {
+    BNode *node = this->_root;
+    depth = 0;
+
+    while (!node->_leaf) {
+        BInner *inner = static_cast<BInner*>(node);
+        int slot = upperBound(inner, prefix, key);
+
+        path[depth] = inner;
+        slots[depth++] = slot;
+        node = inner->_children[slot];
+    }
+
+    return static_cast<BLeaf*>(node);
+}
+
+// preconditions: a lookup of key is needed
+// postconditions: the UNode holding key is returned, nullptr if it is not in the tree
+UNode* BTree::find(const string& key) const {
+    if (!this->_root) { return nullptr; }
+
+    BInner *path[MAX_BTREE_DEPTH];
+    int slots[MAX_BTREE_DEPTH];
+    int depth = 0;
+    unsigned long long prefix = packPrefix(key);
+
+    BLeaf *leaf = findLeaf(prefix, key, path, slots, depth);
+    int index = lowerBound(leaf, prefix, key);
+
+    if (index < leaf->_numKeys && compareKey(prefix, key, leaf, index) == 0) {
+        return leaf->_values[index];
+    }
+
+    return nullptr;
+}
+
+/**
+ * Inserts an account into the DTree of its username, adding the username to a
+ * leaf (and splitting nodes on the way up) if it is new.
+ * @param newAcct Account object to be inserted into the corresponding DTree
+ * @return true if the account was inserted, false otherwise
+ */
+bool BTree::insert(Account newAcct) {
+    string username = newAcct.getUsername();
+    unsigned long long prefix = packPrefix(username);
+
+    if (!this->_root) {
+        BLeaf *leaf = new BLeaf();
+        this->_root = leaf;
+        this->_head = leaf;
+    }
+
+    BInner *path[MAX_BTREE_DEPTH];
+    int slots[MAX_BTREE_DEPTH];
+    int depth = 0;
+
+    BLeaf *leaf = findLeaf(prefix, username, path, slots, depth);
+    int pos = lowerBound(leaf, prefix, username);
+
+    // an existing username only needs its DTree updated
+    if (pos < leaf->_numKeys && compareKey(prefix, username, leaf, pos) == 0) {
+        return leaf->_values[pos]->insert(newAcct);
+    }
+
+    UNode *unode = new UNode();
+    unode->insert(newAcct);
+
+    // a full leaf moves its upper half into a new right sibling first
+    BLeaf *target = leaf;
+    BLeaf *right = nullptr;
+
+    if (leaf->_numKeys == BTREE_ORDER) {
+        right = new BLeaf();
+
+        for (int i = BTREE_MIN_KEYS; i < BTREE_ORDER; i++) {
+            right->_prefixes[i - BTREE_MIN_KEYS] = leaf->_prefixes[i];
+            right->_keys[i - BTREE_MIN_KEYS] = leaf->_keys[i];
+            right->_values[i - BTREE_MIN_KEYS] = leaf->_values[i];
+        }
+
+        right->_numKeys = BTREE_ORDER - BTREE_MIN_KEYS;
+        leaf->_numKeys = BTREE_MIN_KEYS;
+
+        right->_next = leaf->_next;
+        if (right->_next) { right->_next->_prev = right; }
+        right->_prev = leaf;
+        leaf->_next = right;
+
+        if (pos >= BTREE_MIN_KEYS) {
+            target = right;
+            pos -= BTREE_MIN_KEYS;
+        }
+    }
+
+    for (int i = target->_numKeys; i > pos; i--) {
+        target->_prefixes[i] = target->_prefixes[i - 1];
+        target->_keys[i] = target->_keys[i - 1];
+        target->_values[i] = target->_values[i - 1];
+    }
+
+    target->_prefixes[pos] = prefix;
+    target->_keys[pos] = new string(username);
+    target->_values[pos] = unode;
+    target->_numKeys++;
+
+    // the right half's first key separates the two leaves in the parent
+    if (right) {
+        insertIntoParent(path, slots, depth, leaf, right->_prefixes[0], new string(*right->_keys[0]), right);
+    }
+
+    return true;
+}
+
+// preconditions: left (the child at path[depth - 1]'s slot) was split, with right now
+//                holding every key from sepKey up
+// postconditions: the separator and right are added to the parent, splitting it and
+//                 continuing upwards if it was full, or growing a new root at the top
+void BTree::insertIntoParent(BInner **path, int *slots, int depth, BNode *left,
+                             unsigned long long sepPrefix, string *sepKey, BNode *right) {
+    if (depth == 0) {
+        BInner *root = new BInner();
+        root->_prefixes[0] = sepPrefix;
+        root->_keys[0] = sepKey;
+        root->_children[0] = left;
+        root->_children[1] = right;
+        root->_numKeys = 1;
+        this->_root = root;
+
+        return;
+    }
+
+    BInner *parent = path[depth - 1];
+    int slot = slots[depth - 1];
+
+    // lay out the parent's keys and children with the new ones in place, then
+    // deal them back out into one node or two
+    unsigned long long prefixes[BTREE_ORDER + 1];
+    string *keys[BTREE_ORDER + 1];
+    BNode *children[BTREE_ORDER + 2];
+    int numKeys = parent->_numKeys + 1;
+
+    for (int i = 0, j = 0; i < numKeys; i++) {
+        if (i == slot) {
+            prefixes[i] = sepPrefix;
+            keys[i] = sepKey;
+        } else {
+            prefixes[i] = parent->_prefixes[j];
+            keys[i] = parent->_keys[j++];
+        }
+    }
+
+    for (int i = 0, j = 0; i <= numKeys; i++) {
+        children[i] = (i == slot + 1) ? right : parent->_children[j++];
+    }
+
+    if (numKeys <= BTREE_ORDER) {
+        for (int i = 0; i < numKeys; i++) {
+            parent->_prefixes[i] = prefixes[i];
+            parent->_keys[i] = keys[i];
+        }
+        for (int i = 0; i <= numKeys; i++) { parent->_children[i] = children[i]; }
+
+        parent->_numKeys = numKeys;
+
+        return;
+    }
+
+    // the middle key moves up rather than being copied, as in every inner split
+    BInner *newRight = new BInner();
+    int middle = BTREE_MIN_KEYS;
+
+    for (int i = 0; i < middle; i++) {
+        parent->_prefixes[i] = prefixes[i];
+        parent->_keys[i] = keys[i];
+        parent->_children[i] = children[i];
+    }
+    parent->_children[middle] = children[middle];
+    parent->_numKeys = middle;
+
+    for (int i = middle + 1; i < numKeys; i++) {
+        newRight->_prefixes[i - middle - 1] = prefixes[i];
+        newRight->_keys[i - middle - 1] = keys[i];
+        newRight->_children[i - middle - 1] = children[i];
+    }
+    newRight->_children[numKeys - middle - 1] = children[numKeys];
+    newRight->_numKeys = numKeys - middle - 1;
+
+    insertIntoParent(path, slots, depth - 1, parent, prefixes[middle], keys[middle], newRight);
+
+    return;
+}
+
+/**
+ * Removes a user with a matching username and discriminator.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @param removed DNode object to hold removed account
+ * @return true if an account was removed, false otherwise
+ */
+bool BTree::removeUser(string username, int disc, DNode*& removed) {
+    if (!this->_root) { return false; }
+
+    BInner *path[MAX_BTREE_DEPTH];
+    int slots[MAX_BTREE_DEPTH];
+    int depth = 0;
+    unsigned long long prefix = packPrefix(username);
+
+    BLeaf *leaf = findLeaf(prefix, username, path, slots, depth);
+    int pos = lowerBound(leaf, prefix, username);
+
+    if (pos == leaf->_numKeys || compareKey(prefix, username, leaf, pos) != 0) {
+        return false;
+    }
+
+    UNode *unode = leaf->_values[pos];
+
+    if (!unode->remove(disc, removed)) { return false; }
+    if (unode->getNumUsers()) { return true; }
+
+    // the username is empty, so take it out of the leaf
+    delete unode;
+    delete leaf->_keys[pos];
+
+    for (int i = pos + 1; i < leaf->_numKeys; i++) {
+        leaf->_prefixes[i - 1] = leaf->_prefixes[i];
+        leaf->_keys[i - 1] = leaf->_keys[i];
+        leaf->_values[i - 1] = leaf->_values[i];
+    }
+
+    leaf->_numKeys--;
+    fixUnderflow(path, slots, depth, leaf);
+
+    return true;
+}
+
+// preconditions: a key was removed from node, whose ancestors are path[0..depth)
+// postconditions: if node is under half full, it borrows a key from a sibling or is
+//                 merged into one, continuing up the path; an empty root is dropped
+void BTree::fixUnderflow(BInner **path, int *slots, int depth, BNode *node) {
+    if (depth == 0) {
+        // an empty leaf root empties the tree, an inner root without keys hands
+        // the tree to its only child
+        if (node->_numKeys == 0 && node->_leaf) {
+            this->_root = nullptr;
+            this->_head = nullptr;
+            delete static_cast<BLeaf*>(node);
+        } else if (node->_numKeys == 0) {
+            this->_root = static_cast<BInner*>(node)->_children[0];
+            delete static_cast<BInner*>(node);
+        }
+
+        return;
+    }
+
+    if (node->_numKeys >= BTREE_MIN_KEYS) { return; }
+
+    BInner *parent = path[depth - 1];
+    int slot = slots[depth - 1];
+    BNode *left = (slot > 0) ? parent->_children[slot - 1] : nullptr;
+    BNode *right = (slot < parent->_numKeys) ? parent->_children[slot + 1] : nullptr;
+
+    if (node->_leaf) {
+        BLeaf *leaf = static_cast<BLeaf*>(node);
+
+        if (left && left->_numKeys > BTREE_MIN_KEYS) {
+            // take the left sibling's last key; it becomes this leaf's separator
+            BLeaf *from = static_cast<BLeaf*>(left);
+            int last = --from->_numKeys;
+
+            for (int i = leaf->_numKeys; i > 0; i--) {
+                leaf->_prefixes[i] = leaf->_prefixes[i - 1];
+                leaf->_keys[i] = leaf->_keys[i - 1];
+                leaf->_values[i] = leaf->_values[i - 1];
+            }
+
+            leaf->_prefixes[0] = from->_prefixes[last];
+            leaf->_keys[0] = from->_keys[last];
+            leaf->_values[0] = from->_values[last];
+            leaf->_numKeys++;
+
+            delete parent->_keys[slot - 1];
+            parent->_prefixes[slot - 1] = leaf->_prefixes[0];
+            parent->_keys[slot - 1] = new string(*leaf->_keys[0]);
+
+            return;
+        }
+
+        if (right && right->_numKeys > BTREE_MIN_KEYS) {
+            // take the right sibling's first key; its new first key is its separator
+            BLeaf *from = static_cast<BLeaf*>(right);
+
+            leaf->_prefixes[leaf->_numKeys] = from->_prefixes[0];
+            leaf->_keys[leaf->_numKeys] = from->_keys[0];
+            leaf->_values[leaf->_numKeys] = from->_values[0];
+            leaf->_numKeys++;
+
+            for (int i = 1; i < from->_numKeys; i++) {
+                from->_prefixes[i - 1] = from->_prefixes[i];
+                from->_keys[i - 1] = from->_keys[i];
+                from->_values[i - 1] = from->_values[i];
+            }
+            from->_numKeys--;
+
+            delete parent->_keys[slot];
+            parent->_prefixes[slot] = from->_prefixes[0];
+            parent->_keys[slot] = new string(*from->_keys[0]);
+
+            return;
+        }
+
+        // neither sibling can spare a key, so merge with one of them
+        int sepIndex = (left) ? slot - 1 : slot;
+        BLeaf *into = static_cast<BLeaf*>((left) ? left : node);
+        BLeaf *from = static_cast<BLeaf*>((left) ? node : right);
+
+        for (int i = 0; i < from->_numKeys; i++) {
+            into->_prefixes[into->_numKeys + i] = from->_prefixes[i];
+            into->_keys[into->_numKeys + i] = from->_keys[i];
+            into->_values[into->_numKeys + i] = from->_values[i];
+        }
+        into->_numKeys += from->_numKeys;
+
+        into->_next = from->_next;
+        if (into->_next) { into->_next->_prev = into; }
+
+        delete parent->_keys[sepIndex];
+        removeFromInner(parent, sepIndex);
+        delete from;
+    } else {
+        BInner *inner = static_cast<BInner*>(node);
+
+        if (left && left->_numKeys > BTREE_MIN_KEYS) {
+            // rotate right through the parent: its separator comes down in front,
+            // the left sibling's last key goes up in its place
+            BInner *from = static_cast<BInner*>(left);
+            int last = --from->_numKeys;
+
+            inner->_children[inner->_numKeys + 1] = inner->_children[inner->_numKeys];
+            for (int i = inner->_numKeys; i > 0; i--) {
+                inner->_prefixes[i] = inner->_prefixes[i - 1];
+                inner->_keys[i] = inner->_keys[i - 1];
+                inner->_children[i] = inner->_children[i - 1];
+            }
+
+            inner->_prefixes[0] = parent->_prefixes[slot - 1];
+            inner->_keys[0] = parent->_keys[slot - 1];
+            inner->_children[0] = from->_children[last + 1];
+            inner->_numKeys++;
+
+            parent->_prefixes[slot - 1] = from->_prefixes[last];
+            parent->_keys[slot - 1] = from->_keys[last];
+
+            return;
+        }
+
+        if (right && right->_numKeys > BTREE_MIN_KEYS) {
+            // rotate left through the parent
+            BInner *from = static_cast<BInner*>(right);
+
+            inner->_prefixes[inner->_numKeys] = parent->_prefixes[slot];
+            inner->_keys[inner->_numKeys] = parent->_keys[slot];
+            inner->_children[inner->_numKeys + 1] = from->_children[0];
+            inner->_numKeys++;
+
+            parent->_prefixes[slot] = from->_prefixes[0];
+            parent->_keys[slot] = from->_keys[0];
+
+            for (int i = 1; i < from->_numKeys; i++) {
+                from->_prefixes[i - 1] = from->_prefixes[i];
+                from->_keys[i - 1] = from->_keys[i];
+            }
+            for (int i = 1; i <= from->_numKeys; i++) {
+                from->_children[i - 1] = from->_children[i];
+            }
+            from->_numKeys--;
+
+            return;
+        }
+
+        // merge: the separator comes down between the two nodes' keys
+        int sepIndex = (left) ? slot - 1 : slot;
+        BInner *into = static_cast<BInner*>((left) ? left : node);
+        BInner *from = static_cast<BInner*>((left) ? node : right);
+
+        into->_prefixes[into->_numKeys] = parent->_prefixes[sepIndex];
+        into->_keys[into->_numKeys] = parent->_keys[sepIndex];
+        into->_numKeys++;
+
+        for (int i = 0; i < from->_numKeys; i++) {
+            into->_prefixes[into->_numKeys + i] = from->_prefixes[i];
+            into->_keys[into->_numKeys + i] = from->_keys[i];
+        }
+        for (int i = 0; i <= from->_numKeys; i++) {
+            into->_children[into->_numKeys + i] = from->_children[i];
+        }
+        into->_numKeys += from->_numKeys;
+
+        removeFromInner(parent, sepIndex);
+        delete from;
+    }
+
+    fixUnderflow(path, slots, depth - 1, parent);
+
+    return;
+}
+
+// preconditions: the child right of keyIndex was merged away
+// postconditions: the key and that child are dropped from node, the key is not deleted
+void BTree::removeFromInner(BInner *node, int keyIndex) {
+    for (int i = keyIndex + 1; i < node->_numKeys; i++) {
+        node->_prefixes[i - 1] = node->_prefixes[i];
+        node->_keys[i - 1] = node->_keys[i];
+    }
+
+    for (int i = keyIndex + 2; i <= node->_numKeys; i++) {
+        node->_children[i - 1] = node->_children[i];
+    }
+
+    node->_numKeys--;
+
+    return;
+}
+
+/**
+ * Retrieves a set of users within a UNode.
+ * @param username username to match
+ * @return UNode with a matching username, nullptr otherwise
+ */
+UNode* BTree::retrieve(string username) {
+    return find(username);
+}
+
+/**
+ * Retrieves the specified Account within a DNode.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return DNode with a matching username and discriminator, nullptr otherwise
+ */
+DNode* BTree::retrieveUser(string username, int disc) {
+    UNode *unode = find(username);
+
+    return (unode) ? unode->findDisc(disc) : nullptr;
+}
+
+/**
+ * Returns the number of users with a specific username.
+ * @param username username to match
+ * @return number of users with the specified username
+ */
+int BTree::numUsers(string username) {
+    UNode *unode = find(username);
+
+    return (unode) ? unode->getNumUsers() : 0;
+}
+
+/**
+ * Helper for the destructor to clear dynamic memory.
+ */
+void BTree::clear() {
+    if (this->_root) {
+        clear(this->_root);
+    }
+
+    this->_root = nullptr;
+    this->_head = nullptr;
+
+    return;
+}
+
+// preconditions: the clear() shell is called
+// postconditions: every node, key, and UNode in this subtree is deallocated
+void BTree::clear(BNode *node) {
+    for (int i = 0; i < node->_numKeys; i++) {
+        delete node->_keys[i];
+    }
+
+    if (node->_leaf) {
+        BLeaf *leaf = static_cast<BLeaf*>(node);
+        for (int i = 0; i < leaf->_numKeys; i++) { delete leaf->_values[i]; }
+
+        delete leaf;
+    } else {
+        BInner *inner = static_cast<BInner*>(node);
+        for (int i = 0; i <= inner->_numKeys; i++) { clear(inner->_children[i]); }
+
+        delete inner;
+    }
+
+    return;
+}
+
+/**
+ * Prints all accounts' details within every DTree, in username order.
+ */
+void BTree::printUsers() const {
+    if (!this->_head) {
+        cout << "No accounts stored." << endl;
+        return;
+    }
+
+    // the leaves are linked, so an in order walk never goes back up the tree
+    for (BLeaf *leaf = this->_head; leaf; leaf = leaf->_next) {
+        for (int i = 0; i < leaf->_numKeys; i++) {
+            leaf->_values[i]->getDTree()->printAccounts();
+        }
+    }
+
+    return;
+}
+
+/**
+ * Visits, in order, every UNode whose username starts with a prefix.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching UNode and its number of users
+ * @param limit maximum number of UNodes to visit, NO_LIMIT to visit all of them
+ * @return number of UNodes visited
+ */
+int BTree::forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit) const {
+    if (!this->_root) { return 0; }
+
+    BInner *path[MAX_BTREE_DEPTH];
+    int slots[MAX_BTREE_DEPTH];
+    int depth = 0;
+    int visited = 0;
+    unsigned long long packed = packPrefix(prefix);
+
+    // start at the prefix's lower bound and follow the leaf links from there
+    BLeaf *leaf = findLeaf(packed, prefix, path, slots, depth);
+    int index = lowerBound(leaf, packed, prefix);
+
+    while (leaf && visited != limit) {
+        if (index == leaf->_numKeys) {
+            leaf = leaf->_next;
+            index = 0;
+            continue;
+        }
+
+        if (leaf->_keys[index]->compare(0, prefix.length(), prefix) != 0) { break; }
+
+        UNode *unode = leaf->_values[index++];
+        visitor(unode, unode->getNumUsers());
+        visited++;
+    }
+
+    return visited;
+}
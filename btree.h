@@ -0,0 +1,82 @@
+/***************************
+* File:     btree.h
+* Project:  Project 2
+*
+* Header definition of BTree class.
+***************************/
+#pragma once
+
+#include "utree.h"
+
+#define BTREE_ORDER 16                  /* keys per node, 16 packed prefixes fill two cache lines */
+#define BTREE_MIN_KEYS (BTREE_ORDER / 2)
+#define BTREE_PREFIX_BYTES 8
+#define MAX_BTREE_DEPTH 32
+#define CACHE_LINE_SIZE 64
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Common part of every node. Keys are compared by their first 8 bytes packed
+ * big endian into _prefixes, and only fall back to the full string on a tie. */
+struct alignas(CACHE_LINE_SIZE) BNode {
+    bool _leaf;
+    int _numKeys;
+    unsigned long long _prefixes[BTREE_ORDER];
+    string* _keys[BTREE_ORDER];         // owned by the node
+
+    BNode(bool leaf): _leaf(leaf), _numKeys(0) {}
+};
+
+/* Leaves hold the UNode (and through it the DTree) of each username and are
+ * linked in key order for scans */
+struct BLeaf : BNode {
+    UNode* _values[BTREE_ORDER];
+    BLeaf* _prev;
+    BLeaf* _next;
+
+    BLeaf(): BNode(true), _prev(nullptr), _next(nullptr) {}
+};
+
+/* _keys[i] is the smallest key under _children[i + 1] */
+struct BInner : BNode {
+    BNode* _children[BTREE_ORDER + 1];
+
+    BInner(): BNode(false) {}
+};
+
+/* B+tree over usernames. Offers the same operations as UTree. */
+class BTree : public UserIndex {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    BTree():_root(nullptr), _head(nullptr){}
+    ~BTree();
+
+    /* Basic operations */
+    bool insert(Account newAcct) override;
+    bool removeUser(string username, int disc, DNode*& removed) override;
+    UNode* retrieve(string username) override;
+    DNode* retrieveUser(string username, int disc) override;
+    int numUsers(string username) override;
+    void clear() override;
+    void printUsers() const override;
+    int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const override;
+
+private:
+    BNode* _root;
+    BLeaf* _head;   // leftmost leaf
+
+    static unsigned long long packPrefix(const string& key);
+    static int compareKey(unsigned long long prefix, const string& key, BNode *node, int index);
+    static int lowerBound(BNode *node, unsigned long long prefix, const string& key);
+    static int upperBound(BNode *node, unsigned long long prefix, const string& key);
+    BLeaf* findLeaf(unsigned long long prefix, const string& key, BInner **path, int *slots, int &depth) const;
+    UNode* find(const string& key) const;
+    void insertIntoParent(BInner **path, int *slots, int depth, BNode *left,
+                          unsigned long long sepPrefix, string *sepKey, BNode *right);
+    void fixUnderflow(BInner **path, int *slots, int depth, BNode *node);
+    void removeFromInner(BInner *node, int keyIndex);
+    void clear(BNode *node);
+};
@@ -79,7 +79,7 @@ bool DTree::insert(Account newAcct) {
 
     // given that the root exists, check if it is vacant and insert into it if it is
     if (this->_root) {
-        if (this->_root->isVacant() && !this->retrieve(insertMe->getDiscriminator())) {
+        if (this->_root->isVacant() && checkReplacementCandidacy(this->_root, insertMe)) {
             this->_root = replaceVacant(this->_root, insertMe);
             replacedRoot = true;
         }
@@ -97,8 +97,8 @@ bool DTree::insert(Account newAcct) {
 
     // return the inserted node container as a boolean. if we inserted, a DNode
     // is stored here and true is returned, otherwise the node container is nullptr
-    // and is false
-    return inserted;
+    // and is false. filling the vacant root is an insertion too
+    return inserted || replacedRoot;
 }
 
 DNode* DTree::insert(DNode *currNode, DNode *insertMe) {
@@ -114,6 +114,7 @@ DNode* DTree::insert(DNode *currNode, DNode *insertMe) {
             if (currNode->_left->isVacant()) {
                 if (checkReplacementCandidacy(currNode->_left, insertMe)) {
                     currNode->_left = replaceVacant(currNode->_left, insertMe);
+                    updateNumVacant(currNode);
                     return currNode;
                 }
             }
@@ -134,6 +135,7 @@ DNode* DTree::insert(DNode *currNode, DNode *insertMe) {
             if (currNode->_right->isVacant()) {
                 if (checkReplacementCandidacy(currNode->_right, insertMe)) {
                     currNode->_right = replaceVacant(currNode->_right, insertMe);
+                    updateNumVacant(currNode);
                     return currNode;
                 }
             }
@@ -149,8 +151,10 @@ DNode* DTree::insert(DNode *currNode, DNode *insertMe) {
         return nullptr;
     }
 
-    // update the size of the current node, given that an insertion happened
+    // update the size of the current node, given that an insertion happened. a
+    // vacancy may have been filled further down, so the vacant count can change too
     updateSize(currNode);
+    updateNumVacant(currNode);
 
     // rebalance the current node if need be and return it/the new root as the DNode that
     // will be set equal to the previous node's right/left ptr
@@ -166,12 +170,20 @@ bool DTree::checkReplacementCandidacy(DNode *vacantNode, DNode *replacement) {
     // else do nothing and return the vacant node
     if (!this->retrieve(replacement->getDiscriminator())) {
 
-        // get the discriminator of the child nodes if they exist, otherwise get the max values
-        int leftDisc = (vacantNode->_left) ? vacantNode->_left->getDiscriminator() : 0;
-        int rightDisc = (vacantNode->_right) ? vacantNode->_right->getDiscriminator() : MAX_DISC;
+        // get the largest discriminator of the left subtree and the smallest of the
+        // right subtree if they exist, otherwise get the min/max values. vacant nodes
+        // still order the tree, so they count too
+        DNode *leftMax = vacantNode->_left;
+        DNode *rightMin = vacantNode->_right;
+
+        while (leftMax && leftMax->_right) { leftMax = leftMax->_right; }
+        while (rightMin && rightMin->_left) { rightMin = rightMin->_left; }
+
+        int leftDisc = (leftMax) ? leftMax->getDiscriminator() : MIN_DISC - 1;
+        int rightDisc = (rightMin) ? rightMin->getDiscriminator() : MAX_DISC + 1;
 
         // verify that the tree's order will be maintained for this node to be inserted
-        if (replacement->getDiscriminator() >= leftDisc && replacement->getDiscriminator() <= rightDisc) {
+        if (replacement->getDiscriminator() > leftDisc && replacement->getDiscriminator() < rightDisc) {
             return true;
         }
     }
@@ -260,6 +272,79 @@ DNode* DTree::retrieve(int disc) {
     return nullptr;
 }
 
+/**
+ * Retrieves one account from each of several trees, advancing every search a level
+ * at a time and prefetching each one's next node, so that the cache misses of
+ * different searches overlap instead of following one another.
+ * @param trees tree to search for each account, nullptr for none
+ * @param discs discriminator to search for in each tree
+ * @param count number of searches, at most BATCH_GROUP_SIZE
+ * @param results DNode with each matching discriminator, nullptr where there is none
+ */
+void DTree::retrieveBatch(DTree *const *trees, const int *discs, int count, DNode **results) {
+    int active[BATCH_GROUP_SIZE];
+    int numActive = 0;
+
+    // each result holds its search's current node until the search ends
+    for (int i = 0; i < count; i++) {
+        results[i] = (trees[i]) ? trees[i]->_root : nullptr;
+
+        if (results[i]) {
+            prefetchObject(results[i], sizeof(DNode));
+            active[numActive++] = i;
+        }
+    }
+
+    while (numActive > 0) {
+        int stillActive = 0;
+
+        for (int j = 0; j < numActive; j++) {
+            int i = active[j];
+            DNode *node = results[i];
+
+            // as in retrieve(), a vacant match is no match
+            if (discs[i] == node->getDiscriminator()) {
+                if (node->isVacant()) { results[i] = nullptr; }
+                continue;
+            }
+
+            DNode *next = (discs[i] < node->getDiscriminator()) ? node->_left : node->_right;
+            results[i] = next;
+
+            if (next) {
+                prefetchObject(next, sizeof(DNode));
+                active[stillActive++] = i;
+            }
+        }
+
+        numActive = stillActive;
+    }
+
+    return;
+}
+
+/**
+ * Retrieves an account as a coroutine that suspends after prefetching each node,
+ * see UTree::retrieveUserAsync(). The tree must not change until it is done.
+ * @param disc discriminator to match
+ * @return lookup giving what retrieve() would return
+ */
+ULookup<DNode*> DTree::retrieveAsync(int disc) {
+    DNode *currNode = this->_root;
+
+    while (currNode) {
+        co_await UPrefetch{currNode, sizeof(DNode)};
+
+        // as in retrieve(), a vacant match is no match
+        if (disc == currNode->getDiscriminator()) {
+            co_return (currNode->isVacant()) ? nullptr : currNode;
+        }
+        currNode = (disc < currNode->getDiscriminator()) ? currNode->_left : currNode->_right;
+    }
+
+    co_return nullptr;
+}
+
 // preconditions: the outer retrieve() shell is called and root is passed into this helper
 // postconditions: the node with the discriminator that matches the passed arg
 //                 is returned, else nullptr
@@ -303,6 +388,399 @@ void DTree::clear() {
     return;
 }
 
+/**
+ * Replaces the tree's contents with a run of accounts, building a perfectly
+ * balanced tree in one pass rather than inserting them one by one.
+ * @param accts accounts sorted by discriminator without duplicates, moved from
+ * @param count number of accounts in accts
+ */
+void DTree::assign(Account *accts, int count) {
+    clear();
+    if (count <= 0) { return; }
+
+    DNode **arr = new DNode*[count];
+
+    for (int i = 0; i < count; i++) {
+        arr[i] = new DNode(std::move(accts[i]));
+    }
+
+    this->_root = arrToTree(arr, 0, count - 1);
+    delete[] arr;
+
+    return;
+}
+
+/**
+ * Replaces the tree's contents with accounts picked out of a larger array, like
+ * assign() but without gathering them into a run first.
+ * @param accts accounts to pick from; the ones picked are moved from
+ * @param order indices into accts of the accounts, sorted by discriminator without duplicates
+ * @param count number of indices in order
+ */
+void DTree::assign(Account *accts, const int *order, int count) {
+    clear();
+    if (count <= 0) { return; }
+
+    DNode **arr = new DNode*[count];
+
+    for (int i = 0; i < count; i++) {
+        arr[i] = new DNode(std::move(accts[order[i]]));
+    }
+
+    this->_root = arrToTree(arr, 0, count - 1);
+    delete[] arr;
+
+    return;
+}
+
+/**
+ * Moves every account of another DTree into this one in a single linear pass,
+ * leaving both perfectly balanced without vacant nodes. As with insert(), an
+ * account whose discriminator is already taken here is rejected.
+ * @param other tree to take the accounts of, left empty
+ * @return number of accounts taken from other
+ */
+int DTree::merge(DTree& other) {
+    if (&other == this || !other._root) { return 0; }
+
+    int thisCount = 0, otherCount = 0, count = 0, taken = 0;
+    DNode **thisArr = new DNode*[this->_root ? this->_root->getSize() : 0];
+    DNode **otherArr = new DNode*[other._root->getSize()];
+
+    // both trees flatten to their occupied nodes in discriminator order
+    treeToArr(this->_root, thisArr, thisCount);
+    treeToArr(other._root, otherArr, otherCount);
+    this->_root = nullptr;
+    other._root = nullptr;
+
+    DNode **arr = new DNode*[thisCount + otherCount];
+
+    for (int i = 0, j = 0; i < thisCount || j < otherCount;) {
+        if (j == otherCount || (i < thisCount && thisArr[i]->getDiscriminator() < otherArr[j]->getDiscriminator())) {
+            arr[count++] = thisArr[i++];
+        } else if (i == thisCount || otherArr[j]->getDiscriminator() < thisArr[i]->getDiscriminator()) {
+            arr[count++] = otherArr[j++];
+            taken++;
+        } else {
+            // the same discriminator in both, so the existing account stays
+            delete otherArr[j++];
+        }
+    }
+
+    this->_root = arrToTree(arr, 0, count - 1);
+
+    delete [] thisArr;
+    delete [] otherArr;
+    delete [] arr;
+
+    return taken;
+}
+
+/**
+ * Applies a run of insertions and removals of this tree's username. A run that is
+ * short next to the tree goes through insert() and remove() one by one; otherwise
+ * the tree is merged with it in one linear pass and rebuilt once, perfectly balanced
+ * without vacant nodes. Either way the operations take effect in order, and unlike
+ * remove(), which also succeeds on a vacant node until a rebalance drops it, removing
+ * an account that is not there always fails.
+ * @param ops operations of a batch
+ * @param order indices into ops of this run, sorted by discriminator and otherwise in
+ *              the order the operations were given
+ * @param count number of indices in order
+ * @param results gets each operation's outcome at its index
+ * @return number of accounts in the tree afterwards
+ */
+int DTree::applyBatch(const AccountOp *ops, const int *order, int count, AccountOpResult *results) {
+    int size = (this->_root) ? this->_root->getSize() : 0;
+
+    if (count * BATCH_REBUILD_RATIO < size) {
+        for (int i = 0; i < count; i++) {
+            const AccountOp& op = ops[order[i]];
+            AccountOpResult& result = results[order[i]];
+
+            int disc = op.account.getDiscriminator();
+
+            result.removed = nullptr;
+            if (op.type == AccountOp::INSERT) {
+                result.applied = insert(op.account);
+            } else {
+                result.applied = retrieve(disc) && remove(disc, result.removed);
+            }
+        }
+
+        return this->_root->getSize() - this->_root->getNumVacant();
+    }
+
+    // every node, vacant ones too, which are dropped along the way
+    DNode **nodes = new DNode*[size];
+    DNode **arr = new DNode*[size + count];
+    int numNodes = 0, numKept = 0;
+
+    flatten(this->_root, nodes, numNodes);
+    this->_root = nullptr;
+
+    for (int i = 0, j = 0; i < numNodes || j < count;) {
+        int disc = (i < numNodes) ? nodes[i]->getDiscriminator() : MAX_DISC + 1;
+        if (j < count) { disc = std::min(disc, ops[order[j]].account.getDiscriminator()); }
+
+        // the node holding this discriminator, preferring an occupied one to a vacant one
+        DNode *node = nullptr;
+        for (; i < numNodes && nodes[i]->getDiscriminator() == disc; i++) {
+            if (!node || (node->isVacant() && !nodes[i]->isVacant())) {
+                if (node) { delete node; }
+                node = nodes[i];
+            } else {
+                delete nodes[i];
+            }
+        }
+
+        // its operations, in the order they were given
+        for (; j < count && ops[order[j]].account.getDiscriminator() == disc; j++) {
+            const AccountOp& op = ops[order[j]];
+            AccountOpResult& result = results[order[j]];
+            result.applied = false;
+            result.removed = nullptr;
+
+            if (op.type == AccountOp::INSERT) {
+                if (!node || node->isVacant()) {
+                    delete node;
+                    node = new DNode(op.account);
+                    result.applied = true;
+                }
+            } else if (node && !node->isVacant()) {
+                // as in remove(), the caller gets a copy of the node made vacant
+                node->_vacant = true;
+                result.removed = new DNode();
+                *result.removed = *node;
+                result.applied = true;
+            }
+        }
+
+        if (node && node->isVacant()) {
+            delete node;
+        } else if (node) {
+            arr[numKept++] = node;
+        }
+    }
+
+    this->_root = arrToTree(arr, 0, numKept - 1);
+
+    delete [] nodes;
+    delete [] arr;
+
+    return numKept;
+}
+
+/**
+ * Inserts an account into a copy of this tree, leaving this tree as it is. Only
+ * the path to the new account is copied, along with any subtree insert() would
+ * have rebuilt, so readers of this tree never see it change.
+ * @param newAcct Account object to be inserted
+ * @param result empty tree that takes the copy if the account was inserted
+ * @param replaced collects the nodes of this tree the copy does not use
+ * @return true if the account was inserted, false otherwise
+ */
+bool DTree::insertCopy(Account newAcct, DTree& result, std::vector<DNode*>& replaced) {
+    DNode *insertMe = new DNode(newAcct);
+    std::unordered_set<DNode*> fresh = {insertMe};
+
+    // a vacant root is filled the same way insert() fills it
+    if (this->_root && this->_root->isVacant() && checkReplacementCandidacy(this->_root, insertMe)) {
+        result._root = replaceVacantCopy(this->_root, insertMe, replaced);
+        return true;
+    }
+
+    DNode *root = insertCopy(this->_root, insertMe, fresh, replaced);
+
+    if (!root) {
+        delete insertMe;
+        return false;
+    }
+
+    result._root = root;
+
+    return true;
+}
+
+// preconditions: insertCopy() is called and root is passed into this helper
+// postconditions: returns the root of a copy of this subtree holding insertMe, or
+//                 nullptr without copying anything if the discriminator is taken
+DNode* DTree::insertCopy(DNode *currNode, DNode *insertMe, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced) {
+    if (!currNode) { return insertMe; }
+    if (insertMe->getDiscriminator() == currNode->getDiscriminator()) { return nullptr; }
+
+    bool goLeft = insertMe->getDiscriminator() < currNode->getDiscriminator();
+    DNode *child = (goLeft) ? currNode->_left : currNode->_right;
+    DNode *node = nullptr;
+
+    // a vacant child takes the account the same way insert() fills it
+    if (child && child->isVacant() && checkReplacementCandidacy(child, insertMe)) {
+        node = copyNode(currNode, replaced);
+        fresh.insert(node);
+        ((goLeft) ? node->_left : node->_right) = replaceVacantCopy(child, insertMe, replaced);
+        updateNumVacant(node);
+        return node;
+    }
+
+    DNode *inserted = insertCopy(child, insertMe, fresh, replaced);
+    if (!inserted) { return nullptr; }
+
+    node = copyNode(currNode, replaced);
+    fresh.insert(node);
+    ((goLeft) ? node->_left : node->_right) = inserted;
+    updateSize(node);
+    updateNumVacant(node);
+
+    return rebalanceCopy(node, fresh, replaced);
+}
+
+// preconditions: called on insertCopy() when checkReplacementCandidacy() returns true
+// postconditions: like replaceVacant(), but the vacant node is left whole in replaced
+DNode* DTree::replaceVacantCopy(DNode *vacantNode, DNode *replacement, std::vector<DNode*>& replaced) {
+    replacement->_left = vacantNode->_left;
+    replacement->_right = vacantNode->_right;
+    replacement->_size = vacantNode->_size;
+    replaced.push_back(vacantNode);
+
+    updateNumVacant(replacement);
+
+    return replacement;
+}
+
+// preconditions: node was made by this change
+// postconditions: like rebalance(), but nodes shared with the original tree are copied
+//                 into the rebuilt subtree rather than relinked
+DNode* DTree::rebalanceCopy(DNode *node, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced) {
+    if (!checkImbalance(node)) { return node; }
+
+    int arrSize = node->getSize() - node->getNumVacant();
+    DNode **arr = new DNode*[arrSize];
+    int index = 0;
+
+    treeToArrCopy(node, arr, index, fresh, replaced);
+    node = arrToTree(arr, 0, arrSize - 1);
+    delete [] arr;
+
+    return node;
+}
+
+// preconditions: rebalanceCopy() found an imbalance
+// postconditions: the occupied nodes of the subtree are put into arr in order, shared
+//                 ones as copies; vacant nodes made by this change are deleted and
+//                 shared ones left in replaced
+void DTree::treeToArrCopy(DNode *node, DNode **arr, int &index, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced) {
+    if (!node) { return; }
+    DNode *nodeRight = node->_right;
+    bool isFresh = fresh.count(node);
+
+    treeToArrCopy(node->_left, arr, index, fresh, replaced);
+
+    if (!node->isVacant()) {
+        if (!isFresh) {
+            node = copyNode(node, replaced);
+            fresh.insert(node);
+        }
+        arr[index++] = node;
+    } else if (isFresh) {
+        fresh.erase(node);
+        delete node;
+    } else {
+        replaced.push_back(node);
+    }
+
+    treeToArrCopy(nodeRight, arr, index, fresh, replaced);
+
+    return;
+}
+
+/**
+ * Removes an account from a copy of this tree, leaving this tree as it is. Only
+ * the path to the account is copied, and the account's copy is made vacant.
+ * @param disc discriminator to match
+ * @param removed DNode object to hold removed account
+ * @param result empty tree that takes the copy, and stays empty if the tree held
+ *               no other account
+ * @param replaced collects the nodes of this tree the copy does not use
+ * @return true if an account was removed, false otherwise
+ */
+bool DTree::removeCopy(int disc, DNode*& removed, DTree& result, std::vector<DNode*>& replaced) {
+    std::vector<DNode*> fresh;
+    size_t numReplaced = replaced.size();
+    DNode *root = removeCopy(this->_root, disc, removed, fresh, replaced);
+
+    if (!root) { return false; }
+
+    // without a single occupied node the copy is worthless, and every node of
+    // this tree is left behind instead
+    if (root->getSize() == root->getNumVacant()) {
+        for (DNode *node : fresh) { delete node; }
+        replaced.resize(numReplaced);
+        collectNodes(this->_root, replaced);
+        return true;
+    }
+
+    result._root = root;
+
+    return true;
+}
+
+// preconditions: removeCopy() is called and root is passed into this helper
+// postconditions: returns the root of a copy of this subtree with the node made
+//                 vacant, the same as remove(), or nullptr if there was no such node
+DNode* DTree::removeCopy(DNode *currNode, int disc, DNode *&removed, std::vector<DNode*>& fresh, std::vector<DNode*>& replaced) {
+    if (!currNode) { return nullptr; }
+
+    DNode *node = nullptr;
+
+    if (disc != currNode->getDiscriminator()) {
+        bool goLeft = disc < currNode->getDiscriminator();
+        DNode *child = removeCopy((goLeft) ? currNode->_left : currNode->_right, disc, removed, fresh, replaced);
+        if (!child) { return nullptr; }
+
+        node = copyNode(currNode, replaced);
+        ((goLeft) ? node->_left : node->_right) = child;
+    } else {
+        node = copyNode(currNode, replaced);
+        node->_vacant = true;
+
+        removed = new DNode();
+        *removed = *node;
+    }
+
+    fresh.push_back(node);
+    updateNumVacant(node);
+
+    return node;
+}
+
+// preconditions: node belongs to a tree being path copied
+// postconditions: a copy of node, with the same children, is returned and node is
+//                 added to replaced
+DNode* DTree::copyNode(DNode *node, std::vector<DNode*>& replaced) {
+    DNode *copy = new DNode(node->_account);
+    copy->_size = node->_size;
+    copy->_numVacant = node->_numVacant;
+    copy->_vacant = node->_vacant;
+    copy->_left = node->_left;
+    copy->_right = node->_right;
+
+    replaced.push_back(node);
+
+    return copy;
+}
+
+// preconditions: none
+// postconditions: every node of this subtree is appended to nodes
+void DTree::collectNodes(DNode *node, std::vector<DNode*>& nodes) {
+    if (!node) { return; }
+
+    nodes.push_back(node);
+    collectNodes(node->_left, nodes);
+    collectNodes(node->_right, nodes);
+
+    return;
+}
+
 // preconditions: the outer clear() shell is called and root is passed into this function
 // postconditions: the entire tree is deallocated
 void DTree::clear(DNode *currNode) {
@@ -334,6 +812,36 @@ void DTree::printAccounts() const {
     return;
 }
 
+/**
+ * Visits every account in the tree in discriminator order, skipping vacant nodes.
+ * @param visit called with each account
+ */
+void DTree::forEachAccount(const std::function<void(const Account&)>& visit) const {
+    if (this->_root) {
+        this->_root->visitAccounts(visit);
+    }
+
+    return;
+}
+
+// preconditions: the outer shell of forEachAccount() is called and root exists
+// postconditions: visit is called on each non-vacant node's account in order
+void DNode::visitAccounts(const std::function<void(const Account&)>& visit) const {
+    if (this->_left) {
+        this->_left->visitAccounts(visit);
+    }
+
+    if (!this->_vacant) {
+        visit(this->_account);
+    }
+
+    if (this->_right) {
+        this->_right->visitAccounts(visit);
+    }
+
+    return;
+}
+
 // preconditions: the outer shell of printAccounts() is called and root exists
 // postconditions: the details each node's account is printed in order
 void DNode::printAccount() const {
@@ -343,7 +851,8 @@ void DNode::printAccount() const {
         this->_left->printAccount();
     }
 
-    cout << this->getAccount() << endl;
+    // '\n' rather than endl, so a large tree isn't flushed once per account
+    cout << this->_account << '\n';
 
     // after printing this node and the left ones, do the same for the right nodes
     if (this->_right) {
@@ -422,22 +931,23 @@ int DNode::calcNodeSize() {
  * @param node DNode object in which the number of vacant nodes in the subtree will be updated
  */
 void DTree::updateNumVacant(DNode* node) {
-    // traverse down the tree and update the vacant nodes in the case of a rebalance
-    if (node->_left) {
-        updateNumVacant(node->_left);
-    }
+    // use the node helper function here. every caller updates bottom-up, so the
+    // children's counts are already correct
+    node->calcNodeNumVacant();
 
-    if (node->_right) {
-        updateNumVacant(node->_right);
-    }
+    return;
+}
 
+// preconditions: the outer shell of updateNumVacant() is called on this node
+// postconditions: this node's vacant count is updated and returned
+int DNode::calcNodeNumVacant() {
     // similarly to calcNodeSize, get the number of vacant nodes from the children
-    // and their children if they exist and add them to this node's, else use 0.
-    node->_numVacant = (node->_left) ? node->_left->getNumVacant() : 0;
-    node->_numVacant += (node->_right) ? node->_right->getNumVacant() : 0;
-    node->_numVacant += node->isVacant();
+    // if they exist and add them to this node's, else use 0.
+    this->_numVacant = (this->_left) ? this->_left->getNumVacant() : 0;
+    this->_numVacant += (this->_right) ? this->_right->getNumVacant() : 0;
+    this->_numVacant += this->isVacant();
 
-    return;
+    return this->_numVacant;
 }
 
 /**
@@ -490,10 +1000,8 @@ DNode* DTree::rebalance(DNode *node) {
         // from the conversion from array to tree function
         node = arrToTree(arr, 0, arrSize - 1);
 
-        // update all of the nodes' vacancy values, then delete the array used
-        // to rebalance and return the new subtree's root
-        updateNumVacant(node);
-
+        // arrToTree() already updated every node's size and vacancy values, so
+        // delete the array used to rebalance and return the new subtree's root
         delete [] arr;
     }
 
@@ -522,6 +1030,18 @@ void DTree::treeToArr(DNode *node, DNode **arr, int &index) {
     return;
 }
 
+// preconditions: arr has room for every node of the subtree
+// postconditions: every node of the subtree, vacant or not, is put into arr in order
+void DTree::flatten(DNode *node, DNode **arr, int &index) {
+    if (!node) { return; }
+
+    flatten(node->_left, arr, index);
+    arr[index++] = node;
+    flatten(node->_right, arr, index);
+
+    return;
+}
+
 // preconditions: a subtree was converted into an array
 // postconditions: a new tree is formed from the array by process of recursion
 DNode* DTree::arrToTree(DNode **arr, int leftIndex, int rightIndex) {
@@ -540,6 +1060,7 @@ DNode* DTree::arrToTree(DNode **arr, int leftIndex, int rightIndex) {
     node->_right = arrToTree(arr, middleIndex + 1, rightIndex);
 
     updateSize(node);
+    updateNumVacant(node);
 
     return node;
 }
@@ -12,7 +12,12 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <exception>
+#include <functional>
+#include <vector>
+#include <unordered_set>
+#include "ulookup.h"
 
 using std::cout;
 using std::endl;
@@ -29,6 +34,9 @@ using std::ostream;
 #define DEFAULT_SIZE 1
 #define DEFAULT_NUM_VACANT 0
 
+#define BATCH_GROUP_SIZE 16     /* searches advanced in lock-step by batched lookups */
+#define BATCH_REBUILD_RATIO 16  /* nodes per operation below which a batch rebuilds a DTree */
+
 class Grader;   /* For grading purposes */
 class Tester;   /* Forward declaration for testing class */
 
@@ -46,7 +54,9 @@ public:
         _status = DEFAULT_STATUS;
     }
 
-    Account(string username, int disc, bool nitro, string badge, string status) {
+    /* Fields are taken as views so loaders can pass slices of their input
+     * buffer, which are copied exactly once, into the account */
+    Account(std::string_view username, int disc, bool nitro, std::string_view badge, std::string_view status) {
         if(disc < MIN_DISC || disc > MAX_DISC) {
             throw std::out_of_range("Discriminator out of valid range (" + std::to_string(MIN_DISC)
                                     + "-" + std::to_string(MAX_DISC) + ")");
@@ -59,11 +69,11 @@ public:
     }
 
     /* Getters */
-    string getUsername() const {return _username;}
+    const string& getUsername() const {return _username;}
     int getDiscriminator() const {return _disc;}
     bool hasNitro() const {return _nitro;}
-    string getBadge() const {return _badge;}
-    string getStatus() const {return _status;}
+    const string& getBadge() const {return _badge;}
+    const string& getStatus() const {return _status;}
 
 private:
     string _username;
@@ -76,10 +86,30 @@ private:
 /* Overloaded << operator to print Accounts */
 ostream& operator<<(ostream& sout, const Account& acct);
 
+class DNode;
+
+/* One insertion or removal of a batch, see UTree::applyBatch() */
+struct AccountOp {
+    enum Type {INSERT, REMOVE};
+
+    Type type;
+    Account account;    // the account to insert, or for a removal just its username and discriminator
+
+    static AccountOp insert(Account acct) {return {INSERT, std::move(acct)};}
+    static AccountOp remove(std::string_view username, int disc) {return {REMOVE, Account(username, disc, false, "", "")};}
+};
+
+/* What one AccountOp did */
+struct AccountOpResult {
+    bool applied;       // whether it inserted an account or removed one that was there
+    DNode *removed;     // the account a removal took out, for the caller to delete, else nullptr
+};
+
 class DNode {
     friend class Grader;
     friend class Tester;
     friend class DTree;
+    friend class UCache;
 
 public:
     DNode() {
@@ -91,7 +121,7 @@ public:
     }
 
     DNode(Account account) {
-        _account = account;
+        _account = std::move(account);
         _size = DEFAULT_SIZE;
         _numVacant = DEFAULT_NUM_VACANT;
         _vacant = false;
@@ -118,8 +148,10 @@ private:
     /* IMPLEMENT (optional): any other helper functions */
     int getNumUsers() const;
     void printAccount() const;
+    void visitAccounts(const std::function<void(const Account&)>& visit) const;
     DNode* retrieve(int disc);
     int calcNodeSize();
+    int calcNodeNumVacant();
 };
 
 class DTree {
@@ -137,8 +169,22 @@ public:
     bool insert(Account newAcct);
     bool remove(int disc, DNode*& removed);
     DNode* retrieve(int disc);
+    static void retrieveBatch(DTree *const *trees, const int *discs, int count, DNode **results);
+    ULookup<DNode*> retrieveAsync(int disc);
+    int applyBatch(const AccountOp *ops, const int *order, int count, AccountOpResult *results);
     void clear();
+    void assign(Account *accts, int count);
+    void assign(Account *accts, const int *order, int count);
+    int merge(DTree& other);
+
+    /* Path copying: this tree is left untouched and result, an empty tree, gets a
+     * copy sharing every node the change does not reach. replaced collects this
+     * tree's nodes that result no longer uses, see UTree::enableLockFreeReads() */
+    bool insertCopy(Account newAcct, DTree& result, std::vector<DNode*>& replaced);
+    bool removeCopy(int disc, DNode*& removed, DTree& result, std::vector<DNode*>& replaced);
+    void release() {_root = nullptr;}   // lets go of nodes shared with another tree without freeing them
     void printAccounts() const;
+    void forEachAccount(const std::function<void(const Account&)>& visit) const;
     void dump() const {dump(_root);}
     void dump(DNode* node) const;
 
@@ -161,5 +207,13 @@ private:
     bool remove(DNode *currNode, int disc, DNode *&removed);
     void clear(DNode *node);
     void treeToArr(DNode *node, DNode **arr, int &index);
+    static void flatten(DNode *node, DNode **arr, int &index);
     DNode* arrToTree(DNode **arr, int leftIndex, int rightIndex);
+    DNode* insertCopy(DNode *currNode, DNode *insertMe, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced);
+    DNode* removeCopy(DNode *currNode, int disc, DNode *&removed, std::vector<DNode*>& fresh, std::vector<DNode*>& replaced);
+    DNode* replaceVacantCopy(DNode *vacantNode, DNode *replacement, std::vector<DNode*>& replaced);
+    DNode* rebalanceCopy(DNode *node, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced);
+    void treeToArrCopy(DNode *node, DNode **arr, int &index, std::unordered_set<DNode*>& fresh, std::vector<DNode*>& replaced);
+    static DNode* copyNode(DNode *node, std::vector<DNode*>& replaced);
+    static void collectNodes(DNode *node, std::vector<DNode*>& nodes);
 };
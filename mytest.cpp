@@ -11,7 +11,22 @@
 #include <iostream>
 #include <random>
 #include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <fcntl.h>
+#include <unistd.h>
 #include "utree.h"
+#include "rtree.h"
+#include "btree.h"
+#include "ushard.h"
 
 #define NUMACCTS 20
 #define RANDDISC (distAcct(rng))
@@ -52,11 +67,40 @@ public:
     UNode* getUNodeLeft(UNode*);
     UNode* getUNodeRight(UNode*);
     void putUIntoArr(UTree &obj, vector<UNode*> &arr);
+    bool verifyUHeightValues(UTree&);
+    bool verifyUHashIndex(UTree&);
     void uTreeInsertionTime(int, int);
+    void uTreeHashLookupTime(int, int);
+    string describeAccounts(UTree&);
+
+    RNode* getRRoot(RTree&);
+
+    bool verifyBTree(BTree&);
+    int getBHeight(BTree&);
+    void userIndexTime(int, int);
+    void loadDataTime(int, int);
+    void snapshotTime(int, int);
+    void logTime(int, int);
+    void exportTime(int, int);
+    void mergeTime(int, int);
+    void splitJoinTime(int, int);
+    void concurrencyTime(int, int);
+    void shardedTime(int, int);
+    void lockFreeTime(int, int);
+    void persistenceTime(int, int);
+    void batchLookupTime(int, int);
+    void asyncLookupTime(int, int);
+    void applyBatchTime(int, int);
+    void bloomFilterTime(int, int);
+    void hotCacheTime(int, int);
+    void handleTime(int, int);
 
 private:
     bool verifyDSizes(DTree&, DNode*&);
     bool verifyUHeights(UTree&, UNode*&);
+    int verifyUHeightValues(UNode*, bool&);
+    int verifyUHashIndex(UTree&, UNode*, bool&);
+    int verifyBNode(BNode*, const string*, const string*, bool, vector<string>&, bool&);
     void putDIntoArr(vector<DNode*>&, DNode*&);
     void putUIntoArr(vector<UNode*> &arr, UNode *&node);
 };
@@ -64,11 +108,14 @@ private:
 // see function definitions for details, these should be self explanatory from names though
 Account createAccount(int disc=0, string username="placeholder");
 void assertFinish(bool expr, int &numTests, int &numTestsPassed);
+void copyFile(const string& from, const string& to);
+string describeSnapshot(const USnapshot& snap);
 
 // insertion and retrieval of 5 elems
 // insertion of a node that already exists
 // trigger rebalances
 // insertion into a variety of vacant nodes
+// refilling vacancies, at the root and below it
 void dTreeInsertTests(int&, int&);
 
 // removal and retrieval of a node
@@ -115,9 +162,169 @@ void uTreeRemoveTests(int&, int&);
 // test RL rotation
 void uTreeRotationTests(int&, int&);
 
+// random insertions and removals keep the tree balanced with correct heights
+// retracing stops early on sequential insertions
+// removals that empty UNodes with two children
+void uTreeRetraceTests(int&, int&);
+
+// random insertions and removals keep the index in sync with the tree
+// enabling on a populated tree, then disabling
+void uTreeHashIndexTests(int&, int&);
+
+// prefix matches come back in order with their counts
+// limit stops the walk early
+// prefixes that match nothing, everything, or a whole username
+void uTreePrefixTests(int&, int&);
+
+// random insertions and removals agree with a UTree
+// nodes grow to RNode256 and shrink back down to a leaf
+// usernames that are prefixes of each other
+void rTreeTests(int&, int&);
+
 // testing insertion time
 void uTreeInsertionTimeRun();
 
+// testing lookup time with and without the hash index
+void uTreeHashLookupTimeRun();
+
+// random insertions and removals agree with a UTree and keep B+tree invariants
+// splitting past three levels and merging back down to nothing
+// every backend behaves the same through UserIndex
+void bTreeTests(int&, int&);
+
+// testing every UserIndex backend against each other
+void userIndexTimeRun();
+
+// fields, number formats, and a missing final newline load correctly
+// malformed lines and numbers throw
+// appending versus replacing
+void loadDataTests(int&, int&);
+
+// parallel load matches the serial load for several thread counts
+// appending into a tree with a hash index
+// a malformed file leaves the tree untouched
+void loadDataParallelTests(int&, int&);
+
+// bulk load matches row by row insertion and builds balanced trees
+// bulk load into a tree with a hash index
+void loadDataBulkTests(int&, int&);
+
+// testing csv ingestion throughput
+void loadDataTimeRun();
+
+// round trip of a tree with vacant nodes and an empty tree
+// corrupt, truncated and unsupported snapshots throw and leave the tree alone
+// plain and compressed snapshots hold the same accounts
+void snapshotTests(int&, int&);
+
+// lookups, counts and prefix scans match the tree the image was written from
+// an empty image, a corrupt image, and files that aren't images
+// links out of the file, past its accounts, or into cycles throw rather than being followed
+void imageTests(int&, int&);
+
+// testing snapshot and image load time against csv load time
+void snapshotTimeRun();
+
+// recovery from a log alone, from a snapshot plus a log, and ignoring a stale log
+// a torn final record is dropped and appending carries on after it
+// batches committing only their last record still sync every LOG_BATCH_RECORDS records
+// concurrent commits all reach the log
+void logTests(int&, int&);
+
+// testing mutation throughput under each sync policy
+void logTimeRun();
+
+// csv and binary exports load back into the same tree
+// sinks get whole buffers, an empty tree exports nothing, and a refusing sink stops the export
+void exportTests(int&, int&);
+
+// testing export throughput to memory and to a file descriptor
+void exportTimeRun();
+
+// merging trees with shared usernames, duplicate accounts, vacant nodes and a hash index
+// merging sorted files, and rejecting unsorted ones without touching the tree
+void mergeTests(int&, int&);
+
+// testing merge time against appending row by row
+void mergeTimeRun();
+
+// splitting before, between, on and after usernames, with hash indexes on both sides
+// joining back, joining trees of very different heights, and joining out of order
+void splitJoinTests(int&, int&);
+
+// testing split and join time as the tree grows
+void splitJoinTimeRun();
+
+// threads inserting and removing their own and shared usernames, creating and emptying UNodes
+// readers running alongside writers, and concurrent mutations reaching the log
+void concurrencyTests(int&, int&);
+
+// testing mutation throughput as threads are added
+void concurrencyTimeRun();
+
+// the same accounts, lookups and ordered, prefixed and limited traversals as one UTree
+// both kinds of loadData(), and threads inserting into many shards at once
+void shardedTests(int&, int&);
+
+// testing insertion throughput as threads are added
+void shardedTimeRun();
+
+// path copying through every rotation and replacement, with nodes held across writes
+// readers hammering lookups while one writer churns usernames
+void lockFreeTests(int&, int&);
+
+// testing lookup throughput beside a writer as readers are added, against a locked tree and concurrent mode
+void lockFreeTimeRun();
+
+// snapshots unchanged by later writes, DTree path copies shaped like in place, and releasing
+// readers scanning snapshots over and over beside a writer
+void persistenceTests(int&, int&);
+
+// testing write throughput and memory held while a snapshot is alive
+void persistenceTimeRun();
+
+// batches matching key by key lookups across hits, misses, sizes and empty trees
+// batches in every mode: hash index, concurrent, lock-free and persistent
+void batchLookupTests(int&, int&);
+
+// testing batched against key by key lookup throughput
+void batchLookupTimeRun();
+
+// coroutine lookups matching plain ones across windows, late spawns and dropped lookups
+// coroutine lookups in every mode, including beside a lock-free writer
+void asyncLookupTests(int&, int&);
+
+// testing scheduled coroutine against plain lookup throughput
+void asyncLookupTimeRun();
+
+// batches matching one by one application across new, emptied and large DTree usernames
+// batches in every mode: hash index, concurrent, lock-free, persistent and logged
+void applyBatchTests(int&, int&);
+
+// testing batch against one by one mutation throughput
+void applyBatchTimeRun();
+
+// filtered lookups matching the tree through churn, split, join, merge, load and clear
+// the filter with the hash index, concurrency, batched and coroutine lookups, and lock-free reads
+void bloomFilterTests(int&, int&);
+
+// testing lookup latency with and without the filter
+void bloomFilterTimeRun();
+
+// cached lookups matching the tree through churn, batches, split, join, merge, load and clear
+// the cache with the hash index and filter, and refused in concurrent and lock-free mode
+void hotCacheTests(int&, int&);
+
+// testing Zipf lookup latency with and without the cache, alone and mixed with removals
+void hotCacheTimeRun();
+
+// handles following accounts through findReplacement, rebuilds, batches, split, join, merge and clear
+// handles with the hash index, filter and cache, and refused in concurrent and lock-free mode
+void handleTests(int&, int&);
+
+// testing handle dereference against lookup latency
+void handleTimeRun();
+
 int main() {
     int numTests = 0;
     int numTestsPassed = 0;
@@ -139,8 +346,109 @@ int main() {
     cout << endl;
     uTreeRotationTests(numTestsPassed, numTests);
     cout << endl;
+    uTreeRetraceTests(numTestsPassed, numTests);
+    cout << endl;
+    uTreeHashIndexTests(numTestsPassed, numTests);
+    cout << endl;
+    uTreePrefixTests(numTestsPassed, numTests);
+    cout << endl;
     uTreeInsertionTimeRun();
     cout << endl;
+    uTreeHashLookupTimeRun();
+    cout << endl;
+
+    rTreeTests(numTestsPassed, numTests);
+    cout << endl;
+    bTreeTests(numTestsPassed, numTests);
+    cout << endl;
+    userIndexTimeRun();
+    cout << endl;
+
+    loadDataTests(numTestsPassed, numTests);
+    cout << endl;
+    loadDataParallelTests(numTestsPassed, numTests);
+    cout << endl;
+    loadDataBulkTests(numTestsPassed, numTests);
+    cout << endl;
+    loadDataTimeRun();
+    cout << endl;
+
+    snapshotTests(numTestsPassed, numTests);
+    cout << endl;
+    imageTests(numTestsPassed, numTests);
+    cout << endl;
+
+    logTests(numTestsPassed, numTests);
+    cout << endl;
+    logTimeRun();
+    cout << endl;
+    snapshotTimeRun();
+    cout << endl;
+
+    exportTests(numTestsPassed, numTests);
+    cout << endl;
+    exportTimeRun();
+    cout << endl;
+
+    mergeTests(numTestsPassed, numTests);
+    cout << endl;
+    mergeTimeRun();
+    cout << endl;
+
+    splitJoinTests(numTestsPassed, numTests);
+    cout << endl;
+    splitJoinTimeRun();
+    cout << endl;
+
+    concurrencyTests(numTestsPassed, numTests);
+    cout << endl;
+    concurrencyTimeRun();
+    cout << endl;
+
+    shardedTests(numTestsPassed, numTests);
+    cout << endl;
+    shardedTimeRun();
+    cout << endl;
+
+    lockFreeTests(numTestsPassed, numTests);
+    cout << endl;
+    lockFreeTimeRun();
+    cout << endl;
+
+    persistenceTests(numTestsPassed, numTests);
+    cout << endl;
+    persistenceTimeRun();
+    cout << endl;
+
+    batchLookupTests(numTestsPassed, numTests);
+    cout << endl;
+    batchLookupTimeRun();
+    cout << endl;
+
+    asyncLookupTests(numTestsPassed, numTests);
+    cout << endl;
+    asyncLookupTimeRun();
+    cout << endl;
+
+    applyBatchTests(numTestsPassed, numTests);
+    cout << endl;
+    applyBatchTimeRun();
+    cout << endl;
+
+    bloomFilterTests(numTestsPassed, numTests);
+    cout << endl;
+    bloomFilterTimeRun();
+    cout << endl;
+
+    hotCacheTests(numTestsPassed, numTests);
+    cout << endl;
+    hotCacheTimeRun();
+    cout << endl;
+
+    handleTests(numTestsPassed, numTests);
+    cout << endl;
+    handleTimeRun();
+    cout << endl;
 
     cout << numTestsPassed << " tests passed, ran " << numTests << '.' << endl << endl;
 
@@ -403,6 +711,65 @@ void dTreeInsertTests(int &numTestsPassed, int &numTests) {
         assertFinish(passed, numTests, numTestsPassed);
     }
 
+    cout << endl;
+
+    // refilling vacancies
+    {
+        cout << "Testing DTree: Insertion: Refill a vacancy below the root, then the vacant root with an "
+             << "account that fits between its children but not its subtrees, then with one that fits." << endl;
+        cout << "Expects: Vacant counts back to zero, the tree kept in order, and true from the root refill." << endl;
+        bool passed = true;
+
+        try {
+            DNode *removed = nullptr;
+
+            // discriminators must ascend in order, vacancies included
+            auto ordered = [&tester](DTree &tree) {
+                vector<DNode*> arr;
+                tester.putDIntoArr(tree, arr);
+                for (size_t i = 1; i < arr.size(); i++) {
+                    if (arr[i - 1]->getDiscriminator() >= arr[i]->getDiscriminator()) { return false; }
+                }
+                return true;
+            };
+
+            // a refilled vacancy leaves no vacant count behind on its ancestors
+            DTree below;
+            below.insert(createAccount(BASE_ACCOUNT_DISC));
+            below.insert(createAccount(BASE_ACCOUNT_DISC - 1));
+            below.insert(createAccount(BASE_ACCOUNT_DISC + 1));
+            below.insert(createAccount(BASE_ACCOUNT_DISC + 2));
+            below.remove(BASE_ACCOUNT_DISC + 1, removed);
+            delete removed;
+            if (!below.insert(createAccount(BASE_ACCOUNT_DISC + 1)) || tester.getDRoot(below)->getNumVacant() != 0
+                || !tester.verifyDSizes(below)) {
+                passed = false;
+            }
+
+            // the vacant root's left subtree reaches past the new account, so it goes elsewhere
+            DTree root;
+            root.insert(createAccount(20));
+            root.insert(createAccount(10));
+            root.insert(createAccount(30));
+            root.insert(createAccount(15));
+            root.remove(20, removed);
+            delete removed;
+            if (!root.insert(createAccount(13)) || !ordered(root) || !root.retrieve(13)) {
+                passed = false;
+            }
+
+            // an account that does fit takes the vacant root, and that counts as an insertion
+            if (!root.insert(createAccount(20)) || !ordered(root) || !root.retrieve(20)
+                || tester.getDRoot(root)->getNumVacant() != 0 || root.getNumUsers() != 5) {
+                passed = false;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
     return;
 }
 
@@ -1566,301 +1933,5058 @@ void uTreeRotationTests(int &numTestsPassed, int &numTests) {
     return;
 }
 
-void uTreeInsertionTimeRun() {
+void uTreeRetraceTests(int &numTestsPassed, int &numTests) {
     Tester tester;
 
-    cout << "Testing UTree: Insertion time." << endl;
-    tester.uTreeInsertionTime(NUM_TRIALS, NUM_INSERTIONS);
-
-    return;
-}
-
-// acts as a shortcut to create account arguments more easily
-Account createAccount(int disc, string username) {
-    Account acc(username, disc, false, "", "");
-    return acc;
-}
-
-// prints out if a test passed or failed and increments test counters
-void assertFinish(bool expr, int &numTests, int &numTestsPassed) {
-    if (expr) {
-        cout << "\tTest Passed." << endl;
-        numTestsPassed++;
-    }
-    else { cout << "\tTest Failed." << endl; }
+    // random insertions and removals
+    {
+        cout << "Testing UTree: Retrace: Random insertions and removals of whole UNodes." << endl;
+        cout << "Expects: The tree stays balanced, ordered, and every stored height is correct." << endl;
+        UTree obj;
+        bool passed = true;
+        std::uniform_int_distribution<> distName(0, 499);
+        vector<bool> present(500, false);
 
-    numTests++;
+        try {
+            for (int i = 0; i < 5000; i++) {
+                int name = distName(rng);
+                DNode *removed = nullptr;
+
+                // every username holds a single account, so removing it deletes the UNode
+                if (present[name]) {
+                    if (!obj.removeUser(to_string(name), 0, removed)) { passed = false; }
+                    present[name] = false;
+                } else {
+                    if (!obj.insert(createAccount(0, to_string(name)))) { passed = false; }
+                    present[name] = true;
+                }
 
-    return;
-}
+                if (removed) { delete removed; }
+            }
 
-// main container to verify the sizes of all DNodes in a DTree
-bool Tester::verifyDSizes(DTree &obj) {
-    return verifyDSizes(obj, obj._root);
-}
+            // everything left over must be retrievable, everything removed must not be
+            for (int i = 0; i < 500; i++) {
+                if ((obj.retrieve(to_string(i)) != nullptr) != present[i]) { passed = false; }
+            }
 
-// node helper for verifyheights(DTree&)
-bool Tester::verifyDSizes(DTree &obj, DNode *&node) {
-    // the rundown for this fxn is if at any point, balanced gets turned to false,
-    // keep it set to false.
-    bool balanced = true;
+            vector<UNode*> arr;
+            if (tester.getURoot(obj)) { tester.putUIntoArr(obj, arr); }
 
-    if (obj.checkImbalance(node)) { balanced = false; }
+            for (uint i = 1; i < arr.size(); i++) {
+                if (arr.at(i)->getUsername() <= arr.at(i - 1)->getUsername()) { passed = false; }
+            }
 
-    if (node->_left) {
-        balanced = (balanced) ? verifyDSizes(obj, node->_left) : false;
-    }
+            if (tester.getURoot(obj) && !tester.verifyUHeights(obj)) { passed = false; }
+            if (!tester.verifyUHeightValues(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
 
-    if (node->_right) {
-        balanced = (balanced) ? verifyDSizes(obj, node->_right) : false;
+        assertFinish(passed, numTests, numTestsPassed);
     }
 
-    return balanced;
-}
-
-// main container to verify the heights of all UNodes in a UTree
-bool Tester::verifyUHeights(UTree &obj) {
-    return verifyUHeights(obj, obj._root);
-}
+    cout << endl;
 
-// node helper for verifyUHeights(UTree&)
-bool Tester::verifyUHeights(UTree &obj, UNode *&node) {
-    // the rundown for this fxn is if at any point, balanced gets turned to false,
-    // keep it set to false.
-    bool balanced = true;
-    int balanceFactor = obj.checkImbalance(node);
+    // early termination
+    {
+        cout << "Testing UTree: Retrace: Sequential insertion of 4096 usernames." << endl;
+        cout << "Expects: Fewer than 3 ancestors retraced per insertion on average." << endl;
+        UTree obj;
+        bool passed = true;
 
-    if (balanceFactor > 1 || balanceFactor < -1) { balanced = false; }
+        try {
+            for (int i = 0; i < 4096; i++) {
+                char name[8];
+                snprintf(name, sizeof(name), "%05d", i);
+                if (!obj.insert(createAccount(0, name))) { passed = false; }
+            }
 
-    if (node->_left) {
-        balanced = (balanced) ? verifyUHeights(obj, node->_left) : false;
-    }
+            // a full retrace would visit ~12 ancestors per insertion here
+            if (obj.avgRetraced() <= 0.0 || obj.avgRetraced() >= 3.0) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
 
-    if (node->_right) {
-        balanced = (balanced) ? verifyUHeights(obj, node->_right) : false;
+        assertFinish(passed, numTests, numTestsPassed);
     }
 
-    return balanced;
-}
+    cout << endl;
 
-// converts the DTree into a vector for order checking
-void Tester::putDIntoArr(DTree &obj, vector<DNode*> &arr) {
-    putDIntoArr(arr, obj._root);
-    return;
-}
+    // removal of an inner node
+    {
+        cout << "Testing UTree: Retrace: Emptying the root while it has two children." << endl;
+        cout << "Expects: The predecessor replaces the root, then the root is rotated left." << endl;
+        UTree obj;
+        bool passed = false;
+        DNode *removed = nullptr;
 
-// similar to the method in DTree, put all DNodes into an array (vect here)
-// in order
-void Tester::putDIntoArr(vector<DNode*> &arr, DNode *&node) {
-    if (node->_left) {
-        putDIntoArr(arr, node->_left);
-    }
+        try {
+            obj.insert(createAccount(0, "m"));
+            obj.insert(createAccount(0, "f"));
+            obj.insert(createAccount(0, "t"));
+            obj.insert(createAccount(0, "c"));
+            obj.insert(createAccount(1, "c"));
+            obj.insert(createAccount(0, "p"));
+            obj.insert(createAccount(0, "x"));
+            obj.insert(createAccount(0, "z"));
+
+            if (obj.removeUser("m", 0, removed)) {
+                // "f" takes the root's place, leaving it right heavy by two
+                UNode *root = tester.getURoot(obj);
+                if (root->getUsername() == "t" && tester.getUNodeLeft(root)->getUsername() == "f"
+                        && obj.numUsers("c") == 2
+                        && !obj.retrieve("m") && obj.retrieveUser("z", 0)) {
+                    passed = true;
+                }
+            }
 
-    arr.push_back(node);
+            if (removed) { delete removed; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
 
-    if (node->_right) {
-        putDIntoArr(arr, node->_right);
+        assertFinish(passed, numTests, numTestsPassed);
     }
 
     return;
 }
 
-// return the root of a DTree
-DNode* Tester::getDRoot(DTree &obj) {
-    return obj._root;
-}
+void uTreeHashIndexTests(int &numTestsPassed, int &numTests) {
+    Tester tester;
 
-// return the left child of a Dnode
-DNode* Tester::getDNodeLeft(DNode *node) {
-    return node->_left;
-}
+    // random insertions and removals
+    {
+        cout << "Testing UTree: Hash Index: Random insertions and removals with the index enabled." << endl;
+        cout << "Expects: The index maps exactly the usernames in the tree to their UNodes." << endl;
+        UTree obj;
+        bool passed = true;
+        std::uniform_int_distribution<> distName(0, 299);
+        std::uniform_int_distribution<> distSmallDisc(0, 3);
 
-// return the right child of a dnode
-DNode* Tester::getDNodeRight(DNode *node) {
-    return node->_right;
-}
+        try {
+            obj.enableHashIndex();
+
+            for (int i = 0; i < 6000; i++) {
+                string name = to_string(distName(rng));
+                int disc = distSmallDisc(rng);
+                DNode *removed = nullptr;
+
+                // a few discriminators per username so UNodes are emptied from time
+                // to time, exercising every replacement case
+                bool inTree = obj.retrieveUser(name, disc) != nullptr;
+                if (inTree) {
+                    if (!obj.removeUser(name, disc, removed)) { passed = false; }
+                    if (obj.retrieveUser(name, disc)) { passed = false; }
+                } else {
+                    if (!obj.insert(createAccount(disc, name))) { passed = false; }
+                    if (!obj.retrieveUser(name, disc)) { passed = false; }
+                }
 
-// verify that the overloaded = worked
-bool Tester::checkDTreeEquality(DTree &copyTo, DTree &copyFrom) {
-    copyTo = copyFrom;
+                if (removed) { delete removed; }
+            }
 
-    if (&copyTo != &copyFrom) {
-        return checkDNodeEquality(copyTo._root, copyFrom._root);
+            if (!tester.verifyUHashIndex(obj)) { passed = false; }
+            if (tester.getURoot(obj) && !tester.verifyUHeights(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // enable late, then disable
+    {
+        cout << "Testing UTree: Hash Index: Enabling on a populated tree, then disabling." << endl;
+        cout << "Expects: Lookups agree before, during, and after the index exists." << endl;
+        UTree obj;
+        bool passed = true;
+
+        try {
+            for (int i = 0; i < NUM_CHARS; i++) {
+                string letter(1, ALPHABET[i]);
+                obj.insert(createAccount(i, letter));
+                obj.insert(createAccount(i + 1, letter));
+            }
+
+            obj.enableHashIndex();
+            if (!obj.hasHashIndex() || !obj.hashIndexMemory()) { passed = false; }
+            if (!tester.verifyUHashIndex(obj)) { passed = false; }
+
+            for (int i = 0; i < NUM_CHARS; i++) {
+                string letter(1, ALPHABET[i]);
+                if (obj.numUsers(letter) != 2 || !obj.retrieveUser(letter, i + 1)) { passed = false; }
+            }
+
+            if (obj.retrieve("aa") || obj.numUsers("") || obj.retrieveUser("q", 0)) { passed = false; }
+
+            obj.disableHashIndex();
+            if (obj.hasHashIndex() || obj.hashIndexMemory()) { passed = false; }
+            if (obj.numUsers("m") != 2 || !obj.retrieveUser("z", 26)) { passed = false; }
+
+            // clearing the tree must also clear the index
+            obj.enableHashIndex();
+            obj.clear();
+            if (obj.retrieve("a") || obj.numUsers("b")) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void uTreePrefixTests(int &numTestsPassed, int &numTests) {
+    // in order matches with counts
+    {
+        cout << "Testing UTree: Prefix: Visiting every username that starts with \"dr\"." << endl;
+        cout << "Expects: Exactly the matching usernames, in order, with their live counts." << endl;
+        UTree obj;
+        bool passed = true;
+        vector<string> names = {"drew", "dr", "dragon", "d", "drz", "ds", "dq", "a", "zzz", "drew2", "dra"};
+        vector<string> expected = {"dr", "dra", "dragon", "drew", "drew2", "drz"};
+
+        try {
+            for (uint i = 0; i < names.size(); i++) {
+                obj.insert(createAccount(0, names[i]));
+                obj.insert(createAccount(1, names[i]));
+            }
+
+            // a removal should be reflected in the live count
+            DNode *removed = nullptr;
+            obj.removeUser("dragon", 1, removed);
+            delete removed;
+
+            vector<string> seen;
+            vector<int> counts;
+            int visited = obj.forEachWithPrefix("dr", [&](UNode *node, int count) {
+                seen.push_back(node->getUsername());
+                counts.push_back(count);
+            });
+
+            if (visited != 6 || seen != expected) { passed = false; }
+            if (counts != vector<int>({2, 2, 1, 2, 2, 2})) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // limit
+    {
+        cout << "Testing UTree: Prefix: Limiting a search over 1000 matches to 10." << endl;
+        cout << "Expects: The 10 smallest matches are visited." << endl;
+        UTree obj;
+        bool passed = true;
+
+        try {
+            for (int i = 0; i < 1000; i++) {
+                obj.insert(createAccount(0, "user" + to_string(i)));
+                obj.insert(createAccount(0, "other" + to_string(i)));
+            }
+
+            vector<string> seen;
+            int visited = obj.forEachWithPrefix("user", [&](UNode *node, int) {
+                seen.push_back(node->getUsername());
+            }, 10);
+
+            // "user0", "user1", "user10", "user100", ...
+            if (visited != 10 || seen.size() != 10) { passed = false; }
+            else if (seen[0] != "user0" || seen[1] != "user1" || seen[2] != "user10" || seen[9] != "user106") {
+                passed = false;
+            }
+
+            if (obj.forEachWithPrefix("user", [](UNode*, int) {}) != 1000) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // edge cases
+    {
+        cout << "Testing UTree: Prefix: No matches, an empty prefix, and an empty tree." << endl;
+        cout << "Expects: Nothing, everything, and nothing to be visited." << endl;
+        UTree obj;
+        bool passed = true;
+        int counter = 0;
+        auto count = [&](UNode*, int) { counter++; };
+
+        try {
+            if (obj.forEachWithPrefix("", count) != 0) { passed = false; }
+
+            for (int i = 0; i < NUM_CHARS; i++) {
+                obj.insert(createAccount(0, string(1, ALPHABET[i]) + "name"));
+            }
+
+            if (obj.forEachWithPrefix("zz", count) != 0) { passed = false; }
+            if (obj.forEachWithPrefix("0", count) != 0) { passed = false; }
+            if (obj.forEachWithPrefix("", count) != NUM_CHARS) { passed = false; }
+            if (obj.forEachWithPrefix("qname", count) != 1) { passed = false; }
+            if (obj.forEachWithPrefix("qnamex", count) != 0) { passed = false; }
+            if (counter != NUM_CHARS + 1) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void uTreeInsertionTimeRun() {
+    Tester tester;
+
+    cout << "Testing UTree: Insertion time." << endl;
+    tester.uTreeInsertionTime(NUM_TRIALS, NUM_INSERTIONS);
+
+    return;
+}
+
+void uTreeHashLookupTimeRun() {
+    Tester tester;
+
+    cout << "Testing UTree: Lookup time with and without the hash index." << endl;
+    tester.uTreeHashLookupTime(NUM_TRIALS - 2, NUM_INSERTIONS);
+
+    return;
+}
+
+//////////////////////////// vvv rTree vvv ///////////////////////////////
+void rTreeTests(int &numTestsPassed, int &numTests) {
+    Tester tester;
+
+    // differential test against a UTree
+    {
+        cout << "Testing RTree: Random insertions and removals mirrored into a UTree." << endl;
+        cout << "Expects: Both trees hold the same users in the same order." << endl;
+        RTree obj;
+        UTree reference;
+        bool passed = true;
+        vector<string> names;
+
+        // short names over a small alphabet are prefixes of each other all the time,
+        // the "x?" names spread one node over every byte value
+        for (int i = 0; i < 200; i++) {
+            string name;
+            for (int len = i % 6, j = i; len > 0; len--, j /= 3) { name += ALPHABET[j % 3]; }
+            names.push_back(name);
+        }
+        for (int b = 1; b < 256; b++) { names.push_back(string("x") + char(b)); }
+
+        std::uniform_int_distribution<> distName(0, names.size() - 1);
+        std::uniform_int_distribution<> distSmallDisc(0, 2);
+
+        try {
+            for (int i = 0; i < 20000; i++) {
+                string name = names[distName(rng)];
+                int disc = distSmallDisc(rng);
+                DNode *removed = nullptr;
+                DNode *refRemoved = nullptr;
+
+                if (obj.retrieveUser(name, disc)) {
+                    if (obj.removeUser(name, disc, removed) != reference.removeUser(name, disc, refRemoved)) {
+                        passed = false;
+                    }
+                } else if (obj.insert(createAccount(disc, name)) != reference.insert(createAccount(disc, name))) {
+                    passed = false;
+                }
+
+                if (removed) { delete removed; }
+                if (refRemoved) { delete refRemoved; }
+            }
+
+            for (uint i = 0; i < names.size(); i++) {
+                if (obj.numUsers(names[i]) != reference.numUsers(names[i])) { passed = false; }
+            }
+
+            // walk both in order, with and without a prefix
+            vector<string> prefixes = {"", "a", "ab", "x", "cc", "zz"};
+            for (uint i = 0; i < prefixes.size(); i++) {
+                vector<string> seen;
+                vector<string> expected;
+                obj.forEachWithPrefix(prefixes[i], [&](UNode *node, int count) {
+                    seen.push_back(node->getUsername() + ":" + to_string(count));
+                });
+                reference.forEachWithPrefix(prefixes[i], [&](UNode *node, int count) {
+                    expected.push_back(node->getUsername() + ":" + to_string(count));
+                });
+
+                if (seen != expected) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // growing and shrinking
+    {
+        cout << "Testing RTree: Growing one node to 256 children, then removing them all but one." << endl;
+        cout << "Expects: The node becomes an RNode256, then shrinks and collapses into a leaf." << endl;
+        RTree obj;
+        bool passed = true;
+
+        try {
+            for (int b = 0; b < 256; b++) {
+                obj.insert(createAccount(0, string("k") + char(b)));
+            }
+
+            if (tester.getRRoot(obj)->_type != RNODE_256) { passed = false; }
+
+            int lastType = RNODE_256;
+            for (int b = 255; b > 0; b--) {
+                DNode *removed = nullptr;
+                if (!obj.removeUser(string("k") + char(b), 0, removed)) { passed = false; }
+                delete removed;
+
+                // node types may only ever step down
+                int type = tester.getRRoot(obj)->_type;
+                if (type != RNODE_LEAF && type > lastType) { passed = false; }
+                lastType = type;
+            }
+
+            if (tester.getRRoot(obj)->_type != RNODE_LEAF || obj.numUsers(string("k") + char(0)) != 1) {
+                passed = false;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // prefixes of each other
+    {
+        cout << "Testing RTree: Usernames that are prefixes of each other." << endl;
+        cout << "Expects: Each is stored separately and removing one leaves the others." << endl;
+        RTree obj;
+        bool passed = true;
+        DNode *removed = nullptr;
+
+        try {
+            obj.insert(createAccount(0, "drewb"));
+            obj.insert(createAccount(0, "dr"));
+            obj.insert(createAccount(0, "drew"));
+            obj.insert(createAccount(1, "drew"));
+            obj.insert(createAccount(0, ""));
+
+            if (obj.numUsers("drew") != 2 || obj.numUsers("dr") != 1 || obj.numUsers("drewb") != 1) { passed = false; }
+            if (obj.numUsers("d") != 0 || obj.numUsers("drewbb") != 0 || obj.numUsers("") != 1) { passed = false; }
+            if (obj.insert(createAccount(1, "drew"))) { passed = false; }
+
+            obj.removeUser("drew", 0, removed);
+            delete removed;
+            obj.removeUser("drew", 1, removed);
+            delete removed;
+
+            if (obj.retrieve("drew") || !obj.retrieveUser("dr", 0) || !obj.retrieveUser("drewb", 0)) { passed = false; }
+            if (obj.forEachWithPrefix("dr", [](UNode*, int) {}) != 2) { passed = false; }
+            if (obj.removeUser("drew", 0, removed)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+//////////////////////////// vvv bTree vvv ///////////////////////////////
+void bTreeTests(int &numTestsPassed, int &numTests) {
+    Tester tester;
+
+    // differential test against a UTree
+    {
+        cout << "Testing BTree: Random insertions and removals mirrored into a UTree." << endl;
+        cout << "Expects: Both trees hold the same users in order and the B+tree stays valid." << endl;
+        BTree obj;
+        UTree reference;
+        bool passed = true;
+        vector<string> names;
+
+        // long shared prefixes force comparisons past the packed first 8 bytes
+        for (int i = 0; i < 600; i++) {
+            names.push_back((i % 2) ? "same_prefix_" + to_string(i) : to_string(i * 7919));
+        }
+        names.push_back("");
+        names.push_back("same_pre");
+
+        std::uniform_int_distribution<> distName(0, names.size() - 1);
+        std::uniform_int_distribution<> distSmallDisc(0, 1);
+
+        try {
+            for (int i = 0; i < 20000; i++) {
+                string name = names[distName(rng)];
+                int disc = distSmallDisc(rng);
+                DNode *removed = nullptr;
+                DNode *refRemoved = nullptr;
+
+                if (obj.retrieveUser(name, disc)) {
+                    if (obj.removeUser(name, disc, removed) != reference.removeUser(name, disc, refRemoved)) {
+                        passed = false;
+                    }
+                } else if (obj.insert(createAccount(disc, name)) != reference.insert(createAccount(disc, name))) {
+                    passed = false;
+                }
+
+                if (removed) { delete removed; }
+                if (refRemoved) { delete refRemoved; }
+            }
+
+            if (!tester.verifyBTree(obj)) { passed = false; }
+
+            for (uint i = 0; i < names.size(); i++) {
+                if (obj.numUsers(names[i]) != reference.numUsers(names[i])) { passed = false; }
+            }
+
+            vector<string> prefixes = {"", "same_prefix_1", "1", "same_pre", "zzz"};
+            for (uint i = 0; i < prefixes.size(); i++) {
+                vector<string> seen;
+                vector<string> expected;
+                obj.forEachWithPrefix(prefixes[i], [&](UNode *node, int count) {
+                    seen.push_back(node->getUsername() + ":" + to_string(count));
+                });
+                reference.forEachWithPrefix(prefixes[i], [&](UNode *node, int count) {
+                    expected.push_back(node->getUsername() + ":" + to_string(count));
+                });
+
+                if (seen != expected) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // splits and merges
+    {
+        cout << "Testing BTree: Inserting 5000 usernames, then removing every one of them." << endl;
+        cout << "Expects: The tree grows past three levels, stays valid, and ends up empty." << endl;
+        BTree obj;
+        bool passed = true;
+
+        try {
+            for (int i = 0; i < 5000; i++) {
+                obj.insert(createAccount(0, to_string((i * 2654435761u) % 100000)));
+            }
+
+            if (tester.getBHeight(obj) < 3 || !tester.verifyBTree(obj)) { passed = false; }
+
+            for (int i = 0; i < 5000; i++) {
+                DNode *removed = nullptr;
+                if (!obj.removeUser(to_string((i * 2654435761u) % 100000), 0, removed)) { passed = false; }
+                delete removed;
+
+                if (i % 500 == 0 && !tester.verifyBTree(obj)) { passed = false; }
+            }
+
+            if (tester.getBHeight(obj) != 0 || obj.forEachWithPrefix("", [](UNode*, int) {})) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // the interface
+    {
+        cout << "Testing UserIndex: The same operations on every backend." << endl;
+        cout << "Expects: Identical results from UTree, RTree, BTree, and ShardedUTree." << endl;
+        bool passed = true;
+        int backends[] = {UINDEX_AVL, UINDEX_RADIX, UINDEX_BPLUS, UINDEX_SHARDED};
+
+        try {
+            for (int b = 0; b < 4; b++) {
+                UserIndex *obj = UserIndex::create(backends[b]);
+                DNode *removed = nullptr;
+
+                for (int i = 0; i < NUM_CHARS; i++) {
+                    obj->insert(createAccount(i, string(1, ALPHABET[i])));
+                    obj->insert(createAccount(i, string(2, ALPHABET[i])));
+                }
+
+                if (obj->insert(createAccount(3, "d"))) { passed = false; }
+                if (!obj->removeUser("d", 3, removed) || obj->retrieve("d")) { passed = false; }
+                delete removed;
+
+                if (obj->numUsers("dd") != 1 || !obj->retrieveUser("zz", 25)) { passed = false; }
+                if (obj->forEachWithPrefix("", [](UNode*, int) {}) != 2 * NUM_CHARS - 1) { passed = false; }
+
+                obj->clear();
+                if (obj->numUsers("a")) { passed = false; }
+
+                delete obj;
+            }
+
+            UserIndex::create(-1);
+            passed = false;
+        } catch (std::invalid_argument&) {
+            // expected from the unknown backend
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void userIndexTimeRun() {
+    Tester tester;
+
+    cout << "Testing UserIndex: Insertion and lookup time of every backend." << endl;
+    tester.userIndexTime(NUM_TRIALS - 2, NUM_INSERTIONS);
+
+    return;
+}
+
+//////////////////////////// vvv loadData vvv ///////////////////////////////
+void loadDataTests(int &numTestsPassed, int &numTests) {
+    const string CSV_PATH = "loaddata_test.csv";
+
+    // well formed input
+    {
+        cout << "Testing loadData: Loading fields, number formats, and a missing final newline." << endl;
+        cout << "Expects: Every account is inserted with the right fields on every backend." << endl;
+        bool passed = true;
+        int backends[] = {UINDEX_AVL, UINDEX_RADIX, UINDEX_BPLUS, UINDEX_SHARDED};
+
+        try {
+            std::ofstream out(CSV_PATH);
+            out << "drew,1,0,Bug Hunter,online\n"
+                << "drew,2, 1,,idle\n"
+                << "drew,1,0,Duplicate,ignored\n"
+                << "amy,+9999,7,Early Supporter,\n"
+                << "zed,0042,0,HypeSquad,do not disturb";
+            out.close();
+
+            for (int b = 0; b < 4; b++) {
+                UserIndex *obj = UserIndex::create(backends[b]);
+                obj->loadData(CSV_PATH);
+
+                DNode *drew2 = obj->retrieveUser("drew", 2);
+                DNode *amy = obj->retrieveUser("amy", 9999);
+                DNode *zed = obj->retrieveUser("zed", 42);
+
+                if (obj->numUsers("drew") != 2 || !drew2 || !amy || !zed) { passed = false; }
+                else {
+                    Account acc = drew2->getAccount();
+                    if (!acc.hasNitro() || acc.getBadge() != "" || acc.getStatus() != "idle") { passed = false; }
+
+                    acc = amy->getAccount();
+                    if (!acc.hasNitro() || acc.getBadge() != "Early Supporter" || acc.getStatus() != "") { passed = false; }
+
+                    acc = zed->getAccount();
+                    if (acc.hasNitro() || acc.getStatus() != "do not disturb") { passed = false; }
+
+                    if (obj->retrieveUser("drew", 1)->getAccount().getBadge() != "Bug Hunter") { passed = false; }
+                }
+
+                delete obj;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // malformed input
+    {
+        cout << "Testing loadData: Lines with too few or too many fields, and bad numbers." << endl;
+        cout << "Expects: std::invalid_argument for each, std::out_of_range for a bad discriminator." << endl;
+        bool passed = true;
+        vector<string> badFiles = {"a,1,0,b\n", "a,1,0,b,c,d\n", "a,1,0,b,c\n\n", "a,x,0,b,c\n", "a,1,,b,c\n"};
+
+        for (uint i = 0; i < badFiles.size(); i++) {
+            UTree obj;
+            std::ofstream out(CSV_PATH);
+            out << badFiles[i];
+            out.close();
+
+            try {
+                obj.loadData(CSV_PATH);
+                passed = false;
+            } catch (std::invalid_argument&) {
+                // expected
+            } catch (...) {
+                passed = false;
+            }
+        }
+
+        try {
+            UTree obj;
+            std::ofstream out(CSV_PATH);
+            out << "a,10000,0,b,c\n";
+            out.close();
+
+            obj.loadData(CSV_PATH);
+            passed = false;
+        } catch (std::out_of_range&) {
+            // expected
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // append versus replace
+    {
+        cout << "Testing loadData: Appending to and replacing an existing tree." << endl;
+        cout << "Expects: Appending keeps old accounts, replacing drops them; an empty file loads nothing." << endl;
+        UTree obj;
+        bool passed = true;
+
+        try {
+            obj.insert(createAccount(5, "old"));
+
+            std::ofstream out(CSV_PATH);
+            out << "new,1,0,,\n";
+            out.close();
+
+            obj.loadData(CSV_PATH, true);
+            if (!obj.retrieveUser("old", 5) || !obj.retrieveUser("new", 1)) { passed = false; }
+
+            obj.loadData(CSV_PATH, false);
+            if (obj.retrieve("old") || !obj.retrieveUser("new", 1)) { passed = false; }
+
+            out.open(CSV_PATH);
+            out.close();
+
+            obj.loadData(CSV_PATH, false);
+            if (obj.numUsers("new") || obj.forEachWithPrefix("", [](UNode*, int) {})) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void loadDataParallelTests(int &numTestsPassed, int &numTests) {
+    const string CSV_PATH = "loaddata_parallel_test.csv";
+    Tester tester;
+
+    // write a file with plenty of duplicate usernames and a few duplicate accounts,
+    // whose copies differ by badge so the winner can be told apart
+    std::ofstream out(CSV_PATH);
+    for (int i = 0; i < 3000; i++) {
+        out << "user" << (i * 37) % 700 << ',' << (i * 13) % 9 << ',' << i % 2 << ",badge" << i << ",status";
+        if (i < 2999) { out << '\n'; }
+    }
+    out.close();
+
+    // same contents as the serial loader
+    {
+        cout << "Testing loadDataParallel: Loading with 1, 2, 3 and 7 threads." << endl;
+        cout << "Expects: The same accounts as loadData() in a balanced tree every time." << endl;
+        bool passed = true;
+
+        try {
+            UTree serial;
+            serial.loadData(CSV_PATH);
+            string expected = tester.describeAccounts(serial);
+
+            int threadCounts[] = {1, 2, 3, 7};
+            for (int threads : threadCounts) {
+                UTree obj;
+                obj.loadDataParallel(CSV_PATH, threads);
+
+                if (tester.describeAccounts(obj) != expected) { passed = false; }
+                if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // appending
+    {
+        cout << "Testing loadDataParallel: Appending into a populated tree with a hash index." << endl;
+        cout << "Expects: Existing accounts are kept and win over duplicates, the index stays in sync." << endl;
+        bool passed = true;
+
+        try {
+            UTree serial, obj;
+            obj.enableHashIndex();
+
+            for (int i = 0; i < 50; i++) {
+                Account acct("user" + std::to_string(i * 20), i % 9, false, "old", "");
+                serial.insert(acct);
+                obj.insert(acct);
+                serial.insert(createAccount(i, "aaa"));
+                obj.insert(createAccount(i, "aaa"));
+            }
+
+            serial.loadData(CSV_PATH);
+            obj.loadDataParallel(CSV_PATH, 4);
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(serial)) { passed = false; }
+            if (!tester.verifyUHeightValues(obj) || !tester.verifyUHashIndex(obj)) { passed = false; }
+            if (obj.retrieveUser("user0", 0)->getAccount().getBadge() != "old") { passed = false; }
+            if (obj.numUsers("aaa") != 50) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // malformed input
+    {
+        cout << "Testing loadDataParallel: A malformed line near the end of the file." << endl;
+        cout << "Expects: std::invalid_argument, with the tree left as it was." << endl;
+        UTree obj;
+        bool passed = true;
+
+        obj.insert(createAccount(1, "kept"));
+
+        out.open(CSV_PATH, std::ofstream::app);
+        out << "\nbroken,1,0\n";
+        out.close();
+
+        try {
+            obj.loadDataParallel(CSV_PATH, 3, false);
+            passed = false;
+        } catch (std::invalid_argument&) {
+            if (!obj.retrieveUser("kept", 1) || obj.retrieve("user0")) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    std::remove(CSV_PATH.c_str());
+
+    return;
+}
+
+void loadDataBulkTests(int &numTestsPassed, int &numTests) {
+    const string CSV_PATH = "loaddata_bulk_test.csv";
+    Tester tester;
+
+    // unsorted usernames and discriminators with duplicate accounts told apart by badge
+    std::ofstream out(CSV_PATH);
+    for (int i = 0; i < 4000; i++) {
+        out << "user" << (i * 53) % 900 << ',' << (i * 31) % 17 << ',' << i % 2 << ",badge" << i << ",status\n";
+    }
+    out.close();
+
+    // same contents as row by row insertion
+    {
+        cout << "Testing loadData: Bulk loading a file with duplicates out of order." << endl;
+        cout << "Expects: The accounts insert() keeps, in balanced UTree and DTrees with correct sizes." << endl;
+        bool passed = true;
+
+        try {
+            UTree inserted, obj;
+            inserted.loadData(CSV_PATH, true);
+
+            obj.insert(createAccount(1, "dropped"));
+            obj.loadData(CSV_PATH, false);
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(inserted)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            if (obj.retrieve("dropped")) { passed = false; }
+
+            obj.forEachWithPrefix("", [&](UNode *node, int numUsers) {
+                DTree &dtree = *node->getDTree();
+                DNode *root = tester.getDRoot(dtree);
+                int left = tester.getDNodeLeft(root) ? tester.getDNodeLeft(root)->getSize() : 0;
+                int right = tester.getDNodeRight(root) ? tester.getDNodeRight(root)->getSize() : 0;
+
+                if (!tester.verifyDSizes(dtree) || root->getNumVacant() != 0) { passed = false; }
+                if (left - right > 1 || right - left > 1 || numUsers != root->getSize()) { passed = false; }
+            });
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // hash index
+    {
+        cout << "Testing loadData: Bulk loading into a tree with a hash index, then editing it." << endl;
+        cout << "Expects: The index covers every loaded username and later inserts and removals work." << endl;
+        UTree obj;
+        bool passed = true;
+
+        try {
+            obj.enableHashIndex();
+            obj.insert(createAccount(1, "dropped"));
+            obj.loadData(CSV_PATH, false);
+
+            if (!tester.verifyUHashIndex(obj) || obj.retrieve("dropped")) { passed = false; }
+
+            DNode *removed = nullptr;
+            if (!obj.insert(createAccount(9999, "user0")) || !obj.removeUser("user0", 0, removed)) { passed = false; }
+            delete removed;
+
+            if (obj.numUsers("user0") != 5 || !tester.verifyUHashIndex(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    std::remove(CSV_PATH.c_str());
+
+    return;
+}
+
+void loadDataTimeRun() {
+    Tester tester;
+
+    cout << "Testing loadData: Ingestion throughput." << endl;
+    tester.loadDataTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+//////////////////////////// vvv snapshots vvv ///////////////////////////////
+void snapshotTests(int &numTestsPassed, int &numTests) {
+    const string SNAPSHOT_PATH = "snapshot_test.bin";
+    Tester tester;
+
+    // round trip
+    {
+        cout << "Testing snapshots: Saving and loading a tree that has had accounts removed." << endl;
+        cout << "Expects: The loaded tree holds exactly the same accounts, balanced, with no vacant nodes." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, loaded;
+
+            for (int i = 0; i < 2000; i++) {
+                string username = "user" + std::to_string((i * 41) % 300);
+                string badge = (i % 3) ? "Bug Hunter" : "";
+                obj.insert(Account(username, (i * 7) % 23, i % 2, badge, "status " + std::to_string(i % 5)));
+            }
+            for (int i = 0; i < 300; i += 3) {
+                DNode *removed = nullptr;
+                obj.removeUser("user" + std::to_string(i), (i * 7) % 23, removed);
+                delete removed;
+            }
+
+            // and one username emptied out completely
+            vector<int> discs;
+            obj.retrieve("user7")->getDTree()->forEachAccount([&](const Account& acct) {
+                discs.push_back(acct.getDiscriminator());
+            });
+            for (int disc : discs) {
+                DNode *removed = nullptr;
+                obj.removeUser("user7", disc, removed);
+                delete removed;
+            }
+
+            loaded.insert(createAccount(1, "replaced"));
+            loaded.enableHashIndex();
+
+            if (!obj.saveSnapshot(SNAPSHOT_PATH)) { passed = false; }
+            loaded.loadSnapshot(SNAPSHOT_PATH);
+
+            if (tester.describeAccounts(loaded) != tester.describeAccounts(obj)) { passed = false; }
+            if (!tester.verifyUHeights(loaded) || !tester.verifyUHeightValues(loaded)) { passed = false; }
+            if (!tester.verifyUHashIndex(loaded) || loaded.retrieve("replaced")) { passed = false; }
+
+            loaded.forEachWithPrefix("", [&](UNode *node, int) {
+                if (tester.getDRoot(*node->getDTree())->getNumVacant() != 0) { passed = false; }
+            });
+
+            // an empty tree round trips too
+            UTree empty;
+            if (!empty.saveSnapshot(SNAPSHOT_PATH)) { passed = false; }
+            loaded.loadSnapshot(SNAPSHOT_PATH);
+            if (loaded.retrieve("user1") || tester.describeAccounts(loaded) != "") { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // damaged snapshots
+    {
+        cout << "Testing snapshots: Loading flipped, truncated, and future version snapshots." << endl;
+        cout << "Expects: std::invalid_argument each time, with the tree left as it was." << endl;
+        bool passed = true;
+
+        UTree source;
+        for (int i = 0; i < 100; i++) { source.insert(createAccount(i % 10, "user" + std::to_string(i / 10))); }
+        source.saveSnapshot(SNAPSHOT_PATH);
+
+        std::ifstream in(SNAPSHOT_PATH, std::ifstream::binary);
+        string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+
+        // flip a byte in the body, cut off the footer, and bump the version
+        // (with a matching checksum, so only the version is wrong)
+        vector<string> damaged = {original, original.substr(0, original.size() - 4), original};
+        damaged[0][original.size() / 2] ^= 0x20;
+        damaged[2][SNAPSHOT_MAGIC_SIZE] = SNAPSHOT_VERSION + 1;
+        uint64_t checksum = snapshotChecksum(damaged[2].data(), damaged[2].size() - SNAPSHOT_FOOTER_SIZE);
+        for (int i = 0; i < SNAPSHOT_FOOTER_SIZE; i++) {
+            damaged[2][damaged[2].size() - SNAPSHOT_FOOTER_SIZE + i] = (char)(checksum >> (8 * i));
+        }
+
+        for (uint i = 0; i < damaged.size(); i++) {
+            UTree obj;
+            obj.insert(createAccount(1, "kept"));
+
+            std::ofstream out(SNAPSHOT_PATH, std::ofstream::binary);
+            out << damaged[i];
+            out.close();
+
+            try {
+                obj.loadSnapshot(SNAPSHOT_PATH);
+                passed = false;
+            } catch (std::invalid_argument&) {
+                if (!obj.retrieveUser("kept", 1) || obj.retrieve("user0")) { passed = false; }
+            } catch (...) {
+                passed = false;
+            }
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // both encodings
+    {
+        cout << "Testing snapshots: Plain and compressed snapshots of the same tree." << endl;
+        cout << "Expects: Both load to the same accounts, and the compressed one is at most a third of the size." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+
+            // shared username prefixes, wide discriminator gaps, long runs, odd
+            // run lengths for the nitro bits, and a username that extends another
+            for (int i = 0; i < 5000; i++) {
+                string username = "some_long_username_" + std::to_string((i * 37) % 400);
+                obj.insert(Account(username, (i * 7919) % (MAX_DISC + 1), i % 3 == 0,
+                                   (i % 4) ? "Early Supporter" : "HypeSquad", "status " + std::to_string(i % 6)));
+            }
+            for (int disc = MIN_DISC; disc <= MAX_DISC; disc += 3) {
+                obj.insert(Account("some_long_username_1", disc, disc % 2, "Bug Hunter", ""));
+            }
+            obj.insert(createAccount(MAX_DISC, "some_long_username_10x"));
+
+            size_t sizes[2];
+            int versions[] = {SNAPSHOT_VERSION_PLAIN, SNAPSHOT_VERSION_COMPRESSED};
+
+            for (int v = 0; v < 2; v++) {
+                UTree loaded;
+
+                if (!obj.saveSnapshot(SNAPSHOT_PATH, versions[v])) { passed = false; }
+                loaded.loadSnapshot(SNAPSHOT_PATH);
+
+                std::ifstream sizeCheck(SNAPSHOT_PATH, std::ifstream::ate | std::ifstream::binary);
+                sizes[v] = sizeCheck.tellg();
+                sizeCheck.close();
+
+                if (tester.describeAccounts(loaded) != tester.describeAccounts(obj)) { passed = false; }
+            }
+
+            if (sizes[1] * 3 > sizes[0]) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void imageTests(int &numTestsPassed, int &numTests) {
+    const string IMAGE_PATH = "image_test.bin";
+
+    // queries
+    {
+        cout << "Testing images: Querying an image in place." << endl;
+        cout << "Expects: Every lookup, count and prefix scan matches the tree it was written from." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+
+            for (int i = 0; i < 3000; i++) {
+                string username = "user" + std::to_string((i * 41) % 500);
+                obj.insert(Account(username, (i * 7) % 97, i % 2, (i % 3) ? "Bug Hunter" : "", "status " + std::to_string(i % 5)));
+            }
+            for (int i = 0; i < 500; i += 4) {
+                DNode *removed = nullptr;
+                obj.removeUser("user" + std::to_string(i), (i * 7) % 97, removed);
+                delete removed;
+            }
+
+            if (!obj.saveImage(IMAGE_PATH)) { passed = false; }
+            UImage image(IMAGE_PATH);
+
+            if (!image.isOpen() || !image.verify() || image.numUsernames() != 500) { passed = false; }
+
+            // every account, field for field
+            size_t numAccounts = 0;
+            obj.forEachWithPrefix("", [&](UNode *node, int numUsers) {
+                if (image.numUsers(node->getUsername()) != numUsers) { passed = false; }
+
+                node->getDTree()->forEachAccount([&](const Account& acct) {
+                    const ImageAccount *found = image.retrieveUser(acct.getUsername(), acct.getDiscriminator());
+                    numAccounts++;
+
+                    if (!found) { passed = false; return; }
+
+                    Account copy = image.getAccount(image.retrieve(acct.getUsername()), found);
+                    if (copy.getUsername() != acct.getUsername() || copy.getDiscriminator() != acct.getDiscriminator()
+                        || copy.hasNitro() != acct.hasNitro() || copy.getBadge() != acct.getBadge()
+                        || copy.getStatus() != acct.getStatus()) { passed = false; }
+                });
+            });
+
+            if (image.numAccounts() != numAccounts) { passed = false; }
+            if (image.retrieve("user500") || image.retrieveUser("user1", 98) || image.numUsers("") != 0) { passed = false; }
+
+            // prefix scans, with and without limits
+            vector<string> prefixes = {"", "user1", "user49", "user499", "user5", "v", "a"};
+            for (const string& prefix : prefixes) {
+                for (int limit : {NO_LIMIT, 1, 7}) {
+                    string expected, actual;
+                    int expectedCount = obj.forEachWithPrefix(prefix, [&](UNode *node, int n) {
+                        expected += node->getUsername() + ":" + std::to_string(n) + " ";
+                    }, limit);
+                    int actualCount = image.forEachWithPrefix(prefix, [&](const ImageUNode *node, int n) {
+                        actual += string(image.getUsername(node)) + ":" + std::to_string(n) + " ";
+                    }, limit);
+
+                    if (expected != actual || expectedCount != actualCount) { passed = false; }
+                }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(IMAGE_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // edge cases
+    {
+        cout << "Testing images: Empty, corrupt, missing, and non-image files." << endl;
+        cout << "Expects: Empty images answer nothing, corruption fails verify(), bad headers throw." << endl;
+        bool passed = true;
+
+        try {
+            UTree empty;
+            empty.saveImage(IMAGE_PATH);
+
+            UImage image(IMAGE_PATH);
+            if (!image.isOpen() || !image.verify() || image.retrieve("a") || image.forEachWithPrefix("", [](const ImageUNode*, int) {})) {
+                passed = false;
+            }
+
+            UImage missing("no_such_image.bin");
+            if (missing.isOpen() || missing.retrieve("a")) { passed = false; }
+
+            UTree obj;
+            for (int i = 0; i < 50; i++) { obj.insert(createAccount(i, "user" + std::to_string(i % 5))); }
+            obj.saveImage(IMAGE_PATH);
+
+            // flip a byte in the string area at the end of the file
+            std::fstream file(IMAGE_PATH, std::fstream::in | std::fstream::out | std::fstream::binary);
+            file.seekg(-(SNAPSHOT_FOOTER_SIZE + 1), std::fstream::end);
+            char byte = file.get();
+            file.seekp(-(SNAPSHOT_FOOTER_SIZE + 1), std::fstream::end);
+            file.put(byte ^ 0x01);
+            file.close();
+
+            UImage corrupt(IMAGE_PATH);
+            if (!corrupt.isOpen() || corrupt.verify()) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        // a snapshot is not an image
+        UTree obj;
+        obj.insert(createAccount(1, "user"));
+        obj.saveSnapshot(IMAGE_PATH);
+
+        try {
+            UImage image(IMAGE_PATH);
+            passed = false;
+        } catch (std::invalid_argument&) {
+            // expected
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(IMAGE_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // corrupt links
+    {
+        cout << "Testing images: Links pointing out of the file, at too many accounts, and back up the tree." << endl;
+        cout << "Expects: Lookups and walks throw std::invalid_argument instead of reading past the file or looping." << endl;
+        bool passed = true;
+
+        // each case patches one field of the root ImageUNode of a fresh image, then
+        // reports whether query threw std::invalid_argument
+        auto throwsWith = [&IMAGE_PATH](size_t field, uint64_t value, int width, std::function<void(const UImage&)> query) {
+            UTree obj;
+            for (int i = 0; i < 50; i++) { obj.insert(createAccount(i, "user" + std::to_string(i % 25))); }
+            obj.saveImage(IMAGE_PATH);
+
+            std::fstream file(IMAGE_PATH, std::fstream::in | std::fstream::out | std::fstream::binary);
+            uint64_t root = 0;
+            file.seekg(offsetof(ImageHeader, root));
+            file.read(reinterpret_cast<char*>(&root), sizeof(root));
+            if (value == IMAGE_NO_NODE) { value = root; }
+            file.seekp(root + field);
+            file.write(reinterpret_cast<const char*>(&value), width);
+            file.close();
+
+            try {
+                UImage image(IMAGE_PATH);
+                query(image);
+            } catch (std::invalid_argument&) {
+                return true;
+            }
+            return false;
+        };
+
+        try {
+            auto lookup = [](const UImage& image) { image.retrieveUser("user9", 9); };
+            auto walk = [](const UImage& image) { image.forEachWithPrefix("", [](const ImageUNode*, int) {}); };
+
+            // IMAGE_NO_NODE stands for the root's own offset
+            if (!throwsWith(offsetof(ImageUNode, username), 1ull << 40, 8, lookup)) { passed = false; }
+            if (!throwsWith(offsetof(ImageUNode, usernameLength), 1u << 30, 4, lookup)) { passed = false; }
+            if (!throwsWith(offsetof(ImageUNode, left), 1ull << 40, 8, walk)) { passed = false; }
+            if (!throwsWith(offsetof(ImageUNode, left), IMAGE_NO_NODE, 8, walk)) { passed = false; }
+            if (!throwsWith(offsetof(ImageUNode, right), IMAGE_NO_NODE, 8, [](const UImage& image) { image.retrieve("zzz"); })) {
+                passed = false;
+            }
+            // one of the usernames is the root's
+            if (!throwsWith(offsetof(ImageUNode, numAccounts), 1u << 30, 4, [](const UImage& image) {
+                for (int i = 0; i < 25; i++) { image.retrieveUser("user" + std::to_string(i), 0); }
+            })) {
+                passed = false;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(IMAGE_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void snapshotTimeRun() {
+    Tester tester;
+
+    cout << "Testing snapshots: Snapshot load and image open time against csv." << endl;
+    tester.snapshotTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+////////////////////////////// vvv logging vvv /////////////////////////////////
+// copies a file byte for byte, standing in for the disk contents after a crash
+void copyFile(const string& from, const string& to) {
+    std::ifstream in(from, std::ifstream::binary);
+    std::ofstream out(to, std::ofstream::binary);
+    out << in.rdbuf();
+
+    return;
+}
+
+void logTests(int &numTestsPassed, int &numTests) {
+    const string SNAPSHOT_PATH = "log_test_snapshot.bin";
+    const string LOG_PATH = "log_test.wal";
+    const string CRASH_PATH = "log_test_crash.wal";
+    Tester tester;
+
+    // recovery
+    {
+        cout << "Testing logging: Recovering from a log, from a snapshot plus a log, and past a stale log." << endl;
+        cout << "Expects: Every recovered tree matches the tree as it was at the crash." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            obj.recover(SNAPSHOT_PATH, LOG_PATH);
+
+            for (int i = 0; i < 300; i++) {
+                obj.insert(Account("user" + std::to_string(i % 40), i % 13, i % 2, "badge" + std::to_string(i), ""));
+            }
+            for (int i = 0; i < 40; i += 3) {
+                DNode *removed = nullptr;
+                if (obj.removeUser("user" + std::to_string(i), i % 13, removed)) { delete removed; }
+            }
+
+            // everything was synced when it was committed, so a copy of the log
+            // taken now is what a crash would leave behind
+            copyFile(LOG_PATH, CRASH_PATH);
+            UTree fromLog;
+            fromLog.recover(SNAPSHOT_PATH, CRASH_PATH);
+            fromLog.disableLog();
+            if (tester.describeAccounts(fromLog) != tester.describeAccounts(obj)) { passed = false; }
+
+            // checkpoint, mutate some more, and recover from both
+            copyFile(LOG_PATH, CRASH_PATH);
+            if (!obj.checkpoint()) { passed = false; }
+            obj.insert(createAccount(1, "after"));
+            DNode *removed = nullptr;
+            if (obj.removeUser("user1", 1, removed)) { delete removed; }
+            obj.clear();
+            obj.insert(createAccount(2, "cleared"));
+
+            UTree fromBoth;
+            copyFile(LOG_PATH, LOG_PATH + ".copy");
+            fromBoth.recover(SNAPSHOT_PATH, LOG_PATH + ".copy");
+            fromBoth.disableLog();
+            if (tester.describeAccounts(fromBoth) != tester.describeAccounts(obj)) { passed = false; }
+            if (!fromBoth.retrieveUser("cleared", 2) || fromBoth.retrieve("after")) { passed = false; }
+
+            // the log from before the checkpoint follows the old (missing) snapshot,
+            // so recovering the new snapshot with it must ignore it
+            UTree stale;
+            stale.recover(SNAPSHOT_PATH, CRASH_PATH);
+            stale.disableLog();
+            if (!stale.retrieve("user2") || stale.retrieve("cleared")) { passed = false; }
+
+            std::remove((LOG_PATH + ".copy").c_str());
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        std::remove(LOG_PATH.c_str());
+        std::remove(CRASH_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // torn records
+    {
+        cout << "Testing logging: A log whose last record was cut short." << endl;
+        cout << "Expects: Recovery stops before it, and new records follow the last intact one." << endl;
+        bool passed = true;
+
+        try {
+            {
+                UTree obj;
+                obj.recover(SNAPSHOT_PATH, LOG_PATH, LOG_SYNC_NONE);
+                for (int i = 0; i < 10; i++) { obj.insert(createAccount(i, "user")); }
+            }
+
+            std::ifstream in(LOG_PATH, std::ifstream::binary);
+            string log((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+
+            std::ofstream out(LOG_PATH, std::ofstream::binary);
+            out << log.substr(0, log.size() - 3);
+            out.close();
+
+            UTree obj;
+            obj.recover(SNAPSHOT_PATH, LOG_PATH);
+            if (obj.numUsers("user") != 9 || obj.retrieveUser("user", 9)) { passed = false; }
+
+            obj.insert(createAccount(42, "user"));
+
+            UTree again;
+            again.recover(SNAPSHOT_PATH, LOG_PATH);
+            if (again.numUsers("user") != 10 || !again.retrieveUser("user", 42)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(LOG_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // batched syncs
+    {
+        cout << "Testing logging: Batches of 10 inserts under LOG_SYNC_BATCH." << endl;
+        cout << "Expects: A crash after 200 records loses fewer than LOG_BATCH_RECORDS of them." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            obj.recover(SNAPSHOT_PATH, LOG_PATH, LOG_SYNC_BATCH);
+
+            // no batch ends on a multiple of LOG_BATCH_RECORDS after the first
+            for (int batch = 0; batch < 20; batch++) {
+                vector<AccountOp> ops;
+                for (int i = 0; i < 10; i++) { ops.push_back(AccountOp::insert(createAccount(batch * 10 + i, "user"))); }
+                obj.applyBatch(ops);
+            }
+
+            copyFile(LOG_PATH, CRASH_PATH);
+            UTree fromLog;
+            fromLog.recover(SNAPSHOT_PATH, CRASH_PATH);
+            fromLog.disableLog();
+            if (fromLog.numUsers("user") <= 200 - LOG_BATCH_RECORDS) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        std::remove(LOG_PATH.c_str());
+        std::remove(CRASH_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // group commit
+    {
+        cout << "Testing logging: Committing from 4 threads at once." << endl;
+        cout << "Expects: Every record is replayed, using no more fsyncs than commits." << endl;
+        bool passed = true;
+        const int NUM_THREADS = 4;
+        const int NUM_COMMITS = 100;
+
+        try {
+            uint64_t numSyncs;
+
+            {
+                ULog log(LOG_PATH, LOG_NO_BASE, LOG_SYNC_ALWAYS);
+                vector<std::thread> threads;
+
+                for (int t = 0; t < NUM_THREADS; t++) {
+                    threads.emplace_back([&log, t]() {
+                        for (int i = 0; i < NUM_COMMITS; i++) {
+                            log.commit(log.appendInsert(createAccount(i, "thread" + std::to_string(t))));
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) { thread.join(); }
+
+                numSyncs = log.numSyncs();
+            }
+
+            vector<int> seen(NUM_THREADS, 0);
+            ULog::replay(LOG_PATH, LOG_NO_BASE, [&](int op, Account& acct) {
+                int t = acct.getUsername().back() - '0';
+                // each thread's records appear in the order it made them
+                if (op != LOG_OP_INSERT || acct.getDiscriminator() != seen[t]++) { passed = false; }
+            });
+
+            for (int count : seen) { if (count != NUM_COMMITS) { passed = false; } }
+            if (numSyncs > NUM_THREADS * NUM_COMMITS) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(LOG_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void logTimeRun() {
+    Tester tester;
+
+    cout << "Testing logging: Mutation throughput with and without durability." << endl;
+    tester.logTime(NUM_TRIALS - 3, NUM_INSERTIONS / 10);
+
+    return;
+}
+
+////////////////////////////// vvv exporting vvv ////////////////////////////////
+void exportTests(int &numTestsPassed, int &numTests) {
+    const string EXPORT_PATH = "export_test.out";
+    Tester tester;
+    UTree obj;
+
+    for (int i = 0; i < 3000; i++) {
+        string username = "user" + std::to_string((i * 37) % 400);
+        string badge = (i % 4) ? "Early Supporter" : "";
+        obj.insert(Account(username, (i * 13) % 9973, i % 3 == 0, badge, "status " + std::to_string(i % 7)));
+    }
+    for (int i = 0; i < 400; i += 5) {
+        DNode *removed = nullptr;
+        obj.removeUser("user" + std::to_string(i), (i * 13) % 9973, removed);
+        delete removed;
+    }
+
+    // csv and binary round trips
+    {
+        cout << "Testing exports: Exporting a tree with removed accounts as csv and as binary." << endl;
+        cout << "Expects: loadData() and loadSnapshot() read each export back into the same accounts." << endl;
+        bool passed = true;
+
+        try {
+            string csv, binary;
+            StringSink csvSink(csv), binarySink(binary);
+
+            if (!obj.exportTo(csvSink, EXPORT_CSV) || !obj.exportTo(binarySink, EXPORT_BINARY)) { passed = false; }
+
+            UTree fromCsv, fromBinary;
+            std::ofstream(EXPORT_PATH, std::ofstream::binary) << csv;
+            fromCsv.loadData(EXPORT_PATH, false);
+
+            std::ofstream(EXPORT_PATH, std::ofstream::binary) << binary;
+            fromBinary.loadSnapshot(EXPORT_PATH);
+
+            if (tester.describeAccounts(fromCsv) != tester.describeAccounts(obj)) { passed = false; }
+            if (tester.describeAccounts(fromBinary) != tester.describeAccounts(obj)) { passed = false; }
+
+            // writing straight to a file descriptor gives the same bytes
+            int fd = open(EXPORT_PATH.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            FdSink fdSink(fd);
+            if (!obj.exportTo(fdSink)) { passed = false; }
+            close(fd);
+
+            std::ifstream in(EXPORT_PATH, std::ifstream::binary);
+            string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (written != csv) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(EXPORT_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // what the sink is handed
+    {
+        cout << "Testing exports: Exporting through a callback, an empty tree, and to a sink that fails." << endl;
+        cout << "Expects: Only full buffers before the last one, nothing for an empty tree, and false once the sink fails." << endl;
+        bool passed = true;
+
+        try {
+            UTree big, empty;
+            string expected;
+            vector<size_t> sizes;
+
+            // enough accounts to need several buffers
+            for (int i = 0; i < 60000; i++) {
+                big.insert(Account("member" + std::to_string(i / 10), i % 10, false, "Early Supporter",
+                                   "Listening to something"));
+            }
+
+            StringSink expectedSink(expected);
+            big.exportTo(expectedSink);
+
+            string received;
+            CallbackSink callback([&](const char *data, size_t size) {
+                sizes.push_back(size);
+                received.append(data, size);
+                return true;
+            });
+            if (!big.exportTo(callback)) { passed = false; }
+
+            if (received != expected || sizes.size() < 2) { passed = false; }
+            for (size_t i = 0; i + 1 < sizes.size(); i++) {
+                if (sizes[i] != EXPORT_BUFFER_SIZE) { passed = false; }
+            }
+
+            int numCalls = 0;
+            CallbackSink counting([&](const char*, size_t) {
+                numCalls++;
+                return true;
+            });
+            if (!empty.exportTo(counting) || numCalls != 0) { passed = false; }
+
+            // the first refusal ends the export
+            CallbackSink refusing([&](const char*, size_t) {
+                numCalls++;
+                return false;
+            });
+            if (big.exportTo(refusing, EXPORT_CSV) || numCalls != 1) { passed = false; }
+            if (big.exportTo(refusing, EXPORT_BINARY)) { passed = false; }
+
+            try {
+                big.exportTo(counting, 7);
+                passed = false;
+            } catch (const std::invalid_argument&) {}
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void exportTimeRun() {
+    Tester tester;
+
+    cout << "Testing exports: Export throughput to memory and to /dev/null." << endl;
+    tester.exportTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+////////////////////////////// vvv merging vvv //////////////////////////////////
+void mergeTests(int &numTestsPassed, int &numTests) {
+    const string CSV_PATH = "merge_test.csv";
+    Tester tester;
+
+    // merging trees
+    {
+        cout << "Testing merges: Merging a tree into one sharing usernames and accounts with it." << endl;
+        cout << "Expects: The accounts inserting one after the other keeps, balanced, with the other tree emptied." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, other, inserted;
+            vector<Account> first, second;
+
+            for (int i = 0; i < 3000; i++) {
+                first.push_back(Account("user" + std::to_string((i * 41) % 500), (i * 7) % 31, i % 2, "first", ""));
+                second.push_back(Account("user" + std::to_string((i * 43) % 700 + 250), (i * 11) % 31, 0, "second",
+                                         "status"));
+            }
+            for (const Account& acct : first) { obj.insert(acct); }
+            for (const Account& acct : second) { other.insert(acct); }
+
+            // vacant nodes on both sides
+            for (int i = 0; i < 3000; i += 7) {
+                DNode *removed = nullptr;
+                if (obj.removeUser(first[i].getUsername(), first[i].getDiscriminator(), removed)) {
+                    first[i] = Account();
+                }
+                delete removed;
+                removed = nullptr;
+                if (other.removeUser(second[i].getUsername(), second[i].getDiscriminator(), removed)) {
+                    second[i] = Account();
+                }
+                delete removed;
+            }
+
+            for (const Account& acct : first) {
+                if (acct.getDiscriminator() != INVALID_DISC) { inserted.insert(acct); }
+            }
+            for (const Account& acct : second) {
+                if (acct.getDiscriminator() != INVALID_DISC) { inserted.insert(acct); }
+            }
+
+            obj.enableHashIndex();
+            obj.mergeFrom(std::move(other));
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(inserted)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj) || !tester.verifyUHashIndex(obj)) {
+                passed = false;
+            }
+            obj.forEachWithPrefix("", [&](UNode *node, int) {
+                if (!tester.verifyDSizes(*node->getDTree())) { passed = false; }
+            });
+
+            if (tester.describeAccounts(other) != "" || other.retrieve("user300")) { passed = false; }
+
+            // the emptied tree is still usable, and merging an empty tree changes nothing
+            string before = tester.describeAccounts(obj);
+            if (!other.insert(createAccount(1, "user300"))) { passed = false; }
+            obj.mergeFrom(UTree());
+            obj.mergeFrom(std::move(obj));
+            if (tester.describeAccounts(obj) != before) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // merging sorted files
+    {
+        cout << "Testing merges: Merging a sorted file, then files out of order." << endl;
+        cout << "Expects: The same accounts as appending the file, and std::invalid_argument with the tree unchanged." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, appended;
+
+            for (int i = 0; i < 2000; i++) {
+                Account acct("user" + std::to_string((i * 37) % 400), (i * 13) % 50, false, "existing", "");
+                obj.insert(acct);
+                appended.insert(acct);
+            }
+
+            // usernames sorted as strings, with a repeated row for each name
+            vector<string> usernames;
+            for (int i = 0; i < 600; i += 3) { usernames.push_back("user" + std::to_string(i)); }
+            std::sort(usernames.begin(), usernames.end());
+
+            std::ofstream out(CSV_PATH);
+            for (const string& username : usernames) {
+                for (int disc = 0; disc < 50; disc += 4) {
+                    out << username << ',' << disc << ",1,merged" << disc << ",status\n";
+                }
+                out << username << ",48,0,repeat,status\n";
+            }
+            out.close();
+
+            appended.loadData(CSV_PATH, true);
+            obj.mergeSorted(CSV_PATH);
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(appended)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+
+            string before = tester.describeAccounts(obj);
+            string unsorted[] = {"userb,1,0,,\nusera,1,0,,\n", "usera,2,0,,\nusera,1,0,,\n"};
+            for (const string& contents : unsorted) {
+                std::ofstream(CSV_PATH) << "new,1,0,,\n" << contents;
+
+                try {
+                    obj.mergeSorted(CSV_PATH);
+                    passed = false;
+                } catch (const std::invalid_argument&) {}
+            }
+            if (tester.describeAccounts(obj) != before || obj.retrieve("new")) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void mergeTimeRun() {
+    Tester tester;
+
+    cout << "Testing merges: Applying a delta a tenth of the tree's size." << endl;
+    tester.mergeTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+/////////////////////////// vvv splitting and joining vvv /////////////////////////
+void splitJoinTests(int &numTestsPassed, int &numTests) {
+    Tester tester;
+
+    // splits
+    {
+        cout << "Testing split/join: Splitting at the first, a missing, an existing, and a past-the-end username." << endl;
+        cout << "Expects: Each side holds its own usernames as an AVL tree with a correct hash index, and joining restores the tree." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            for (int i = 0; i < 3000; i++) {
+                obj.insert(createAccount(i % 7, "user" + std::to_string((i * 37) % 1000)));
+            }
+            string whole = tester.describeAccounts(obj);
+
+            string splits[] = {"", "user5000", "user500", "zzz", "user0"};
+            for (const string& username : splits) {
+                UTree right;
+                right.insert(createAccount(1, "replaced"));
+                obj.enableHashIndex();
+                right.enableHashIndex();
+
+                obj.split(username, right);
+
+                if (tester.describeAccounts(obj) + tester.describeAccounts(right) != whole) { passed = false; }
+                if (right.retrieve("replaced")) { passed = false; }
+
+                UTree *sides[] = {&obj, &right};
+                for (UTree *side : sides) {
+                    // verifyUHeights() needs a root, and one side of the first and last splits is empty
+                    if (tester.getURoot(*side) && !tester.verifyUHeights(*side)) { passed = false; }
+                    if (!tester.verifyUHeightValues(*side)) { passed = false; }
+                    if (!tester.verifyUHashIndex(*side)) { passed = false; }
+                }
+
+                obj.forEachWithPrefix("", [&](UNode *node, int) {
+                    if (!(node->getUsername() < username)) { passed = false; }
+                });
+                right.forEachWithPrefix("", [&](UNode *node, int) {
+                    if (node->getUsername() < username) { passed = false; }
+                });
+
+                obj.disableHashIndex();
+                obj.join(std::move(right));
+
+                if (tester.describeAccounts(obj) != whole || tester.describeAccounts(right) != "") { passed = false; }
+                if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // joins
+    {
+        cout << "Testing split/join: Joining trees of very different heights, empty trees, and trees out of order." << endl;
+        cout << "Expects: Balanced joins in both directions, and std::invalid_argument with both trees unchanged." << endl;
+        bool passed = true;
+
+        try {
+            int sizes[][2] = {{2000, 1}, {1, 2000}, {2000, 3}, {5, 1500}, {0, 10}, {10, 0}};
+            for (auto& size : sizes) {
+                UTree left, right, all;
+                for (int i = 0; i < size[0]; i++) {
+                    left.insert(createAccount(1, "a" + std::to_string(i)));
+                    all.insert(createAccount(1, "a" + std::to_string(i)));
+                }
+                for (int i = 0; i < size[1]; i++) {
+                    right.insert(createAccount(2, "b" + std::to_string(i)));
+                    all.insert(createAccount(2, "b" + std::to_string(i)));
+                }
+
+                left.enableHashIndex();
+                left.join(std::move(right));
+
+                if (tester.describeAccounts(left) != tester.describeAccounts(all)) { passed = false; }
+                if (!tester.verifyUHeights(left) || !tester.verifyUHeightValues(left)) { passed = false; }
+                if (!tester.verifyUHashIndex(left) || right.retrieve("b0")) { passed = false; }
+            }
+
+            UTree left, right;
+            for (int i = 0; i < 100; i++) {
+                left.insert(createAccount(1, "m" + std::to_string(i)));
+                right.insert(createAccount(1, "n" + std::to_string(i)));
+            }
+            right.insert(createAccount(1, "m99"));
+            string leftBefore = tester.describeAccounts(left), rightBefore = tester.describeAccounts(right);
+
+            try {
+                left.join(std::move(right));
+                passed = false;
+            } catch (const std::invalid_argument&) {}
+
+            if (tester.describeAccounts(left) != leftBefore || tester.describeAccounts(right) != rightBefore) {
+                passed = false;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void splitJoinTimeRun() {
+    Tester tester;
+
+    cout << "Testing split/join: Moving the usernames from user5 on out and back." << endl;
+    tester.splitJoinTime(NUM_TRIALS - 2, NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv concurrency vvv //////////////////////////////
+void concurrencyTests(int &numTestsPassed, int &numTests) {
+    const int NUM_THREADS = 4;
+    const string SNAPSHOT_PATH = "concurrency_test_snapshot.bin";
+    const string LOG_PATH = "concurrency_test.wal";
+    Tester tester;
+
+    // writers
+    {
+        cout << "Testing concurrency: " << NUM_THREADS << " threads inserting and removing, on their own and shared usernames." << endl;
+        cout << "Expects: The same accounts as running every thread's work one after the other, in a valid tree and index." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, serial;
+
+            // thread t owns usernames ending in t; "shared" is written to by everyone,
+            // each thread with its own discriminators
+            auto work = [](UTree &tree, int t) {
+                for (int i = 0; i < 2000; i++) {
+                    string username = "user" + std::to_string(i % 150) + "_" + std::to_string(t);
+                    tree.insert(Account(username, i % 40, i % 2, "badge", "status"));
+                    tree.insert(Account("shared", t * 1000 + i % 500, false, "", ""));
+
+                    // every so often empty a username out entirely, taking its UNode with it
+                    if (i % 7 == 0) {
+                        for (int disc = 0; disc < 40; disc++) {
+                            DNode *removed = nullptr;
+                            if (tree.removeUser("user" + std::to_string((i * 3) % 150) + "_" + std::to_string(t), disc, removed)) {
+                                delete removed;
+                            }
+                        }
+                    }
+                }
+            };
+
+            obj.enableConcurrency();
+            vector<std::thread> threads;
+            for (int t = 0; t < NUM_THREADS; t++) { threads.emplace_back(work, std::ref(obj), t); }
+            for (std::thread& thread : threads) { thread.join(); }
+
+            for (int t = 0; t < NUM_THREADS; t++) { work(serial, t); }
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(serial)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj) || !tester.verifyUHashIndex(obj)) {
+                passed = false;
+            }
+
+            // the index stays for as long as concurrency does
+            obj.disableHashIndex();
+            if (!obj.hasHashIndex() || obj.numUsers("shared") != NUM_THREADS * 500) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // readers alongside writers
+    {
+        cout << "Testing concurrency: Readers looking up accounts while writers add and remove others." << endl;
+        cout << "Expects: Accounts nobody touches are always found, with the right count, and the log replays the result." << endl;
+        bool passed = true;
+
+        try {
+            std::remove(SNAPSHOT_PATH.c_str());
+            std::remove(LOG_PATH.c_str());
+
+            UTree obj;
+            obj.recover(SNAPSHOT_PATH, LOG_PATH, LOG_SYNC_NONE);
+            for (int i = 0; i < 200; i++) { obj.insert(createAccount(i % 5, "stable" + std::to_string(i / 5))); }
+            obj.enableConcurrency();
+
+            std::atomic<bool> readersOk(true);
+            std::atomic<int> writersLeft(NUM_THREADS / 2);
+            vector<std::thread> threads;
+
+            for (int t = 0; t < NUM_THREADS / 2; t++) {
+                threads.emplace_back([&obj, &writersLeft, t]() {
+                    for (int i = 0; i < 3000; i++) {
+                        string username = "churn" + std::to_string(i % 60);
+                        DNode *removed = nullptr;
+                        obj.insert(createAccount(t * 100 + i % 50, username));
+                        if (obj.removeUser(username, t * 100 + (i * 7) % 50, removed)) { delete removed; }
+                    }
+                    writersLeft--;
+                });
+                threads.emplace_back([&obj, &readersOk, &writersLeft]() {
+                    do {
+                        for (int i = 0; i < 40; i++) {
+                            string username = "stable" + std::to_string(i);
+                            if (!obj.retrieveUser(username, i % 5) || obj.numUsers(username) != 5 || !obj.retrieve(username)) {
+                                readersOk = false;
+                            }
+                        }
+                        obj.numUsers("churn1");
+                    } while (writersLeft > 0);
+                });
+            }
+            for (std::thread& thread : threads) { thread.join(); }
+
+            if (!readersOk) { passed = false; }
+
+            obj.syncLog();
+            copyFile(LOG_PATH, LOG_PATH + ".copy");
+            UTree recovered;
+            recovered.recover(SNAPSHOT_PATH, LOG_PATH + ".copy");
+            recovered.disableLog();
+            if (tester.describeAccounts(recovered) != tester.describeAccounts(obj)) { passed = false; }
+            obj.disableLog();
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        std::remove(LOG_PATH.c_str());
+        std::remove((LOG_PATH + ".copy").c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void concurrencyTimeRun() {
+    Tester tester;
+
+    cout << "Testing concurrency: Mutation throughput as threads are added, against one global mutex." << endl;
+    tester.concurrencyTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+////////////////////////////// vvv sharding vvv /////////////////////////////////
+void shardedTests(int &numTestsPassed, int &numTests) {
+    const string CSV_PATH = "sharded_test.csv";
+    const int NUM_SHARDS = 8;
+
+    // agreement with a single UTree
+    {
+        cout << "Testing ShardedUTree: Inserting, removing and traversing across " << NUM_SHARDS << " shards." << endl;
+        cout << "Expects: The results of one UTree, with traversals in username order whatever shard a name is in." << endl;
+        bool passed = true;
+
+        try {
+            ShardedUTree obj(NUM_SHARDS);
+            UTree single;
+
+            for (int i = 0; i < 3000; i++) {
+                Account acct("user" + std::to_string((i * 37) % 800), i % 23, false, "", "");
+                if (obj.insert(acct) != single.insert(acct)) { passed = false; }
+            }
+            for (int i = 0; i < 800; i += 3) {
+                DNode *removed = nullptr, *singleRemoved = nullptr;
+                string username = "user" + std::to_string(i);
+                if (obj.removeUser(username, i % 23, removed) != single.removeUser(username, i % 23, singleRemoved)) {
+                    passed = false;
+                }
+                delete removed;
+                delete singleRemoved;
+            }
+
+            for (int i = 0; i < 900; i++) {
+                string username = "user" + std::to_string(i);
+                if (obj.numUsers(username) != single.numUsers(username)) { passed = false; }
+                if (!obj.retrieveUser(username, i % 23) != !single.retrieveUser(username, i % 23)) { passed = false; }
+            }
+
+            // the usernames are spread over every shard
+            vector<int> perShard(NUM_SHARDS);
+            for (int i = 0; i < 800; i++) { perShard[obj.shardOf("user" + std::to_string(i))]++; }
+            for (int count : perShard) {
+                if (count < 800 / NUM_SHARDS / 2) { passed = false; }
+            }
+
+            string prefixes[] = {"", "user1", "user79", "nobody"};
+            int limits[] = {NO_LIMIT, 1, 25};
+            for (const string& prefix : prefixes) {
+                for (int limit : limits) {
+                    string sharded, expected;
+                    int visited = obj.forEachWithPrefix(prefix, [&](UNode *node, int numUsers) {
+                        sharded += node->getUsername() + ":" + std::to_string(numUsers) + " ";
+                    }, limit);
+                    int expectedVisited = single.forEachWithPrefix(prefix, [&](UNode *node, int numUsers) {
+                        expected += node->getUsername() + ":" + std::to_string(numUsers) + " ";
+                    }, limit);
+
+                    if (sharded != expected || visited != expectedVisited) { passed = false; }
+                }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // loading and threads
+    {
+        cout << "Testing ShardedUTree: Loading a file in both modes, then inserting from several threads." << endl;
+        cout << "Expects: The accounts one UTree would hold each time." << endl;
+        bool passed = true;
+
+        try {
+            std::ofstream out(CSV_PATH);
+            for (int i = 0; i < 4000; i++) {
+                out << "user" << (i * 53) % 900 << ',' << (i * 31) % 17 << ',' << i % 2 << ",badge" << i << ",status\n";
+            }
+            out.close();
+
+            ShardedUTree obj(NUM_SHARDS);
+            UTree single;
+
+            auto describe = [](UserIndex &index) {
+                string description;
+                index.forEachWithPrefix("", [&](UNode *node, int) {
+                    node->getDTree()->forEachAccount([&](const Account& acct) {
+                        description += acct.getUsername() + "#" + std::to_string(acct.getDiscriminator()) + ":"
+                                       + acct.getBadge() + " ";
+                    });
+                });
+                return description;
+            };
+
+            obj.insert(createAccount(1, "dropped"));
+            obj.loadData(CSV_PATH, false);
+            single.loadData(CSV_PATH, false);
+            if (describe(obj) != describe(single) || obj.retrieve("dropped")) { passed = false; }
+
+            obj.loadData(CSV_PATH, true);
+            single.loadData(CSV_PATH, true);
+            if (describe(obj) != describe(single)) { passed = false; }
+
+            obj.clear();
+            single.clear();
+
+            vector<std::thread> threads;
+            for (int t = 0; t < 4; t++) {
+                threads.emplace_back([&obj, t]() {
+                    for (int i = 0; i < 3000; i++) { obj.insert(createAccount(i % 50, "user" + std::to_string((i + t) % 400))); }
+                });
+            }
+            for (std::thread& thread : threads) { thread.join(); }
+
+            for (int t = 0; t < 4; t++) {
+                for (int i = 0; i < 3000; i++) { single.insert(createAccount(i % 50, "user" + std::to_string((i + t) % 400))); }
+            }
+            if (describe(obj) != describe(single)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void shardedTimeRun() {
+    Tester tester;
+
+    cout << "Testing ShardedUTree: Insertion throughput as threads are added, against one UTree behind a mutex." << endl;
+    tester.shardedTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv lock-free reads vvv ////////////////////////////
+void lockFreeTests(int &numTestsPassed, int &numTests) {
+    const int NUM_READERS = 3;
+    Tester tester;
+
+    // path copying
+    {
+        cout << "Testing lock-free reads: Inserting and removing by copying paths, with every kind of rotation and replacement." << endl;
+        cout << "Expects: The accounts and AVL heights of an ordinary tree, held nodes left untouched, and everything retired freed." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, plain;
+            obj.enableLockFreeReads();
+
+            // ascending, descending and interleaved usernames rotate every way; emptying
+            // usernames with two children exercises the replacement
+            auto work = [](UTree &tree) {
+                for (int i = 0; i < 600; i++) {
+                    string username = "user" + std::to_string((i * 37) % 211);
+                    tree.insert(createAccount(i % 9, username));
+                    tree.insert(createAccount(i % 9, "asc" + std::to_string(1000 + i)));
+                    tree.insert(createAccount(i % 9, "desc" + std::to_string(1000 - i)));
+                }
+                for (int i = 0; i < 600; i += 2) {
+                    DNode *removed = nullptr;
+                    if (tree.removeUser("asc" + std::to_string(1000 + i), i % 9, removed)) { delete removed; }
+                    for (int disc = 0; disc < 9; disc++) {
+                        if (tree.removeUser("user" + std::to_string(i % 211), disc, removed)) { delete removed; }
+                    }
+                }
+            };
+
+            // a node held across writes keeps the username and accounts it had
+            obj.insert(createAccount(1, "held"));
+            UNode *held = nullptr;
+            {
+                UEpochGuard guard(obj.getEpoch());
+                held = obj.retrieve("held");
+                work(obj);
+                DNode *removed = nullptr;
+                if (!obj.removeUser("held", 1, removed)) { passed = false; }
+                delete removed;
+                obj.getEpoch()->collect();
+
+                if (!held || held->getUsername() != "held" || held->getDTree()->getNumUsers() != 1 || obj.retrieve("held")) {
+                    passed = false;
+                }
+            }
+            work(plain);
+
+            if (tester.describeAccounts(obj) != tester.describeAccounts(plain)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            if (obj.numUsers("desc900") != 1 || !obj.retrieveUser("asc1001", 1) || obj.retrieveUser("asc1000", 0)) {
+                passed = false;
+            }
+
+            // unpinned, two epochs are enough to free it all
+            obj.getEpoch()->collect();
+            if (obj.getEpoch()->numRetired() != 0 || obj.getEpoch()->numFreed() == 0) { passed = false; }
+
+            // the hash index cannot follow copied UNodes, and concurrent mode replaces this one
+            obj.enableHashIndex();
+            if (obj.hasHashIndex()) { passed = false; }
+            obj.enableConcurrency();
+            if (obj.hasLockFreeReads() || !obj.hasHashIndex() || !tester.verifyUHashIndex(obj)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // stress
+    {
+        cout << "Testing lock-free reads: " << NUM_READERS << " readers hammering lookups while one writer churns usernames." << endl;
+        cout << "Expects: Untouched accounts always found with the right contents, and the writes of a serial run." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, serial;
+            for (int i = 0; i < 200; i++) {
+                obj.insert(createAccount(i % 5, "stable" + std::to_string(i / 5)));
+                serial.insert(createAccount(i % 5, "stable" + std::to_string(i / 5)));
+            }
+            obj.enableLockFreeReads();
+
+            // churn usernames keep appearing and emptying out, so UNodes are linked,
+            // replaced and rotated all the while
+            auto work = [](UTree &tree) {
+                for (int i = 0; i < 20000; i++) {
+                    DNode *removed = nullptr;
+                    tree.insert(createAccount(i % 30, "churn" + std::to_string((i * 13) % 97)));
+                    if (tree.removeUser("churn" + std::to_string((i * 7) % 97), (i * 11) % 30, removed)) { delete removed; }
+                }
+            };
+
+            std::atomic<bool> writing(true);
+            std::atomic<bool> readersOk(true);
+            vector<std::thread> threads;
+
+            for (int t = 0; t < NUM_READERS; t++) {
+                threads.emplace_back([&obj, &writing, &readersOk]() {
+                    do {
+                        for (int i = 0; i < 40; i++) {
+                            string username = "stable" + std::to_string(i);
+                            UEpochGuard guard(obj.getEpoch());
+                            DNode *found = obj.retrieveUser(username, i % 5);
+
+                            if (!found || found->getUsername() != username || found->getDiscriminator() != i % 5
+                                || obj.numUsers(username) != 5) {
+                                readersOk = false;
+                            }
+
+                            UNode *churn = obj.retrieve("churn" + std::to_string(i));
+                            if (churn && churn->getUsername() != "churn" + std::to_string(i)) { readersOk = false; }
+                        }
+                    } while (writing);
+                });
+            }
+            work(obj);
+            writing = false;
+            for (std::thread& thread : threads) { thread.join(); }
+
+            work(serial);
+
+            if (!readersOk) { passed = false; }
+            if (tester.describeAccounts(obj) != tester.describeAccounts(serial)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+
+            // retired nodes are freed as the writer goes, not only at the end
+            if (obj.getEpoch()->numFreed() == 0) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // clearing and merging beside readers
+    {
+        cout << "Testing lock-free reads: " << NUM_READERS << " readers looking up accounts while the writer refills, clears and tries mergeFrom()." << endl;
+        cout << "Expects: Readers only ever see accounts that were inserted, mergeFrom() refused either way round with both trees intact, and clear() retiring rather than freeing." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, other;
+            obj.enableLockFreeReads();
+            other.insert(createAccount(1, "other"));
+
+            std::atomic<bool> writing(true);
+            std::atomic<bool> readersOk(true);
+            vector<std::thread> threads;
+
+            for (int t = 0; t < NUM_READERS; t++) {
+                threads.emplace_back([&obj, &writing, &readersOk]() {
+                    do {
+                        for (int i = 0; i < 40; i++) {
+                            string username = "stable" + std::to_string(i);
+                            UEpochGuard guard(obj.getEpoch());
+                            DNode *found = obj.retrieveUser(username, i % 5);
+                            int count = obj.numUsers(username);
+
+                            if (found && (found->getUsername() != username || found->getDiscriminator() != i % 5)) {
+                                readersOk = false;
+                            }
+                            if (count < 0 || count > 5) { readersOk = false; }
+                        }
+                    } while (writing);
+                });
+            }
+
+            for (int round = 0; round < 200; round++) {
+                // readers may catch a username with any of its five accounts in
+                for (int i = 0; i < 40; i++) {
+                    for (int disc = 0; disc < 5; disc++) {
+                        obj.insert(createAccount(disc, "stable" + std::to_string(i)));
+                    }
+                }
+
+                // mergeFrom() relinks both trees' nodes in place, so neither side may read lock-free
+                try {
+                    obj.mergeFrom(std::move(other));
+                    passed = false;
+                } catch (const std::logic_error&) {}
+                try {
+                    other.mergeFrom(std::move(obj));
+                    passed = false;
+                } catch (const std::logic_error&) {}
+                if (obj.numUsers("stable0") != 5 || obj.retrieve("other") || other.numUsers("other") != 1) { passed = false; }
+
+                obj.clear();
+            }
+
+            writing = false;
+            for (std::thread& thread : threads) { thread.join(); }
+
+            if (!readersOk) { passed = false; }
+            if (obj.retrieve("stable0")) { passed = false; }
+
+            // cleared trees go the way of any retired node
+            obj.getEpoch()->collect();
+            if (obj.getEpoch()->numRetired() != 0 || obj.getEpoch()->numFreed() == 0) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void lockFreeTimeRun() {
+    Tester tester;
+
+    cout << "Testing lock-free reads: Lookup throughput beside one writer, against tree walks behind one reader-writer lock and concurrent mode's hash index." << endl;
+    tester.lockFreeTime(NUM_TRIALS - 2, NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv persistence vvv ////////////////////////////////
+// lists a snapshot's usernames, counts and discriminators in order
+string describeSnapshot(const USnapshot& snap) {
+    string description;
+
+    snap.forEachWithPrefix("", [&description](UNode *node, int count) {
+        description += node->getUsername() + ":" + std::to_string(count) + "[";
+        node->getDTree()->forEachAccount([&description](const Account& acct) {
+            description += std::to_string(acct.getDiscriminator()) + " ";
+        });
+        description += "]";
+    });
+
+    return description;
+}
+
+void persistenceTests(int &numTestsPassed, int &numTests) {
+    const int NUM_READERS = 3;
+    const string CSV_PATH = "persistence_test.csv";
+    const string SNAPSHOT_PATH = "persistence_test.bin";
+    Tester tester;
+
+    // churn over a few usernames: DTrees grow, rebuild, fill vacancies and empty out
+    auto work = [](UTree &tree, int n, int seed) {
+        for (int i = 0; i < n; i++) {
+            DNode *removed = nullptr;
+            tree.insert(createAccount((i * 7) % 50, "user" + std::to_string((i * 13 + seed) % 300)));
+            if (tree.removeUser("user" + std::to_string((i * 11 + seed) % 300), (i * 3) % 50, removed)) { delete removed; }
+        }
+    };
+
+    // versions
+    {
+        cout << "Testing persistence: Taking snapshots, writing on, and letting the snapshots go." << endl;
+        cout << "Expects: Each snapshot unchanged by later writes, DTrees shaped as in place, and nothing held once released." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, plain;
+
+            // there is nothing to snapshot without versions
+            try {
+                obj.snapshot();
+                passed = false;
+            } catch (const std::logic_error&) {}
+
+            obj.enablePersistence();
+            work(obj, 3000, 1);
+            work(plain, 3000, 1);
+            std::shared_ptr<USnapshot> first = obj.snapshot();
+            string firstDescription = describeSnapshot(*first);
+
+            work(obj, 8000, 2);
+            work(plain, 8000, 2);
+            std::shared_ptr<USnapshot> second = obj.snapshot();
+            std::shared_ptr<USnapshot> again = second;
+            string secondDescription = describeSnapshot(*second);
+
+            work(obj, 8000, 3);
+            work(plain, 8000, 3);
+
+            if (describeSnapshot(*first) != firstDescription || describeSnapshot(*again) != secondDescription
+                || firstDescription == secondDescription || second->getVersion() <= first->getVersion()) {
+                passed = false;
+            }
+
+            // lookups on a snapshot agree with walking it
+            first->forEachWithPrefix("user2", [&first, &passed](UNode *node, int count) {
+                const string& username = node->getUsername();
+                if (first->retrieve(username) != node || first->numUsers(username) != count) { passed = false; }
+                node->getDTree()->forEachAccount([&first, &passed, &username](const Account& acct) {
+                    if (!first->retrieveUser(username, acct.getDiscriminator())) { passed = false; }
+                });
+            });
+            if (first->retrieve("nobody") || first->numUsers("nobody") != 0) { passed = false; }
+
+            // path copying the DTrees shapes them exactly like the operations in place
+            if (tester.describeAccounts(obj) != tester.describeAccounts(plain)) { passed = false; }
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            for (int i = 0; i < 300; i++) {
+                UNode *node = obj.retrieve("user" + std::to_string(i));
+                UNode *match = plain.retrieve("user" + std::to_string(i));
+                if (!node != !match) { passed = false; }
+                else if (node && (!tester.checkDTreeEquality(*node->getDTree(), *match->getDTree())
+                                  || !tester.verifyDSizes(*node->getDTree()))) {
+                    passed = false;
+                }
+            }
+
+            // the oldest snapshot keeps the most; the last reference frees the rest
+            UVersions *versions = obj.getVersions();
+            size_t bothHeld = versions->numHeld();
+            first.reset();
+            size_t secondHeld = versions->numHeld();
+            second.reset();
+            if (versions->numSnapshots() != 1 || versions->numHeld() != secondHeld) { passed = false; }
+            again.reset();
+            if (bothHeld <= secondHeld || secondHeld == 0 || versions->numHeld() != 0 || versions->numSnapshots() != 0) {
+                passed = false;
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // long scans beside a writer
+    {
+        cout << "Testing persistence: " << NUM_READERS << " readers scanning snapshots over and over while one writer churns." << endl;
+        cout << "Expects: Every snapshot reads the same on each scan, and the writes of a serial run." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, serial;
+            obj.enablePersistence();
+
+            std::atomic<bool> writing(true);
+            std::atomic<bool> readersOk(true);
+            vector<std::thread> threads;
+
+            for (int t = 0; t < NUM_READERS; t++) {
+                threads.emplace_back([&obj, &writing, &readersOk]() {
+                    do {
+                        std::shared_ptr<USnapshot> snap = obj.snapshot();
+                        string description = describeSnapshot(*snap);
+                        std::this_thread::yield();
+                        if (describeSnapshot(*snap) != description) { readersOk = false; }
+                    } while (writing);
+                });
+            }
+            work(obj, 20000, 4);
+            writing = false;
+            for (std::thread& thread : threads) { thread.join(); }
+
+            work(serial, 20000, 4);
+
+            if (!readersOk) { passed = false; }
+            if (tester.describeAccounts(obj) != tester.describeAccounts(serial)) { passed = false; }
+            if (obj.getVersions()->numHeld() != 0) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // clearing and bulk operations
+    {
+        cout << "Testing persistence: Clearing under a snapshot, then every bulk operation that relinks nodes in place." << endl;
+        cout << "Expects: The snapshot reads the same after clear(), and each bulk operation throws std::logic_error with both trees intact." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, plain, other, right;
+            obj.enablePersistence();
+            work(obj, 3000, 5);
+
+            // clear() hands the tree to the snapshot instead of freeing it
+            std::shared_ptr<USnapshot> cleared = obj.snapshot();
+            string clearedDescription = describeSnapshot(*cleared);
+            obj.clear();
+            if (describeSnapshot(*cleared) != clearedDescription || clearedDescription.empty() || obj.retrieve("user5")) {
+                passed = false;
+            }
+            cleared.reset();
+            if (obj.getVersions()->numHeld() != 0) { passed = false; }
+
+            work(obj, 3000, 6);
+            work(plain, 3000, 6);
+            plain.saveSnapshot(SNAPSHOT_PATH);
+            std::ofstream(CSV_PATH) << "user1,1,0,,\n";
+            other.insert(createAccount(1, "zzz"));
+
+            std::shared_ptr<USnapshot> held = obj.snapshot();
+            string heldDescription = describeSnapshot(*held);
+            string current = tester.describeAccounts(obj);
+
+            std::function<void()> bulk[] = {
+                [&]() { obj.mergeFrom(std::move(other)); },
+                [&]() { other.mergeFrom(std::move(obj)); },
+                [&]() { obj.mergeSorted(CSV_PATH); },
+                [&]() { obj.split("user150", right); },
+                [&]() { obj.join(std::move(other)); },
+                [&]() { right.join(std::move(obj)); },
+                [&]() { obj.loadData(CSV_PATH, false); },
+                [&]() { obj.loadDataParallel(CSV_PATH, 2); },
+                [&]() { obj.loadSnapshot(SNAPSHOT_PATH); }
+            };
+            for (std::function<void()>& operation : bulk) {
+                try {
+                    operation();
+                    passed = false;
+                } catch (const std::logic_error&) {}
+            }
+
+            if (tester.describeAccounts(obj) != current || describeSnapshot(*held) != heldDescription) { passed = false; }
+            if (other.numUsers("zzz") != 1 || right.retrieve("user150") || obj.retrieve("zzz")) { passed = false; }
+
+            // appending goes through insert(), which copies paths as usual
+            obj.loadData(CSV_PATH, true);
+            if (!obj.retrieveUser("user1", 1) || describeSnapshot(*held) != heldDescription) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+        std::remove(SNAPSHOT_PATH.c_str());
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void persistenceTimeRun() {
+    Tester tester;
+
+    cout << "Testing persistence: Write throughput and memory held per write while a snapshot is alive." << endl;
+    tester.persistenceTime(NUM_TRIALS - 2, NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv batch lookup vvv ////////////////////////////////
+
+void batchLookupTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 400;
+
+    // hits, vacant discriminators, unknown discriminators and unknown usernames, shuffled
+    auto makeKeys = [](int count) {
+        vector<UserKey> keys;
+        for (int i = 0; i < count; i++) {
+            long long name = (long long)i * 7919 % (NUM_USERNAMES + 50);
+            keys.push_back({"user" + std::to_string(name), (i * 7) % 25});
+        }
+        return keys;
+    };
+
+    auto build = [](UTree &tree) {
+        for (int i = 0; i < NUM_USERNAMES * 10; i++) { tree.insert(createAccount(i % 20, "user" + std::to_string(i / 10))); }
+        for (int i = 0; i < NUM_USERNAMES; i += 3) {
+            DNode *removed = nullptr;
+            if (tree.removeUser("user" + std::to_string(i), i % 10, removed)) { delete removed; }
+        }
+    };
+
+    // a batch gives exactly what retrieveUser() gives key by key
+    auto agrees = [](UTree &tree, const vector<UserKey> &keys) {
+        vector<DNode*> results(keys.size() + 1, nullptr);
+        DNode *sentinel = reinterpret_cast<DNode*>(&results);
+        results[keys.size()] = sentinel;
+
+        tree.retrieveUserBatch(keys.data(), (int)keys.size(), results.data());
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (results[i] != tree.retrieveUser(keys[i].username, keys[i].disc)) { return false; }
+        }
+
+        return results[keys.size()] == sentinel;
+    };
+
+    // plain tree
+    {
+        cout << "Testing batch lookup: Batches of 0, 1, 17 and 1000 keys mixing hits and misses." << endl;
+        cout << "Expects: Each result matching retrieveUser(), nothing written past the batch, and an empty tree missing everything." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, empty;
+            build(obj);
+
+            int found = 0;
+            for (int count : {0, 1, 17, 1000}) {
+                vector<UserKey> keys = makeKeys(count);
+                if (!agrees(obj, keys) || !agrees(empty, keys)) { passed = false; }
+
+                vector<DNode*> results(count);
+                obj.retrieveUserBatch(keys.data(), count, results.data());
+                for (DNode *result : results) { if (result) { found++; } }
+            }
+
+            // the mix has to have had both hits and misses
+            if (found == 0 || found == 1018) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing batch lookup: Batches with the hash index, in concurrent mode, with lock-free reads and persistent." << endl;
+        cout << "Expects: Each result matching retrieveUser() in every mode, and the writes after enabling it seen." << endl;
+        bool passed = true;
+
+        try {
+            vector<UserKey> keys = makeKeys(1000);
+
+            for (int mode = 0; mode < 4; mode++) {
+                UTree obj;
+                build(obj);
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else if (mode == 1) { obj.enableConcurrency(); }
+                else if (mode == 2) { obj.enableLockFreeReads(); }
+                else { obj.enablePersistence(); }
+
+                if (!agrees(obj, keys)) { passed = false; }
+
+                for (int i = 0; i < NUM_USERNAMES; i += 5) {
+                    DNode *removed = nullptr;
+                    obj.insert(createAccount(21, "user" + std::to_string(NUM_USERNAMES + i)));
+                    if (obj.removeUser("user" + std::to_string(i), (i * 7) % 20, removed)) { delete removed; }
+                }
+
+                if (!agrees(obj, keys)) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void batchLookupTimeRun() {
+    Tester tester;
+
+    cout << "Testing batch lookup: Throughput of batched lookups against one retrieveUser() after another." << endl;
+    tester.batchLookupTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv async lookup vvv ////////////////////////////////
+
+void asyncLookupTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 400;
+
+    auto build = [](UTree &tree) {
+        for (int i = 0; i < NUM_USERNAMES * 10; i++) { tree.insert(createAccount(i % 20, "user" + std::to_string(i / 10))); }
+        for (int i = 0; i < NUM_USERNAMES; i += 3) {
+            DNode *removed = nullptr;
+            if (tree.removeUser("user" + std::to_string(i), i % 10, removed)) { delete removed; }
+        }
+    };
+
+    // hits, vacant discriminators, unknown discriminators and unknown usernames
+    auto username = [](int i) { return "user" + std::to_string((long long)i * 7919 % (NUM_USERNAMES + 50)); };
+
+    // runs count lookups of each kind through a scheduler, spawning half of them only once
+    // the first half is under way, and checks them against the plain lookups
+    auto agrees = [&username](UTree &tree, int count, size_t window) {
+        vector<ULookup<DNode*>> accounts;
+        vector<ULookup<int>> counts;
+        ULookupScheduler scheduler(window);
+        accounts.reserve(count);
+        counts.reserve(count);
+
+        for (int i = 0; i < count; i++) {
+            if (i == count / 2) { scheduler.step(); }
+            accounts.push_back(tree.retrieveUserAsync(username(i), (i * 7) % 25));
+            counts.push_back(tree.numUsersAsync(username(i)));
+            scheduler.spawn(accounts.back());
+            scheduler.spawn(counts.back());
+        }
+        scheduler.run();
+
+        bool same = scheduler.numPending() == 0 && !scheduler.step();
+        for (int i = 0; i < count; i++) {
+            if (!accounts[i].done() || accounts[i].get() != tree.retrieveUser(username(i), (i * 7) % 25)) { same = false; }
+            if (!counts[i].done() || counts[i].get() != tree.numUsers(username(i))) { same = false; }
+        }
+
+        return same;
+    };
+
+    // one thread
+    {
+        cout << "Testing async lookup: Scheduling lookups of hits and misses with windows of 1, 16 and 1000." << endl;
+        cout << "Expects: Each lookup matching retrieveUser() and numUsers(), and lookups run without a scheduler just the same." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, empty;
+            build(obj);
+
+            for (size_t window : {1, 16, 1000}) {
+                if (!agrees(obj, 1000, window) || !agrees(empty, 50, window)) { passed = false; }
+            }
+            if (!agrees(obj, 0, LOOKUP_WINDOW)) { passed = false; }
+
+            // a lookup starts suspended, and get() runs it the rest of the way
+            ULookup<DNode*> lookup = obj.retrieveUserAsync("user1", 11);
+            ULookup<int> count = obj.numUsersAsync("user1");
+            if (lookup.done() || count.done()) { passed = false; }
+            lookup.resume();
+            if (lookup.get() != obj.retrieveUser("user1", 11) || !lookup.done() || count.get() != 10) { passed = false; }
+
+            // dropping a lookup part way frees it
+            ULookup<DNode*> dropped = obj.retrieveUserAsync("user2", 2);
+            dropped.resume();
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing async lookup: Scheduling lookups with the hash index, in concurrent mode, persistent, and beside a lock-free writer." << endl;
+        cout << "Expects: Each lookup matching retrieveUser() and numUsers(), and lock-free lookups finding what the writer never touches." << endl;
+        bool passed = true;
+
+        try {
+            for (int mode = 0; mode < 3; mode++) {
+                UTree obj;
+                build(obj);
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else if (mode == 1) { obj.enableConcurrency(); }
+                else { obj.enablePersistence(); }
+
+                if (!agrees(obj, 1000, LOOKUP_WINDOW)) { passed = false; }
+            }
+
+            // usernames 6k + 2 hold discriminators 0 to 9 and lost none to build()'s removals;
+            // those stay put while the writer churns 20 to 29
+            UTree obj;
+            build(obj);
+            obj.enableLockFreeReads();
+            std::atomic<bool> writing(true);
+            std::atomic<bool> readerOk(true);
+
+            std::thread reader([&obj, &writing, &readerOk]() {
+                do {
+                    UEpochGuard guard(obj.getEpoch());
+                    vector<ULookup<DNode*>> lookups;
+                    ULookupScheduler scheduler;
+                    lookups.reserve(200);
+
+                    for (int i = 0; i < 200; i++) {
+                        lookups.push_back(obj.retrieveUserAsync("user" + std::to_string(i * 7 % 33 * 6 + 2), i % 10));
+                        scheduler.spawn(lookups.back());
+                    }
+                    scheduler.run();
+
+                    for (int i = 0; i < 200; i++) {
+                        DNode *found = lookups[i].get();
+                        if (!found || found->getDiscriminator() != i % 10) { readerOk = false; }
+                    }
+                } while (writing);
+            });
+            for (int i = 0; i < 5000; i++) {
+                string name = "user" + std::to_string(i % NUM_USERNAMES);
+                DNode *removed = nullptr;
+                obj.insert(createAccount(20 + i % 10, name));
+                if (obj.removeUser(name, 20 + (i + 5) % 10, removed)) { delete removed; }
+            }
+            writing = false;
+            reader.join();
+
+            if (!readerOk || !agrees(obj, 1000, LOOKUP_WINDOW)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void asyncLookupTimeRun() {
+    Tester tester;
+
+    cout << "Testing async lookup: Throughput of scheduled coroutine lookups against one retrieveUser() after another." << endl;
+    tester.asyncLookupTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv batch mutation vvv ////////////////////////////////
+
+void applyBatchTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 300;
+    const string SNAPSHOT_PATH = "batch_test_snapshot.bin";
+    const string LOG_PATH = "batch_test.wal";
+    Tester tester;
+
+    // inserts and removals over usernames that exist, get emptied, and are new, with
+    // repeats of the same account in one batch
+    auto makeOps = [](int count) {
+        vector<AccountOp> ops;
+        for (int i = 0; i < count; i++) {
+            string username = "user" + std::to_string(rng() % (NUM_USERNAMES + 30));
+            int disc = rng() % 30;
+            if (rng() % 10 < 6) {
+                ops.push_back(AccountOp::insert(Account(username, disc, i % 2, "badge" + std::to_string(i), "")));
+            } else {
+                ops.push_back(AccountOp::remove(username, disc));
+            }
+        }
+        return ops;
+    };
+
+    auto build = [](UTree &tree) {
+        for (int i = 0; i < NUM_USERNAMES * 10; i++) { tree.insert(createAccount(i % 20, "user" + std::to_string(i / 10))); }
+    };
+
+    // applies ops one by one to serial and as a batch to obj, and checks the batch's
+    // results against the accounts serial had before each operation
+    auto agrees = [&tester](UTree &obj, UTree &serial, const vector<AccountOp> &ops) {
+        vector<AccountOpResult> results = obj.applyBatch(ops);
+        bool same = results.size() == ops.size();
+
+        for (size_t i = 0; i < ops.size() && same; i++) {
+            const Account& acct = ops[i].account;
+            bool present = serial.retrieveUser(acct.getUsername(), acct.getDiscriminator()) != nullptr;
+            DNode *removed = nullptr;
+
+            if (ops[i].type == AccountOp::INSERT) {
+                serial.insert(acct);
+                if (results[i].applied == present || results[i].removed) { same = false; }
+            } else {
+                if (present && serial.removeUser(acct.getUsername(), acct.getDiscriminator(), removed)) { delete removed; }
+                if (results[i].applied != present || !results[i].removed != !present) { same = false; }
+                if (results[i].removed && (results[i].removed->getUsername() != acct.getUsername()
+                                           || results[i].removed->getDiscriminator() != acct.getDiscriminator())) {
+                    same = false;
+                }
+            }
+        }
+        for (AccountOpResult& result : results) { delete result.removed; }
+
+        return same && tester.describeAccounts(obj) == tester.describeAccounts(serial);
+    };
+
+    // plain tree
+    {
+        cout << "Testing batch mutation: Batches of inserts and removals against applying them one by one." << endl;
+        cout << "Expects: The same accounts and per operation results, balanced trees, and DTrees rebuilt or updated in place." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj, serial;
+            build(obj);
+            build(serial);
+
+            for (int count : {0, 1, 50, 5000}) {
+                if (!agrees(obj, serial, makeOps(count))) { passed = false; }
+            }
+            if (!obj.applyBatch({}).empty()) { passed = false; }
+
+            // a batch can empty a username and bring it back, or bring one in and empty it
+            vector<AccountOp> ops;
+            for (int disc = 0; disc < 30; disc++) { ops.push_back(AccountOp::remove("user1", disc)); }
+            ops.push_back(AccountOp::insert(createAccount(40, "user1")));
+            ops.push_back(AccountOp::insert(createAccount(40, "brand new")));
+            ops.push_back(AccountOp::remove("brand new", 40));
+            ops.push_back(AccountOp::insert(createAccount(41, "zz new")));
+            for (int disc = 0; disc < 30; disc++) { ops.push_back(AccountOp::remove("user2", disc)); }
+            if (!agrees(obj, serial, ops)) { passed = false; }
+            if (obj.numUsers("user1") != 1 || obj.retrieve("brand new") || !obj.retrieve("zz new") || obj.retrieve("user2")) {
+                passed = false;
+            }
+
+            // a few operations on a large DTree go through it in place
+            for (int disc = 0; disc < 1000; disc++) { obj.insert(createAccount(disc, "big")); serial.insert(createAccount(disc, "big")); }
+            if (!agrees(obj, serial, {AccountOp::remove("big", 500), AccountOp::insert(createAccount(2000, "big")),
+                                      AccountOp::remove("big", 500), AccountOp::insert(createAccount(500, "big"))})) {
+                passed = false;
+            }
+
+            if (!tester.verifyUHeights(obj) || !tester.verifyUHeightValues(obj)) { passed = false; }
+            obj.forEachWithPrefix("", [&tester, &passed](UNode *node, int) {
+                if (!tester.verifyDSizes(*node->getDTree())) { passed = false; }
+            });
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing batch mutation: Batches with the hash index, in concurrent mode, lock-free, persistent, and logged." << endl;
+        cout << "Expects: The same accounts and results as one by one in every mode, and the log recovering the batch." << endl;
+        bool passed = true;
+
+        try {
+            for (int mode = 0; mode < 4; mode++) {
+                UTree obj, serial;
+                build(obj);
+                build(serial);
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else if (mode == 1) { obj.enableConcurrency(); }
+                else if (mode == 2) { obj.enableLockFreeReads(); }
+                else { obj.enablePersistence(); }
+
+                if (!agrees(obj, serial, makeOps(5000))) { passed = false; }
+                if (mode == 0 && !tester.verifyUHashIndex(obj)) { passed = false; }
+            }
+
+            {
+                UTree obj, serial;
+                obj.recover(SNAPSHOT_PATH, LOG_PATH);
+                build(obj);
+                build(serial);
+                if (!agrees(obj, serial, makeOps(5000))) { passed = false; }
+
+                UTree fromLog;
+                fromLog.recover(SNAPSHOT_PATH, LOG_PATH);
+                fromLog.disableLog();
+                if (tester.describeAccounts(fromLog) != tester.describeAccounts(obj)) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(SNAPSHOT_PATH.c_str());
+        std::remove(LOG_PATH.c_str());
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void applyBatchTimeRun() {
+    Tester tester;
+
+    cout << "Testing batch mutation: Throughput of applyBatch() against insert() and removeUser() one by one." << endl;
+    tester.applyBatchTime(NUM_TRIALS - 2, NUM_INSERTIONS * 25 / 2);
+
+    return;
+}
+
+///////////////////////////// vvv bloom filter vvv ////////////////////////////////
+
+void bloomFilterTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 400;
+    const string CSV_PATH = "filter_test.csv";
+    Tester tester;
+
+    auto username = [](int i) { return "user" + std::to_string(i); };
+
+    // every username in the tree must get past the filter, and what it lets through
+    // must match the tree; absent usernames are checked to exercise the counters
+    auto agrees = [&username](UTree &obj, int upTo) {
+        bool same = true;
+
+        for (int i = 0; i < upTo; i++) {
+            UNode *found = obj.retrieve(username(i));
+            if (found && !obj.getFilter()->mayContain(username(i))) { same = false; }
+            if (found && (found->getUsername() != username(i) || obj.numUsers(username(i)) != found->getDTree()->getNumUsers())) {
+                same = false;
+            }
+            if (!found && (obj.numUsers(username(i)) != 0 || obj.retrieveUser(username(i), 0))) { same = false; }
+            if (obj.retrieve("absent" + std::to_string(i))) { same = false; }
+        }
+
+        // walking the tree does not go through the filter, so this catches what it wrongly rules out
+        obj.forEachWithPrefix("", [&obj, &same](UNode *node, int) {
+            if (obj.retrieve(node->getUsername()) != node) { same = false; }
+        });
+
+        // the filter stays sized for what it holds and is rebuilt before it goes stale
+        const UFilter *filter = obj.getFilter();
+        if (filter->getNumKeys() > filter->getCapacity() || filter->getNumStale() * 2 > filter->getNumKeys()) { same = false; }
+
+        return same;
+    };
+
+    // plain tree
+    {
+        cout << "Testing bloom filter: Lookups through the filter across churn, split(), join(), mergeFrom(), loadData() and clear()." << endl;
+        cout << "Expects: No username in the tree ruled out, lookups matching the tree, and few absent usernames let through." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            for (int i = 0; i < NUM_USERNAMES * 5; i++) { obj.insert(createAccount(i % 5, username(i / 5))); }
+            obj.enableFilter();
+            if (!obj.hasFilter() || !agrees(obj, NUM_USERNAMES + 50)) { passed = false; }
+
+            // usernames come and go, so the filter both fills and goes stale
+            for (int i = 0; i < 20000; i++) {
+                int user = rng() % (NUM_USERNAMES * 3);
+                DNode *removed = nullptr;
+                if (rng() % 2) {
+                    obj.insert(createAccount(rng() % 3, username(user)));
+                } else if (obj.removeUser(username(user), rng() % 3, removed)) {
+                    delete removed;
+                }
+            }
+            if (!agrees(obj, NUM_USERNAMES * 3)) { passed = false; }
+
+            UTree right;
+            right.enableFilter();
+            obj.split(username(NUM_USERNAMES), right);
+            if (!agrees(obj, NUM_USERNAMES * 3) || !agrees(right, NUM_USERNAMES * 3)) { passed = false; }
+            obj.join(std::move(right));
+            if (!agrees(obj, NUM_USERNAMES * 3) || !agrees(right, NUM_USERNAMES * 3) || right.retrieve(username(NUM_USERNAMES * 2))) {
+                passed = false;
+            }
+
+            UTree other;
+            other.enableFilter();
+            for (int i = 0; i < 100; i++) { other.insert(createAccount(7, username(NUM_USERNAMES * 3 + i))); }
+            obj.mergeFrom(std::move(other));
+            if (!agrees(obj, NUM_USERNAMES * 3 + 100) || !agrees(other, NUM_USERNAMES * 3 + 100)) { passed = false; }
+
+            // joining more usernames than the filter has room for rebuilds it part way through
+            UTree small, large;
+            small.enableFilter();
+            small.insert(createAccount(1, "a"));
+            for (int i = 0; i < 500; i++) { large.insert(createAccount(1, username(i))); }
+            small.join(std::move(large));
+            if (!agrees(small, 500)) { passed = false; }
+
+            std::ofstream out(CSV_PATH);
+            for (int i = 0; i < 200; i++) { out << username(NUM_USERNAMES * 4 + i) << "," << i % 10 << ",0,b,c\n"; }
+            out.close();
+            obj.loadData(CSV_PATH);
+            if (!agrees(obj, NUM_USERNAMES * 5) || obj.numUsers(username(NUM_USERNAMES * 4 + 199)) != 1) { passed = false; }
+
+            // the filter rules out most of the absent usernames checked so far
+            const UFilter *filter = obj.getFilter();
+            if (filter->numRuledOut() == 0 || filter->falsePositiveRate() > 0.05) { passed = false; }
+
+            obj.clear();
+            if (!agrees(obj, NUM_USERNAMES * 5) || obj.getFilter()->getNumKeys() != 0) { passed = false; }
+            obj.insert(createAccount(1, "back"));
+            if (!obj.retrieve("back")) { passed = false; }
+
+            obj.disableFilter();
+            if (obj.hasFilter() || !obj.retrieve("back")) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing bloom filter: The filter with the hash index, in concurrent mode, and through batched and coroutine lookups." << endl;
+        cout << "Expects: Lookups matching the tree in every mode, and no filter beside lock-free reads." << endl;
+        bool passed = true;
+
+        try {
+            for (int mode = 0; mode < 2; mode++) {
+                UTree obj;
+                for (int i = 0; i < NUM_USERNAMES * 5; i++) { obj.insert(createAccount(i % 5, username(i / 5))); }
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else { obj.enableConcurrency(); }
+                obj.enableFilter();
+
+                for (int i = 0; i < 5000; i++) {
+                    DNode *removed = nullptr;
+                    obj.insert(createAccount(i % 5, username(NUM_USERNAMES + i % 300)));
+                    if (obj.removeUser(username(i % (NUM_USERNAMES * 2)), (i + 2) % 5, removed)) { delete removed; }
+                }
+                if (!agrees(obj, NUM_USERNAMES * 2)) { passed = false; }
+                if (mode == 0 && !tester.verifyUHashIndex(obj)) { passed = false; }
+
+                // half the keys are absent, and each batched or coroutine result matches retrieveUser()
+                vector<UserKey> keys;
+                for (int i = 0; i < 1000; i++) { keys.push_back({username(i * 7 % (NUM_USERNAMES * 4)), i % 6}); }
+                vector<DNode*> batched(keys.size());
+                obj.retrieveUserBatch(keys.data(), keys.size(), batched.data());
+
+                vector<ULookup<DNode*>> lookups;
+                ULookupScheduler scheduler;
+                lookups.reserve(keys.size());
+                for (UserKey& key : keys) {
+                    lookups.push_back(obj.retrieveUserAsync(key.username, key.disc));
+                    scheduler.spawn(lookups.back());
+                }
+                scheduler.run();
+
+                for (size_t i = 0; i < keys.size(); i++) {
+                    DNode *expected = obj.retrieveUser(keys[i].username, keys[i].disc);
+                    if (batched[i] != expected || lookups[i].get() != expected) { passed = false; }
+                }
+            }
+
+            // lock-free reads drop the filter and refuse a new one
+            UTree obj;
+            for (int i = 0; i < 100; i++) { obj.insert(createAccount(i % 5, username(i / 5))); }
+            obj.enableFilter();
+            obj.enableLockFreeReads();
+            if (obj.hasFilter()) { passed = false; }
+            obj.enableFilter();
+            if (obj.hasFilter() || !obj.retrieve(username(3)) || obj.retrieve("absent")) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void bloomFilterTimeRun() {
+    Tester tester;
+
+    cout << "Testing bloom filter: Latency of lookups for usernames in and not in the tree, with and without the filter." << endl;
+    tester.bloomFilterTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv hot account cache vvv ////////////////////////////////
+
+void hotCacheTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 60;
+    const string CSV_PATH = "cache_test.csv";
+
+    auto username = [](int i) { return "user" + std::to_string(i); };
+
+    // what retrieveUser() must return, found without going through the cache
+    auto uncached = [](UTree &tree, const string &name, int disc) -> DNode* {
+        UNode *node = tree.retrieve(name);
+        return (node) ? node->getDTree()->retrieve(disc) : nullptr;
+    };
+
+    // lookups, mostly of a few hot accounts, between inserts, removals that vacate
+    // DNodes and empty usernames, and batches that rebuild DTrees
+    auto churn = [&username, &uncached](UTree &obj, int count) {
+        bool same = true;
+
+        for (int i = 0; i < count; i++) {
+            int op = rng() % 100;
+            string name = username((op < 30) ? rng() % 4 : rng() % NUM_USERNAMES);
+            int disc = rng() % 12;
+            DNode *removed = nullptr;
+
+            if (op < 60) {
+                DNode *found = obj.retrieveUser(name, disc);
+                if (found != uncached(obj, name, disc)) { same = false; }
+                if (found && (found->getUsername() != name || found->getDiscriminator() != disc)) { same = false; }
+            } else if (op < 78) {
+                obj.insert(createAccount(disc, name));
+            } else if (op < 98) {
+                if (obj.removeUser(name, disc, removed)) { delete removed; }
+            } else {
+                vector<AccountOp> ops;
+                for (int j = 0; j < 40; j++) {
+                    string other = username(rng() % NUM_USERNAMES);
+                    ops.push_back((rng() % 2) ? AccountOp::insert(createAccount(rng() % 12, other)) : AccountOp::remove(other, rng() % 12));
+                }
+                for (AccountOpResult& result : obj.applyBatch(ops)) { delete result.removed; }
+            }
+        }
+
+        return same;
+    };
+
+    // every account looked up twice, the second time from the cache if it is still there
+    auto agrees = [&username, &uncached](UTree &obj) {
+        bool same = true;
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < NUM_USERNAMES; i++) {
+                for (int disc = 0; disc < 12; disc++) {
+                    if (obj.retrieveUser(username(i), disc) != uncached(obj, username(i), disc)) { same = false; }
+                }
+            }
+        }
+
+        return same;
+    };
+
+    // plain tree
+    {
+        cout << "Testing hot account cache: Cached lookups across churn, findReplacement(), batches, split(), join(), mergeFrom(), loadData() and clear()." << endl;
+        cout << "Expects: Every lookup matching the tree, with hits, evictions and invalidations counted." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            for (int i = 0; i < NUM_USERNAMES * 6; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+            obj.enableCache(64);
+            if (!obj.hasCache() || obj.getCache()->getCapacity() < 64) { passed = false; }
+
+            // the same account twice is a miss and then a hit
+            unsigned long hits = obj.getCache()->numHits();
+            if (!obj.retrieveUser(username(1), 6) || obj.retrieveUser(username(1), 6) != uncached(obj, username(1), 6)
+                || obj.getCache()->numHits() != hits + 1) {
+                passed = false;
+            }
+
+            if (!churn(obj, 50000) || !agrees(obj)) { passed = false; }
+
+            UTree right;
+            right.enableCache();
+            obj.split(username(30), right);
+            if (!agrees(obj) || !agrees(right)) { passed = false; }
+            obj.join(std::move(right));
+            if (!agrees(obj) || !agrees(right) || !churn(obj, 5000)) { passed = false; }
+
+            UTree other;
+            for (int i = 0; i < NUM_USERNAMES * 6; i++) { other.insert(createAccount(rng() % 12, username(rng() % NUM_USERNAMES))); }
+            obj.mergeFrom(std::move(other));
+            if (!agrees(obj) || !churn(obj, 5000)) { passed = false; }
+
+            std::ofstream out(CSV_PATH);
+            for (int i = 0; i < NUM_USERNAMES * 3; i++) { out << username(i % NUM_USERNAMES) << "," << i % 7 << ",0,b,c\n"; }
+            out.close();
+            obj.loadData(CSV_PATH, false);
+            if (!agrees(obj) || obj.numUsers(username(0)) != 3 || !churn(obj, 5000)) { passed = false; }
+
+            const UCache *cache = obj.getCache();
+            if (!cache->numHits() || !cache->numEvictions() || !cache->numInvalidated()) { passed = false; }
+            if (cache->hitRate() <= 0.0 || cache->hitRate() >= 1.0) { passed = false; }
+
+            obj.clear();
+            if (!agrees(obj) || obj.retrieveUser(username(1), 0)) { passed = false; }
+
+            obj.disableCache();
+            obj.insert(createAccount(5, "back"));
+            if (obj.hasCache() || !obj.retrieveUser("back", 5)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        std::remove(CSV_PATH.c_str());
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // one username's accounts
+    {
+        cout << "Testing hot account cache: Sixteen hot accounts of one username in a 64 account cache, then removing one." << endl;
+        cout << "Expects: Only the first lookup of each account missing, and every account of the username dropped by the removal." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            for (int disc = 0; disc < 16; disc++) { obj.insert(createAccount(disc, "popular")); }
+            obj.enableCache(64);
+
+            // the discriminators spread over the sets, so no set has to hold more than its ways
+            for (int round = 0; round < 50; round++) {
+                for (int disc = 0; disc < 16; disc++) {
+                    if (obj.retrieveUser("popular", disc) != uncached(obj, "popular", disc)) { passed = false; }
+                }
+            }
+
+            const UCache *cache = obj.getCache();
+            if (cache->numMisses() != 16 || cache->numHits() != 49 * 16 || cache->numEvictions() != 0) { passed = false; }
+
+            // the removal may rebuild the DTree, so all sixteen go wherever they were cached
+            vector<AccountOp> ops = {AccountOp::remove("popular", 3)};
+            for (AccountOpResult& result : obj.applyBatch(ops)) { delete result.removed; }
+            if (cache->numInvalidated() != 16) { passed = false; }
+            for (int disc = 0; disc < 16; disc++) {
+                if (obj.retrieveUser("popular", disc) != uncached(obj, "popular", disc)) { passed = false; }
+            }
+            if (obj.retrieveUser("popular", 3) || cache->numMisses() != 33) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing hot account cache: The cache with the hash index and the Bloom filter, and beside concurrent and lock-free modes." << endl;
+        cout << "Expects: Lookups matching the tree, and no cache in concurrent or lock-free mode." << endl;
+        bool passed = true;
+
+        try {
+            for (int mode = 0; mode < 2; mode++) {
+                UTree obj;
+                for (int i = 0; i < NUM_USERNAMES * 6; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else { obj.enableFilter(); }
+                obj.enableCache(64);
+
+                if (!churn(obj, 50000) || !agrees(obj)) { passed = false; }
+            }
+
+            // lookups in either mode come from many threads, so the cache is dropped and refused
+            for (int mode = 0; mode < 2; mode++) {
+                UTree obj;
+                for (int i = 0; i < 60; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+                obj.enableCache();
+
+                if (mode == 0) { obj.enableConcurrency(); }
+                else { obj.enableLockFreeReads(); }
+                if (obj.hasCache()) { passed = false; }
+
+                obj.enableCache();
+                if (obj.hasCache() || !obj.retrieveUser(username(3), 6) || obj.retrieveUser(username(3), 0)) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void hotCacheTimeRun() {
+    Tester tester;
+
+    cout << "Testing hot account cache: Latency of Zipf distributed lookups with and without the cache, alone and mixed with removals." << endl;
+    tester.hotCacheTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+///////////////////////////// vvv stable handles vvv ////////////////////////////////
+
+void handleTests(int &numTestsPassed, int &numTests) {
+    const int NUM_USERNAMES = 60;
+    Tester tester;
+
+    auto username = [](int i) { return "user" + std::to_string(i); };
+
+    auto uncached = [](UTree &tree, const string &name, int disc) -> DNode* {
+        UNode *node = tree.retrieve(name);
+        return (node) ? node->getDTree()->retrieve(disc) : nullptr;
+    };
+
+    struct Held {
+        AccountHandle handle;
+        string username;
+        int disc;
+        bool live;      // the account has stayed in the tree since the handle was taken
+    };
+
+    // a handle resolves to its account's DNode until the account is removed, and then never again
+    auto agrees = [&uncached](UTree &obj, const vector<Held> &held) {
+        bool same = true;
+
+        for (const Held& h : held) {
+            DNode *found = obj.deref(h.handle);
+
+            if (h.live && (!found || found != uncached(obj, h.username, h.disc))) { same = false; }
+            if (!h.live && (found || obj.isValid(h.handle))) { same = false; }
+        }
+
+        return same;
+    };
+
+    auto removed = [](vector<Held> &held, const string &name, int disc) {
+        for (Held& h : held) {
+            if (h.username == name && h.disc == disc) { h.live = false; }
+        }
+    };
+
+    // handles taken between inserts, removals that vacate DNodes and empty usernames,
+    // and batches that rebuild DTrees
+    auto churn = [&username, &uncached, &removed](UTree &obj, vector<Held> &held, int count) {
+        bool same = true;
+
+        for (int i = 0; i < count; i++) {
+            int op = rng() % 100;
+            string name = username(rng() % NUM_USERNAMES);
+            int disc = rng() % 12;
+            DNode *removedNode = nullptr;
+
+            if (op < 25) {
+                AccountHandle handle = obj.getHandle(name, disc);
+                bool present = uncached(obj, name, disc) != nullptr;
+
+                if (present != (handle.generation != INVALID_GENERATION)) { same = false; }
+                if (present) {
+                    bool known = false;
+                    for (Held& h : held) {
+                        if (h.live && h.username == name && h.disc == disc) {
+                            known = true;
+                            if (!(h.handle == handle)) { same = false; }
+                        }
+                    }
+                    if (!known) { held.push_back({handle, name, disc, true}); }
+                }
+            } else if (op < 55) {
+                obj.insert(createAccount(disc, name));
+            } else if (op < 97) {
+                if (obj.removeUser(name, disc, removedNode)) {
+                    delete removedNode;
+                    removed(held, name, disc);
+                }
+            } else {
+                vector<AccountOp> ops;
+                for (int j = 0; j < 40; j++) {
+                    string other = username(rng() % NUM_USERNAMES);
+                    ops.push_back((rng() % 2) ? AccountOp::insert(createAccount(rng() % 12, other)) : AccountOp::remove(other, rng() % 12));
+                }
+
+                vector<AccountOpResult> results = obj.applyBatch(ops);
+                for (size_t j = 0; j < ops.size(); j++) {
+                    if (ops[j].type == AccountOp::REMOVE && results[j].applied) {
+                        removed(held, ops[j].account.getUsername(), ops[j].account.getDiscriminator());
+                    }
+                    delete results[j].removed;
+                }
+            }
+        }
+
+        return same;
+    };
+
+    // plain tree
+    {
+        cout << "Testing stable handles: Handles across findReplacement(), DTree rebuilds, churn, batches, split(), join(), mergeFrom() and clear()." << endl;
+        cout << "Expects: Each handle resolving to its account's current DNode until the account is removed, and never after." << endl;
+        bool passed = true;
+
+        try {
+            UTree obj;
+            for (int i = 0; i < NUM_USERNAMES * 6; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+
+            bool threw = false;
+            try { obj.getHandle(username(0), 0); } catch (std::logic_error&) { threw = true; }
+            if (!threw) { passed = false; }
+
+            obj.enableHandles();
+            if (obj.getHandle(username(0), 11).generation != INVALID_GENERATION || obj.getHandle("nobody", 0).generation != INVALID_GENERATION) {
+                passed = false;
+            }
+
+            vector<Held> held;
+            for (int i = 0; i < NUM_USERNAMES * 6; i++) {
+                held.push_back({obj.getHandle(username(i / 6), i % 12), username(i / 6), i % 12, true});
+            }
+            if (obj.numHandles() != held.size() || !agrees(obj, held)) { passed = false; }
+
+            // emptying the root's username hands the largest username left of it to the
+            // root's UNode, DTree and all, so that username's accounts keep their DNodes
+            UNode *root = tester.getURoot(obj);
+            UNode *replacement = tester.getUNodeLeft(root);
+            while (tester.getUNodeRight(replacement)) { replacement = tester.getUNodeRight(replacement); }
+            string rootName = root->getUsername(), movedName = replacement->getUsername();
+            vector<DNode*> before;
+            for (Held& h : held) { if (h.username == movedName) { before.push_back(obj.deref(h.handle)); } }
+
+            for (int disc = 0; disc < 12; disc++) {
+                DNode *removedNode = nullptr;
+                if (obj.removeUser(rootName, disc, removedNode)) { delete removedNode; }
+                removed(held, rootName, disc);
+            }
+
+            size_t next = 0;
+            for (Held& h : held) {
+                if (h.username == movedName && obj.deref(h.handle) != before[next++]) { passed = false; }
+            }
+            if (before.empty() || !agrees(obj, held)) { passed = false; }
+
+            // inserts that rebalance a DTree only relink its DNodes
+            for (int disc = 100; disc < 400; disc++) { obj.insert(createAccount(disc, username(1))); }
+            if (!agrees(obj, held)) { passed = false; }
+
+            if (!churn(obj, held, 30000) || !agrees(obj, held)) { passed = false; }
+
+            // a removed account's handle stays invalid when the account comes back, through
+            // removeUser() or within one batch, and it gets a new handle
+            AccountHandle first = obj.getHandle(username(1), 150);
+            for (AccountOpResult& result : obj.applyBatch({AccountOp::remove(username(1), 150), AccountOp::insert(createAccount(150, username(1)))})) {
+                delete result.removed;
+            }
+            AccountHandle second = obj.getHandle(username(1), 150);
+            if (obj.isValid(first) || !obj.isValid(second) || first == second) { passed = false; }
+            removed(held, username(1), 150);
+
+            UTree right;
+            string at = username(30);
+            obj.split(at, right);
+            for (Held& h : held) { if (h.username >= at) { h.live = false; } }
+            if (!agrees(obj, held)) { passed = false; }
+            obj.join(std::move(right));
+            if (!agrees(obj, held) || !churn(obj, held, 5000) || !agrees(obj, held)) { passed = false; }
+
+            UTree other;
+            for (int i = 0; i < NUM_USERNAMES * 6; i++) { other.insert(createAccount(rng() % 12, username(rng() % NUM_USERNAMES))); }
+            obj.mergeFrom(std::move(other));
+            if (!agrees(obj, held) || !churn(obj, held, 5000) || !agrees(obj, held)) { passed = false; }
+
+            obj.clear();
+            for (Held& h : held) { h.live = false; }
+            if (!agrees(obj, held) || obj.numHandles() != 0) { passed = false; }
+
+            obj.insert(createAccount(5, "back"));
+            AccountHandle back = obj.getHandle("back", 5);
+            obj.disableHandles();
+            if (obj.hasHandles() || obj.isValid(back)) { passed = false; }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    cout << endl;
+
+    // other modes
+    {
+        cout << "Testing stable handles: Handles with the hash index, the Bloom filter and the cache, and beside concurrent and lock-free modes." << endl;
+        cout << "Expects: Handles tracking their accounts, and none in concurrent or lock-free mode." << endl;
+        bool passed = true;
+
+        try {
+            for (int mode = 0; mode < 2; mode++) {
+                UTree obj;
+                for (int i = 0; i < NUM_USERNAMES * 6; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+
+                if (mode == 0) { obj.enableHashIndex(); }
+                else { obj.enableFilter(); obj.enableCache(64); }
+                obj.enableHandles();
+
+                vector<Held> held;
+                if (!churn(obj, held, 30000) || !agrees(obj, held)) { passed = false; }
+            }
+
+            // lookups in either mode come from many threads, so handles are dropped and refused
+            for (int mode = 0; mode < 2; mode++) {
+                UTree obj;
+                for (int i = 0; i < 60; i++) { obj.insert(createAccount(i % 12, username(i / 6))); }
+                obj.enableHandles();
+                AccountHandle handle = obj.getHandle(username(3), 6);
+
+                if (mode == 0) { obj.enableConcurrency(); }
+                else { obj.enableLockFreeReads(); }
+                obj.enableHandles();
+
+                bool threw = false;
+                try { obj.getHandle(username(3), 6); } catch (std::logic_error&) { threw = true; }
+                if (obj.hasHandles() || obj.isValid(handle) || !threw) { passed = false; }
+            }
+        } catch (...) {
+            passed = false;
+        }
+
+        assertFinish(passed, numTests, numTestsPassed);
+    }
+
+    return;
+}
+
+void handleTimeRun() {
+    Tester tester;
+
+    cout << "Testing stable handles: Latency of deref() against retrieveUser() for the same accounts." << endl;
+    tester.handleTime(NUM_TRIALS - 2, 10 * NUM_INSERTIONS);
+
+    return;
+}
+
+// acts as a shortcut to create account arguments more easily
+Account createAccount(int disc, string username) {
+    Account acc(username, disc, false, "", "");
+    return acc;
+}
+
+// prints out if a test passed or failed and increments test counters
+void assertFinish(bool expr, int &numTests, int &numTestsPassed) {
+    if (expr) {
+        cout << "\tTest Passed." << endl;
+        numTestsPassed++;
+    }
+    else { cout << "\tTest Failed." << endl; }
+
+    numTests++;
+
+    return;
+}
+
+// main container to verify the sizes of all DNodes in a DTree
+bool Tester::verifyDSizes(DTree &obj) {
+    return verifyDSizes(obj, obj._root);
+}
+
+// node helper for verifyheights(DTree&)
+bool Tester::verifyDSizes(DTree &obj, DNode *&node) {
+    // the rundown for this fxn is if at any point, balanced gets turned to false,
+    // keep it set to false.
+    bool balanced = true;
+
+    if (obj.checkImbalance(node)) { balanced = false; }
+
+    if (node->_left) {
+        balanced = (balanced) ? verifyDSizes(obj, node->_left) : false;
+    }
+
+    if (node->_right) {
+        balanced = (balanced) ? verifyDSizes(obj, node->_right) : false;
+    }
+
+    return balanced;
+}
+
+// main container to verify the heights of all UNodes in a UTree
+bool Tester::verifyUHeights(UTree &obj) {
+    return verifyUHeights(obj, obj._root);
+}
+
+// node helper for verifyUHeights(UTree&)
+bool Tester::verifyUHeights(UTree &obj, UNode *&node) {
+    // the rundown for this fxn is if at any point, balanced gets turned to false,
+    // keep it set to false.
+    bool balanced = true;
+    int balanceFactor = obj.checkImbalance(node);
+
+    if (balanceFactor > 1 || balanceFactor < -1) { balanced = false; }
+
+    if (node->_left) {
+        balanced = (balanced) ? verifyUHeights(obj, node->_left) : false;
+    }
+
+    if (node->_right) {
+        balanced = (balanced) ? verifyUHeights(obj, node->_right) : false;
+    }
+
+    return balanced;
+}
+
+// converts the DTree into a vector for order checking
+void Tester::putDIntoArr(DTree &obj, vector<DNode*> &arr) {
+    putDIntoArr(arr, obj._root);
+    return;
+}
+
+// similar to the method in DTree, put all DNodes into an array (vect here)
+// in order
+void Tester::putDIntoArr(vector<DNode*> &arr, DNode *&node) {
+    if (node->_left) {
+        putDIntoArr(arr, node->_left);
+    }
+
+    arr.push_back(node);
+
+    if (node->_right) {
+        putDIntoArr(arr, node->_right);
+    }
+
+    return;
+}
+
+// return the root of a DTree
+DNode* Tester::getDRoot(DTree &obj) {
+    return obj._root;
+}
+
+// return the left child of a Dnode
+DNode* Tester::getDNodeLeft(DNode *node) {
+    return node->_left;
+}
+
+// return the right child of a dnode
+DNode* Tester::getDNodeRight(DNode *node) {
+    return node->_right;
+}
+
+// verify that the overloaded = worked
+bool Tester::checkDTreeEquality(DTree &copyTo, DTree &copyFrom) {
+    copyTo = copyFrom;
+
+    if (&copyTo != &copyFrom) {
+        return checkDNodeEquality(copyTo._root, copyFrom._root);
+    }
+
+    return false;
+}
+
+// recursive helper for the above
+bool Tester::checkDNodeEquality(DNode *lhs, DNode *rhs) {
+    // if both of the nodes dont exist, weve reached the end. if one of them doesnt exist
+    // something went wrong
+    if (!(lhs || rhs)) { return true; }
+    else if ((!lhs && rhs) || (lhs && !rhs)) { return false; }
+
+    bool properCopy = false;
+
+    Account lhsAcc = lhs->getAccount();
+    Account rhsAcc = rhs->getAccount();
+
+    // verify all acc details
+    if (lhsAcc.getUsername() == rhsAcc.getUsername() && lhsAcc.getDiscriminator() == rhsAcc.getDiscriminator()
+            && lhsAcc.hasNitro() == rhsAcc.hasNitro() && lhsAcc.getBadge() == rhsAcc.getBadge()
+            && lhsAcc.getStatus() == lhsAcc.getStatus() && &lhsAcc != &rhsAcc)
+    {
+        // verify all node members
+        if (lhs->getSize() == rhs->getSize() && lhs->getNumVacant() == rhs->getNumVacant()
+                && lhs->isVacant() == rhs->isVacant())
+        {
+            // verify deep copy
+            if (lhs != rhs) {
+                properCopy = true;
+            }
+        }
+    }
+
+    return properCopy && checkDNodeEquality(lhs->_left, rhs->_left) && checkDNodeEquality(lhs->_right, rhs->_right);
+}
+
+// return the root of a UTree
+UNode* Tester::getURoot(UTree& tree) {
+    return tree._root;
+}
+
+// return the left child of a UNode
+UNode* Tester::getUNodeLeft(UNode* node) {
+    return node->_left;
+}
+
+// return the right child of a UNode
+UNode* Tester::getUNodeRight(UNode* node) {
+    return node->_right;
+}
+
+// verify that every UNode stores the true height of its subtree
+bool Tester::verifyUHeightValues(UTree &obj) {
+    bool correct = true;
+    verifyUHeightValues(obj._root, correct);
+    return correct;
+}
+
+// node helper for verifyUHeightValues(UTree&), returns the real height of the subtree
+// (-1 for an empty one) and flips correct if a stored height disagrees with it
+int Tester::verifyUHeightValues(UNode *node, bool &correct) {
+    if (!node) { return -1; }
+
+    int left = verifyUHeightValues(node->_left, correct);
+    int right = verifyUHeightValues(node->_right, correct);
+    int height = ((left > right) ? left : right) + 1;
+
+    if (node->_height != height) { correct = false; }
+
+    return height;
+}
+
+// verify that the hash index holds exactly the UNodes in the tree
+bool Tester::verifyUHashIndex(UTree &obj) {
+    bool correct = obj._index != nullptr;
+
+    if (correct && verifyUHashIndex(obj, obj._root, correct) != obj._index->size()) {
+        correct = false;
+    }
+
+    return correct;
+}
+
+// node helper for verifyUHashIndex(UTree&), returns the number of UNodes in the subtree
+int Tester::verifyUHashIndex(UTree &obj, UNode *node, bool &correct) {
+    if (!node) { return 0; }
+
+    if (obj._index->find(node->getUsername()) != node) { correct = false; }
+
+    return 1 + verifyUHashIndex(obj, node->_left, correct) + verifyUHashIndex(obj, node->_right, correct);
+}
+
+// converts the UTree into a vector for order checking
+void Tester::putUIntoArr(UTree &obj, vector<UNode*> &arr) {
+    putUIntoArr(arr, obj._root);
+    return;
+}
+
+// similar to the method for DTree, put all Unodes into an array (vect) in order
+void Tester::putUIntoArr(vector<UNode*> &arr, UNode *&node) {
+    if (node->_left) {
+        putUIntoArr(arr, node->_left);
+    }
+
+    arr.push_back(node);
+
+    if (node->_right) {
+        putUIntoArr(arr, node->_right);
+    }
+
+    return;
+}
+
+// test insertion time into a DTree
+void Tester::dTreeInsertionTime(int numTrials, int N) {
+    const int SCALING = 2;
+
+    // start and end time keep track of when the test was started and finished
+    clock_t startTime;
+    clock_t endTime;
+
+    // timeTaken is a shortcut for endTime - startTime
+    double timeTaken = 0.0;
+
+    // stores the previous times of each iteration to compare
+    double prevTime = 0.0;
+
+    for (int i = 0; i < numTrials; i++) {
+        DTree *obj = new DTree;
+
+        int name = 0;
+        int disc = 0;
+
+        // insert N elements, keeping track of start and end time
+        startTime = clock();
+        for (int i = 0; i < N; i++) {
+            disc = i % MAX_DISC;
+            if (!disc) { name++; }
+            obj->insert(createAccount(disc, to_string(name)));
+        }
+        endTime = clock();
+
+        // output how long the enqueue test took
+        timeTaken = double(endTime - startTime) / CLOCKS_PER_SEC;
+        cout << "\tInserted " << N << " accounts into DTree, took " << timeTaken
+             << " seconds ";
+
+        // if there was actually a previous iteration, output how much longer
+        // this one took (should float around 2x for O(n) since our scaling is 2)
+        if (prevTime) {
+            cout << '(' << double(timeTaken / prevTime)
+                 << "x longer than previous insertion)";
+        }
+
+        // store into the previous time for tracking
+        prevTime = timeTaken;
+
+        cout << endl;
+
+        // scale our number of elements by 2
+        N *= SCALING;
+
+        delete obj;
+    }
+
+    return;
+}
+
+void Tester::uTreeInsertionTime(int numTrials, int N) {
+    const int SCALING = 2;
+
+    // start and end time keep track of when the test was started and finished
+    clock_t startTime;
+    clock_t endTime;
+
+    // timeTaken is a shortcut for endTime - startTime
+    double timeTaken = 0.0;
+
+    // stores the previous times of each iteration to compare
+    double prevTime = 0.0;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree *obj = new UTree;
+
+        int name = 0;
+        int disc = 0;
+
+        startTime = clock();
+        for (int i = 0; i < N; i++) {
+            disc = i % MAX_DISC;
+            if (!disc) { name++; }
+            obj->insert(createAccount(disc, to_string(name)));
+        }
+        endTime = clock();
+
+        // output how long the enqueue test took
+        timeTaken = double(endTime - startTime) / CLOCKS_PER_SEC;
+        cout << "\tInserted " << N << " accounts into UTree, took " << timeTaken
+             << " seconds, " << obj->avgRetraced() << " nodes retraced per new UNode ";
+
+        // if there was actually a previous iteration, output how much longer
+        // this one took (should float around 2x for O(n) since our scaling is 2)
+        if (prevTime) {
+            cout << '(' << double(timeTaken / prevTime)
+                 << "x longer than previous insertion)";
+        }
+
+        // store into the previous time for tracking
+        prevTime = timeTaken;
+
+        cout << endl;
+
+        // scale our number of elements by 2
+        N *= SCALING;
+
+        delete obj;
+    }
+
+    return;
+}
+
+// test retrieveUser() time over N distinct usernames with and without the hash index
+void Tester::uTreeHashLookupTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const int NUM_LOOKUPS = 100000;
+
+    clock_t startTime;
+    clock_t endTime;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree *obj = new UTree;
+        vector<string> names;
+
+        // usernames share a long prefix, as they tend to in practice
+        for (int j = 0; j < N; j++) {
+            names.push_back("user_account_" + to_string(j));
+            obj->insert(createAccount(j % MAX_DISC, names.back()));
+        }
+
+        std::uniform_int_distribution<> distName(0, N - 1);
+        vector<int> order;
+        for (int j = 0; j < NUM_LOOKUPS; j++) { order.push_back(distName(rng)); }
+
+        // time the same lookups through the tree, then through the index
+        int found = 0;
+        startTime = clock();
+        for (int j = 0; j < NUM_LOOKUPS; j++) {
+            found += obj->retrieveUser(names[order[j]], order[j] % MAX_DISC) != nullptr;
+        }
+        endTime = clock();
+        double treeTime = double(endTime - startTime) / CLOCKS_PER_SEC;
+
+        obj->enableHashIndex();
+
+        startTime = clock();
+        for (int j = 0; j < NUM_LOOKUPS; j++) {
+            found += obj->retrieveUser(names[order[j]], order[j] % MAX_DISC) != nullptr;
+        }
+        endTime = clock();
+        double indexTime = double(endTime - startTime) / CLOCKS_PER_SEC;
+
+        cout << "\t" << N << " usernames, " << NUM_LOOKUPS << " lookups: tree " << treeTime
+             << "s, index " << indexTime << "s (" << treeTime / indexTime << "x faster), index uses "
+             << obj->hashIndexMemory() << " bytes (" << double(obj->hashIndexMemory()) / N
+             << " per username)";
+        if (found != 2 * NUM_LOOKUPS) { cout << " [lookup mismatch]"; }
+        cout << endl;
+
+        N *= SCALING;
+
+        delete obj;
+    }
+
+    return;
+}
+
+// return the root of an RTree
+RNode* Tester::getRRoot(RTree &obj) {
+    return obj._root;
+}
+
+// verify the B+tree invariants: keys sorted and separated by their parents' keys,
+// nodes at least half full, every leaf at the same depth, and the leaf links
+// visiting every key in order
+bool Tester::verifyBTree(BTree &obj) {
+    bool correct = true;
+    vector<string> inOrder;
+
+    if (!obj._root) { return !obj._head; }
+
+    verifyBNode(obj._root, nullptr, nullptr, true, inOrder, correct);
+
+    // walk the leaf links and compare with the recursive walk
+    vector<string> linked;
+    BLeaf *prev = nullptr;
+    for (BLeaf *leaf = obj._head; leaf; prev = leaf, leaf = leaf->_next) {
+        if (leaf->_prev != prev) { correct = false; }
+        for (int i = 0; i < leaf->_numKeys; i++) { linked.push_back(*leaf->_keys[i]); }
+    }
+
+    return correct && linked == inOrder;
+}
+
+// node helper for verifyBTree(BTree&), returns the height of the subtree and collects
+// its keys in order
+int Tester::verifyBNode(BNode *node, const string *low, const string *high, bool isRoot,
+                        vector<string> &inOrder, bool &correct) {
+    if (!isRoot && node->_numKeys < BTREE_MIN_KEYS) { correct = false; }
+
+    for (int i = 0; i < node->_numKeys; i++) {
+        const string &key = *node->_keys[i];
+
+        if (node->_prefixes[i] != BTree::packPrefix(key)) { correct = false; }
+        if (i && !(*node->_keys[i - 1] < key)) { correct = false; }
+        if ((low && key < *low) || (high && !(key < *high))) { correct = false; }
+    }
+
+    if (node->_leaf) {
+        for (int i = 0; i < node->_numKeys; i++) {
+            BLeaf *leaf = static_cast<BLeaf*>(node);
+            if (leaf->_values[i]->getUsername() != *leaf->_keys[i]) { correct = false; }
+            inOrder.push_back(*leaf->_keys[i]);
+        }
+
+        return 1;
+    }
+
+    BInner *inner = static_cast<BInner*>(node);
+    int height = -1;
+
+    for (int i = 0; i <= inner->_numKeys; i++) {
+        const string *childLow = (i) ? inner->_keys[i - 1] : low;
+        const string *childHigh = (i < inner->_numKeys) ? inner->_keys[i] : high;
+        int childHeight = verifyBNode(inner->_children[i], childLow, childHigh, false, inOrder, correct);
+
+        if (height != -1 && childHeight != height) { correct = false; }
+        height = childHeight;
+    }
+
+    return height + 1;
+}
+
+// return the number of levels in a BTree
+int Tester::getBHeight(BTree &obj) {
+    int height = 0;
+
+    for (BNode *node = obj._root; node; height++) {
+        node = (node->_leaf) ? nullptr : static_cast<BInner*>(node)->_children[0];
+    }
+
+    return height;
+}
+
+// test insertion and retrieveUser() time of N prefix-heavy usernames in every backend
+void Tester::userIndexTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const int NUM_LOOKUPS = 100000;
+    const int NUM_BACKENDS = 4;
+    const int BACKENDS[NUM_BACKENDS] = {UINDEX_AVL, UINDEX_RADIX, UINDEX_BPLUS, UINDEX_SHARDED};
+    const string NAMES[NUM_BACKENDS] = {"UTree", "RTree", "BTree", "ShardedUTree"};
+
+    clock_t startTime;
+
+    for (int i = 0; i < numTrials; i++) {
+        vector<string> names;
+        for (int j = 0; j < N; j++) { names.push_back("user_account_" + to_string(j)); }
+
+        std::uniform_int_distribution<> distName(0, N - 1);
+        vector<int> order;
+        for (int j = 0; j < NUM_LOOKUPS; j++) { order.push_back(distName(rng)); }
+
+        cout << "\t" << N << " usernames, " << NUM_LOOKUPS << " lookups:";
+
+        for (int b = 0; b < NUM_BACKENDS; b++) {
+            UserIndex *obj = UserIndex::create(BACKENDS[b]);
+
+            startTime = clock();
+            for (int j = 0; j < N; j++) { obj->insert(createAccount(j % MAX_DISC, names[j])); }
+            double insertTime = double(clock() - startTime) / CLOCKS_PER_SEC;
+
+            int found = 0;
+            startTime = clock();
+            for (int j = 0; j < NUM_LOOKUPS; j++) {
+                found += obj->retrieveUser(names[order[j]], order[j] % MAX_DISC) != nullptr;
+            }
+            double lookupTime = double(clock() - startTime) / CLOCKS_PER_SEC;
+
+            cout << " " << NAMES[b] << " insert " << insertTime << "s lookup " << lookupTime << "s";
+            if (found != NUM_LOOKUPS) { cout << " [lookup mismatch]"; }
+            cout << ((b + 1 < NUM_BACKENDS) ? ";" : "");
+
+            delete obj;
+        }
+
+        cout << endl;
+
+        N *= SCALING;
+    }
+
+    return;
+}
+
+// test loadData() (row by row and bulk) and loadDataParallel() throughput on generated
+// csv files of N rows.
+// wall clock time is used since clock() adds up every thread's cpu time
+void Tester::loadDataTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const string CSV_PATH = "loaddata_bench.csv";
+    const int ACCOUNTS_PER_NAME = 10;
+    int numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 0; i < numTrials; i++) {
+        // rows look like real exports: a handful of accounts per username, in no
+        // particular order (7919 is prime, so j * 7919 % N visits every row once)
+        std::ofstream out(CSV_PATH);
+        for (int j = 0; j < N; j++) {
+            out << "user_account_" << (long long)j * 7919 % N / ACCOUNTS_PER_NAME << ',' << (j * 7) % MAX_DISC << ','
+                << j % 2 << ",Early Supporter,Listening to something\n";
+        }
+        out.close();
+
+        std::ifstream sizeCheck(CSV_PATH, std::ifstream::ate | std::ifstream::binary);
+        double megabytes = double(sizeCheck.tellg()) / (1024 * 1024);
+        sizeCheck.close();
+
+        UTree *inserted = new UTree;
+        UTree *bulk = new UTree;
+        UTree *parallel = new UTree;
+
+        auto startTime = std::chrono::steady_clock::now();
+        inserted->loadData(CSV_PATH, true);
+        double insertTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        startTime = std::chrono::steady_clock::now();
+        bulk->loadData(CSV_PATH, false);
+        double bulkTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        startTime = std::chrono::steady_clock::now();
+        parallel->loadDataParallel(CSV_PATH, numThreads, false);
+        double parallelTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << "\tLoaded " << N << " rows (" << megabytes << " MB) into UTree, inserting took " << insertTime
+             << " seconds (" << megabytes / insertTime << " MB/s), bulk loading took " << bulkTime << " seconds ("
+             << megabytes / bulkTime << " MB/s, " << insertTime / bulkTime << "x inserting), " << numThreads << " threads took " << parallelTime << " seconds ("
+             << megabytes / parallelTime << " MB/s)" << endl;
+
+        N *= SCALING;
+
+        delete inserted;
+        delete bulk;
+        delete parallel;
+        std::remove(CSV_PATH.c_str());
+    }
+
+    return;
+}
+
+// describe every account in a UTree, in order, as "username#disc:nitro:badge:status" entries
+string Tester::describeAccounts(UTree &obj) {
+    string description;
+
+    obj.forEachWithPrefix("", [&](UNode *node, int) {
+        vector<DNode*> accounts;
+        putDIntoArr(*node->_dtree, accounts);
+
+        for (DNode *account : accounts) {
+            if (account->_vacant) { continue; }
+            description += account->getUsername() + "#" + std::to_string(account->getDiscriminator())
+                           + ":" + std::to_string(account->_account.hasNitro()) + ":" + account->_account.getBadge()
+                           + ":" + account->_account.getStatus() + " ";
+        }
+    });
+
+    return description;
+}
+
+// test loadSnapshot() and opening a UImage against loadData() on the same N accounts
+void Tester::snapshotTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const string CSV_PATH = "snapshot_bench.csv";
+    const string SNAPSHOT_PATH = "snapshot_bench.bin";
+    const string IMAGE_PATH = "image_bench.bin";
+    const int ACCOUNTS_PER_NAME = 10;
+
+    for (int i = 0; i < numTrials; i++) {
+        std::ofstream out(CSV_PATH);
+        for (int j = 0; j < N; j++) {
+            out << "user_account_" << (long long)j * 7919 % N / ACCOUNTS_PER_NAME << ',' << (j * 7) % MAX_DISC << ','
+                << j % 2 << ",Early Supporter,Listening to something\n";
+        }
+        out.close();
+
+        UTree *obj = new UTree;
+
+        auto startTime = std::chrono::steady_clock::now();
+        obj->loadData(CSV_PATH, false);
+        double csvTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << "\t" << N << " accounts: csv load took " << csvTime << " seconds";
+
+        int versions[] = {SNAPSHOT_VERSION_PLAIN, SNAPSHOT_VERSION_COMPRESSED};
+        for (int version : versions) {
+            startTime = std::chrono::steady_clock::now();
+            obj->saveSnapshot(SNAPSHOT_PATH, version);
+            double saveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            startTime = std::chrono::steady_clock::now();
+            obj->loadSnapshot(SNAPSHOT_PATH);
+            double snapshotTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            std::ifstream sizeCheck(SNAPSHOT_PATH, std::ifstream::ate | std::ifstream::binary);
+            double megabytes = double(sizeCheck.tellg()) / (1024 * 1024);
+            sizeCheck.close();
+
+            cout << ", " << (version == SNAPSHOT_VERSION_PLAIN ? "plain" : "compressed") << " snapshot (" << megabytes
+                 << " MB) saved in " << saveTime << " seconds and loaded in " << snapshotTime << " seconds";
+        }
+
+        obj->saveImage(IMAGE_PATH);
+
+        startTime = std::chrono::steady_clock::now();
+        UImage *image = new UImage(IMAGE_PATH);
+        double imageTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        // look every username up once, in a scattered order
+        int numNames = N / ACCOUNTS_PER_NAME;
+        int found = 0;
+        startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < numNames; j++) {
+            found += image->numUsers("user_account_" + std::to_string((long long)j * 7919 % numNames)) > 0;
+        }
+        double lookupTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << ", image opened in " << imageTime << " seconds and answered " << found << " lookups in " << lookupTime << " seconds" << endl;
+
+        N *= SCALING;
+
+        delete obj;
+        delete image;
+        std::remove(CSV_PATH.c_str());
+        std::remove(SNAPSHOT_PATH.c_str());
+        std::remove(IMAGE_PATH.c_str());
+    }
+
+    return;
+}
+
+// test insert() throughput with no log and with each sync policy, then group
+// commit from several threads
+void Tester::logTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const string SNAPSHOT_PATH = "log_bench_snapshot.bin";
+    const string LOG_PATH = "log_bench.wal";
+    const int NUM_THREADS = 4;
+
+    for (int i = 0; i < numTrials; i++) {
+        int policies[] = {-1, LOG_SYNC_NONE, LOG_SYNC_BATCH, LOG_SYNC_ALWAYS};
+        string names[] = {"no log", "LOG_SYNC_NONE", "LOG_SYNC_BATCH", "LOG_SYNC_ALWAYS"};
+
+        cout << "\t" << N << " insertions:";
+
+        for (int p = 0; p < 4; p++) {
+            UTree obj;
+            if (policies[p] != -1) { obj.recover(SNAPSHOT_PATH, LOG_PATH, policies[p]); }
+
+            auto startTime = std::chrono::steady_clock::now();
+            for (int j = 0; j < N; j++) {
+                obj.insert(createAccount(j % MAX_DISC, "user" + std::to_string(j * 7919 % N / 10)));
+            }
+            obj.syncLog();
+            double timeTaken = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            cout << " " << names[p] << " " << int(N / timeTaken) << "/s" << (p < 3 ? "," : "");
+
+            obj.disableLog();
+            std::remove(LOG_PATH.c_str());
+        }
+
+        // the same number of commits from several threads share fsyncs
+        ULog *log = new ULog(LOG_PATH, LOG_NO_BASE, LOG_SYNC_ALWAYS);
+        vector<std::thread> threads;
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int t = 0; t < NUM_THREADS; t++) {
+            threads.emplace_back([log, N, t]() {
+                for (int j = t; j < N; j += NUM_THREADS) {
+                    log->commit(log->appendInsert(createAccount(j % MAX_DISC, "user")));
+                }
+            });
+        }
+        for (std::thread& thread : threads) { thread.join(); }
+        double timeTaken = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << ", group commit from " << NUM_THREADS << " threads " << int(N / timeTaken) << "/s with "
+             << log->numSyncs() << " fsyncs" << endl;
+
+        delete log;
+        std::remove(LOG_PATH.c_str());
+
+        N *= SCALING;
+    }
+
+    return;
+}
+
+// test exportTo() throughput for both formats, into memory and into /dev/null
+void Tester::exportTime(int numTrials, int N) {
+    const int SCALING = 2;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        {
+            vector<Account> accts;
+            accts.reserve(N);
+            for (int j = 0; j < N; j++) {
+                accts.push_back(Account("user_account_" + std::to_string((long long)j * 7919 % N / 10), (j * 7) % MAX_DISC,
+                                        j % 2, "Early Supporter", "Listening to something"));
+            }
+            obj.bulkLoad(accts);
+        }
+
+        cout << "\t" << N << " accounts:";
+
+        int formats[] = {EXPORT_CSV, EXPORT_BINARY};
+        for (int format : formats) {
+            string out;
+            StringSink memory(out);
+
+            auto startTime = std::chrono::steady_clock::now();
+            obj.exportTo(memory, format);
+            double memoryTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            int fd = open("/dev/null", O_WRONLY);
+            FdSink devNull(fd);
+
+            startTime = std::chrono::steady_clock::now();
+            obj.exportTo(devNull, format);
+            double fdTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            close(fd);
+
+            double megabytes = double(out.size()) / (1024 * 1024);
+            cout << (format == EXPORT_CSV ? " csv (" : ", binary (") << megabytes << " MB) to memory in "
+                 << memoryTime << " seconds, to /dev/null in " << fdTime << " seconds";
+        }
+        cout << endl;
+
+        N *= SCALING;
     }
 
-    return false;
+    return;
 }
 
-// recursive helper for the above
-bool Tester::checkDNodeEquality(DNode *lhs, DNode *rhs) {
-    // if both of the nodes dont exist, weve reached the end. if one of them doesnt exist
-    // something went wrong
-    if (!(lhs || rhs)) { return true; }
-    else if ((!lhs && rhs) || (lhs && !rhs)) { return false; }
+// test merging a delta of N / 10 rows into an N row tree with mergeSorted() and
+// mergeFrom() against loadData() appending the same rows one by one
+void Tester::mergeTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const string CSV_PATH = "merge_bench.csv";
+    const string DELTA_PATH = "merge_bench_delta.csv";
 
-    bool properCopy = false;
+    for (int i = 0; i < numTrials; i++) {
+        // the delta touches existing usernames and adds new ones, in sorted order
+        std::ofstream out(CSV_PATH), delta(DELTA_PATH);
+        for (int j = 0; j < N; j++) {
+            out << "user_account_" << (long long)j * 7919 % N / 10 << ',' << (j * 7) % MAX_DISC
+                << ",0,Early Supporter,Listening to something\n";
+        }
+        for (int j = 0; j < N / 10; j++) {
+            delta << "user_account_" << j << ",1" << std::setw(3) << std::setfill('0') << j % 1000
+                  << ",1,Early Supporter,Listening to something\n";
+        }
+        out.close();
+        delta.close();
+
+        // string order isn't numeric order, so sort the delta's lines
+        std::ifstream in(DELTA_PATH);
+        vector<string> lines;
+        for (string line; std::getline(in, line);) { lines.push_back(line); }
+        in.close();
+        std::sort(lines.begin(), lines.end());
+        std::ofstream sorted(DELTA_PATH);
+        for (const string& line : lines) { sorted << line << '\n'; }
+        sorted.close();
+
+        // one tree at a time, each loaded from the same rows before the delta goes in
+        UTree *obj = new UTree;
+        obj->loadData(CSV_PATH, false);
+        auto startTime = std::chrono::steady_clock::now();
+        obj->loadData(DELTA_PATH, true);
+        double appendTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        delete obj;
 
-    Account lhsAcc = lhs->getAccount();
-    Account rhsAcc = rhs->getAccount();
+        obj = new UTree;
+        obj->loadData(CSV_PATH, false);
+        startTime = std::chrono::steady_clock::now();
+        obj->mergeSorted(DELTA_PATH);
+        double streamTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        delete obj;
 
-    // verify all acc details
-    if (lhsAcc.getUsername() == rhsAcc.getUsername() && lhsAcc.getDiscriminator() == rhsAcc.getDiscriminator()
-            && lhsAcc.hasNitro() == rhsAcc.hasNitro() && lhsAcc.getBadge() == rhsAcc.getBadge()
-            && lhsAcc.getStatus() == lhsAcc.getStatus() && &lhsAcc != &rhsAcc)
-    {
-        // verify all node members
-        if (lhs->getSize() == rhs->getSize() && lhs->getNumVacant() == rhs->getNumVacant()
-                && lhs->isVacant() == rhs->isVacant())
-        {
-            // verify deep copy
-            if (lhs != rhs) {
-                properCopy = true;
-            }
-        }
+        obj = new UTree;
+        UTree *source = new UTree;
+        obj->loadData(CSV_PATH, false);
+        source->loadData(DELTA_PATH, false);
+        startTime = std::chrono::steady_clock::now();
+        obj->mergeFrom(std::move(*source));
+        double mergeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        delete obj;
+        delete source;
+
+        cout << "\t" << N / 10 << " rows into " << N << ": appending took " << appendTime << " seconds, mergeSorted() took "
+             << streamTime << " seconds, mergeFrom() took " << mergeTime << " seconds" << endl;
+
+        std::remove(CSV_PATH.c_str());
+        std::remove(DELTA_PATH.c_str());
+
+        N *= SCALING;
     }
 
-    return properCopy && checkDNodeEquality(lhs->_left, rhs->_left) && checkDNodeEquality(lhs->_right, rhs->_right);
+    return;
 }
 
-// return the root of a UTree
-UNode* Tester::getURoot(UTree& tree) {
-    return tree._root;
-}
+// test split() and join() on trees of N usernames; both should grow with the
+// tree's height rather than with the N / 2 usernames moved
+void Tester::splitJoinTime(int numTrials, int N) {
+    const int SCALING = 4;
+    const int REPEATS = 1000;
 
-// return the left child of a UNode
-UNode* Tester::getUNodeLeft(UNode* node) {
-    return node->_left;
-}
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj, right;
+        for (int j = 0; j < N; j++) {
+            obj.insert(createAccount(j % MAX_DISC, "user" + std::to_string(j * 7919 % N)));
+        }
 
-// return the right child of a UNode
-UNode* Tester::getUNodeRight(UNode* node) {
-    return node->_right;
-}
+        auto startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < REPEATS; j++) {
+            obj.split("user5", right);
+            obj.join(std::move(right));
+        }
+        double timeTaken = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << "\t" << N << " usernames: " << timeTaken / REPEATS * 1e6 << " microseconds per split and join" << endl;
+
+        N *= SCALING;
+    }
 
-// converts the UTree into a vector for order checking
-void Tester::putUIntoArr(UTree &obj, vector<UNode*> &arr) {
-    putUIntoArr(arr, obj._root);
     return;
 }
 
-// similar to the method for DTree, put all Unodes into an array (vect) in order
-void Tester::putUIntoArr(vector<UNode*> &arr, UNode *&node) {
-    if (node->_left) {
-        putUIntoArr(arr, node->_left);
-    }
+// test N mutations spread over 1, 2, 4 and 8 threads, each thread working on its
+// own usernames, in concurrent mode and with every call behind one global mutex
+void Tester::concurrencyTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const int NUM_NAMES = 10000;
 
-    arr.push_back(node);
+    for (int i = 0; i < numTrials; i++) {
+        cout << "\t" << N << " mutations:";
+
+        for (int numThreads = 1; numThreads <= 8; numThreads *= 2) {
+            double times[2];
+
+            for (int concurrent = 0; concurrent < 2; concurrent++) {
+                UTree obj;
+                std::mutex global;
+
+                // every username exists up front, so most mutations only need its UNode's lock
+                for (int j = 0; j < NUM_NAMES; j++) { obj.insert(createAccount(MAX_DISC, "user" + std::to_string(j))); }
+                if (concurrent) { obj.enableConcurrency(); }
+
+                auto startTime = std::chrono::steady_clock::now();
+                vector<std::thread> threads;
+                for (int t = 0; t < numThreads; t++) {
+                    threads.emplace_back([&, t]() {
+                        for (int j = t; j < N; j += numThreads) {
+                            long long name = (long long)(j / numThreads) * 7919 % (NUM_NAMES / numThreads);
+                            string username = "user" + std::to_string(name * numThreads + t);
+                            DNode *removed = nullptr;
+
+                            std::unique_lock<std::mutex> guard(global, std::defer_lock);
+                            if (!concurrent) { guard.lock(); }
+                            obj.insert(createAccount(j % MAX_DISC, username));
+                            if (j % 3 == 0 && obj.removeUser(username, (j / 2) % MAX_DISC, removed)) { delete removed; }
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) { thread.join(); }
+                times[concurrent] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            }
 
-    if (node->_right) {
-        putUIntoArr(arr, node->_right);
+            cout << " " << numThreads << " threads " << int(N / times[1]) << "/s (global mutex " << int(N / times[0]) << "/s)"
+                 << (numThreads < 8 ? "," : "");
+        }
+        cout << endl;
+
+        N *= SCALING;
     }
 
     return;
 }
 
-// test insertion time into a DTree
-void Tester::dTreeInsertionTime(int numTrials, int N) {
+// test N insertions spread over 1, 2, 4 and 8 threads into an 8 shard ShardedUTree
+// and into one UTree with every call behind a mutex
+void Tester::shardedTime(int numTrials, int N) {
     const int SCALING = 2;
+    const int NUM_SHARDS = 8;
 
-    // start and end time keep track of when the test was started and finished
-    clock_t startTime;
-    clock_t endTime;
+    for (int i = 0; i < numTrials; i++) {
+        cout << "\t" << N << " insertions:";
+
+        for (int numThreads = 1; numThreads <= 8; numThreads *= 2) {
+            ShardedUTree *sharded = new ShardedUTree(NUM_SHARDS);
+            UTree *single = new UTree;
+            std::mutex global;
+            double times[2];
+
+            for (int s = 0; s < 2; s++) {
+                auto startTime = std::chrono::steady_clock::now();
+                vector<std::thread> threads;
+                for (int t = 0; t < numThreads; t++) {
+                    threads.emplace_back([&, s, t]() {
+                        for (int j = t; j < N; j += numThreads) {
+                            Account acct("user_account_" + std::to_string((long long)j * 7919 % N / 10), j % MAX_DISC,
+                                         false, "", "");
+                            if (s == 0) {
+                                sharded->insert(std::move(acct));
+                            } else {
+                                std::lock_guard<std::mutex> guard(global);
+                                single->insert(std::move(acct));
+                            }
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) { thread.join(); }
+                times[s] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            }
 
-    // timeTaken is a shortcut for endTime - startTime
-    double timeTaken = 0.0;
+            cout << " " << numThreads << " threads " << int(N / times[0]) << "/s (one UTree " << int(N / times[1]) << "/s)"
+                 << (numThreads < 8 ? "," : "");
 
-    // stores the previous times of each iteration to compare
-    double prevTime = 0.0;
+            delete sharded;
+            delete single;
+        }
+        cout << endl;
+
+        N *= SCALING;
+    }
+
+    return;
+}
+
+// test lookups from 1, 2 and 4 reader threads while one writer keeps inserting and
+// removing, with lock-free reads, with a plain tree behind one reader-writer lock, and
+// with concurrent mode. lock-free readers and the plain tree both walk the UTree, while
+// concurrent mode finds UNodes through its hash index
+void Tester::lockFreeTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const int NUM_WRITES = 20000;
+    enum { LOCK_FREE, TREE_LOCK, CONCURRENT, NUM_MODES };
 
     for (int i = 0; i < numTrials; i++) {
-        DTree *obj = new DTree;
+        cout << "\t" << N << " accounts:";
+
+        for (int numReaders = 1; numReaders <= 4; numReaders *= 2) {
+            double rates[NUM_MODES];
+
+            for (int mode = 0; mode < NUM_MODES; mode++) {
+                UTree obj;
+                std::shared_mutex treeLock;
+                std::atomic<bool> writerWaiting(false);     // shared_mutex alone lets readers starve the writer
+                for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string(j / 10))); }
+                if (mode == LOCK_FREE) { obj.enableLockFreeReads(); } else if (mode == CONCURRENT) { obj.enableConcurrency(); }
+
+                std::atomic<bool> writing(true);
+                std::atomic<long long> lookups(0);
+                auto startTime = std::chrono::steady_clock::now();
+                vector<std::thread> threads;
+
+                for (int t = 0; t < numReaders; t++) {
+                    threads.emplace_back([&, t]() {
+                        long long done = 0;
+                        for (long long j = t; writing; j += numReaders) {
+                            string username = "user" + std::to_string(j * 7919 % (N / 10));
+                            if (mode == TREE_LOCK) {
+                                while (writerWaiting) { std::this_thread::yield(); }
+                                std::shared_lock<std::shared_mutex> guard(treeLock);
+                                if (obj.retrieveUser(username, j % 10)) { done++; }
+                            } else if (obj.retrieveUser(username, j % 10)) {
+                                done++;
+                            }
+                        }
+                        lookups += done;
+                    });
+                }
+                for (int j = 0; j < NUM_WRITES; j++) {
+                    string username = "user" + std::to_string((long long)j * 7919 % (N / 10));
+                    DNode *removed = nullptr;
+                    std::unique_lock<std::shared_mutex> guard(treeLock, std::defer_lock);
+                    if (mode == TREE_LOCK) {
+                        writerWaiting = true;
+                        guard.lock();
+                    }
+                    obj.insert(createAccount(10 + j % 10, username));
+                    if (obj.removeUser(username, 10 + (j + 5) % 10, removed)) { delete removed; }
+                    if (mode == TREE_LOCK) {
+                        writerWaiting = false;
+                        guard.unlock();
+                    }
+                }
+                writing = false;
+                for (std::thread& thread : threads) { thread.join(); }
 
-        int name = 0;
-        int disc = 0;
+                rates[mode] = lookups / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            }
 
-        // insert N elements, keeping track of start and end time
-        startTime = clock();
-        for (int i = 0; i < N; i++) {
-            disc = i % MAX_DISC;
-            if (!disc) { name++; }
-            obj->insert(createAccount(disc, to_string(name)));
+            cout << " " << numReaders << " readers " << (long long)rates[LOCK_FREE] << "/s (tree lock "
+                 << (long long)rates[TREE_LOCK] << "/s, concurrent mode " << (long long)rates[CONCURRENT] << "/s)"
+                 << (numReaders < 4 ? "," : "");
         }
-        endTime = clock();
+        cout << endl;
 
-        // output how long the enqueue test took
-        timeTaken = double(endTime - startTime) / CLOCKS_PER_SEC;
-        cout << "\tInserted " << N << " accounts into DTree, took " << timeTaken
-             << " seconds ";
+        N *= SCALING;
+    }
 
-        // if there was actually a previous iteration, output how much longer
-        // this one took (should float around 2x for O(n) since our scaling is 2)
-        if (prevTime) {
-            cout << '(' << double(timeTaken / prevTime)
-                 << "x longer than previous insertion)";
-        }
+    return;
+}
 
-        // store into the previous time for tracking
-        prevTime = timeTaken;
+// test N insertions and removals into a tree of N accounts in place, path copied with
+// no snapshot, and path copied while a snapshot from before the writes is kept
+void Tester::persistenceTime(int numTrials, int N) {
+    const int SCALING = 2;
 
+    for (int i = 0; i < numTrials; i++) {
+        cout << "\t" << N << " writes:";
+
+        for (int mode = 0; mode < 3; mode++) {
+            UTree obj;
+            for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string(j / 10))); }
+            if (mode > 0) { obj.enablePersistence(); }
+            std::shared_ptr<USnapshot> snap = (mode == 2) ? obj.snapshot() : nullptr;
+
+            auto startTime = std::chrono::steady_clock::now();
+            for (int j = 0; j < N / 2; j++) {
+                string username = "user" + std::to_string((long long)j * 7919 % (N / 10));
+                DNode *removed = nullptr;
+                obj.insert(createAccount(10 + j % 10, username));
+                if (obj.removeUser(username, j % 10, removed)) { delete removed; }
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            if (mode == 0) {
+                cout << " in place " << int(N / time) << "/s,";
+            } else if (mode == 1) {
+                cout << " path copied " << int(N / time) << "/s,";
+            } else {
+                cout << " with a snapshot " << int(N / time) << "/s holding "
+                     << std::fixed << std::setprecision(1) << (double)obj.getVersions()->numHeld() / N << " nodes per write";
+                cout.unsetf(std::ios::fixed);
+            }
+        }
         cout << endl;
 
-        // scale our number of elements by 2
         N *= SCALING;
+    }
 
-        delete obj;
+    return;
+}
+
+// test N lookups, mostly hits, on trees of N accounts one retrieveUser() at a time
+// and through retrieveUserBatch() in batches of 256
+void Tester::batchLookupTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const int BATCH = 256;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+
+        vector<UserKey> keys;
+        for (long long j = 0; j < N; j++) { keys.push_back({"user" + std::to_string(j * 104729 % N / 10), (int)(j % 12)}); }
+        vector<DNode*> scalar(N), batched(N);
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < N; j++) { scalar[j] = obj.retrieveUser(keys[j].username, keys[j].disc); }
+        double scalarTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < N; j += BATCH) { obj.retrieveUserBatch(keys.data() + j, std::min(BATCH, N - j), batched.data() + j); }
+        double batchTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << "\t" << N << " lookups: one at a time " << int(N / scalarTime) << "/s, batched " << int(N / batchTime) << "/s ("
+             << std::fixed << std::setprecision(2) << scalarTime / batchTime << "x)" << (scalar == batched ? "" : ", MISMATCH") << endl;
+        cout.unsetf(std::ios::fixed);
+
+        N *= SCALING;
     }
 
     return;
 }
 
-void Tester::uTreeInsertionTime(int numTrials, int N) {
+// test N lookups, mostly hits, on trees of N accounts one retrieveUser() at a time
+// and as coroutines through a scheduler with windows of 1, LOOKUP_WINDOW and 64
+void Tester::asyncLookupTime(int numTrials, int N) {
     const int SCALING = 2;
+    const int BATCH = 256;
 
-    // start and end time keep track of when the test was started and finished
-    clock_t startTime;
-    clock_t endTime;
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+
+        vector<UserKey> keys;
+        for (long long j = 0; j < N; j++) { keys.push_back({"user" + std::to_string(j * 104729 % N / 10), (int)(j % 12)}); }
+        vector<DNode*> plain(N), scheduled(N);
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < N; j++) { plain[j] = obj.retrieveUser(keys[j].username, keys[j].disc); }
+        double plainTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        cout << "\t" << N << " lookups: one at a time " << int(N / plainTime) << "/s";
+        for (size_t window : {(size_t)1, (size_t)LOOKUP_WINDOW, (size_t)64}) {
+            startTime = std::chrono::steady_clock::now();
+            for (int j = 0; j < N; j += BATCH) {
+                int count = std::min(BATCH, N - j);
+                vector<ULookup<DNode*>> lookups;
+                ULookupScheduler scheduler(window);
+                lookups.reserve(count);
+
+                for (int k = 0; k < count; k++) {
+                    lookups.push_back(obj.retrieveUserAsync(keys[j + k].username, keys[j + k].disc));
+                    scheduler.spawn(lookups.back());
+                }
+                scheduler.run();
+                for (int k = 0; k < count; k++) { scheduled[j + k] = lookups[k].get(); }
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 
-    // timeTaken is a shortcut for endTime - startTime
-    double timeTaken = 0.0;
+            cout << ", window " << window << " " << int(N / time) << "/s" << (plain == scheduled ? "" : " MISMATCH");
+        }
+        cout << endl;
 
-    // stores the previous times of each iteration to compare
-    double prevTime = 0.0;
+        N *= SCALING;
+    }
+
+    return;
+}
+
+// test a batch of N operations, 60% inserts and 40% removals over N / 10 usernames,
+// on trees of N / 2 accounts, applied one by one and through applyBatch()
+void Tester::applyBatchTime(int numTrials, int N) {
+    const int SCALING = 2;
 
     for (int i = 0; i < numTrials; i++) {
-        UTree *obj = new UTree;
+        UTree serial, batched;
+        for (int j = 0; j < N / 2; j++) {
+            Account acct = createAccount(rng() % 40, "user" + std::to_string(rng() % (N / 10)));
+            serial.insert(acct);
+            batched.insert(acct);
+        }
 
-        int name = 0;
-        int disc = 0;
+        vector<AccountOp> ops;
+        for (int j = 0; j < N; j++) {
+            string username = "user" + std::to_string(rng() % (N / 10 + N / 100));
+            int disc = rng() % 40;
+            ops.push_back((rng() % 10 < 6) ? AccountOp::insert(createAccount(disc, username)) : AccountOp::remove(username, disc));
+        }
 
-        startTime = clock();
-        for (int i = 0; i < N; i++) {
-            disc = i % MAX_DISC;
-            if (!disc) { name++; }
-            obj->insert(createAccount(disc, to_string(name)));
+        auto startTime = std::chrono::steady_clock::now();
+        for (const AccountOp& op : ops) {
+            DNode *removed = nullptr;
+            if (op.type == AccountOp::INSERT) {
+                serial.insert(op.account);
+            } else if (serial.removeUser(op.account.getUsername(), op.account.getDiscriminator(), removed)) {
+                delete removed;
+            }
         }
-        endTime = clock();
+        double serialTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 
-        // output how long the enqueue test took
-        timeTaken = double(endTime - startTime) / CLOCKS_PER_SEC;
-        cout << "\tInserted " << N << " accounts into UTree, took " << timeTaken
-             << " seconds ";
+        startTime = std::chrono::steady_clock::now();
+        vector<AccountOpResult> results = batched.applyBatch(ops);
+        for (AccountOpResult& result : results) { delete result.removed; }
+        double batchTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 
-        // if there was actually a previous iteration, output how much longer
-        // this one took (should float around 2x for O(n) since our scaling is 2)
-        if (prevTime) {
-            cout << '(' << double(timeTaken / prevTime)
-                 << "x longer than previous insertion)";
+        cout << "\t" << N << " operations: one by one " << int(N / serialTime) << "/s, batched " << int(N / batchTime) << "/s ("
+             << std::fixed << std::setprecision(2) << serialTime / batchTime << "x)"
+             << (describeAccounts(serial) == describeAccounts(batched) ? "" : ", MISMATCH") << endl;
+        cout.unsetf(std::ios::fixed);
+
+        N *= SCALING;
+    }
+
+    return;
+}
+
+// test N lookups of usernames in a tree of N accounts and N of usernames not in it,
+// without and with the filter
+void Tester::bloomFilterTime(int numTrials, int N) {
+    const int SCALING = 2;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+
+        vector<string> hits, misses;
+        for (long long j = 0; j < N; j++) {
+            hits.push_back("user" + std::to_string(j * 104729 % N / 10));
+            misses.push_back("nobody" + std::to_string(j * 104729 % N));
         }
 
-        // store into the previous time for tracking
-        prevTime = timeTaken;
+        // ns per lookup of each username in order
+        auto timeLookups = [&obj](const vector<string> &usernames, int &found) {
+            found = 0;
+            auto startTime = std::chrono::steady_clock::now();
+            for (const string& name : usernames) { if (obj.retrieve(name)) { found++; } }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / usernames.size();
+        };
+
+        int hitsFound, missesFound, filteredHits, filteredMisses;
+        timeLookups(hits, hitsFound);   // warms the cache for both runs
+        double hitTime = timeLookups(hits, hitsFound);
+        double missTime = timeLookups(misses, missesFound);
+        obj.enableFilter();
+        double filteredHitTime = timeLookups(hits, filteredHits);
+        double filteredMissTime = timeLookups(misses, filteredMisses);
+
+        cout << "\t" << N << " accounts: hits " << int(hitTime) << "ns, filtered " << int(filteredHitTime) << "ns; misses "
+             << int(missTime) << "ns, filtered " << int(filteredMissTime) << "ns; "
+             << std::fixed << std::setprecision(3) << 100 * obj.getFilter()->falsePositiveRate() << "% false positives in "
+             << obj.getFilter()->memoryUsage() << " bytes"
+             << ((hitsFound == filteredHits && missesFound == 0 && filteredMisses == 0) ? "" : ", MISMATCH") << endl;
+        cout.unsetf(std::ios::fixed);
+
+        N *= SCALING;
+    }
 
+    return;
+}
+
+// test N lookups, Zipf distributed over the accounts of a tree of N accounts,
+// without the cache and with caches of 1024 and 16384 accounts, then again with
+// every 10th lookup replaced by a removal
+void Tester::hotCacheTime(int numTrials, int N) {
+    const int SCALING = 2;
+    const double ZIPF_EXPONENT = 0.99;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+
+        // account rank r, in a random order of the accounts, is looked up in proportion to 1 / r^s
+        vector<double> weights(N);
+        for (int j = 0; j < N; j++) { weights[j] = 1.0 / std::pow(j + 1, ZIPF_EXPONENT); }
+        std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+        vector<int> accounts(N);
+        for (int j = 0; j < N; j++) { accounts[j] = j; }
+        std::shuffle(accounts.begin(), accounts.end(), rng);
+
+        vector<UserKey> keys;
+        for (int j = 0; j < N; j++) {
+            int account = accounts[zipf(rng)];
+            keys.push_back({"user" + std::to_string(account / 10), account % 10});
+        }
+
+        // ns per lookup of each key in order
+        auto timeLookups = [&obj, &keys](vector<DNode*> &results) {
+            auto startTime = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < keys.size(); j++) { results[j] = obj.retrieveUser(keys[j].username, keys[j].disc); }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / keys.size();
+        };
+
+        vector<DNode*> plain(N), cached(N);
+        timeLookups(plain);     // warms the cache for every run
+        double plainTime = timeLookups(plain);
+
+        cout << "\t" << N << " lookups: uncached " << int(plainTime) << "ns";
+        for (size_t capacity : {(size_t)1024, (size_t)16384}) {
+            obj.enableCache(capacity);
+            double cachedTime = timeLookups(cached);
+
+            cout << ", " << capacity << " cached " << int(cachedTime) << "ns at "
+                 << std::fixed << std::setprecision(1) << 100 * obj.getCache()->hitRate() << "% hits"
+                 << (plain == cached ? "" : " MISMATCH");
+            cout.unsetf(std::ios::fixed);
+            obj.disableCache();
+        }
+        cout << endl;
+
+        // ns per operation of the same keys with every 10th lookup replaced by a
+        // removal, taking out one username's accounts after another so that UNodes
+        // keep emptying and being replaced
+        auto timeMixed = [N, &keys](size_t capacity, vector<bool> &found) {
+            UTree mixed;
+            for (int j = 0; j < N; j++) { mixed.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+            if (capacity) { mixed.enableCache(capacity); }
+
+            auto startTime = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < keys.size(); j++) {
+                if (j % 10 == 9) {
+                    int account = j / 10;
+                    DNode *removed = nullptr;
+                    if (mixed.removeUser("user" + std::to_string(account / 10), account % 10, removed)) { delete removed; }
+                } else {
+                    found[j] = mixed.retrieveUser(keys[j].username, keys[j].disc) != nullptr;
+                }
+            }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / keys.size();
+        };
+
+        vector<bool> plainFound(N), cachedFound(N);
+        cout << "\t" << N << " with removals: uncached " << int(timeMixed(0, plainFound)) << "ns";
+        for (size_t capacity : {(size_t)1024, (size_t)16384}) {
+            cout << ", " << capacity << " cached " << int(timeMixed(capacity, cachedFound)) << "ns"
+                 << (plainFound == cachedFound ? "" : " MISMATCH");
+        }
         cout << endl;
 
-        // scale our number of elements by 2
         N *= SCALING;
+    }
 
-        delete obj;
+    return;
+}
+
+// test N lookups of accounts in a tree of N accounts through retrieveUser() and
+// through handles taken to them beforehand
+void Tester::handleTime(int numTrials, int N) {
+    const int SCALING = 2;
+
+    for (int i = 0; i < numTrials; i++) {
+        UTree obj;
+        for (int j = 0; j < N; j++) { obj.insert(createAccount(j % 10, "user" + std::to_string((long long)j * 7919 % N / 10))); }
+        obj.enableHandles();
+
+        vector<UserKey> keys;
+        for (long long j = 0; j < N; j++) { keys.push_back({"user" + std::to_string(j * 104729 % N / 10), (int)(j % 10)}); }
+
+        auto startTime = std::chrono::steady_clock::now();
+        vector<AccountHandle> handles;
+        for (UserKey& key : keys) { handles.push_back(obj.getHandle(key.username, key.disc)); }
+        double acquireTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / N;
+
+        vector<DNode*> looked(N), derefed(N);
+        startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < N; j++) { looked[j] = obj.retrieveUser(keys[j].username, keys[j].disc); }
+        double lookupTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / N;
+
+        startTime = std::chrono::steady_clock::now();
+        for (int j = 0; j < N; j++) { derefed[j] = obj.deref(handles[j]); }
+        double derefTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / N;
+
+        cout << "\t" << N << " accounts: retrieveUser() " << int(lookupTime) << "ns, deref() "
+             << std::fixed << std::setprecision(1) << derefTime << "ns, getHandle() " << int(acquireTime) << "ns, "
+             << obj.numHandles() << " handles in " << obj._handles->memoryUsage() << " bytes"
+             << (looked == derefed ? "" : ", MISMATCH") << endl;
+        cout.unsetf(std::ios::fixed);
+
+        N *= SCALING;
     }
 
     return;
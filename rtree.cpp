@@ -0,0 +1,689 @@
+/***************************
+* File:     rtree.cpp
+* Project:  Project 2
+*
+* Implementation of rtree.h.
+***************************/
+#include "rtree.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// preconditions: node is an RNode4 or RNode16 with room for another child
+// postconditions: child is inserted at the position that keeps the keys sorted
+template <class SortedNode>
+static void insertSorted(SortedNode *node, unsigned char byte, RNode *child) {
+    int pos = node->_numChildren;
+
+    // shift every larger key one slot to the right to open up a hole
+    while (pos > 0 && node->_keys[pos - 1] > byte) {
+        node->_keys[pos] = node->_keys[pos - 1];
+        node->_children[pos] = node->_children[pos - 1];
+        pos--;
+    }
+
+    node->_keys[pos] = byte;
+    node->_children[pos] = child;
+
+    return;
+}
+
+// preconditions: node is an RNode4 or RNode16 holding a child under byte
+// postconditions: the child is dropped and the keys after it shift left
+template <class SortedNode>
+static void removeSorted(SortedNode *node, unsigned char byte) {
+    int pos = 0;
+    while (node->_keys[pos] != byte) { pos++; }
+
+    for (int i = pos + 1; i < node->_numChildren; i++) {
+        node->_keys[i - 1] = node->_keys[i];
+        node->_children[i - 1] = node->_children[i];
+    }
+
+    return;
+}
+
+// preconditions: an inner node is being replaced by one of another type
+// postconditions: the prefix, terminal, and child count are moved over
+static void moveHeader(RInner *to, RInner *from) {
+    to->_numChildren = from->_numChildren;
+    to->_prefix.swap(from->_prefix);
+    to->_terminal = from->_terminal;
+    from->_terminal = nullptr;
+
+    return;
+}
+
+/**
+ * Destructor, deletes all dynamic memory.
+ */
+RTree::~RTree() {
+    clear();
+}
+
+/**
+ * Inserts an account into the DTree of its username, creating a leaf for the
+ * username if it is new.
+ * @param newAcct Account object to be inserted into the corresponding DTree
+ * @return true if the account was inserted, false otherwise
+ */
+bool RTree::insert(Account newAcct) {
+    RLeaf *leaf = insert(this->_root, newAcct.getUsername(), 0);
+
+    return leaf->_unode->insert(newAcct);
+}
+
+// preconditions: link is the slot in which a key with depth bytes already consumed belongs
+// postconditions: the leaf holding key is returned, created and linked in if it did not exist
+RLeaf* RTree::insert(RNode *&link, const string& key, int depth) {
+    // an empty slot takes a new leaf directly
+    if (!link) {
+        RLeaf *leaf = new RLeaf(key);
+        link = leaf;
+        return leaf;
+    }
+
+    if (link->_type == RNODE_LEAF) {
+        RLeaf *existing = static_cast<RLeaf*>(link);
+        if (existing->_key == key) { return existing; }
+
+        // two keys now share this slot, so give them an inner node holding the
+        // bytes they still have in common
+        int keyLength = key.length();
+        int existingLength = existing->_key.length();
+        int common = 0;
+
+        while (depth + common < keyLength && depth + common < existingLength
+                && key[depth + common] == existing->_key[depth + common]) {
+            common++;
+        }
+
+        RNode4 *node = new RNode4();
+        node->_prefix = key.substr(depth, common);
+
+        RLeaf *leaf = new RLeaf(key);
+        RNode *newLink = node;
+        attachLeaf(newLink, existing, depth + common);
+        attachLeaf(newLink, leaf, depth + common);
+        link = newLink;
+
+        return leaf;
+    }
+
+    RInner *node = static_cast<RInner*>(link);
+    int prefixLength = node->_prefix.length();
+    int common = 0;
+
+    while (common < prefixLength && depth + common < (int)key.length()
+            && node->_prefix[common] == key[depth + common]) {
+        common++;
+    }
+
+    // the key leaves the compressed path part way through, so split the path
+    // into a new parent holding the shared part and the old node below it
+    if (common < prefixLength) {
+        RNode4 *parent = new RNode4();
+        parent->_prefix = node->_prefix.substr(0, common);
+
+        unsigned char byte = node->_prefix[common];
+        node->_prefix.erase(0, common + 1);
+
+        RLeaf *leaf = new RLeaf(key);
+        RNode *parentLink = parent;
+        addChild(parentLink, byte, node);
+        attachLeaf(parentLink, leaf, depth + common);
+        link = parentLink;
+
+        return leaf;
+    }
+
+    depth += prefixLength;
+
+    // the key ends at this node
+    if (depth == (int)key.length()) {
+        if (!node->_terminal) { node->_terminal = new RLeaf(key); }
+        return node->_terminal;
+    }
+
+    RNode **child = findChild(node, key[depth]);
+
+    if (child) {
+        return insert(*child, key, depth + 1);
+    }
+
+    RLeaf *leaf = new RLeaf(key);
+    addChild(link, key[depth], leaf);
+
+    return leaf;
+}
+
+// preconditions: link is a new inner node and leaf's key matches it through depth bytes
+// postconditions: leaf becomes the node's terminal if its key ends here, else a child
+void RTree::attachLeaf(RNode *&link, RLeaf *leaf, int depth) {
+    if ((int)leaf->_key.length() == depth) {
+        static_cast<RInner*>(link)->_terminal = leaf;
+    } else {
+        addChild(link, leaf->_key[depth], leaf);
+    }
+
+    return;
+}
+
+/**
+ * Removes a user with a matching username and discriminator.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @param removed DNode object to hold removed account
+ * @return true if an account was removed, false otherwise
+ */
+bool RTree::removeUser(string username, int disc, DNode*& removed) {
+    RLeaf *leaf = findLeaf(username);
+
+    if (!leaf || !leaf->_unode->remove(disc, removed)) {
+        return false;
+    }
+
+    // once the username holds no accounts, its leaf comes out of the tree
+    if (!leaf->_unode->getNumUsers()) {
+        erase(this->_root, username, 0);
+    }
+
+    return true;
+}
+
+// preconditions: key is in the subtree at link, with depth bytes already consumed
+// postconditions: the leaf for key is deleted and every node on the way back up is
+//                 shrunk or collapsed into its parent if it got too sparse
+void RTree::erase(RNode *&link, const string& key, int depth) {
+    if (link->_type == RNODE_LEAF) {
+        deleteNode(link);
+        link = nullptr;
+        return;
+    }
+
+    RInner *node = static_cast<RInner*>(link);
+    depth += node->_prefix.length();
+
+    if (depth == (int)key.length()) {
+        deleteNode(node->_terminal);
+        node->_terminal = nullptr;
+    } else {
+        unsigned char byte = key[depth];
+        RNode **child = findChild(node, byte);
+
+        erase(*child, key, depth + 1);
+        if (!*child) { removeChild(link, byte); }
+    }
+
+    compact(link);
+
+    return;
+}
+
+// preconditions: a key was removed from the inner node at link
+// postconditions: the node is shrunk to a smaller type if it is sparse enough,
+//                 replaced by its terminal if it has no children left, or merged
+//                 into its only child
+void RTree::compact(RNode *&link) {
+    shrink(link);
+
+    RInner *node = static_cast<RInner*>(link);
+
+    if (node->_numChildren == 0) {
+        link = node->_terminal;
+        node->_terminal = nullptr;
+        deleteNode(node);
+    } else if (node->_numChildren == 1 && !node->_terminal && node->_type == RNODE_4) {
+        RNode4 *single = static_cast<RNode4*>(node);
+        RNode *child = single->_children[0];
+
+        // leaves hold their whole key, so only an inner child needs the path prepended
+        if (child->_type != RNODE_LEAF) {
+            RInner *inner = static_cast<RInner*>(child);
+            inner->_prefix = single->_prefix + (char)single->_keys[0] + inner->_prefix;
+        }
+
+        link = child;
+        deleteNode(single);
+    }
+
+    return;
+}
+
+// preconditions: a node needs the slot of the child stored under byte
+// postconditions: a pointer to the child's slot is returned, nullptr if there is none
+RNode** RTree::findChild(RInner *node, unsigned char byte) const {
+    switch (node->_type) {
+    case RNODE_4: {
+        RNode4 *n = static_cast<RNode4*>(node);
+        for (int i = 0; i < n->_numChildren; i++) {
+            if (n->_keys[i] == byte) { return &n->_children[i]; }
+        }
+        return nullptr;
+    }
+    case RNODE_16: {
+        RNode16 *n = static_cast<RNode16*>(node);
+#ifdef __SSE2__
+        // compare all 16 keys at once and mask off the unused ones
+        __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(byte), _mm_loadu_si128((__m128i*)n->_keys));
+        int bits = _mm_movemask_epi8(matches) & ((1 << n->_numChildren) - 1);
+        return (bits) ? &n->_children[__builtin_ctz(bits)] : nullptr;
+#else
+        for (int i = 0; i < n->_numChildren; i++) {
+            if (n->_keys[i] == byte) { return &n->_children[i]; }
+        }
+        return nullptr;
+#endif
+    }
+    case RNODE_48: {
+        RNode48 *n = static_cast<RNode48*>(node);
+        int index = n->_childIndex[byte];
+        return (index) ? &n->_children[index - 1] : nullptr;
+    }
+    default: {
+        RNode256 *n = static_cast<RNode256*>(node);
+        return (n->_children[byte]) ? &n->_children[byte] : nullptr;
+    }
+    }
+}
+
+// preconditions: the inner node at link has no child under byte
+// postconditions: child is added under byte, growing the node first if it is full
+void RTree::addChild(RNode *&link, unsigned char byte, RNode *child) {
+    RInner *node = static_cast<RInner*>(link);
+
+    if ((node->_type == RNODE_4 && node->_numChildren == RNODE_4_MAX)
+            || (node->_type == RNODE_16 && node->_numChildren == RNODE_16_MAX)
+            || (node->_type == RNODE_48 && node->_numChildren == RNODE_48_MAX)) {
+        grow(link);
+        node = static_cast<RInner*>(link);
+    }
+
+    switch (node->_type) {
+    case RNODE_4:
+        insertSorted(static_cast<RNode4*>(node), byte, child);
+        break;
+    case RNODE_16:
+        insertSorted(static_cast<RNode16*>(node), byte, child);
+        break;
+    case RNODE_48: {
+        // removals leave holes, so take the first free slot
+        RNode48 *n = static_cast<RNode48*>(node);
+        int slot = 0;
+        while (n->_children[slot]) { slot++; }
+
+        n->_children[slot] = child;
+        n->_childIndex[byte] = slot + 1;
+        break;
+    }
+    default:
+        static_cast<RNode256*>(node)->_children[byte] = child;
+        break;
+    }
+
+    node->_numChildren++;
+
+    return;
+}
+
+// preconditions: the inner node at link has a child under byte
+// postconditions: the child is unlinked (not deleted)
+void RTree::removeChild(RNode *&link, unsigned char byte) {
+    RInner *node = static_cast<RInner*>(link);
+
+    switch (node->_type) {
+    case RNODE_4:
+        removeSorted(static_cast<RNode4*>(node), byte);
+        break;
+    case RNODE_16:
+        removeSorted(static_cast<RNode16*>(node), byte);
+        break;
+    case RNODE_48: {
+        RNode48 *n = static_cast<RNode48*>(node);
+        n->_children[n->_childIndex[byte] - 1] = nullptr;
+        n->_childIndex[byte] = 0;
+        break;
+    }
+    default:
+        static_cast<RNode256*>(node)->_children[byte] = nullptr;
+        break;
+    }
+
+    node->_numChildren--;
+
+    return;
+}
+
+// preconditions: the inner node at link is full
+// postconditions: the node is replaced by one of the next larger type
+void RTree::grow(RNode *&link) {
+    RNode *old = link;
+
+    switch (old->_type) {
+    case RNODE_4: {
+        RNode4 *from = static_cast<RNode4*>(old);
+        RNode16 *to = new RNode16();
+        moveHeader(to, from);
+
+        for (int i = 0; i < from->_numChildren; i++) {
+            to->_keys[i] = from->_keys[i];
+            to->_children[i] = from->_children[i];
+        }
+
+        link = to;
+        break;
+    }
+    case RNODE_16: {
+        RNode16 *from = static_cast<RNode16*>(old);
+        RNode48 *to = new RNode48();
+        moveHeader(to, from);
+
+        for (int i = 0; i < from->_numChildren; i++) {
+            to->_children[i] = from->_children[i];
+            to->_childIndex[from->_keys[i]] = i + 1;
+        }
+
+        link = to;
+        break;
+    }
+    default: {
+        RNode48 *from = static_cast<RNode48*>(old);
+        RNode256 *to = new RNode256();
+        moveHeader(to, from);
+
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            if (from->_childIndex[b]) { to->_children[b] = from->_children[from->_childIndex[b] - 1]; }
+        }
+
+        link = to;
+        break;
+    }
+    }
+
+    deleteNode(old);
+
+    return;
+}
+
+// preconditions: a child was just removed from the inner node at link
+// postconditions: if the node has dropped to its shrink size, it is replaced by
+//                 one of the next smaller type
+void RTree::shrink(RNode *&link) {
+    RInner *old = static_cast<RInner*>(link);
+
+    if (old->_type == RNODE_16 && old->_numChildren <= RNODE_16_SHRINK) {
+        RNode16 *from = static_cast<RNode16*>(old);
+        RNode4 *to = new RNode4();
+        moveHeader(to, from);
+
+        for (int i = 0; i < from->_numChildren; i++) {
+            to->_keys[i] = from->_keys[i];
+            to->_children[i] = from->_children[i];
+        }
+
+        link = to;
+    } else if (old->_type == RNODE_48 && old->_numChildren <= RNODE_48_SHRINK) {
+        RNode48 *from = static_cast<RNode48*>(old);
+        RNode16 *to = new RNode16();
+        moveHeader(to, from);
+
+        // walking the index in byte order leaves the keys sorted
+        int pos = 0;
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            if (from->_childIndex[b]) {
+                to->_keys[pos] = b;
+                to->_children[pos++] = from->_children[from->_childIndex[b] - 1];
+            }
+        }
+
+        link = to;
+    } else if (old->_type == RNODE_256 && old->_numChildren <= RNODE_256_SHRINK) {
+        RNode256 *from = static_cast<RNode256*>(old);
+        RNode48 *to = new RNode48();
+        moveHeader(to, from);
+
+        int slot = 0;
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            if (from->_children[b]) {
+                to->_children[slot] = from->_children[b];
+                to->_childIndex[b] = ++slot;
+            }
+        }
+
+        link = to;
+    } else {
+        return;
+    }
+
+    deleteNode(old);
+
+    return;
+}
+
+/**
+ * Retrieves a set of users within a UNode.
+ * @param username username to match
+ * @return UNode with a matching username, nullptr otherwise
+ */
+UNode* RTree::retrieve(string username) {
+    RLeaf *leaf = findLeaf(username);
+
+    return (leaf) ? leaf->_unode : nullptr;
+}
+
+/**
+ * Retrieves the specified Account within a DNode.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return DNode with a matching username and discriminator, nullptr otherwise
+ */
+DNode* RTree::retrieveUser(string username, int disc) {
+    RLeaf *leaf = findLeaf(username);
+
+    return (leaf) ? leaf->_unode->findDisc(disc) : nullptr;
+}
+
+/**
+ * Returns the number of users with a specific username.
+ * @param username username to match
+ * @return number of users with the specified username
+ */
+int RTree::numUsers(string username) {
+    RLeaf *leaf = findLeaf(username);
+
+    return (leaf) ? leaf->_unode->getNumUsers() : 0;
+}
+
+// preconditions: a lookup of key is needed
+// postconditions: the leaf holding key is returned, nullptr if it is not in the tree
+RLeaf* RTree::findLeaf(const string& key) const {
+    RNode *node = this->_root;
+    int depth = 0;
+
+    while (node) {
+        // leaves keep the whole key, so one comparison settles it
+        if (node->_type == RNODE_LEAF) {
+            RLeaf *leaf = static_cast<RLeaf*>(node);
+            return (leaf->_key == key) ? leaf : nullptr;
+        }
+
+        RInner *inner = static_cast<RInner*>(node);
+
+        if (key.compare(depth, inner->_prefix.length(), inner->_prefix) != 0) {
+            return nullptr;
+        }
+
+        depth += inner->_prefix.length();
+
+        if (depth == (int)key.length()) {
+            return inner->_terminal;
+        }
+
+        RNode **child = findChild(inner, key[depth++]);
+        node = (child) ? *child : nullptr;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Helper for the destructor to clear dynamic memory.
+ */
+void RTree::clear() {
+    if (this->_root) {
+        clear(this->_root);
+    }
+
+    this->_root = nullptr;
+
+    return;
+}
+
+// preconditions: the clear() shell is called
+// postconditions: every node and leaf in this subtree is deallocated
+void RTree::clear(RNode *node) {
+    if (node->_type != RNODE_LEAF) {
+        RInner *inner = static_cast<RInner*>(node);
+        if (inner->_terminal) { clear(inner->_terminal); }
+
+        // children can sit in any slot of an RNode48/256, so visit every slot
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            RNode **child = findChild(inner, b);
+            if (child) { clear(*child); }
+        }
+    }
+
+    deleteNode(node);
+
+    return;
+}
+
+// preconditions: node has been unlinked from the tree
+// postconditions: the node itself is deallocated as its real type; children and
+//                 terminals are not, but a leaf's UNode is
+void RTree::deleteNode(RNode *node) {
+    switch (node->_type) {
+    case RNODE_LEAF: {
+        RLeaf *leaf = static_cast<RLeaf*>(node);
+        delete leaf->_unode;
+        delete leaf;
+        break;
+    }
+    case RNODE_4: delete static_cast<RNode4*>(node); break;
+    case RNODE_16: delete static_cast<RNode16*>(node); break;
+    case RNODE_48: delete static_cast<RNode48*>(node); break;
+    default: delete static_cast<RNode256*>(node); break;
+    }
+
+    return;
+}
+
+/**
+ * Prints all accounts' details within every DTree, in username order.
+ */
+void RTree::printUsers() const {
+    if (this->_root) {
+        forEachWithPrefix("", [](UNode *node, int) { node->getDTree()->printAccounts(); });
+    } else {
+        cout << "No accounts stored." << endl;
+    }
+
+    return;
+}
+
+/**
+ * Visits, in order, every UNode whose username starts with a prefix.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching UNode and its number of users
+ * @param limit maximum number of UNodes to visit, NO_LIMIT to visit all of them
+ * @return number of UNodes visited
+ */
+int RTree::forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit) const {
+    RNode *node = this->_root;
+    int depth = 0;
+    int visited = 0;
+
+    // follow the prefix down to the subtree in which every key matches it
+    while (node && node->_type != RNODE_LEAF) {
+        RInner *inner = static_cast<RInner*>(node);
+        int remaining = prefix.length() - depth;
+        int overlap = (remaining < (int)inner->_prefix.length()) ? remaining : inner->_prefix.length();
+
+        if (prefix.compare(depth, overlap, inner->_prefix, 0, overlap) != 0) { return 0; }
+
+        // the prefix runs out inside (or at the end of) this node's path
+        if (remaining <= (int)inner->_prefix.length()) { break; }
+
+        depth += inner->_prefix.length();
+        RNode **child = findChild(inner, prefix[depth++]);
+        node = (child) ? *child : nullptr;
+    }
+
+    if (!node) { return 0; }
+
+    if (node->_type == RNODE_LEAF && static_cast<RLeaf*>(node)->_key.compare(0, prefix.length(), prefix) != 0) {
+        return 0;
+    }
+
+    traverse(node, visitor, limit, visited);
+
+    return visited;
+}
+
+// preconditions: forEachWithPrefix() found the subtree to walk
+// postconditions: the subtree's UNodes are visited in order, false is returned once
+//                 limit is reached so callers stop walking
+bool RTree::traverse(RNode *node, std::function<void(UNode*, int)>& visitor, int limit, int &visited) const {
+    if (node->_type == RNODE_LEAF) {
+        if (visited == limit) { return false; }
+
+        UNode *unode = static_cast<RLeaf*>(node)->_unode;
+        visitor(unode, unode->getNumUsers());
+        visited++;
+
+        return true;
+    }
+
+    RInner *inner = static_cast<RInner*>(node);
+
+    // a key ending here is shorter than, and so sorts before, every child's
+    if (inner->_terminal && !traverse(inner->_terminal, visitor, limit, visited)) {
+        return false;
+    }
+
+    switch (inner->_type) {
+    case RNODE_4: {
+        RNode4 *n = static_cast<RNode4*>(inner);
+        for (int i = 0; i < n->_numChildren; i++) {
+            if (!traverse(n->_children[i], visitor, limit, visited)) { return false; }
+        }
+        break;
+    }
+    case RNODE_16: {
+        RNode16 *n = static_cast<RNode16*>(inner);
+        for (int i = 0; i < n->_numChildren; i++) {
+            if (!traverse(n->_children[i], visitor, limit, visited)) { return false; }
+        }
+        break;
+    }
+    case RNODE_48: {
+        RNode48 *n = static_cast<RNode48*>(inner);
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            if (n->_childIndex[b] && !traverse(n->_children[n->_childIndex[b] - 1], visitor, limit, visited)) {
+                return false;
+            }
+        }
+        break;
+    }
+    default: {
+        RNode256 *n = static_cast<RNode256*>(inner);
+        for (int b = 0; b < RNODE_256_MAX; b++) {
+            if (n->_children[b] && !traverse(n->_children[b], visitor, limit, visited)) { return false; }
+        }
+        break;
+    }
+    }
+
+    return true;
+}
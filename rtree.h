@@ -0,0 +1,129 @@
+/***************************
+* File:     rtree.h
+* Project:  Project 2
+*
+* Header definition of RTree class.
+***************************/
+#pragma once
+
+#include "utree.h"
+
+/* Node types, sized by fanout */
+#define RNODE_LEAF 0
+#define RNODE_4 1
+#define RNODE_16 2
+#define RNODE_48 3
+#define RNODE_256 4
+
+/* Capacities and the sizes at which a node shrinks to the next smaller type.
+ * The gaps keep a node from flipping types on alternating insert/remove. */
+#define RNODE_4_MAX 4
+#define RNODE_16_MAX 16
+#define RNODE_48_MAX 48
+#define RNODE_256_MAX 256
+#define RNODE_16_SHRINK 3
+#define RNODE_48_SHRINK 12
+#define RNODE_256_SHRINK 40
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Common header of every radix tree node */
+struct RNode {
+    unsigned char _type;
+
+    RNode(unsigned char type): _type(type) {}
+};
+
+/* A leaf owns the UNode (and through it the DTree) of exactly one username */
+struct RLeaf : RNode {
+    string _key;
+    UNode* _unode;
+
+    RLeaf(string key): RNode(RNODE_LEAF), _key(key), _unode(new UNode()) {}
+};
+
+/* Inner nodes compress the bytes every key below them shares into _prefix.
+ * A key that ends exactly at an inner node is kept in _terminal, which sorts
+ * before every child. */
+struct RInner : RNode {
+    int _numChildren;
+    string _prefix;
+    RLeaf* _terminal;
+
+    RInner(unsigned char type): RNode(type), _numChildren(0), _terminal(nullptr) {}
+};
+
+/* Up to 4 children, keys kept sorted */
+struct RNode4 : RInner {
+    unsigned char _keys[RNODE_4_MAX];
+    RNode* _children[RNODE_4_MAX];
+
+    RNode4(): RInner(RNODE_4) {}
+};
+
+/* Up to 16 children, keys kept sorted and searched 16 at a time */
+struct RNode16 : RInner {
+    unsigned char _keys[RNODE_16_MAX];
+    RNode* _children[RNODE_16_MAX];
+
+    RNode16(): RInner(RNODE_16) {}
+};
+
+/* Up to 48 children, _childIndex maps a key byte to its slot + 1 (0 is empty) */
+struct RNode48 : RInner {
+    unsigned char _childIndex[RNODE_256_MAX];
+    RNode* _children[RNODE_48_MAX];
+
+    RNode48(): RInner(RNODE_48) {
+        for (int i = 0; i < RNODE_256_MAX; i++) { _childIndex[i] = 0; }
+        for (int i = 0; i < RNODE_48_MAX; i++) { _children[i] = nullptr; }
+    }
+};
+
+/* One child pointer per key byte */
+struct RNode256 : RInner {
+    RNode* _children[RNODE_256_MAX];
+
+    RNode256(): RInner(RNODE_256) {
+        for (int i = 0; i < RNODE_256_MAX; i++) { _children[i] = nullptr; }
+    }
+};
+
+/* Adaptive radix tree over usernames. Offers the same operations as UTree,
+ * with each leaf's UNode owning that username's DTree. */
+class RTree : public UserIndex {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    RTree():_root(nullptr){}
+    ~RTree();
+
+    /* Basic operations */
+    bool insert(Account newAcct) override;
+    bool removeUser(string username, int disc, DNode*& removed) override;
+    UNode* retrieve(string username) override;
+    DNode* retrieveUser(string username, int disc) override;
+    int numUsers(string username) override;
+    void clear() override;
+    void printUsers() const override;
+    int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const override;
+
+private:
+    RNode* _root;
+
+    RLeaf* findLeaf(const string& key) const;
+    RLeaf* insert(RNode *&link, const string& key, int depth);
+    void attachLeaf(RNode *&link, RLeaf *leaf, int depth);
+    void erase(RNode *&link, const string& key, int depth);
+    RNode** findChild(RInner *node, unsigned char byte) const;
+    void addChild(RNode *&link, unsigned char byte, RNode *child);
+    void removeChild(RNode *&link, unsigned char byte);
+    void compact(RNode *&link);
+    void grow(RNode *&link);
+    void shrink(RNode *&link);
+    bool traverse(RNode *node, std::function<void(UNode*, int)>& visitor, int limit, int &visited) const;
+    void clear(RNode *node);
+    void deleteNode(RNode *node);
+};
@@ -0,0 +1,309 @@
+/***************************
+* File:     snapshot.cpp
+* Project:  Project 2
+*
+* Implementation of snapshot.h.
+***************************/
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * Checksums a piece of a snapshot.
+ * @param data bytes to add to the checksum
+ * @param size number of bytes, a multiple of 8 unless this is the last piece
+ * @param checksum checksum of the pieces before this one, or the seed
+ * @return checksum including this piece
+ */
+uint64_t snapshotChecksum(const char *data, size_t size, uint64_t checksum) {
+    const char *end = data + size;
+
+    for (; end - data >= 8; data += 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        checksum = (checksum ^ word) * FNV_PRIME;
+    }
+
+    for (; data < end; data++) {
+        checksum = (checksum ^ (unsigned char)*data) * FNV_PRIME;
+    }
+
+    return checksum;
+}
+
+/**
+ * Opens a snapshot for writing.
+ * @param path where the snapshot ends up once committed, isOpen() is false if
+ *             its temporary file could not be created
+ */
+SnapshotWriter::SnapshotWriter(string path): _path(path), _tmpPath(path + ".tmp"), _sink(nullptr) {
+    _fd = open(_tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    _buffer = new char[SNAPSHOT_BUFFER_SIZE];
+    _used = 0;
+    _checksum = SNAPSHOT_CHECKSUM_SEED;
+    _failed = false;
+}
+
+/**
+ * Opens a snapshot that is streamed to a sink.
+ * @param sink where the snapshot's bytes go, in order
+ */
+SnapshotWriter::SnapshotWriter(ExportSink& sink): _fd(-1), _sink(&sink) {
+    _buffer = new char[SNAPSHOT_BUFFER_SIZE];
+    _used = 0;
+    _checksum = SNAPSHOT_CHECKSUM_SEED;
+    _failed = false;
+}
+
+/**
+ * Destructor, throws away the temporary file if the snapshot was never committed.
+ */
+SnapshotWriter::~SnapshotWriter() {
+    if (_fd != -1) {
+        close(_fd);
+        unlink(_tmpPath.c_str());
+    }
+
+    delete [] _buffer;
+    _buffer = nullptr;
+}
+
+/**
+ * Appends integers to the snapshot, little endian.
+ * @param value value to append
+ */
+void SnapshotWriter::putU8(uint8_t value) {
+    if (_used == SNAPSHOT_BUFFER_SIZE) { flush(); }
+    _buffer[_used++] = (char)value;
+
+    return;
+}
+
+void SnapshotWriter::putU16(uint16_t value) {
+    putU8(value & 0xff);
+    putU8(value >> 8);
+
+    return;
+}
+
+void SnapshotWriter::putU32(uint32_t value) {
+    putU16(value & 0xffff);
+    putU16(value >> 16);
+
+    return;
+}
+
+void SnapshotWriter::putU64(uint64_t value) {
+    putU32(value & 0xffffffff);
+    putU32(value >> 32);
+
+    return;
+}
+
+/**
+ * Appends an unsigned integer as a LEB128 varint: seven bits per byte, lowest
+ * first, with the top bit set on every byte but the last.
+ * @param value value to append
+ */
+void SnapshotWriter::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        putU8((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    putU8(value);
+
+    return;
+}
+
+/**
+ * Appends raw bytes to the snapshot.
+ * @param data bytes to append
+ * @param size number of bytes
+ */
+void SnapshotWriter::putBytes(const char *data, size_t size) {
+    while (size > 0) {
+        if (_used == SNAPSHOT_BUFFER_SIZE) { flush(); }
+
+        size_t amount = std::min(size, (size_t)SNAPSHOT_BUFFER_SIZE - _used);
+        memcpy(_buffer + _used, data, amount);
+        _used += amount;
+        data += amount;
+        size -= amount;
+    }
+
+    return;
+}
+
+/**
+ * Finishes the snapshot: appends the checksum, syncs it to disk and moves it
+ * over any previous snapshot at the same path.
+ * @return true if the snapshot was written, false otherwise
+ */
+bool SnapshotWriter::commit() {
+    if (!isOpen()) { return false; }
+
+    // the footer is not part of its own checksum
+    _checksum = snapshotChecksum(_buffer, _used, _checksum);
+    writeOut(_buffer, _used);
+    _used = 0;
+
+    char footer[SNAPSHOT_FOOTER_SIZE];
+    for (int i = 0; i < SNAPSHOT_FOOTER_SIZE; i++) {
+        footer[i] = (char)(_checksum >> (8 * i));
+    }
+    writeOut(footer, SNAPSHOT_FOOTER_SIZE);
+
+    if (_sink) { return !_failed; }
+
+    _failed = _failed || fsync(_fd) != 0;
+    _failed = close(_fd) != 0 || _failed;
+    _fd = -1;
+
+    if (_failed || rename(_tmpPath.c_str(), _path.c_str()) != 0) {
+        unlink(_tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// preconditions: the buffer is full
+// postconditions: the buffer is checksummed and written out, and emptied
+void SnapshotWriter::flush() {
+    _checksum = snapshotChecksum(_buffer, _used, _checksum);
+    writeOut(_buffer, _used);
+    _used = 0;
+
+    return;
+}
+
+// preconditions: the snapshot file or sink is open
+// postconditions: the bytes are written out, or _failed is set
+void SnapshotWriter::writeOut(const char *data, size_t size) {
+    if (_sink) {
+        _failed = _failed || !_sink->write(data, size);
+        return;
+    }
+
+    while (size > 0 && !_failed) {
+        ssize_t result = write(_fd, data, size);
+
+        if (result <= 0) {
+            _failed = true;
+        } else {
+            data += result;
+            size -= result;
+        }
+    }
+
+    return;
+}
+
+/**
+ * Reads little endian integers from the snapshot.
+ * @return the value read
+ */
+uint8_t SnapshotReader::getU8() {
+    return (uint8_t)*take(1);
+}
+
+uint16_t SnapshotReader::getU16() {
+    const unsigned char *bytes = (const unsigned char*)take(2);
+    return bytes[0] | (bytes[1] << 8);
+}
+
+uint32_t SnapshotReader::getU32() {
+    const unsigned char *bytes = (const unsigned char*)take(4);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+uint64_t SnapshotReader::getU64() {
+    uint64_t low = getU32();
+    return low | ((uint64_t)getU32() << 32);
+}
+
+/**
+ * Reads a LEB128 varint from the snapshot.
+ * @return the value read
+ */
+uint64_t SnapshotReader::getVarint() {
+    uint64_t value = 0;
+
+    for (int i = 0; i < MAX_VARINT_SIZE; i++) {
+        uint8_t byte = getU8();
+        value |= (uint64_t)(byte & 0x7f) << (7 * i);
+
+        if (!(byte & 0x80)) { return value; }
+    }
+
+    throw std::invalid_argument("Malformed snapshot detected - varint is too long");
+}
+
+/**
+ * Reads a run of varints that each fit in 32 bits. Runs of small values, the
+ * common case for discriminator gaps and value ids, are decoded eight bytes at
+ * a time with no branches between them.
+ * @param values where to store the values
+ * @param count number of values to read
+ */
+void SnapshotReader::getVarints(uint32_t *values, size_t count) {
+    const uint64_t CONTINUATION_BITS = 0x8080808080808080ULL;
+    size_t i = 0;
+
+    while (i < count) {
+        // eight bytes without a continuation bit between them are eight values
+        if (count - i >= 8 && remaining() >= 8) {
+            uint64_t word;
+            memcpy(&word, _pos, sizeof(word));
+
+            if (!(word & CONTINUATION_BITS)) {
+                for (int j = 0; j < 8; j++) {
+                    values[i + j] = (unsigned char)_pos[j];
+                }
+
+                _pos += 8;
+                i += 8;
+                continue;
+            }
+        }
+
+        uint64_t value = getVarint();
+        if (value > UINT32_MAX) {
+            throw std::invalid_argument("Malformed snapshot detected - value out of range");
+        }
+        values[i++] = value;
+    }
+
+    return;
+}
+
+/**
+ * Reads raw bytes from the snapshot without copying them.
+ * @param size number of bytes
+ * @return view of the bytes, valid as long as the snapshot's memory is
+ */
+std::string_view SnapshotReader::getBytes(size_t size) {
+    return std::string_view(take(size), size);
+}
+
+// preconditions: a value of size bytes is about to be read
+// postconditions: the value's first byte is returned and skipped over, or
+//                 std::invalid_argument is thrown if the snapshot ends first
+const char* SnapshotReader::take(size_t size) {
+    if (size > remaining()) {
+        throw std::invalid_argument("Malformed snapshot detected - unexpected end of file");
+    }
+
+    const char *start = _pos;
+    _pos += size;
+
+    return start;
+}
@@ -0,0 +1,118 @@
+/***************************
+* File:     snapshot.h
+* Project:  Project 2
+*
+* Header definition of the snapshot file reader and writer.
+***************************/
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include "uexport.h"
+
+using std::string;
+
+/* Snapshot layout, every fixed width integer little endian. Both versions start
+ * with magic[8], u32 version and end with a u64 checksum of everything before it.
+ *
+ * SNAPSHOT_VERSION_PLAIN
+ *   header    u32 numStrings, u64 numUsernames, u64 numAccounts
+ *   strings   numStrings x (u32 length, bytes), usernames, badges and statuses
+ *   usernames numUsernames x (u32 stringId, u32 numAccounts, accounts), sorted
+ *   accounts  numAccounts x (u16 disc, u8 nitro, u32 badgeId, u32 statusId), sorted
+ *
+ * SNAPSHOT_VERSION_COMPRESSED, where v is a LEB128 varint
+ *   header    u64 numUsernames, u64 numAccounts, v numValues
+ *   values    numValues x (v length, bytes), badges and statuses, most used first
+ *   usernames numUsernames x (username, v numAccounts, discs, nitro, badges, statuses)
+ *   username  v bytes shared with the previous username, v suffix length, suffix
+ *   discs     numAccounts x v, the first disc and then each gap to the next minus one
+ *   nitro     (numAccounts + 7) / 8 bytes, a bit per account, lowest bit first
+ *   badges    numAccounts x v value ids, then statuses the same way */
+#define SNAPSHOT_MAGIC "USNAPSHT"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_VERSION_PLAIN 1
+#define SNAPSHOT_VERSION_COMPRESSED 2
+#define SNAPSHOT_VERSION SNAPSHOT_VERSION_COMPRESSED    /* written by default */
+#define MAX_VARINT_SIZE 10
+#define SNAPSHOT_FOOTER_SIZE 8
+#define SNAPSHOT_CHECKSUM_SEED 14695981039346656037ULL
+#define SNAPSHOT_BUFFER_SIZE (1 << 20)  /* a multiple of 8, see SnapshotWriter::flush() */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Checksum of a snapshot: FNV-1a over 8 byte little endian words, then over the
+ * remaining tail bytes. Feeding a buffer in pieces gives the same result as
+ * feeding it at once as long as every piece but the last is a multiple of 8. */
+uint64_t snapshotChecksum(const char *data, size_t size, uint64_t checksum = SNAPSHOT_CHECKSUM_SEED);
+
+/* Buffered writer of a snapshot. Data goes to "<path>.tmp", which commit()
+ * syncs and renames over path, so a crash never leaves a half written snapshot.
+ * A writer given a sink instead streams the snapshot to it as it goes. */
+class SnapshotWriter {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    SnapshotWriter(string path);
+    SnapshotWriter(ExportSink& sink);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    /* Basic operations */
+    void putU8(uint8_t value);
+    void putU16(uint16_t value);
+    void putU32(uint32_t value);
+    void putU64(uint64_t value);
+    void putVarint(uint64_t value);
+    void putBytes(const char *data, size_t size);
+    bool commit();
+
+    /* Getters */
+    bool isOpen() const {return _fd != -1 || _sink;}
+
+private:
+    string _path;
+    string _tmpPath;
+    int _fd;
+    ExportSink* _sink;      // nullptr when writing to a file
+    char* _buffer;
+    size_t _used;
+    uint64_t _checksum;
+    bool _failed;
+
+    void flush();
+    void writeOut(const char *data, size_t size);
+};
+
+/* Bounds checked reader over a snapshot in memory. Reading past the end throws
+ * std::invalid_argument, the same as any other malformed input. */
+class SnapshotReader {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    SnapshotReader(const char *data, size_t size): _pos(data), _end(data + size) {}
+
+    /* Basic operations */
+    uint8_t getU8();
+    uint16_t getU16();
+    uint32_t getU32();
+    uint64_t getU64();
+    uint64_t getVarint();
+    void getVarints(uint32_t *values, size_t count);
+    std::string_view getBytes(size_t size);
+
+    /* Getters */
+    size_t remaining() const {return _end - _pos;}
+
+private:
+    const char* _pos;
+    const char* _end;
+
+    const char* take(size_t size);
+};
@@ -0,0 +1,191 @@
+/***************************
+* File:     ucache.cpp
+* Project:  Project 2
+*
+* Implementation of ucache.h.
+***************************/
+#include "ucache.h"
+#include <algorithm>
+
+/**
+ * Constructor, allocates an empty cache.
+ * @param capacity number of accounts to hold, rounded up to a power of two sets
+ */
+UCache::UCache(size_t capacity): _sets(nullptr), _hands(nullptr), _numSets(1), _numHits(0), _numMisses(0),
+                                 _numEvictions(0), _numInvalidated(0) {
+    while (this->_numSets * CACHE_WAYS < capacity) { this->_numSets *= 2; }
+
+    this->_sets = new Set[this->_numSets]();
+    this->_hands = new uint8_t[this->_numSets]();
+}
+
+/**
+ * Destructor, deletes the sets. The cached DNodes belong to the tree.
+ */
+UCache::~UCache() {
+    delete [] _sets;
+    _sets = nullptr;
+    delete [] _hands;
+    _hands = nullptr;
+}
+
+/**
+ * Looks up an account, marking it referenced if it is cached.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return the cached DNode, nullptr if the account is not cached
+ */
+DNode* UCache::find(const string& username, int disc) {
+    uint64_t hash = hashUsername(username);
+    uint32_t tag = hash >> 32;
+    Set& set = this->_sets[setIndex(hash, disc)];
+
+    for (Entry& entry : set.entries) {
+        // the tag only narrows it down; the node itself settles the username
+        if (entry.node && entry.tag == tag && entry.disc == disc && entry.node->_account.getUsername() == username) {
+            entry.referenced = 1;
+            this->_numHits++;
+            return entry.node;
+        }
+    }
+
+    this->_numMisses++;
+
+    return nullptr;
+}
+
+/**
+ * Caches the DNode an account was found in, evicting an entry of its set if the
+ * set is full.
+ * @param username username of the account
+ * @param disc discriminator of the account
+ * @param node DNode holding the account
+ */
+void UCache::fill(const string& username, int disc, DNode* node) {
+    uint64_t hash = hashUsername(username);
+    size_t index = setIndex(hash, disc);
+    Set& set = this->_sets[index];
+    Entry *target = nullptr;
+
+    for (Entry& entry : set.entries) {
+        if (!entry.node && !target) { target = &entry; }
+    }
+
+    if (!target) {
+        // CLOCK: referenced entries get a second chance, so some entry is
+        // unreferenced by the time the hand has gone round once
+        uint8_t& hand = this->_hands[index];
+
+        while (set.entries[hand].referenced) {
+            set.entries[hand].referenced = 0;
+            hand = (hand + 1) % CACHE_WAYS;
+        }
+
+        target = &set.entries[hand];
+        hand = (hand + 1) % CACHE_WAYS;
+        this->_numEvictions++;
+    }
+
+    // a new entry has to be hit once before it outlasts one that was
+    *target = {node, uint32_t(hash >> 32), uint16_t(disc), 0};
+
+    return;
+}
+
+/**
+ * Drops an account, if cached. Must be called before its DNode is freed or moved.
+ * @param username username of the account
+ * @param disc discriminator of the account
+ */
+void UCache::invalidate(const string& username, int disc) {
+    uint64_t hash = hashUsername(username);
+    uint32_t tag = hash >> 32;
+
+    // matching on the tag alone never reads the node, and at worst also drops an
+    // entry of another username that shares it
+    for (Entry& entry : this->_sets[setIndex(hash, disc)].entries) {
+        if (entry.node && entry.tag == tag && entry.disc == disc) {
+            entry.node = nullptr;
+            this->_numInvalidated++;
+        }
+    }
+
+    return;
+}
+
+/**
+ * Drops every cached account of a username. Must be called before its DTree is
+ * freed, copied over or rebuilt. Scans every set, as the username's accounts may
+ * be in any of them.
+ * @param username username whose accounts to drop
+ */
+void UCache::invalidateUser(const string& username) {
+    uint32_t tag = hashUsername(username) >> 32;
+    invalidateTags(&tag, 1);
+
+    return;
+}
+
+/**
+ * Drops every cached account of several usernames, in one scan of the cache
+ * rather than one per username.
+ * @param usernames usernames whose accounts to drop
+ */
+void UCache::invalidateUsers(const std::vector<string>& usernames) {
+    if (usernames.empty()) { return; }
+
+    std::vector<uint32_t> tags;
+    tags.reserve(usernames.size());
+    for (const string& username : usernames) { tags.push_back(hashUsername(username) >> 32); }
+
+    std::sort(tags.begin(), tags.end());
+    invalidateTags(tags.data(), tags.size());
+
+    return;
+}
+
+/**
+ * Drops every cached account, keeping the counters.
+ */
+void UCache::clear() {
+    for (size_t i = 0; i < this->_numSets; i++) {
+        this->_sets[i] = Set();
+        this->_hands[i] = 0;
+    }
+
+    return;
+}
+
+/**
+ * Returns the number of bytes used by the cache.
+ * @return size of the sets and hands plus the cache object itself
+ */
+size_t UCache::memoryUsage() const {
+    return sizeof(UCache) + this->_numSets * (sizeof(Set) + sizeof(uint8_t));
+}
+
+/**
+ * Returns the share of lookups the cache answered.
+ * @return hits over hits and misses, 0 if there were no lookups
+ */
+double UCache::hitRate() const {
+    unsigned long lookups = this->_numHits + this->_numMisses;
+
+    return (lookups) ? double(this->_numHits) / lookups : 0.0;
+}
+
+// preconditions: tags holds count username tags in increasing order
+// postconditions: every entry with one of the tags is dropped; like invalidate(), an
+//                 entry of another username that shares a tag may go too
+void UCache::invalidateTags(const uint32_t *tags, size_t count) {
+    for (size_t i = 0; i < this->_numSets; i++) {
+        for (Entry& entry : this->_sets[i].entries) {
+            if (entry.node && std::binary_search(tags, tags + count, entry.tag)) {
+                entry.node = nullptr;
+                this->_numInvalidated++;
+            }
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,83 @@
+/***************************
+* File:     ucache.h
+* Project:  Project 2
+*
+* Header definition of UCache class.
+***************************/
+#pragma once
+
+#include "dtree.h"
+#include "uhash.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+
+#define DEFAULT_CACHE_CAPACITY 1024 /* accounts a cache holds unless told otherwise */
+#define CACHE_WAYS 4                /* entries per set, which fill one cache line */
+#define DISC_SPREAD 0x9e3779b97f4a7c15ULL   /* odd, so consecutive discriminators of a username land in different sets */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Fixed size, set associative CLOCK cache from a (username, discriminator) pair to
+ * the DNode holding it. The set is picked from both, so many hot accounts of one
+ * username spread over the sets rather than fighting over one set's ways; dropping
+ * every account of a username scans the whole cache instead, which only removals
+ * that move DNodes and bulk changes do. Within a set, a hit marks its entry
+ * referenced, and a fill evicts the first unreferenced entry from the set's hand
+ * on, clearing marks as it passes them. Entries are never checked against the
+ * tree: the owner must invalidate every DNode it frees or moves. */
+class UCache {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    UCache(size_t capacity = DEFAULT_CACHE_CAPACITY);
+    ~UCache();
+    UCache(const UCache&) = delete;
+    UCache& operator=(const UCache&) = delete;
+
+    /* Basic operations */
+    DNode* find(const string& username, int disc);
+    void fill(const string& username, int disc, DNode* node);
+    void invalidate(const string& username, int disc);
+    void invalidateUser(const string& username);
+    void invalidateUsers(const std::vector<string>& usernames);
+    void clear();
+
+    /* Getters */
+    size_t getCapacity() const {return _numSets * CACHE_WAYS;}
+    size_t memoryUsage() const;
+    unsigned long numHits() const {return _numHits;}
+    unsigned long numMisses() const {return _numMisses;}
+    unsigned long numEvictions() const {return _numEvictions;}
+    unsigned long numInvalidated() const {return _numInvalidated;}
+    double hitRate() const;
+
+private:
+    struct Entry {
+        DNode* node;        // nullptr if the entry is empty
+        uint32_t tag;       // high half of the username's hash
+        uint16_t disc;
+        uint8_t referenced; // hit since the hand last passed it
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Set {
+        Entry entries[CACHE_WAYS];
+    };
+
+    Set* _sets;
+    uint8_t* _hands;        // next entry each set's CLOCK looks at
+    size_t _numSets;        // always a power of two
+
+    unsigned long _numHits;
+    unsigned long _numMisses;
+    unsigned long _numEvictions;
+    unsigned long _numInvalidated;
+
+    size_t setIndex(uint64_t hash, int disc) const {return (hash + uint64_t(disc) * DISC_SPREAD) & (_numSets - 1);}
+    void invalidateTags(const uint32_t *tags, size_t count);
+};
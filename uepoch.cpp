@@ -0,0 +1,286 @@
+/***************************
+* File:     uepoch.cpp
+* Project:  Project 2
+*
+* Implementation of uepoch.h.
+***************************/
+#include "uepoch.h"
+#include <stdexcept>
+
+// slots are handed out per thread, not per manager, so a thread has the same slot
+// in every UEpoch and gives it back when it exits
+static std::atomic<bool> slotTaken[EPOCH_MAX_THREADS];
+
+namespace {
+
+struct ThreadSlot {
+    int index;
+
+    ThreadSlot(): index(-1) {
+        for (int i = 0; i < EPOCH_MAX_THREADS; i++) {
+            bool expected = false;
+            if (slotTaken[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                index = i;
+                break;
+            }
+        }
+
+        if (index == -1) { throw std::runtime_error("More than EPOCH_MAX_THREADS threads are using epochs"); }
+    }
+
+    ~ThreadSlot() {
+        slotTaken[index].store(false, std::memory_order_release);
+    }
+};
+
+}
+
+// preconditions: none
+// postconditions: the calling thread's slot index is returned, claiming one on first use
+static int threadSlot() {
+    thread_local ThreadSlot slot;
+
+    return slot.index;
+}
+
+/**
+ * Constructor, starts in the first epoch with nothing retired.
+ */
+UEpoch::UEpoch(): _slots(new Slot[EPOCH_MAX_THREADS]), _epoch(EPOCH_INACTIVE + 1), _numFreed(0), _lastCollected(0) {}
+
+/**
+ * Destructor, frees everything still retired. No thread may be pinned.
+ */
+UEpoch::~UEpoch() {
+    for (Retired& retired : this->_retired) {
+        retired.object.deleter(retired.object.ptr);
+    }
+
+    delete[] this->_slots;
+    this->_slots = nullptr;
+}
+
+/**
+ * Marks the calling thread as reading. Nodes reachable after this returns are not
+ * freed until the matching unpin(). Pins nest.
+ */
+void UEpoch::pin() {
+    Slot& slot = this->_slots[threadSlot()];
+
+    if (slot.depth++ == 0) {
+        slot.epoch.store(this->_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        // the slot must be visible before any node is read, see tryAdvance()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    return;
+}
+
+/**
+ * Ends the calling thread's outermost pin.
+ */
+void UEpoch::unpin() {
+    Slot& slot = this->_slots[threadSlot()];
+
+    if (--slot.depth == 0) {
+        slot.epoch.store(EPOCH_INACTIVE, std::memory_order_release);
+    }
+
+    return;
+}
+
+/**
+ * Hands unlinked objects over to be freed once no reader can still hold them.
+ * @param objects objects that new readers can no longer reach, taken
+ */
+void UEpoch::retire(std::vector<URetired>& objects) {
+    std::lock_guard<std::mutex> guard(this->_retireLock);
+    uint64_t epoch = this->_epoch.load(std::memory_order_acquire);
+
+    for (URetired& object : objects) {
+        this->_retired.push_back({object, epoch});
+    }
+    objects.clear();
+
+    if (this->_retired.size() >= this->_lastCollected + EPOCH_COLLECT_THRESHOLD) {
+        tryAdvance();
+        freeExpired();
+        this->_lastCollected = this->_retired.size();
+    }
+
+    return;
+}
+
+/**
+ * Frees whatever can be freed now, advancing the epoch as far as the readers allow.
+ */
+void UEpoch::collect() {
+    std::lock_guard<std::mutex> guard(this->_retireLock);
+
+    // two advances are enough to free everything retired before this call
+    for (int i = 0; i < 2; i++) { tryAdvance(); }
+    freeExpired();
+    this->_lastCollected = this->_retired.size();
+
+    return;
+}
+
+// preconditions: the retire lock is held
+// postconditions: everything retired two or more epochs ago, and so unreachable to
+//                 every reader, is freed
+void UEpoch::freeExpired() {
+    uint64_t epoch = this->_epoch.load(std::memory_order_acquire);
+    size_t kept = 0;
+
+    for (Retired& retired : this->_retired) {
+        if (retired.epoch + 2 <= epoch) {
+            retired.object.deleter(retired.object.ptr);
+            this->_numFreed++;
+        } else {
+            this->_retired[kept++] = retired;
+        }
+    }
+
+    this->_retired.resize(kept);
+
+    return;
+}
+
+/**
+ * Returns the number of objects waiting to be freed.
+ * @return retired objects not yet freed
+ */
+size_t UEpoch::numRetired() const {
+    std::lock_guard<std::mutex> guard(this->_retireLock);
+
+    return this->_retired.size();
+}
+
+// preconditions: the retire lock is held
+// postconditions: the epoch is advanced and true returned if every pinned thread
+//                 has seen the current one, else nothing changes
+bool UEpoch::tryAdvance() {
+    uint64_t epoch = this->_epoch.load(std::memory_order_relaxed);
+
+    // pairs with the fence in pin(): a reader this scan misses pinned after the
+    // unlinks before it, so it can only reach nodes retired from now on
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (int i = 0; i < EPOCH_MAX_THREADS; i++) {
+        uint64_t seen = this->_slots[i].epoch.load(std::memory_order_seq_cst);
+        if (seen != EPOCH_INACTIVE && seen != epoch) { return false; }
+    }
+
+    this->_epoch.store(epoch + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * Destructor, frees everything held back. No snapshot may be alive.
+ */
+UVersions::~UVersions() {
+    for (Batch& batch : this->_held) {
+        for (URetired& retired : batch.objects) {
+            retired.deleter(retired.ptr);
+        }
+    }
+}
+
+/**
+ * Ends a write: the next version is published, and the objects it replaced are
+ * retired as soon as no snapshot can reach them.
+ * @param replaced objects reachable from the previous version but not the new one, taken
+ */
+void UVersions::commit(std::vector<URetired>& replaced) {
+    std::lock_guard<std::mutex> guard(this->_lock);
+
+    this->_version++;
+
+    if (!replaced.empty()) {
+        this->_numHeld += replaced.size();
+        this->_held.push_back({this->_version, std::move(replaced)});
+        replaced.clear();
+        retireUnreachable();
+    }
+
+    return;
+}
+
+/**
+ * Registers a snapshot. Its root must be read after this returns, so it is at
+ * least as new as the version returned.
+ * @return version the snapshot is kept as
+ */
+uint64_t UVersions::acquire() {
+    std::lock_guard<std::mutex> guard(this->_lock);
+
+    this->_live[this->_version]++;
+
+    return this->_version;
+}
+
+/**
+ * Unregisters a snapshot, retiring whatever only it was keeping.
+ * @param version version acquire() returned for it
+ */
+void UVersions::release(uint64_t version) {
+    std::lock_guard<std::mutex> guard(this->_lock);
+
+    auto found = this->_live.find(version);
+    if (found != this->_live.end() && --found->second == 0) {
+        this->_live.erase(found);
+    }
+
+    retireUnreachable();
+
+    return;
+}
+
+/**
+ * Returns the latest version.
+ * @return number of writes committed
+ */
+uint64_t UVersions::getVersion() const {
+    std::lock_guard<std::mutex> guard(this->_lock);
+
+    return this->_version;
+}
+
+/**
+ * Returns the number of snapshots alive.
+ * @return snapshots acquired and not released
+ */
+size_t UVersions::numSnapshots() const {
+    std::lock_guard<std::mutex> guard(this->_lock);
+    size_t count = 0;
+
+    for (auto& live : this->_live) { count += live.second; }
+
+    return count;
+}
+
+/**
+ * Returns the number of objects held back for snapshots.
+ * @return objects replaced but not yet retired
+ */
+size_t UVersions::numHeld() const {
+    std::lock_guard<std::mutex> guard(this->_lock);
+
+    return this->_numHeld;
+}
+
+// preconditions: the lock is held
+// postconditions: every batch no snapshot can reach, those replaced by writes no later
+//                 than the oldest snapshot's version, is retired
+void UVersions::retireUnreachable() {
+    // a snapshot of version s reaches what a write replaced only if the write came later
+    while (!this->_held.empty()
+           && (this->_live.empty() || this->_live.begin()->first >= this->_held.front().version)) {
+        this->_numHeld -= this->_held.front().objects.size();
+        this->_epoch->retire(this->_held.front().objects);
+        this->_held.pop_front();
+    }
+
+    return;
+}
@@ -0,0 +1,51 @@
+/***************************
+* File:     uexport.cpp
+* Project:  Project 2
+*
+* Implementation of uexport.h.
+***************************/
+#include "uexport.h"
+#include <cerrno>
+#include <unistd.h>
+
+/**
+ * Writes every byte to the file descriptor, retrying short writes.
+ * @param data bytes to write
+ * @param size number of bytes
+ * @return true if everything was written, false otherwise
+ */
+bool FdSink::write(const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t result = ::write(_fd, data, size);
+
+        if (result < 0 && errno == EINTR) { continue; }
+        if (result <= 0) { return false; }
+
+        data += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+/**
+ * Appends the bytes to the string.
+ * @param data bytes to append
+ * @param size number of bytes
+ * @return true
+ */
+bool StringSink::write(const char *data, size_t size) {
+    _out.append(data, size);
+
+    return true;
+}
+
+/**
+ * Hands the bytes to the callback.
+ * @param data bytes to pass on
+ * @param size number of bytes
+ * @return what the callback returned
+ */
+bool CallbackSink::write(const char *data, size_t size) {
+    return _callback(data, size);
+}
@@ -0,0 +1,70 @@
+/***************************
+* File:     uexport.h
+* Project:  Project 2
+*
+* Header definition of the export sinks.
+***************************/
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <functional>
+
+using std::string;
+
+/* Export formats */
+#define EXPORT_CSV 0        /* the same lines loadData() reads */
+#define EXPORT_BINARY 1     /* a snapshot, see snapshot.h */
+
+#define EXPORT_BUFFER_SIZE (1 << 20)
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Destination of an export. Exports hand it large buffers, never single lines. */
+class ExportSink {
+public:
+    virtual ~ExportSink() {}
+
+    /* Takes size bytes, returns false if they could not be written */
+    virtual bool write(const char *data, size_t size) = 0;
+};
+
+/* Writes to an open file descriptor, which stays open afterwards */
+class FdSink : public ExportSink {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    FdSink(int fd): _fd(fd) {}
+    bool write(const char *data, size_t size) override;
+
+private:
+    int _fd;
+};
+
+/* Appends to a string */
+class StringSink : public ExportSink {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    StringSink(string& out): _out(out) {}
+    bool write(const char *data, size_t size) override;
+
+private:
+    string& _out;
+};
+
+/* Passes each buffer to a callback */
+class CallbackSink : public ExportSink {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    CallbackSink(std::function<bool(const char*, size_t)> callback): _callback(callback) {}
+    bool write(const char *data, size_t size) override;
+
+private:
+    std::function<bool(const char*, size_t)> _callback;
+};
@@ -0,0 +1,124 @@
+/***************************
+* File:     ufilter.cpp
+* Project:  Project 2
+*
+* Implementation of ufilter.h.
+***************************/
+#include "ufilter.h"
+
+// odd multipliers that pick the bit each word of a block gets from the same 32 bits of hash
+static const uint32_t BLOCK_SALTS[FILTER_BLOCK_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+/**
+ * Constructor, allocates an empty filter.
+ * @param capacity number of usernames to size the filter for
+ */
+UFilter::UFilter(size_t capacity): _blocks(nullptr), _numBlocks(0), _capacity(0), _numKeys(0), _numStale(0),
+                                   _numChecked(0), _numRuledOut(0), _numFalsePositives(0) {
+    reset(capacity);
+}
+
+/**
+ * Destructor, deletes the blocks.
+ */
+UFilter::~UFilter() {
+    delete [] _blocks;
+    _blocks = nullptr;
+}
+
+/**
+ * Adds a username, so mayContain() is true for it from now on.
+ * @param username username to add
+ */
+void UFilter::add(const string& username) {
+    uint64_t hash = hashUsername(username);
+    Block& block = this->_blocks[blockIndex(hash)];
+
+    for (int i = 0; i < FILTER_BLOCK_WORDS; i++) {
+        block.words[i] |= 1U << ((uint32_t(hash) * BLOCK_SALTS[i]) >> 27);
+    }
+    this->_numKeys++;
+
+    return;
+}
+
+/**
+ * Checks whether a username may have been added. False is definite; true is wrong
+ * for about 0.1% of usernames never added once the filter is at capacity, and for
+ * far fewer below it.
+ * @param username username to check
+ * @return false if the username was never added, true if it may have been
+ */
+bool UFilter::mayContain(const string& username) const {
+    uint64_t hash = hashUsername(username);
+    const Block& block = this->_blocks[blockIndex(hash)];
+    this->_numChecked.fetch_add(1, std::memory_order_relaxed);
+
+    for (int i = 0; i < FILTER_BLOCK_WORDS; i++) {
+        if (!(block.words[i] & (1U << ((uint32_t(hash) * BLOCK_SALTS[i]) >> 27)))) {
+            this->_numRuledOut.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Returns whether the filter should be rebuilt from the usernames still present:
+ * once more usernames than it was sized for were added, or once most of those
+ * added were removed since.
+ * @return true if a rebuild would bring the false positive rate back down
+ */
+bool UFilter::needsRebuild() const {
+    return this->_numKeys > this->_capacity || this->_numStale * 2 > this->_numKeys;
+}
+
+/**
+ * Empties the filter and resizes it, keeping the lookup counters.
+ * @param capacity number of usernames to size the filter for
+ */
+void UFilter::reset(size_t capacity) {
+    const size_t BLOCK_BITS = FILTER_BLOCK_WORDS * 32;
+
+    this->_capacity = (capacity > DEFAULT_FILTER_CAPACITY) ? capacity : DEFAULT_FILTER_CAPACITY;
+    this->_numBlocks = (this->_capacity * FILTER_BITS_PER_KEY + BLOCK_BITS - 1) / BLOCK_BITS;
+    this->_numKeys = 0;
+    this->_numStale = 0;
+
+    delete [] this->_blocks;
+    this->_blocks = new Block[this->_numBlocks]();
+
+    return;
+}
+
+/**
+ * Returns the number of bytes used by the filter.
+ * @return size of the blocks plus the filter object itself
+ */
+size_t UFilter::memoryUsage() const {
+    return sizeof(UFilter) + this->_numBlocks * sizeof(Block);
+}
+
+/**
+ * Returns the share of checks for usernames not in the tree that the filter let
+ * through, as counted by noteFalsePositive().
+ * @return false positives over all checks of absent usernames, 0 if there were none
+ */
+double UFilter::falsePositiveRate() const {
+    unsigned long falsePositives = numFalsePositives();
+    unsigned long negatives = numRuledOut() + falsePositives;
+
+    return (negatives) ? double(falsePositives) / negatives : 0.0;
+}
+
+
+// preconditions: hash is a username's hash
+// postconditions: the index of the block the username's bits go in is returned
+size_t UFilter::blockIndex(uint64_t hash) const {
+    // the high 32 bits scaled onto the blocks, leaving the low 32 for the bits themselves
+    return ((hash >> 32) * this->_numBlocks) >> 32;
+}
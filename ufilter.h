@@ -0,0 +1,73 @@
+/***************************
+* File:     ufilter.h
+* Project:  Project 2
+*
+* Header definition of UFilter class.
+***************************/
+#pragma once
+
+#include "uhash.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+#define DEFAULT_FILTER_CAPACITY 64
+#define FILTER_BITS_PER_KEY 16  /* bits per username at capacity, about 0.1% false positives */
+#define FILTER_BLOCK_WORDS 8    /* 32 bit words per block, one bit set in each per username */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Split block Bloom filter over usernames. Each username sets one bit in every word
+ * of a single 32 byte block, so a check touches one cache line. Usernames cannot be
+ * taken out; removals are only counted, and the owner rebuilds the filter once
+ * needsRebuild() says stale usernames or growth have worn it down. */
+class UFilter {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    UFilter(size_t capacity = DEFAULT_FILTER_CAPACITY);
+    ~UFilter();
+    UFilter(const UFilter&) = delete;
+    UFilter& operator=(const UFilter&) = delete;
+
+    /* Basic operations */
+    void add(const string& username);
+    bool mayContain(const string& username) const;
+    void noteRemoved(size_t count = 1) {_numStale += count;}
+    void noteFalsePositive() const {_numFalsePositives.fetch_add(1, std::memory_order_relaxed);}
+    bool needsRebuild() const;
+    void reset(size_t capacity);
+
+    /* Getters */
+    size_t getCapacity() const {return _capacity;}
+    size_t getNumKeys() const {return _numKeys;}
+    size_t getNumStale() const {return _numStale;}
+    size_t memoryUsage() const;
+    unsigned long numChecked() const {return _numChecked.load(std::memory_order_relaxed);}
+    unsigned long numRuledOut() const {return _numRuledOut.load(std::memory_order_relaxed);}
+    unsigned long numFalsePositives() const {return _numFalsePositives.load(std::memory_order_relaxed);}
+    double falsePositiveRate() const;
+
+private:
+    struct alignas(32) Block {
+        uint32_t words[FILTER_BLOCK_WORDS];
+    };
+
+    Block* _blocks;
+    size_t _numBlocks;
+    size_t _capacity;       // usernames the filter is sized for
+    size_t _numKeys;        // usernames added since the last reset, stale ones included
+    size_t _numStale;       // of those, usernames since removed from the tree
+
+    // lookups may run on many threads at once in concurrent mode
+    mutable std::atomic<unsigned long> _numChecked;
+    mutable std::atomic<unsigned long> _numRuledOut;
+    mutable std::atomic<unsigned long> _numFalsePositives;
+
+    size_t blockIndex(uint64_t hash) const;
+};
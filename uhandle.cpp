@@ -0,0 +1,136 @@
+/***************************
+* File:     uhandle.cpp
+* Project:  Project 2
+*
+* Implementation of uhandle.h.
+***************************/
+#include "uhandle.h"
+
+/**
+ * Hands out the handle of an account, giving it a slot if it has none.
+ * @param username username of the account
+ * @param node DNode holding the account
+ * @return the account's handle, the same one for as long as the account stays
+ */
+AccountHandle UHandleTable::acquire(const string& username, DNode* node) {
+    std::vector<uint32_t>& slots = this->_byUser[username];
+    int disc = node->getDiscriminator();
+
+    for (uint32_t slot : slots) {
+        if (this->_slots[slot].disc == disc) { return {slot, this->_slots[slot].generation}; }
+    }
+
+    uint32_t slot;
+
+    if (!this->_free.empty()) {
+        slot = this->_free.back();
+        this->_free.pop_back();
+    } else {
+        slot = this->_slots.size();
+        this->_slots.push_back({nullptr, INVALID_GENERATION + 1, 0});
+    }
+
+    this->_slots[slot].node = node;
+    this->_slots[slot].disc = disc;
+    slots.push_back(slot);
+    this->_numLive++;
+
+    return {slot, this->_slots[slot].generation};
+}
+
+/**
+ * Retires the handle of an account, if it has one. Must be called when the
+ * account is removed.
+ * @param username username of the account
+ * @param disc discriminator of the account
+ */
+void UHandleTable::retire(const string& username, int disc) {
+    auto found = this->_byUser.find(username);
+    if (found == this->_byUser.end()) { return; }
+
+    std::vector<uint32_t>& slots = found->second;
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (this->_slots[slots[i]].disc == disc) {
+            retireSlot(slots[i]);
+            slots[i] = slots.back();
+            slots.pop_back();
+            break;
+        }
+    }
+
+    if (slots.empty()) { this->_byUser.erase(found); }
+
+    return;
+}
+
+/**
+ * Repoints every handle of a username at its account in a DTree, retiring those
+ * whose accounts it does not hold. Must be called when the username's DNodes are
+ * copied or rebuilt, or leave the tree.
+ * @param username username whose handles to repoint
+ * @param dtree DTree now holding the username's accounts, nullptr if it has none
+ */
+void UHandleTable::rebind(const string& username, DTree* dtree) {
+    auto found = this->_byUser.find(username);
+    if (found == this->_byUser.end()) { return; }
+
+    std::vector<uint32_t>& slots = found->second;
+    size_t kept = 0;
+
+    for (uint32_t slot : slots) {
+        DNode *node = (dtree) ? dtree->retrieve(this->_slots[slot].disc) : nullptr;
+
+        if (node) {
+            this->_slots[slot].node = node;
+            slots[kept++] = slot;
+        } else {
+            retireSlot(slot);
+        }
+    }
+
+    slots.resize(kept);
+    if (slots.empty()) { this->_byUser.erase(found); }
+
+    return;
+}
+
+/**
+ * Retires every handle.
+ */
+void UHandleTable::clear() {
+    for (auto& user : this->_byUser) {
+        for (uint32_t slot : user.second) { retireSlot(slot); }
+    }
+
+    this->_byUser.clear();
+
+    return;
+}
+
+/**
+ * Returns the number of bytes used by the table, not counting the map's nodes.
+ * @return size of the slots, the free list and the per username lists
+ */
+size_t UHandleTable::memoryUsage() const {
+    size_t bytes = sizeof(UHandleTable) + this->_slots.capacity() * sizeof(Slot) + this->_free.capacity() * sizeof(uint32_t);
+
+    for (auto& user : this->_byUser) {
+        bytes += user.first.capacity() + user.second.capacity() * sizeof(uint32_t);
+    }
+
+    return bytes;
+}
+
+// preconditions: slot is live and the caller takes it off its username's list
+// postconditions: the slot is free, and every handle to it stops resolving
+void UHandleTable::retireSlot(uint32_t slot) {
+    Slot& entry = this->_slots[slot];
+
+    entry.node = nullptr;
+    if (++entry.generation == INVALID_GENERATION) { entry.generation++; }
+    this->_free.push_back(slot);
+    this->_numLive--;
+
+    return;
+}
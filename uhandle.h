@@ -0,0 +1,69 @@
+/***************************
+* File:     uhandle.h
+* Project:  Project 2
+*
+* Header definition of UHandleTable class.
+***************************/
+#pragma once
+
+#include "dtree.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+#define INVALID_GENERATION 0    /* generation of the null handle, never given to a slot */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* A reference to an account that outlives the DNode holding it, see UTree::getHandle() */
+struct AccountHandle {
+    uint32_t slot;
+    uint32_t generation;    // INVALID_GENERATION for the null handle
+
+    bool operator==(const AccountHandle&) const = default;
+};
+
+/* Slots that each point at the DNode of one account. A handle names a slot and the
+ * generation it had when handed out; the owner repoints the slot whenever the
+ * account's DNode is copied or rebuilt, and retires it when the account leaves,
+ * which bumps the generation so every handle to it stops resolving. */
+class UHandleTable {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    UHandleTable(): _numLive(0) {}
+
+    /* Basic operations */
+    AccountHandle acquire(const string& username, DNode* node);
+    DNode* get(AccountHandle handle) const {
+        return (handle.slot < _slots.size() && _slots[handle.slot].generation == handle.generation)
+               ? _slots[handle.slot].node : nullptr;
+    }
+    void retire(const string& username, int disc);
+    void rebind(const string& username, DTree* dtree);
+    void clear();
+
+    /* Getters */
+    size_t size() const {return _numLive;}
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        DNode* node;            // nullptr while the slot is free
+        uint32_t generation;
+        int disc;
+    };
+
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _free;
+    std::unordered_map<string, std::vector<uint32_t>> _byUser;     // live slots of each username
+    size_t _numLive;
+
+    void retireSlot(uint32_t slot);
+};
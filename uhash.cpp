@@ -0,0 +1,159 @@
+/***************************
+* File:     uhash.cpp
+* Project:  Project 2
+*
+* Implementation of uhash.h.
+***************************/
+#include "uhash.h"
+#include "utree.h"
+
+/**
+ * Constructor, allocates an empty table.
+ */
+UHashIndex::UHashIndex() {
+    _capacity = DEFAULT_INDEX_CAPACITY;
+    _size = 0;
+    _slots = new Slot[_capacity]();
+}
+
+/**
+ * Destructor, deletes the table. The UNodes themselves belong to the UTree.
+ */
+UHashIndex::~UHashIndex() {
+    delete [] _slots;
+    _slots = nullptr;
+}
+
+/**
+ * Looks up the UNode holding a username.
+ * @param username username to match
+ * @return UNode with a matching username, nullptr otherwise
+ */
+UNode* UHashIndex::find(const string& username) const {
+    return this->_slots[findSlot(username, hashUsername(username))].node;
+}
+
+/**
+ * Maps a username to a UNode, replacing the mapping if the username is already present.
+ * @param username username of the node
+ * @param node UNode that holds the username's DTree
+ */
+void UHashIndex::insert(const string& username, UNode* node) {
+    // grow before probing so that the slot we find stays valid
+    if (this->_size + 1 > this->_capacity * MAX_INDEX_LOAD) {
+        grow();
+    }
+
+    size_t hash = hashUsername(username);
+    size_t index = findSlot(username, hash);
+
+    if (!this->_slots[index].node) { this->_size++; }
+
+    this->_slots[index].hash = hash;
+    this->_slots[index].node = node;
+
+    return;
+}
+
+/**
+ * Removes the mapping for a username.
+ * @param username username to remove
+ * @return true if the username was present, false otherwise
+ */
+bool UHashIndex::erase(const string& username) {
+    size_t mask = this->_capacity - 1;
+    size_t hole = findSlot(username, hashUsername(username));
+
+    if (!this->_slots[hole].node) { return false; }
+
+    // backward shift deletion: pull every later entry of the probe run into the
+    // hole if the hole lies between its home slot and where it currently sits,
+    // so lookups never need tombstones
+    size_t next = hole;
+
+    while (true) {
+        next = (next + 1) & mask;
+        if (!this->_slots[next].node) { break; }
+
+        size_t home = this->_slots[next].hash & mask;
+        bool movable = (hole <= next) ? (home <= hole || home > next)
+                                      : (home <= hole && home > next);
+
+        if (movable) {
+            this->_slots[hole] = this->_slots[next];
+            hole = next;
+        }
+    }
+
+    this->_slots[hole].node = nullptr;
+    this->_size--;
+
+    return true;
+}
+
+/**
+ * Removes every mapping, keeping the current capacity.
+ */
+void UHashIndex::clear() {
+    for (size_t i = 0; i < this->_capacity; i++) {
+        this->_slots[i].node = nullptr;
+    }
+
+    this->_size = 0;
+
+    return;
+}
+
+/**
+ * Returns the number of bytes used by the index.
+ * @return size of the table plus the index object itself
+ */
+size_t UHashIndex::memoryUsage() const {
+    return sizeof(UHashIndex) + this->_capacity * sizeof(Slot);
+}
+
+// preconditions: hash is the hash of username
+// postconditions: the index of the slot holding username is returned, or the index
+//                 of the empty slot that ends its probe run if it is not present
+size_t UHashIndex::findSlot(const string& username, size_t hash) const {
+    size_t mask = this->_capacity - 1;
+    size_t index = hash & mask;
+
+    // the full hash rules out almost every other key before we pay for the
+    // username copy and comparison
+    while (this->_slots[index].node) {
+        if (this->_slots[index].hash == hash && this->_slots[index].node->getUsername() == username) {
+            break;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    return index;
+}
+
+// preconditions: the table is about to pass its maximum load factor
+// postconditions: the table doubles in capacity and every entry is rehashed into it
+void UHashIndex::grow() {
+    Slot *oldSlots = this->_slots;
+    size_t oldCapacity = this->_capacity;
+
+    this->_capacity *= 2;
+    this->_slots = new Slot[this->_capacity]();
+
+    size_t mask = this->_capacity - 1;
+
+    // entries are known to be distinct, so they only need an empty slot
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (!oldSlots[i].node) { continue; }
+
+        size_t index = oldSlots[i].hash & mask;
+        while (this->_slots[index].node) { index = (index + 1) & mask; }
+
+        this->_slots[index] = oldSlots[i];
+    }
+
+    delete [] oldSlots;
+
+    return;
+}
@@ -0,0 +1,78 @@
+/***************************
+* File:     uhash.h
+* Project:  Project 2
+*
+* Header definition of UHashIndex class.
+***************************/
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+using std::string;
+
+#define DEFAULT_INDEX_CAPACITY 16
+#define MAX_INDEX_LOAD 0.7
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+class UNode;
+
+/* 64-bit FNV-1a hash of a username, run through the splitmix64 finalizer so that
+ * its low bits and its high bits both depend on every character. Shared by the
+ * hash index, the Bloom filter and the hot account cache. */
+inline uint64_t hashUsername(const string& username) {
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    uint64_t hash = FNV_OFFSET;
+
+    for (unsigned char c : username) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+
+    return hash;
+}
+
+/* Open-addressing (linear probing) map from a username to the UNode holding it.
+ * Keys are not stored; a slot keeps the full hash and compares the UNode's
+ * username on a hash match. */
+class UHashIndex {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    UHashIndex();
+    ~UHashIndex();
+
+    /* Basic operations */
+    UNode* find(const string& username) const;
+    void insert(const string& username, UNode* node);
+    bool erase(const string& username);
+    void clear();
+
+    /* Getters */
+    int size() const {return _size;}
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        size_t hash;
+        UNode* node;
+    };
+
+    Slot* _slots;
+    size_t _capacity;   // always a power of two
+    int _size;
+
+    size_t findSlot(const string& username, size_t hash) const;
+    void grow();
+};
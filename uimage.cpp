@@ -0,0 +1,183 @@
+/***************************
+* File:     uimage.cpp
+* Project:  Project 2
+*
+* Implementation of uimage.h.
+***************************/
+#include "uimage.h"
+#include "snapshot.h"
+#include <cstring>
+
+/**
+ * Maps an image for querying. Only the header is read; verify() checks the rest.
+ * @param path path of an image written by UTree::saveImage(), isOpen() is false if
+ *             it could not be opened
+ */
+UImage::UImage(string path): _file(path, false), _header(nullptr) {
+    if (!_file.isOpen()) { return; }
+
+    if (_file.size() < sizeof(ImageHeader) + SNAPSHOT_FOOTER_SIZE) {
+        throw std::invalid_argument("Malformed image detected - file is too short");
+    }
+
+    const ImageHeader *header = at<ImageHeader>(0);
+
+    if (memcmp(header->magic, IMAGE_MAGIC, IMAGE_MAGIC_SIZE) != 0) {
+        throw std::invalid_argument("Malformed image detected - not an image file");
+    }
+    if (header->byteOrder != IMAGE_BYTE_ORDER) {
+        throw std::invalid_argument("Image was written on a host with a different byte order");
+    }
+    if (header->version != IMAGE_VERSION) {
+        throw std::invalid_argument("Unsupported image version " + std::to_string(header->version));
+    }
+
+    // the node and account arrays have to fit, or even a lookup could run off the end
+    uint64_t arrays = header->numUsernames * sizeof(ImageUNode) + header->numAccounts * sizeof(ImageAccount);
+    if (header->size != _file.size() || header->numUsernames > _file.size() || header->numAccounts > _file.size()
+        || arrays > _file.size() - sizeof(ImageHeader) - SNAPSHOT_FOOTER_SIZE) {
+        throw std::invalid_argument("Malformed image detected - sizes do not match");
+    }
+
+    _header = header;
+}
+
+/**
+ * Finds the node of a username.
+ * @param username username to match
+ * @return node with a matching username, nullptr otherwise
+ */
+const ImageUNode* UImage::retrieve(std::string_view username) const {
+    uint64_t offset = (_header) ? _header->root : IMAGE_NO_NODE;
+    int depth = 0;
+
+    while (offset != IMAGE_NO_NODE) {
+        // images are written balanced, so a longer path can only be a cycle
+        if (depth++ == MAX_IMAGE_DEPTH) {
+            throw std::invalid_argument("Malformed image detected - tree is too deep");
+        }
+
+        const ImageUNode *node = at<ImageUNode>(offset);
+        int order = username.compare(getUsername(node));
+
+        if (order == 0) { return node; }
+        offset = (order < 0) ? node->left : node->right;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Finds an account by its username and discriminator.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return matching account, nullptr otherwise
+ */
+const ImageAccount* UImage::retrieveUser(std::string_view username, int disc) const {
+    const ImageUNode *node = retrieve(username);
+    if (!node) { return nullptr; }
+
+    const ImageAccount *accounts = getAccounts(node);
+    int low = 0;
+    int high = (int)node->numAccounts - 1;
+
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+
+        if (accounts[mid].disc == disc) { return &accounts[mid]; }
+        if (accounts[mid].disc < disc) { low = mid + 1; }
+        else { high = mid - 1; }
+    }
+
+    return nullptr;
+}
+
+/**
+ * Counts the accounts of a username.
+ * @param username username to match
+ * @return number of accounts with the username, 0 if there are none
+ */
+int UImage::numUsers(std::string_view username) const {
+    const ImageUNode *node = retrieve(username);
+
+    return (node) ? node->numAccounts : 0;
+}
+
+/**
+ * Visits, in order, every node whose username starts with a prefix.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching node and its number of accounts
+ * @param limit maximum number of nodes to visit, NO_LIMIT to visit all of them
+ * @return number of nodes visited
+ */
+int UImage::forEachWithPrefix(std::string_view prefix, std::function<void(const ImageUNode*, int)> visitor,
+                              int limit) const {
+    const ImageUNode *stack[MAX_IMAGE_DEPTH];
+    int top = 0;
+    int visited = 0;
+    uint64_t reached = 0;
+
+    // push the path to the lower bound of the prefix, then walk in order from it
+    // exactly like UTree::forEachWithPrefix. that reaches every node at most once,
+    // so reaching more nodes than the image holds means its links form a cycle
+    auto pushLeft = [&](uint64_t offset, bool bounded) {
+        while (offset != IMAGE_NO_NODE) {
+            if (reached++ == _header->numUsernames) {
+                throw std::invalid_argument("Malformed image detected - tree links form a cycle");
+            }
+
+            const ImageUNode *node = at<ImageUNode>(offset);
+
+            if (bounded && getUsername(node) < prefix) {
+                offset = node->right;
+                continue;
+            }
+            if (top == MAX_IMAGE_DEPTH) {
+                throw std::invalid_argument("Malformed image detected - tree is too deep");
+            }
+
+            stack[top++] = node;
+            offset = node->left;
+        }
+    };
+
+    pushLeft((_header) ? _header->root : IMAGE_NO_NODE, true);
+
+    while (top > 0 && visited != limit) {
+        const ImageUNode *node = stack[--top];
+
+        if (getUsername(node).substr(0, prefix.length()) != prefix) { break; }
+
+        visitor(node, node->numAccounts);
+        visited++;
+
+        pushLeft(node->right, false);
+    }
+
+    return visited;
+}
+
+/**
+ * Checks the whole image against its checksum. Lookups only check that the offsets
+ * they follow stay inside the file, throwing std::invalid_argument if one doesn't,
+ * so an image from an untrusted source should still be verified once before use.
+ * @return true if the image is intact, false otherwise
+ */
+bool UImage::verify() const {
+    if (!_header) { return false; }
+
+    size_t bodySize = _file.size() - SNAPSHOT_FOOTER_SIZE;
+    SnapshotReader footer(_file.data() + bodySize, SNAPSHOT_FOOTER_SIZE);
+
+    return snapshotChecksum(_file.data(), bodySize) == footer.getU64();
+}
+
+/**
+ * Copies an account out of the image.
+ * @param node node holding the account
+ * @param acct account to copy
+ * @return the account
+ */
+Account UImage::getAccount(const ImageUNode *node, const ImageAccount *acct) const {
+    return Account(getUsername(node), acct->disc, acct->nitro, getBadge(acct), getStatus(acct));
+}
@@ -0,0 +1,108 @@
+/***************************
+* File:     uimage.h
+* Project:  Project 2
+*
+* Header definition of UImage class.
+***************************/
+#pragma once
+
+#include "uindex.h"
+#include <cstdint>
+
+/* Image layout. Every link is a byte offset from the start of the file, so the
+ * image can be mapped at any address and queried where it lies:
+ *   header    ImageHeader
+ *   unodes    numUsernames x ImageUNode, linked into a balanced search tree
+ *   accounts  numAccounts x ImageAccount, each username's run sorted by disc
+ *   strings   usernames, badges and statuses, each stored once
+ *   footer    u64 checksum of everything before it, see snapshot.h */
+#define IMAGE_MAGIC "UIMAGE01"
+#define IMAGE_MAGIC_SIZE 8
+#define IMAGE_VERSION 1
+#define IMAGE_BYTE_ORDER 0x01020304     /* reads back differently on a host of the other endianness */
+#define IMAGE_NO_NODE 0                 /* offset 0 is the header, so it can't be a node */
+#define MAX_IMAGE_DEPTH 64              /* images are written perfectly balanced */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+struct ImageHeader {
+    char magic[IMAGE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numUsernames;
+    uint64_t numAccounts;
+    uint64_t root;
+    uint64_t size;              // of the whole file, footer included
+};
+
+/* One username. Its DTree is kept as the in-order array of its accounts, which
+ * a bisection walks the same way it would walk a perfectly balanced DTree. */
+struct ImageUNode {
+    uint64_t left;
+    uint64_t right;
+    uint64_t username;
+    uint64_t accounts;
+    uint32_t usernameLength;
+    uint32_t numAccounts;
+};
+
+struct ImageAccount {
+    uint64_t badge;
+    uint64_t status;
+    uint32_t badgeLength;
+    uint32_t statusLength;
+    uint16_t disc;
+    uint8_t nitro;
+    uint8_t padding[5];
+};
+
+/* The writer lays these out field by field, so none of them may have padding */
+static_assert(sizeof(ImageHeader) == 48, "ImageHeader must not be padded");
+static_assert(sizeof(ImageUNode) == 40, "ImageUNode must not be padded");
+static_assert(sizeof(ImageAccount) == 32, "ImageAccount must not be padded");
+
+/* Read-only UTree served straight out of a memory mapped image written by
+ * UTree::saveImage(). Opening it reads only the header, and processes mapping the
+ * same image share its pages. */
+class UImage {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    UImage(string path);
+
+    /* Basic operations */
+    const ImageUNode* retrieve(std::string_view username) const;
+    const ImageAccount* retrieveUser(std::string_view username, int disc) const;
+    int numUsers(std::string_view username) const;
+    int forEachWithPrefix(std::string_view prefix, std::function<void(const ImageUNode*, int)> visitor,
+                          int limit = NO_LIMIT) const;
+    bool verify() const;
+
+    /* Getters */
+    bool isOpen() const {return _header != nullptr;}
+    size_t numUsernames() const {return _header ? _header->numUsernames : 0;}
+    size_t numAccounts() const {return _header ? _header->numAccounts : 0;}
+    std::string_view getUsername(const ImageUNode *node) const {return view(node->username, node->usernameLength);}
+    std::string_view getBadge(const ImageAccount *acct) const {return view(acct->badge, acct->badgeLength);}
+    std::string_view getStatus(const ImageAccount *acct) const {return view(acct->status, acct->statusLength);}
+    const ImageAccount* getAccounts(const ImageUNode *node) const {return at<ImageAccount>(node->accounts, node->numAccounts);}
+    Account getAccount(const ImageUNode *node, const ImageAccount *acct) const;
+
+private:
+    MappedFile _file;
+    const ImageHeader* _header;     // nullptr unless the image opened
+
+    // every offset read from the image is checked against the file before it is
+    // followed, so a corrupt image throws std::invalid_argument instead of reading
+    // outside the mapping
+    template <class T>
+    const T* at(uint64_t offset, uint64_t count = 1) const {
+        if (offset % alignof(T) != 0 || offset > _file.size() || count > (_file.size() - offset) / sizeof(T)) {
+            throw std::invalid_argument("Malformed image detected - offset out of bounds");
+        }
+        return reinterpret_cast<const T*>(_file.data() + offset);
+    }
+    std::string_view view(uint64_t offset, uint32_t length) const {return std::string_view(at<char>(offset, length), length);}
+};
@@ -0,0 +1,180 @@
+/***************************
+* File:     uindex.cpp
+* Project:  Project 2
+*
+* Implementation of uindex.h.
+***************************/
+#include "uindex.h"
+#include "utree.h"
+#include "rtree.h"
+#include "btree.h"
+#include "ushard.h"
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Constructs an empty username index.
+ * @param backend UINDEX_AVL, UINDEX_RADIX or UINDEX_BPLUS
+ * @return the new index, owned by the caller
+ */
+UserIndex* UserIndex::create(int backend) {
+    switch (backend) {
+    case UINDEX_RADIX: return new RTree();
+    case UINDEX_BPLUS: return new BTree();
+    case UINDEX_AVL: return new UTree();
+    case UINDEX_SHARDED: return new ShardedUTree();
+    default: throw std::invalid_argument("Unknown username index backend " + std::to_string(backend));
+    }
+}
+
+/**
+ * Maps a file into memory for reading.
+ * @param path path of the file to map, isOpen() is false if it could not be opened
+ * @param sequential true if the file will be read front to back, false for random access
+ */
+MappedFile::MappedFile(string path, bool sequential): _fd(-1), _data(nullptr), _size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+
+    if (fd == -1) { return; }
+
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        return;
+    }
+
+    _fd = fd;
+    _size = info.st_size;
+
+    // an empty file can't be mapped, but it is still a valid (empty) input
+    if (_size) {
+        void *mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+        if (mapped == MAP_FAILED) {
+            close(_fd);
+            _fd = -1;
+            _size = 0;
+            return;
+        }
+
+        madvise(mapped, _size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        _data = static_cast<const char*>(mapped);
+    }
+}
+
+/**
+ * Destructor, unmaps and closes the file.
+ */
+MappedFile::~MappedFile() {
+    if (_data) { munmap(const_cast<char*>(_data), _size); }
+    if (_fd != -1) { close(_fd); }
+}
+
+// preconditions: [pos, end) is the unread part of a csv buffer
+// postconditions: a pointer to the first ',' or '\n' at or after pos is returned, or end
+//                 if there is neither
+static const char* findDelimiter(const char *pos, const char *end) {
+#ifdef __SSE2__
+    // test 16 bytes at a time for either character and jump to the first hit
+    const __m128i commas = _mm_set1_epi8(',');
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    while (end - pos >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+        int bits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, commas), _mm_cmpeq_epi8(chunk, newlines)));
+
+        if (bits) { return pos + __builtin_ctz(bits); }
+        pos += 16;
+    }
+#endif
+
+    while (pos < end && *pos != ',' && *pos != '\n') { pos++; }
+
+    return pos;
+}
+
+// preconditions: field is a numeric csv field
+// postconditions: the field's value is returned, parsed with the same leniency as
+//                 std::stoi (leading whitespace, a '+' sign, trailing characters)
+static int parseIntField(std::string_view field) {
+    const char *first = field.data();
+    const char *last = first + field.size();
+
+    while (first < last && isspace((unsigned char)*first)) { first++; }
+    if (last - first > 1 && *first == '+' && isdigit((unsigned char)first[1])) { first++; }
+
+    int value = 0;
+    std::from_chars_result result = std::from_chars(first, last, value);
+
+    if (result.ec == std::errc::invalid_argument) { throw std::invalid_argument("stoi"); }
+    if (result.ec == std::errc::result_out_of_range) { throw std::out_of_range("stoi"); }
+
+    return value;
+}
+
+/**
+ * Sources a .csv file to populate Account objects and insert them into the index.
+ * @param infile path to .csv file containing database of accounts
+ * @param append true to append to an existing tree structure or false to clear before importing
+ */
+void UserIndex::loadData(string infile, bool append) {
+    MappedFile file(infile);
+
+    /* Check to make sure the file was opened */
+    if(!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    /* Should we append or clear? */
+    if(!append) this->clear();
+
+    parseRows(file.data(), file.data() + file.size(), [this](Account acct) {
+        this->insert(std::move(acct));
+    });
+}
+
+/**
+ * Parses every csv line in a buffer into an Account.
+ * @param pos start of the buffer, at the beginning of a line
+ * @param end one past the end of the buffer
+ * @param visit called with each line's Account, in order
+ */
+void UserIndex::parseRows(const char *pos, const char *end, const std::function<void(Account)>& visit) {
+    const int numFields = 5;
+    std::string_view fields[numFields];
+
+    /* Read the data straight out of the buffer: every field is a view into it,
+     * so nothing is copied until the Account is built */
+    while(pos < end) {
+        const char *fieldStart = pos;
+        const char *stop = findDelimiter(pos, end);
+        int delimCount = 0;
+
+        /* Split the line on ',' until its '\n' (or the end of the buffer) */
+        while(stop < end && *stop == ',') {
+            if(delimCount < numFields - 1) fields[delimCount] = std::string_view(fieldStart, stop - fieldStart);
+            delimCount++;
+
+            fieldStart = stop + 1;
+            stop = findDelimiter(fieldStart, end);
+        }
+
+        /* Quick check to make sure each line is formatted correctly */
+        if(delimCount != numFields - 1) {
+            throw std::invalid_argument("Malformed input file detected - ensure each line contains 5 fields deliminated by a ','");
+        }
+        fields[numFields - 1] = std::string_view(fieldStart, stop - fieldStart);
+
+        visit(Account(fields[0], parseIntField(fields[1]), parseIntField(fields[2]), fields[3], fields[4]));
+
+        pos = (stop < end) ? stop + 1 : end;
+    }
+}
@@ -0,0 +1,63 @@
+/***************************
+* File:     uindex.h
+* Project:  Project 2
+*
+* Header definition of UserIndex interface.
+***************************/
+#pragma once
+
+#include "dtree.h"
+#include <fstream>
+#include <sstream>
+#include <functional>
+
+#define NO_LIMIT -1
+
+/* Username index backends */
+#define UINDEX_AVL 0
+#define UINDEX_RADIX 1
+#define UINDEX_BPLUS 2
+#define UINDEX_SHARDED 3
+
+class UNode;
+
+/* Read-only memory mapping of a whole file, unmapped on destruction */
+class MappedFile {
+public:
+    MappedFile(string path, bool sequential = true);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /* Getters */
+    bool isOpen() const {return _fd != -1;}
+    const char* data() const {return _data;}
+    size_t size() const {return _size;}
+
+private:
+    int _fd;
+    const char* _data;
+    size_t _size;
+};
+
+/* Operations shared by every username index (UTree, RTree, BTree), so the
+ * backend can be picked when the index is constructed. */
+class UserIndex {
+public:
+    virtual ~UserIndex() {}
+
+    static UserIndex* create(int backend);
+
+    virtual void loadData(string infile, bool append = true);
+    virtual bool insert(Account newAcct) = 0;
+    virtual bool removeUser(string username, int disc, DNode*& removed) = 0;
+    virtual UNode* retrieve(string username) = 0;
+    virtual DNode* retrieveUser(string username, int disc) = 0;
+    virtual int numUsers(string username) = 0;
+    virtual void clear() = 0;
+    virtual void printUsers() const = 0;
+    virtual int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const = 0;
+
+protected:
+    static void parseRows(const char *pos, const char *end, const std::function<void(Account)>& visit);
+};
@@ -0,0 +1,316 @@
+/***************************
+* File:     ulog.cpp
+* Project:  Project 2
+*
+* Implementation of ulog.h.
+***************************/
+#include "ulog.h"
+#include "snapshot.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// preconditions: out is a record payload being built
+// postconditions: value is appended to out little endian
+static void putInt(std::vector<char>& out, uint64_t value, int size) {
+    for (int i = 0; i < size; i++) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+
+    return;
+}
+
+// preconditions: out is a record payload being built
+// postconditions: str is appended to out as (u32 length, bytes)
+static void putString(std::vector<char>& out, const string& str) {
+    putInt(out, str.size(), 4);
+    out.insert(out.end(), str.begin(), str.end());
+
+    return;
+}
+
+// preconditions: the file is open for writing
+// postconditions: every byte is written, or std::runtime_error is thrown
+static void writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t result = write(fd, data, size);
+
+        if (result <= 0) { throw std::runtime_error("Write-ahead log could not be written"); }
+        data += result;
+        size -= result;
+    }
+
+    return;
+}
+
+/**
+ * Opens a log for appending. An existing log that follows the same snapshot is
+ * kept up to its last intact record; anything else is replaced by an empty log.
+ * @param path path of the log, isOpen() is false if it could not be opened
+ * @param base checksum of the snapshot the log follows, LOG_NO_BASE for none
+ * @param syncPolicy LOG_SYNC_NONE, LOG_SYNC_ALWAYS or LOG_SYNC_BATCH
+ */
+ULog::ULog(string path, uint64_t base, int syncPolicy): _path(path), _base(base), _syncPolicy(syncPolicy), _fd(-1),
+    _lsn(0), _writtenLsn(0), _syncedLsn(0), _writing(false), _failed(false), _numSyncs(0) {
+    size_t keep = 0;
+
+    {
+        MappedFile existing(path);
+        if (existing.isOpen()) { keep = validLength(existing.data(), existing.size(), base, nullptr); }
+    }
+
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (_fd == -1) { return; }
+
+    if (keep) {
+        // drop a torn record left by a crash so new records follow intact ones
+        if (ftruncate(_fd, keep) != 0) { close(_fd); _fd = -1; return; }
+    } else {
+        std::vector<char> header(LOG_MAGIC, LOG_MAGIC + LOG_MAGIC_SIZE);
+        putInt(header, base, 8);
+
+        try {
+            if (ftruncate(_fd, 0) != 0 || fdatasync(_fd) != 0) { throw std::runtime_error("truncate"); }
+            writeAll(_fd, header.data(), header.size());
+            if (fdatasync(_fd) != 0) { throw std::runtime_error("sync"); }
+        } catch (std::runtime_error&) {
+            close(_fd);
+            _fd = -1;
+            return;
+        }
+    }
+
+    lseek(_fd, 0, SEEK_END);
+}
+
+/**
+ * Destructor, writes out and syncs every record appended so far.
+ */
+ULog::~ULog() {
+    if (_fd == -1) { return; }
+
+    try {
+        sync();
+    } catch (std::exception&) {
+        // nothing left to report the failure to
+    }
+
+    close(_fd);
+    _fd = -1;
+}
+
+/**
+ * Appends a mutation to the log. It is not durable until commit() says so.
+ * @param acct account being inserted
+ * @return the record's log sequence number, to pass to commit()
+ */
+uint64_t ULog::appendInsert(const Account& acct) {
+    std::vector<char> payload;
+
+    payload.push_back(LOG_OP_INSERT);
+    putInt(payload, acct.getDiscriminator(), 2);
+    payload.push_back(acct.hasNitro());
+    putString(payload, acct.getUsername());
+    putString(payload, acct.getBadge());
+    putString(payload, acct.getStatus());
+
+    return append(payload);
+}
+
+uint64_t ULog::appendRemove(const string& username, int disc) {
+    std::vector<char> payload;
+
+    payload.push_back(LOG_OP_REMOVE);
+    putInt(payload, disc, 2);
+    putString(payload, username);
+
+    return append(payload);
+}
+
+uint64_t ULog::appendClear() {
+    return append(std::vector<char>(1, LOG_OP_CLEAR));
+}
+
+/**
+ * Makes a record as durable as the sync policy asks for before returning.
+ * @param lsn log sequence number returned by an append
+ */
+void ULog::commit(uint64_t lsn) {
+    switch (_syncPolicy) {
+    case LOG_SYNC_ALWAYS:
+        writeOut(lsn, true);
+        break;
+    case LOG_SYNC_BATCH: {
+        // counts the records since the last sync rather than looking at lsn itself,
+        // since a batch only commits its last record and could step over every multiple
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (lsn < _syncedLsn + LOG_BATCH_RECORDS) { return; }
+        lock.unlock();
+
+        writeOut(lsn, true);
+        break;
+    }
+    default: {
+        // only hand the buffer to the OS once it is worth a write()
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_pending.size() < LOG_BUFFER_SIZE) { return; }
+        lock.unlock();
+
+        writeOut(lsn, false);
+        break;
+    }
+    }
+
+    return;
+}
+
+/**
+ * Writes out and syncs every record appended so far, whatever the sync policy.
+ */
+void ULog::sync() {
+    uint64_t lsn;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        lsn = _lsn;
+    }
+
+    writeOut(lsn, true);
+
+    return;
+}
+
+/**
+ * Calls visit on every intact record of a log, in order. Nothing is visited if
+ * the log is missing or follows a different snapshot.
+ * @param path path of the log
+ * @param base checksum of the snapshot the log has to follow
+ * @param visit called with each record's LOG_OP_* and its account; a removal
+ *              only fills in the username and discriminator
+ */
+void ULog::replay(string path, uint64_t base, std::function<void(int, Account&)> visit) {
+    MappedFile file(path);
+
+    if (file.isOpen()) {
+        validLength(file.data(), file.size(), base, &visit);
+    }
+
+    return;
+}
+
+// preconditions: payload is a complete record payload
+// postconditions: the record is buffered and its log sequence number returned
+uint64_t ULog::append(const std::vector<char>& payload) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    putInt(_pending, payload.size(), 4);
+    putInt(_pending, snapshotChecksum(payload.data(), payload.size()), 8);
+    _pending.insert(_pending.end(), payload.begin(), payload.end());
+
+    return ++_lsn;
+}
+
+// preconditions: lsn has been appended
+// postconditions: lsn has been written, and synced if durable is true. The first
+//                 committer to find no write in progress writes out everything
+//                 buffered; everyone who arrives meanwhile waits for it and is
+//                 usually covered by its write when it finishes
+void ULog::writeOut(uint64_t lsn, bool durable) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::vector<char> buffer;
+
+    while ((durable ? _syncedLsn : _writtenLsn) < lsn) {
+        if (_failed || _fd == -1) { throw std::runtime_error("Write-ahead log could not be written"); }
+
+        if (_writing) {
+            _synced.wait(lock);
+            continue;
+        }
+
+        _writing = true;
+        buffer.swap(_pending);
+        uint64_t target = _lsn;
+        lock.unlock();
+
+        bool failed = false;
+        try {
+            writeAll(_fd, buffer.data(), buffer.size());
+            if (durable && fdatasync(_fd) != 0) { failed = true; }
+        } catch (std::runtime_error&) {
+            failed = true;
+        }
+        buffer.clear();
+
+        lock.lock();
+        _writing = false;
+        _failed = _failed || failed;
+        _synced.notify_all();
+
+        if (failed) { throw std::runtime_error("Write-ahead log could not be written"); }
+
+        _writtenLsn = target;
+        if (durable) {
+            _syncedLsn = target;
+            _numSyncs++;
+        }
+    }
+
+    return;
+}
+
+// preconditions: data holds size bytes of a log file
+// postconditions: the length of the log up to its last intact record is returned,
+//                 0 if it isn't a log following base. visit, if given, is called on
+//                 every intact record
+size_t ULog::validLength(const char *data, size_t size, uint64_t base, std::function<void(int, Account&)>* visit) {
+    if (size < LOG_HEADER_SIZE || memcmp(data, LOG_MAGIC, LOG_MAGIC_SIZE) != 0) { return 0; }
+
+    SnapshotReader header(data + LOG_MAGIC_SIZE, LOG_HEADER_SIZE - LOG_MAGIC_SIZE);
+    if (header.getU64() != base) { return 0; }
+
+    size_t pos = LOG_HEADER_SIZE;
+
+    while (size - pos >= LOG_RECORD_HEADER_SIZE) {
+        SnapshotReader recordHeader(data + pos, LOG_RECORD_HEADER_SIZE);
+        uint32_t length = recordHeader.getU32();
+        uint64_t checksum = recordHeader.getU64();
+        const char *payload = data + pos + LOG_RECORD_HEADER_SIZE;
+
+        if (length == 0 || length > size - pos - LOG_RECORD_HEADER_SIZE
+            || snapshotChecksum(payload, length) != checksum) { break; }
+
+        if (visit) {
+            Account acct;
+            int op = 0;
+
+            try {
+                SnapshotReader reader(payload, length);
+                op = reader.getU8();
+
+                if (op == LOG_OP_INSERT) {
+                    int disc = reader.getU16();
+                    bool nitro = reader.getU8();
+                    std::string_view username = reader.getBytes(reader.getU32());
+                    std::string_view badge = reader.getBytes(reader.getU32());
+                    std::string_view status = reader.getBytes(reader.getU32());
+                    acct = Account(username, disc, nitro, badge, status);
+                } else if (op == LOG_OP_REMOVE) {
+                    int disc = reader.getU16();
+                    acct = Account(reader.getBytes(reader.getU32()), disc, false, DEFAULT_BADGE, DEFAULT_STATUS);
+                } else if (op != LOG_OP_CLEAR) {
+                    break;
+                }
+            } catch (std::exception&) {
+                // a record that passed its checksum but doesn't parse ends the log too
+                break;
+            }
+
+            (*visit)(op, acct);
+        }
+
+        pos += LOG_RECORD_HEADER_SIZE + length;
+    }
+
+    return pos;
+}
@@ -0,0 +1,41 @@
+/***************************
+* File:     ulookup.cpp
+* Project:  Project 2
+*
+* Implementation of ulookup.h.
+***************************/
+#include "ulookup.h"
+
+/**
+ * Resumes every lookup in flight once, then fills the window back up from those waiting.
+ * @return true if any lookup is still pending
+ */
+bool ULookupScheduler::step() {
+    size_t kept = 0;
+
+    while (this->_inFlight.size() < this->_window && !this->_waiting.empty()) {
+        this->_inFlight.push_back(this->_waiting.front());
+        this->_waiting.pop_front();
+    }
+
+    for (Entry& entry : this->_inFlight) {
+        entry.next->resume();
+
+        if (!entry.lookup.done()) {
+            this->_inFlight[kept++] = entry;
+        }
+    }
+
+    this->_inFlight.resize(kept);
+
+    return this->numPending() > 0;
+}
+
+/**
+ * Steps until every lookup spawned is done.
+ */
+void ULookupScheduler::run() {
+    while (step()) {}
+
+    return;
+}
@@ -0,0 +1,175 @@
+/***************************
+* File:     ulookup.h
+* Project:  Project 2
+*
+* Header definition of the coroutine lookups and the scheduler that interleaves them.
+***************************/
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#define CACHE_LINE_SIZE 64
+#define LOOKUP_WINDOW 16    /* lookups a scheduler keeps in flight at once */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* Asks for every cache line of an object ahead of reading it */
+inline void prefetchObject(const void *object, size_t size) {
+    const char *start = static_cast<const char*>(object);
+
+    for (size_t offset = 0; offset < size; offset += CACHE_LINE_SIZE) {
+        __builtin_prefetch(start + offset);
+    }
+    // an object that does not start on a line boundary spills into one more
+    __builtin_prefetch(start + size - 1);
+}
+
+/* State every lookup's promise shares. Lookups nest, a UTree lookup awaiting a DTree
+ * one; the outermost keeps the handle of whichever is suspended, so resuming it
+ * continues the lookup wherever it stopped. */
+class ULookupPromise {
+    friend class Grader;
+    friend class Tester;
+    friend class ULookupScheduler;
+    template<typename T> friend class ULookup;
+    friend struct UPrefetch;
+
+public:
+    std::suspend_always initial_suspend() noexcept {return {};}
+    void unhandled_exception() {_error = std::current_exception();}
+
+    /* An inner lookup hands control straight back to the one awaiting it */
+    struct FinalAwaiter {
+        bool await_ready() noexcept {return false;}
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> awaiting = handle.promise()._awaiting;
+            return (awaiting) ? awaiting : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept {return {};}
+
+protected:
+    ULookupPromise(): _suspended(&_next) {}
+
+    std::coroutine_handle<> _next;          // suspended part of the lookup, if this is the outermost
+    std::coroutine_handle<> *_suspended;    // the outermost lookup's _next
+    std::coroutine_handle<> _awaiting;      // lookup to continue when this one ends, if any
+    std::exception_ptr _error;
+};
+
+/* A lookup suspended before its first step. Resuming runs it to its next prefetch,
+ * so a caller either resumes it until done() or hands it to a ULookupScheduler, and
+ * then takes get(). Another lookup may co_await it, which runs it as part of that one. */
+template<typename T>
+class ULookup {
+    friend class Grader;
+    friend class Tester;
+    friend class ULookupScheduler;
+
+public:
+    class promise_type: public ULookupPromise {
+        friend class ULookup;
+
+    public:
+        ULookup get_return_object() {
+            std::coroutine_handle<promise_type> handle = std::coroutine_handle<promise_type>::from_promise(*this);
+            this->_next = handle;
+            return ULookup(handle);
+        }
+        void return_value(T value) {_value = std::move(value);}
+
+    private:
+        T _value{};
+    };
+
+    ULookup(ULookup&& other) noexcept: _handle(std::exchange(other._handle, nullptr)) {}
+    ULookup& operator=(ULookup&& other) noexcept {
+        if (this != &other) {
+            if (_handle) { _handle.destroy(); }
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+    ~ULookup() { if (_handle) { _handle.destroy(); } }
+
+    /* Basic operations */
+    bool done() const {return !_handle || _handle.done();}
+    void resume() { if (!done()) { _handle.promise()._next.resume(); } }
+    T get() {
+        while (!done()) { resume(); }
+        if (_handle.promise()._error) { std::rethrow_exception(_handle.promise()._error); }
+        return _handle.promise()._value;
+    }
+
+    /* Awaiting from another lookup */
+    bool await_ready() const noexcept {return false;}
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+        _handle.promise()._awaiting = awaiting;
+        _handle.promise()._suspended = awaiting.promise()._suspended;
+        return _handle;
+    }
+    T await_resume() { return get(); }
+
+private:
+    explicit ULookup(std::coroutine_handle<promise_type> handle): _handle(handle) {}
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+/* co_await UPrefetch{node, sizeof(*node)} asks for node and suspends the lookup, so
+ * the others run while it comes in. A null node does not suspend. */
+struct UPrefetch {
+    const void *object;
+    size_t size;
+
+    bool await_ready() const noexcept {return object == nullptr;}
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        prefetchObject(object, size);
+        *handle.promise()._suspended = handle;
+    }
+    void await_resume() const noexcept {}
+};
+
+/* Round-robins lookups on the calling thread. At most a window of them is in flight;
+ * each step() resumes every one in flight once, so each advances a node while the
+ * others' prefetches complete, and starts waiting ones as others finish. The lookups
+ * are not owned and must outlive their run. */
+class ULookupScheduler {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    ULookupScheduler(size_t window = LOOKUP_WINDOW): _window((window > 0) ? window : 1) {}
+
+    /* Basic operations */
+    template<typename T>
+    void spawn(ULookup<T>& lookup) {
+        if (!lookup.done()) { _waiting.push_back({lookup._handle, &lookup._handle.promise()._next}); }
+    }
+    bool step();
+    void run();
+
+    /* Getters */
+    size_t numPending() const {return _inFlight.size() + _waiting.size();}
+    size_t getWindow() const {return _window;}
+
+private:
+    struct Entry {
+        std::coroutine_handle<> lookup;     // the outermost coroutine, done once the lookup is
+        std::coroutine_handle<> *next;      // its _next
+    };
+
+    size_t _window;
+    std::vector<Entry> _inFlight;
+    std::deque<Entry> _waiting;
+};
@@ -0,0 +1,214 @@
+/***************************
+* File:     ushard.cpp
+* Project:  Project 2
+*
+* Implementation of ushard.h.
+***************************/
+#include "ushard.h"
+#include <algorithm>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Constructor, creates the empty shards.
+ * @param numShards number of shards, DEFAULT_SHARDS for one per hardware thread
+ */
+ShardedUTree::ShardedUTree(int numShards) {
+    if (numShards <= 0) { numShards = std::max(1u, std::thread::hardware_concurrency()); }
+
+    _numShards = numShards;
+    _shards = new UShard[_numShards];
+}
+
+/**
+ * Destructor, deletes every shard and the accounts in it.
+ */
+ShardedUTree::~ShardedUTree() {
+    delete [] _shards;
+    _shards = nullptr;
+}
+
+/**
+ * Returns the shard a username lives in.
+ * @param username username to place
+ * @return index of its shard
+ */
+int ShardedUTree::shardOf(const string& username) const {
+    return hashUsername(username) % this->_numShards;
+}
+
+/**
+ * Inserts an account into its username's shard.
+ * @param newAcct Account object to be inserted
+ * @return true if the account was inserted, false otherwise
+ */
+bool ShardedUTree::insert(Account newAcct) {
+    UShard &shard = this->_shards[shardOf(newAcct.getUsername())];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    return shard.tree.insert(std::move(newAcct));
+}
+
+/**
+ * Removes a user with a matching username and discriminator.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @param removed DNode object to hold removed account
+ * @return true if an account was removed, false otherwise
+ */
+bool ShardedUTree::removeUser(string username, int disc, DNode*& removed) {
+    UShard &shard = this->_shards[shardOf(username)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    return shard.tree.removeUser(username, disc, removed);
+}
+
+/**
+ * Retrieves the set of users with a username.
+ * @param username username to match
+ * @return UNode with a matching username, nullptr otherwise
+ */
+UNode* ShardedUTree::retrieve(string username) {
+    UShard &shard = this->_shards[shardOf(username)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    return shard.tree.retrieve(username);
+}
+
+/**
+ * Retrieves the specified Account within a DNode.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return DNode with a matching username and discriminator, nullptr otherwise
+ */
+DNode* ShardedUTree::retrieveUser(string username, int disc) {
+    UShard &shard = this->_shards[shardOf(username)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    return shard.tree.retrieveUser(username, disc);
+}
+
+/**
+ * Returns the number of users with a specific username.
+ * @param username username to match
+ * @return number of users with the specified username
+ */
+int ShardedUTree::numUsers(string username) {
+    UShard &shard = this->_shards[shardOf(username)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    return shard.tree.numUsers(username);
+}
+
+/**
+ * Deletes every account in every shard.
+ */
+void ShardedUTree::clear() {
+    for (int i = 0; i < this->_numShards; i++) {
+        std::lock_guard<std::mutex> guard(this->_shards[i].lock);
+        this->_shards[i].tree.clear();
+    }
+
+    return;
+}
+
+/**
+ * Prints all accounts' details in username order across the shards.
+ */
+void ShardedUTree::printUsers() const {
+    int visited = forEachWithPrefix("", [](UNode *node, int) { node->getDTree()->printAccounts(); });
+
+    if (!visited) { cout << "No accounts stored." << endl; }
+
+    return;
+}
+
+/**
+ * Visits, in order, every UNode whose username starts with a prefix. Each shard
+ * is walked in order on its own and the walks are merged through a heap, with
+ * every shard locked for the duration so the traversal sees one consistent state.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching UNode and its number of users
+ * @param limit maximum number of UNodes to visit, NO_LIMIT to visit all of them
+ * @return number of UNodes visited
+ */
+int ShardedUTree::forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit) const {
+    std::vector<std::unique_lock<std::mutex>> guards;
+    std::vector<std::vector<std::pair<UNode*, int>>> runs(this->_numShards);
+
+    // shards are always locked in index order, so two traversals can't deadlock
+    for (int i = 0; i < this->_numShards; i++) {
+        guards.emplace_back(this->_shards[i].lock);
+
+        // no shard can contribute more than limit nodes to the first limit overall
+        this->_shards[i].tree.forEachWithPrefix(prefix, [&runs, i](UNode *node, int numUsers) {
+            runs[i].emplace_back(node, numUsers);
+        }, limit);
+    }
+
+    // each heap entry is (shard, position in its run), smallest username on top
+    auto later = [&runs](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+        return runs[a.first][a.second].first->getUsername() > runs[b.first][b.second].first->getUsername();
+    };
+    std::priority_queue<std::pair<int, size_t>, std::vector<std::pair<int, size_t>>, decltype(later)> heads(later);
+    int visited = 0;
+
+    for (int i = 0; i < this->_numShards; i++) {
+        if (!runs[i].empty()) { heads.emplace(i, 0); }
+    }
+
+    while (!heads.empty() && (limit == NO_LIMIT || visited < limit)) {
+        std::pair<int, size_t> head = heads.top();
+        heads.pop();
+
+        visitor(runs[head.first][head.second].first, runs[head.first][head.second].second);
+        visited++;
+
+        if (head.second + 1 < runs[head.first].size()) { heads.emplace(head.first, head.second + 1); }
+    }
+
+    return visited;
+}
+
+/**
+ * Loads a .csv file. The file is parsed once, its rows are routed to their
+ * shards, and every shard then loads its own rows on its own thread.
+ * @param infile path to .csv file containing database of accounts
+ * @param append true to append to the existing accounts or false to replace them
+ */
+void ShardedUTree::loadData(string infile, bool append) {
+    MappedFile file(infile);
+    std::vector<std::vector<Account>> rows(this->_numShards);
+
+    if (!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    // a malformed file throws here, before any shard changes
+    parseRows(file.data(), file.data() + file.size(), [this, &rows](Account acct) {
+        rows[shardOf(acct.getUsername())].push_back(std::move(acct));
+    });
+
+    std::vector<std::thread> loaders;
+
+    for (int i = 0; i < this->_numShards; i++) {
+        loaders.emplace_back([this, &rows, append, i]() {
+            UShard &shard = this->_shards[i];
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            if (append) {
+                for (Account &acct : rows[i]) { shard.tree.insert(std::move(acct)); }
+            } else {
+                shard.tree.clear();
+                shard.tree.bulkLoad(rows[i]);
+                if (shard.tree.hasLog()) { shard.tree.checkpoint(); }
+            }
+        });
+    }
+
+    for (std::thread &loader : loaders) { loader.join(); }
+
+    return;
+}
@@ -0,0 +1,56 @@
+/***************************
+* File:     ushard.h
+* Project:  Project 2
+*
+* Header definition of ShardedUTree class.
+***************************/
+#pragma once
+
+#include "utree.h"
+#include <mutex>
+
+#define DEFAULT_SHARDS 0    /* one shard per hardware thread */
+
+class Grader;   /* For grading purposes */
+class Tester;   /* Forward declaration for testing class */
+
+/* One independent UTree and the lock serializing calls into it. Shards are
+ * cache line aligned so neighbouring locks don't share a line. */
+struct alignas(CACHE_LINE_SIZE) UShard {
+    UTree tree;
+    mutable std::mutex lock;
+};
+
+/* Username index that hashes each username to one of several independent
+ * UTrees. Every call locks only the shard the username lives in, so threads
+ * working on different shards never wait on each other. Ordered traversals
+ * merge the shards' in-order walks. */
+class ShardedUTree : public UserIndex {
+    friend class Grader;
+    friend class Tester;
+
+public:
+    ShardedUTree(int numShards = DEFAULT_SHARDS);
+    ~ShardedUTree();
+    ShardedUTree(const ShardedUTree&) = delete;
+    ShardedUTree& operator=(const ShardedUTree&) = delete;
+
+    /* Basic operations */
+    bool insert(Account newAcct) override;
+    bool removeUser(string username, int disc, DNode*& removed) override;
+    UNode* retrieve(string username) override;
+    DNode* retrieveUser(string username, int disc) override;
+    int numUsers(string username) override;
+    void clear() override;
+    void printUsers() const override;
+    int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const override;
+    void loadData(string infile, bool append = true) override;
+
+    /* Getters */
+    int numShards() const {return _numShards;}
+    int shardOf(const string& username) const;
+
+private:
+    UShard* _shards;
+    int _numShards;
+};
@@ -9,55 +9,34 @@
 * Implementation of UTree.h.
 ***************************/
 #include "utree.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 /**
  * Destructor, deletes all dynamic memory.
  */
 UTree::~UTree() {
+    // the log syncs what it holds; clearing the tree is not a logged mutation
+    disableLog();
     clear();
-}
-
-/**
- * Sources a .csv file to populate Account objects and insert them into the UTree.
- * @param infile path to .csv file containing database of accounts
- * @param append true to append to an existing tree structure or false to clear before importing
- */
-void UTree::loadData(string infile, bool append) {
-    std::ifstream instream(infile);
-    string line;
-    char delim = ',';
-    const int numFields = 5;
-    string fields[numFields];
-
-    /* Check to make sure the file was opened */
-    if(!instream.is_open()) {
-        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
-        exit(-1);
-    }
-
-    /* Should we append or clear? */
-    if(!append) this->clear();
-
-    /* Read in the data from the .csv file and insert into the UTree */
-    while(std::getline(instream, line)) {
-        std::stringstream buffer(line);
-
-        /* Quick check to make sure each line is formatted correctly */
-        int delimCount = 0;
-        for(unsigned int c = 0; c < buffer.str().length(); c++) if(buffer.str()[c] == delim) delimCount++;
-        if(delimCount != numFields - 1) {
-            throw std::invalid_argument("Malformed input file detected - ensure each line contains 5 fields deliminated by a ','");
-        }
-
-        /* Populate the account attributes -
-         * Each line always has 5 sections of data */
-        for(int i = 0; i < numFields; i++) {
-            std::getline(buffer, line, delim);
-            fields[i] = line;
-        }
-        Account newAcct = Account(fields[0], std::stoi(fields[1]), std::stoi(fields[2]), fields[3], fields[4]);
-        this->insert(newAcct);
-    }
+    delete _index;
+    _index = nullptr;
+    delete _filter;
+    _filter = nullptr;
+    delete _cache;
+    _cache = nullptr;
+    delete _handles;
+    _handles = nullptr;
+    delete _versions;
+    _versions = nullptr;
+    delete _epoch;
+    _epoch = nullptr;
 }
 
 /**
@@ -68,78 +47,60 @@ void UTree::loadData(string infile, bool append) {
  * @return true if the account was inserted, false otherwise
  */
 bool UTree::insert(Account newAcct) {
-    bool inserted = this->insert(this->_root, newAcct);
+    if (this->_concurrent) { return insertConcurrent(newAcct); }
 
-    // once we've reached the root and a node was actually inserted, rotate the
-    // root if it needs it
-    if (inserted) {
-        this->_root = rebalance(this->_root);
-    }
+    // the log gets the request before the tree changes; replaying it repeats the
+    // same outcome, so failed insertions need no special treatment
+    if (this->_log) { this->_log->commit(this->_log->appendInsert(newAcct)); }
 
-    return inserted;
+    return (this->_epoch) ? insertPublished(newAcct) : insertNode(newAcct);
 }
 
-// preconditions: the insert shell was called for account
-// postconditions: an account is inserted into a UNode if a username matches,
-//                 else a new UNode is created and the tree is rebalanced if it needs it
-bool UTree::insert(UNode *currNode, Account insertMe) {
-    // if the tree does not yet have a root, make one
-    if (!this->_root) {
-        this->_root = new UNode();
-
-        return this->_root->insert(insertMe);
+// preconditions: insert() has logged the request, and in concurrent mode holds the
+//                tree lock exclusively
+// postconditions: the account is inserted into its username's UNode, which is created,
+//                 linked in and retraced if it is new; returns true if it was inserted
+bool UTree::insertNode(Account& newAcct) {
+    // keep the address of every child pointer we follow so that the retrace can
+    // walk back up and reattach rotated subtrees without recursion
+    UNode **path[MAX_UTREE_DEPTH];
+    int depth = 0;
+    UNode **link = &this->_root;
+    string username = newAcct.getUsername();
+
+    // an existing username can be inserted into without walking the tree at all
+    if (this->_index) {
+        UNode *found = this->_index->find(username);
+        if (found) { return found->insert(newAcct); }
     }
 
-    // we need to use these booleans to determine if we should rotate the left or right
-    // nodes later after insertion
-    bool leftInsert = false;
-    bool rightInsert = false;
-
-    if (insertMe.getUsername() < currNode->getUsername()) {
-        // if there is a left node, continue to perform recursion down until there
-        // is an empty node to insert at
-        if (currNode->_left) {
-            leftInsert = this->insert(currNode->_left, insertMe);
-
-            // if we didn't successfully insert the node, stop execution and return false
-            if (!leftInsert) { return false; }
-        } else {
-            // if we're at a node that does not exist, we can insert our node here
-            currNode->_left = new UNode();
-            bool inserted = currNode->_left->insert(insertMe);
-
-            updateHeight(currNode);
+    while (*link) {
+        UNode *currNode = *link;
+        const string& nodeName = currNode->getUsername();
 
-            return inserted;
+        // if the usernames are equal, insert the account into this node. the
+        // username level does not change, so there is nothing to retrace
+        if (username == nodeName) {
+            return currNode->insert(newAcct);
         }
-    } else if (insertMe.getUsername() > currNode->getUsername()) {
-        // if there is a right node, continue to traverse the tree until we find a node
-        // to insert into
-        if (currNode->_right) {
-            rightInsert = this->insert(currNode->_right, insertMe);
 
-            // if there wasn't an insertion, stop execution
-            if (!rightInsert) { return false; }
-        } else {
-            // if the next node does not exist, make a new UNode in it's place
-            currNode->_right = new UNode();
-            bool inserted = currNode->_right->insert(insertMe);
+        path[depth++] = link;
+        link = (username < nodeName) ? &currNode->_left : &currNode->_right;
+    }
 
-            updateHeight(currNode);
+    // we've fallen off the tree, so the account gets a brand new UNode here
+    UNode *newNode = new UNode();
 
-            return inserted;
-        }
-    } else {
-        // if the usernames are equal, insert the account into this node
-        return currNode->insert(insertMe);
+    if (!newNode->insert(newAcct)) {
+        delete newNode;
+        return false;
     }
 
-    updateHeight(currNode);
+    *link = newNode;
+    if (this->_index) { this->_index->insert(username, newNode); }
 
-    // if we inserted into a node successfully, check the node path we went down
-    // for if it needs a rebalance
-    if (leftInsert) { currNode->_left = rebalance(currNode->_left); }
-    else if (rightInsert) { currNode->_right = rebalance(currNode->_right); }
+    retrace(path, depth);
+    if (this->_filter) { filterAdd(username); }
 
     return true;
 }
@@ -147,9 +108,31 @@ bool UTree::insert(UNode *currNode, Account insertMe) {
 // preconditions: we're at a UNode in which we can insert the account
 // postconditions: the dtree attempts to insert the node, returns true if it did else false
 bool UNode::insert(Account acc) {
+    // the first account names the node; after that the name never changes
+    if (!this->_dtree->getNumUsers()) { this->_username = acc.getUsername(); }
+
     return this->_dtree->insert(acc);
 }
 
+// preconditions: accts holds count accounts of one username, sorted by discriminator
+// postconditions: the DTree is rebuilt from them and the node takes their username
+void UNode::assign(Account *accts, int count) {
+    if (count > 0) { this->_username = accts[0].getUsername(); }
+    this->_dtree->assign(accts, count);
+
+    return;
+}
+
+// preconditions: order holds count indices into accts of accounts of one username,
+//                sorted by discriminator
+// postconditions: the DTree is rebuilt from them and the node takes their username
+void UNode::assign(Account *accts, const int *order, int count) {
+    if (count > 0) { this->_username = accts[order[0]].getUsername(); }
+    this->_dtree->assign(accts, order, count);
+
+    return;
+}
+
 /**
  * Removes a user with a matching username and discriminator.
  * @param username username to match
@@ -158,54 +141,64 @@ bool UNode::insert(Account acc) {
  * @return true if an account was removed, false otherwise
  */
 bool UTree::removeUser(string username, int disc, DNode*& removed) {
-    bool removedNode = this->remove(this->_root, username, disc, removed);
+    if (this->_concurrent) { return removeUserConcurrent(username, disc, removed); }
 
-    // if we did remove a node and the root is empty, we know we removed from the root
-    // so we can replace it with something else
-    if (removedNode && !this->_root->getNumUsers()) {
-        this->_root = findReplacement(this->_root);
-    }
+    if (this->_log) { this->_log->commit(this->_log->appendRemove(username, disc)); }
 
-    return removedNode;
+    return (this->_epoch) ? removePublished(username, disc, removed) : removeNode(username, disc, removed);
 }
 
-// preconditions: removeUser() is called
-// postconditions: a DNode is removed from a UNode's dtree and if the unode is empty,
-//                 it is delete and replaced
-bool UTree::remove(UNode *currNode, string username, int disc, DNode *&removed) {
-    // we only want to check this node for removal if it actually exists... duh
-    if (currNode) {
-        if (username < currNode->getUsername()) {
-            bool removedNode = this->remove(currNode->_left, username, disc, removed);
+// preconditions: removeUser() has logged the request, and in concurrent mode holds the
+//                tree lock exclusively
+// postconditions: the account is removed from its UNode, which is unlinked and retraced
+//                 if that emptied it; returns true if an account was removed
+bool UTree::removeNode(const string& username, int disc, DNode*& removed) {
+    UNode **path[MAX_UTREE_DEPTH];
+    int depth = 0;
+    UNode **link = &this->_root;
+
+    // with a hash index, removing from a UNode that stays non-empty never has
+    // to touch the tree; only emptying it needs the path below
+    if (this->_index) {
+        UNode *found = this->_index->find(username);
+
+        if (!found || !found->remove(disc, removed)) { return false; }
+        if (this->_cache) { this->_cache->invalidate(username, disc); }
+        if (this->_handles) { this->_handles->retire(username, disc); }
+        if (found->getNumUsers()) { return true; }
+    }
 
-            // if we removed a node from the left side and the left node is now empty
-            // then we can find a replacement for it and delete it
-            if (removedNode && !currNode->_left->getNumUsers()) {
-                currNode->_left = findReplacement(currNode->_left);
-                updateHeight(currNode);
-            }
+    // binary search for the username, remembering the path down to it
+    while (*link) {
+        const string& nodeName = (*link)->getUsername();
 
-            return removedNode;
-        } else if (username > currNode->getUsername()) {
-            bool removedNode = this->remove(currNode->_right, username, disc, removed);
+        if (username == nodeName) { break; }
 
-            // if we removed a node from the right side and the right node is now empty
-            // then we can find a replacement for it and delete it
-            if (removedNode && !currNode->_right->getNumUsers()) {
-                currNode->_right = findReplacement(currNode->_right);
-                updateHeight(currNode);
-            }
+        path[depth++] = link;
+        link = (username < nodeName) ? &(*link)->_left : &(*link)->_right;
+    }
 
-            return removedNode;
-        } else if (username == currNode->getUsername()) {
-            // if we found a matching username in this node, we can attempt to remove
-            // from this nodes DTree
-            return currNode->remove(disc, removed);
+    if (!this->_index) {
+        // the username doesn't exist or the discriminator wasn't in its DTree
+        if (!*link || !(*link)->remove(disc, removed)) {
+            return false;
+        }
+
+        // the DNode is vacant now, and freed by the next rebuild that reaches it
+        if (this->_cache) { this->_cache->invalidate(username, disc); }
+        if (this->_handles) { this->_handles->retire(username, disc); }
+
+        // if the node still holds accounts, the shape of the tree is unchanged
+        if ((*link)->getNumUsers()) {
+            return true;
         }
     }
 
-    // if none of the conditions above occur, then nothing was removed and we return false
-    return false;
+    // otherwise the UNode is empty and has to be taken out of the tree
+    path[depth++] = link;
+    findReplacement(path, depth);
+
+    return true;
 }
 
 // preconditions: we found a unode with a matching username for removal
@@ -214,69 +207,284 @@ bool UNode::remove(int disc, DNode *&removed) {
     return this->_dtree->remove(disc, removed);
 }
 
-// preconditions: a DNode was removed from a UNode's DTree
-// postconditions: a the node passed into this function is replaced by the next
-//                 largest UNode in the tree
-UNode* UTree::findReplacement(UNode *empty) {
-    UNode *trav = empty;
+/**
+ * Applies a batch of insertions and removals with one descent per username. The
+ * batch is sorted by username and discriminator, keeping operations on the same
+ * account in the order given, and each username's run goes through its DTree in one
+ * pass, creating or unlinking the UNode at most once.
+ * @param ops insertions and removals, in the order they would be applied one by one
+ * @return for each operation, whether it inserted an account or removed one that was
+ *         there, see DTree::applyBatch(), with the removed account for the caller to delete
+ */
+std::vector<AccountOpResult> UTree::applyBatch(const std::vector<AccountOp>& ops) {
+    std::vector<AccountOpResult> results(ops.size(), AccountOpResult{false, nullptr});
+
+    // path copying has no batch path, so each operation is published on its own
+    if (this->_epoch) {
+        for (size_t i = 0; i < ops.size(); i++) {
+            const Account& acct = ops[i].account;
+            int disc = acct.getDiscriminator();
+
+            if (ops[i].type == AccountOp::INSERT) {
+                results[i].applied = insert(acct);
+            } else {
+                results[i].applied = retrieveUser(acct.getUsername(), disc) && removeUser(acct.getUsername(), disc, results[i].removed);
+            }
+        }
+
+        return results;
+    }
 
-    // we need to go down left, then all the way to the right to find the largest
-    // node in this subtree
-    if (trav->_left) {
-        // find the deepest node in the left subtree and copy the dtree of it into
-        // the empty node's, then delete the found node
-        trav = replacementTraversal(trav->_left);
-        *empty->_dtree = *trav->_dtree;
+    std::vector<int> order, runs;
+    sortBatch(ops, order, runs);
 
-        delete trav;
-        trav = empty;
-    } else {
-        // if there is no left node, return the next node to the right of empty
-        trav = trav->_right;
-        delete empty;
+    uint64_t lsn = 0;
+
+    {
+        // in concurrent mode, readers hold the shared lock around everything they touch
+        std::unique_lock<std::shared_mutex> exclusive(this->_treeLock, std::defer_lock);
+        if (this->_concurrent) { exclusive.lock(); }
+
+        // logged in the order given; replaying one at a time ends with the same accounts
+        if (this->_log) {
+            for (const AccountOp& op : ops) {
+                lsn = (op.type == AccountOp::INSERT)
+                      ? this->_log->appendInsert(op.account)
+                      : this->_log->appendRemove(op.account.getUsername(), op.account.getDiscriminator());
+            }
+        }
+
+        // each run may rebuild its username's DTree out of new DNodes; the cache drops
+        // them all in one scan
+        if (this->_cache) {
+            std::vector<string> usernames;
+            for (size_t run = 0; run + 1 < runs.size(); run++) { usernames.push_back(ops[order[runs[run]]].account.getUsername()); }
+            this->_cache->invalidateUsers(usernames);
+        }
+
+        for (size_t run = 0; run + 1 < runs.size(); run++) {
+            applyUser(ops, order.data() + runs[run], runs[run + 1] - runs[run], results);
+
+            // a removed account's handle goes even if the batch put the account back,
+            // and the rest follow their accounts into a DTree that may have been rebuilt
+            if (this->_handles) {
+                for (int i = runs[run]; i < runs[run + 1]; i++) {
+                    const Account& acct = ops[order[i]].account;
+                    if (ops[order[i]].type == AccountOp::REMOVE && results[order[i]].applied) {
+                        this->_handles->retire(acct.getUsername(), acct.getDiscriminator());
+                    }
+                }
+                rebindHandles(ops[order[runs[run]]].account.getUsername());
+            }
+        }
     }
 
-    return trav;
+    if (this->_log && !ops.empty()) { this->_log->commit(lsn); }
+
+    return results;
 }
 
-// preconditions: there was a left node found in the findReplacement() function
-// postconditions: the deepest right node of the left subtree found in findReplacement()
-//                 is returned
-UNode* UTree::replacementTraversal(UNode *candidate) {
-    UNode *returnMe = nullptr;
+// preconditions: accountOf(i) returns the i-th of count accounts
+// postconditions: order holds every index, sorted by username, then discriminator, then
+//                 index; runs holds where each username's indices start in order,
+//                 followed by their total
+template <typename AccountOf>
+static void sortAccounts(size_t count, AccountOf accountOf, std::vector<int>& order, std::vector<int>& runs) {
+    // an LSD radix sort: a counting sort on the discriminator, which is bounded, then a
+    // stable one on the username's rank, so nothing is sorted by comparison but the
+    // distinct usernames
+    std::vector<int> byDisc(count);
+    {
+        std::vector<int> discStart(MAX_DISC - MIN_DISC + 2, 0);
+        for (size_t i = 0; i < count; i++) { discStart[accountOf(i).getDiscriminator() - MIN_DISC + 1]++; }
+        for (size_t d = 1; d < discStart.size(); d++) { discStart[d] += discStart[d - 1]; }
+        for (size_t i = 0; i < count; i++) { byDisc[discStart[accountOf(i).getDiscriminator() - MIN_DISC]++] = (int)i; }
+    }
 
-    // if there is a node to the right of the passed node, verify if it is the deepest node
-    if (candidate->_right) {
+    // grouping by hash and sorting only the distinct usernames keeps string comparisons,
+    // each a cache miss into the accounts, to far fewer than sorting every one would take
+    std::unordered_map<std::string_view, int> groupOf;
+    std::vector<std::string_view> names;
+    std::vector<int> groups(count);
+    groupOf.reserve(count);
 
-        // if the next node is the deepest node, then store it for returning and
-        // replace the right pointer of this node with the right node's left node
-        if (!candidate->_right->_right) {
-            returnMe = candidate->_right;
-            candidate->_right = candidate->_right->_left;
+    for (size_t i = 0; i < count; i++) {
+        const string& username = accountOf(i).getUsername();
+        auto found = groupOf.try_emplace(username, (int)names.size());
 
-            updateHeight(candidate);
+        if (found.second) { names.push_back(username); }
+        groups[i] = found.first->second;
+    }
 
-            // if the node needs to be rebalanced, do it
-            if (candidate->_right) {
-                candidate = rebalance(candidate);
-            }
+    std::vector<int> byName(names.size());
+    std::vector<int> rank(names.size());
+    for (size_t g = 0; g < names.size(); g++) { byName[g] = (int)g; }
+    std::sort(byName.begin(), byName.end(), [&names](int a, int b) { return names[a] < names[b]; });
+    for (size_t r = 0; r < names.size(); r++) { rank[byName[r]] = (int)r; }
 
-            return returnMe;
-        } else {
-            // if the next node wasn't the deepest node, perform recursion until we're there
-            UNode* replacement = replacementTraversal(candidate->_right);
-            updateHeight(candidate);
+    // taking indices in discriminator order keeps each username's run sorted by
+    // discriminator, and ties in increasing index order
+    runs.assign(names.size() + 1, 0);
+    for (int group : groups) { runs[rank[group] + 1]++; }
+    for (size_t r = 0; r < names.size(); r++) { runs[r + 1] += runs[r]; }
+
+    std::vector<int> next(runs.begin(), runs.end() - 1);
+    order.resize(count);
+    for (int i : byDisc) { order[next[rank[groups[i]]]++] = i; }
+
+    return;
+}
+
+// preconditions: none
+// postconditions: order holds the index of every operation, sorted by username, then
+//                 discriminator, then position in ops; runs holds where each username's
+//                 operations start in order, followed by their total
+void UTree::sortBatch(const std::vector<AccountOp>& ops, std::vector<int>& order, std::vector<int>& runs) {
+    sortAccounts(ops.size(), [&ops](size_t i) -> const Account& { return ops[i].account; }, order, runs);
+
+    return;
+}
+
+// preconditions: order holds count indices into ops of operations on one username,
+//                sorted by discriminator
+// postconditions: they are applied to the username's DTree, and its UNode is created
+//                 and linked in, or unlinked, if that changes whether it has accounts
+void UTree::applyUser(const std::vector<AccountOp>& ops, const int *order, int count, std::vector<AccountOpResult>& results) {
+    const string& username = ops[order[0]].account.getUsername();
+    UNode **path[MAX_UTREE_DEPTH];
+    int depth = 0;
+    UNode **link = &this->_root;
+
+    // with a hash index, the tree is only walked if the UNode is new or emptied
+    if (this->_index) {
+        UNode *found = this->_index->find(username);
+        if (found && found->_dtree->applyBatch(ops.data(), order, count, results.data()) > 0) { return; }
+    }
+
+    while (*link) {
+        const string& nodeName = (*link)->getUsername();
+
+        if (username == nodeName) { break; }
+
+        path[depth++] = link;
+        link = (username < nodeName) ? &(*link)->_left : &(*link)->_right;
+    }
+
+    if (*link) {
+        // the index already applied the run to this UNode
+        if (!this->_index && (*link)->_dtree->applyBatch(ops.data(), order, count, results.data()) > 0) { return; }
+
+        path[depth++] = link;
+        findReplacement(path, depth);
+
+        return;
+    }
+
+    // a new username is linked in only if the run leaves it an account
+    UNode *newNode = new UNode();
+    newNode->_username = username;
+
+    if (newNode->_dtree->applyBatch(ops.data(), order, count, results.data()) == 0) {
+        delete newNode;
+        return;
+    }
+
+    *link = newNode;
+    if (this->_index) { this->_index->insert(username, newNode); }
+
+    retrace(path, depth);
+    if (this->_filter) { filterAdd(username); }
 
-            // if this node is now unbalanced, rebalance it and return the replacement
-            candidate = rebalance(candidate);
+    return;
+}
 
-            return replacement;
+// preconditions: the last entry of path links to a UNode whose DTree is now empty
+// postconditions: the empty node is replaced by the largest UNode of its left subtree
+//                 (or by its right child if there is no left subtree) and the path
+//                 back up to the root is retraced
+void UTree::findReplacement(UNode **path[], int depth) {
+    UNode **emptyLink = path[depth - 1];
+    UNode *empty = *emptyLink;
+
+    if (this->_index) { this->_index->erase(empty->getUsername()); }
+
+    if (empty->_left) {
+        // go down left, then all the way to the right to find the largest node
+        // in this subtree. every node passed on the way is an ancestor of the
+        // node that is actually unlinked, so it goes on the path
+        UNode **link = &empty->_left;
+
+        while ((*link)->_right) {
+            path[depth++] = link;
+            link = &(*link)->_right;
         }
+
+        // hand the found node's dtree to the empty node, then splice the found
+        // node out by handing its left child to its parent. its DNodes don't
+        // move, so cached accounts and handles still point at the right ones
+        UNode *replacement = *link;
+        if (this->_index) { this->_index->insert(replacement->getUsername(), empty); }
+
+        std::swap(empty->_dtree, replacement->_dtree);
+        empty->_username = std::move(replacement->_username);
+        *link = replacement->_left;
+
+        delete replacement;
+    } else {
+        // if there is no left node, the right child takes the empty node's place
+        *emptyLink = empty->_right;
+        depth--;
+
+        delete empty;
+    }
+
+    retrace(path, depth);
+    if (this->_filter) { filterRemoved(1); }
+
+    return;
+}
+
+// preconditions: a UNode was linked into or unlinked from the tree below the last
+//                entry of path
+// postconditions: heights are updated and imbalances rotated from the bottom of the
+//                 path upwards, stopping at the first subtree whose height is unchanged
+void UTree::retrace(UNode **path[], int depth) {
+    this->_numRetraceOps++;
+
+    while (depth > 0) {
+        UNode **link = path[--depth];
+        int oldHeight = (*link)->getHeight();
+
+        // rebalance() also updates the height of whatever ends up rooting this subtree
+        *link = rebalance(*link);
+        this->_numRetraced++;
+
+        // if the subtree is as tall as it was before, nothing above it can change
+        if ((*link)->getHeight() == oldHeight) { break; }
     }
 
-    // if there was no right node, then this node is the one that will replace
-    // the empty node
-    return candidate;
+    return;
+}
+
+/**
+ * Returns the average number of ancestors retraced per insertion or removal that
+ * added or deleted a UNode.
+ * @return average nodes retraced per structural change, 0 if there were none
+ */
+double UTree::avgRetraced() const {
+    if (!this->_numRetraceOps) { return 0.0; }
+
+    return double(this->_numRetraced) / this->_numRetraceOps;
+}
+
+/**
+ * Resets the retracing counters.
+ */
+void UTree::resetRetraceStats() {
+    this->_numRetraceOps = 0;
+    this->_numRetraced = 0;
+
+    return;
 }
 
 /**
@@ -285,6 +493,19 @@ UNode* UTree::replacementTraversal(UNode *candidate) {
  * @return UNode with a matching username, nullptr otherwise
  */
 UNode* UTree::retrieve(string username) {
+    if (this->_epoch) {
+        UEpochGuard guard(this->_epoch);
+        return findPublished(username);
+    }
+
+    if (this->_concurrent) {
+        std::shared_lock<std::shared_mutex> shared(this->_treeLock);
+        return (this->_filter) ? findFiltered(username) : this->_index->find(username);
+    }
+
+    if (this->_filter) { return findFiltered(username); }
+    if (this->_index) { return this->_index->find(username); }
+
     return this->retrieve(this->_root, username);
 }
 
@@ -311,6 +532,28 @@ UNode* UTree::retrieve(UNode *currNode, string username) {
  * @return DNode with a matching username and discriminator, nullptr otherwise
  */
 DNode* UTree::retrieveUser(string username, int disc) {
+    if (this->_epoch) {
+        UEpochGuard guard(this->_epoch);
+        UNode *found = findPublished(username);
+        return (found) ? found->findDisc(disc) : nullptr;
+    }
+
+    if (this->_concurrent) {
+        std::shared_lock<std::shared_mutex> shared(this->_treeLock);
+        UNode *found = (this->_filter) ? findFiltered(username) : this->_index->find(username);
+        if (!found) { return nullptr; }
+
+        std::lock_guard<std::mutex> guard(found->_lock);
+        return found->findDisc(disc);
+    }
+
+    if (this->_cache) { return retrieveCached(username, disc); }
+
+    if (this->_filter || this->_index) {
+        UNode *found = (this->_filter) ? findFiltered(username) : this->_index->find(username);
+        return (found) ? found->findDisc(disc) : nullptr;
+    }
+
     return this->retrieveUser(this->_root, username, disc);
 }
 
@@ -330,6 +573,148 @@ DNode* UTree::retrieveUser(UNode *currNode, string username, int disc) {
     return nullptr;
 }
 
+/**
+ * Retrieves many accounts at once. Searches go through the tree in groups of
+ * BATCH_GROUP_SIZE, each advancing a level at a time with its next UNode, and
+ * then its next DNode, prefetched, so that one search's cache misses overlap with
+ * the others' rather than stalling retrieveUser() one lookup after another.
+ * @param keys usernames and discriminators to match
+ * @param count number of keys
+ * @param results gets, for each key, the DNode retrieveUser() would return
+ */
+void UTree::retrieveUserBatch(const UserKey *keys, int count, DNode **results) {
+    // the per UNode locks leave nothing to interleave
+    if (this->_concurrent) {
+        for (int i = 0; i < count; i++) { results[i] = retrieveUser(keys[i].username, keys[i].disc); }
+        return;
+    }
+
+    UEpochGuard guard(this->_epoch);
+    UNode *root = (this->_epoch) ? __atomic_load_n(&this->_root, __ATOMIC_ACQUIRE) : this->_root;
+
+    for (int start = 0; start < count; start += BATCH_GROUP_SIZE) {
+        retrieveGroup(root, keys + start, std::min(BATCH_GROUP_SIZE, count - start), results + start);
+    }
+
+    return;
+}
+
+// preconditions: count is at most BATCH_GROUP_SIZE and root is the tree to search
+// postconditions: results holds each key's DNode, or nullptr, found in lock-step
+void UTree::retrieveGroup(UNode *root, const UserKey *keys, int count, DNode **results) {
+    UNode *cursors[BATCH_GROUP_SIZE];
+    DTree *dtrees[BATCH_GROUP_SIZE];
+    int discs[BATCH_GROUP_SIZE];
+    int active[BATCH_GROUP_SIZE];
+    bool ruledOut[BATCH_GROUP_SIZE];
+    int numActive = 0;
+
+    for (int i = 0; i < count; i++) {
+        discs[i] = keys[i].disc;
+        dtrees[i] = nullptr;
+
+        // a username the filter rules out has nothing to search
+        ruledOut[i] = this->_filter && !this->_filter->mayContain(keys[i].username);
+        if (ruledOut[i]) { continue; }
+
+        // the hash index finds the UNode outright; only the DTree is left to search
+        if (this->_index) {
+            UNode *found = this->_index->find(keys[i].username);
+            if (found) {
+                dtrees[i] = found->_dtree;
+                __builtin_prefetch(dtrees[i]);
+            }
+        } else if (root) {
+            cursors[i] = root;
+            active[numActive++] = i;
+        }
+    }
+
+    while (numActive > 0) {
+        int stillActive = 0;
+
+        for (int j = 0; j < numActive; j++) {
+            int i = active[j];
+            UNode *node = cursors[i];
+            int order = keys[i].username.compare(node->getUsername());
+
+            if (order == 0) {
+                dtrees[i] = node->_dtree;
+                __builtin_prefetch(dtrees[i]);
+                continue;
+            }
+
+            UNode *next = (order < 0) ? node->_left : node->_right;
+
+            if (next) {
+                prefetchObject(next, sizeof(UNode));
+                cursors[i] = next;
+                active[stillActive++] = i;
+            }
+        }
+
+        numActive = stillActive;
+    }
+
+    if (this->_filter) {
+        for (int i = 0; i < count; i++) {
+            if (!ruledOut[i] && !dtrees[i]) { this->_filter->noteFalsePositive(); }
+        }
+    }
+
+    DTree::retrieveBatch(dtrees, discs, count, results);
+
+    return;
+}
+
+/**
+ * Retrieves an account as a coroutine that suspends after prefetching each node it
+ * goes on to, so a ULookupScheduler running many of them on one thread overlaps
+ * their cache misses. Lookups in flight keep the thread pinned with lock-free reads;
+ * otherwise the tree must not change until they are done.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return lookup giving what retrieveUser() would return
+ */
+ULookup<DNode*> UTree::retrieveUserAsync(string username, int disc) {
+    // the per UNode locks cannot be held across a suspension
+    if (this->_concurrent) { co_return retrieveUser(username, disc); }
+
+    UEpochGuard guard(this->_epoch);
+    UNode *found = co_await findAsync(username);
+    if (!found) { co_return nullptr; }
+
+    co_await UPrefetch{found->_dtree, sizeof(DTree)};
+    co_return co_await found->_dtree->retrieveAsync(disc);
+}
+
+// preconditions: the caller keeps username alive and the tree unchanged until this is done
+// postconditions: the UNode with a matching username is returned, else nullptr, with
+//                 a suspension after prefetching each node on the way
+ULookup<UNode*> UTree::findAsync(const string& username) {
+    if (this->_filter && !this->_filter->mayContain(username)) { co_return nullptr; }
+
+    UNode *found = nullptr;
+
+    if (this->_index) {
+        found = this->_index->find(username);
+    } else {
+        UNode *currNode = (this->_epoch) ? __atomic_load_n(&this->_root, __ATOMIC_ACQUIRE) : this->_root;
+
+        while (currNode && !found) {
+            co_await UPrefetch{currNode, sizeof(UNode)};
+            int order = username.compare(currNode->getUsername());
+
+            if (order == 0) { found = currNode; }
+            currNode = (order < 0) ? currNode->_left : currNode->_right;
+        }
+    }
+
+    if (!found && this->_filter) { this->_filter->noteFalsePositive(); }
+
+    co_return found;
+}
+
 // preconditions: a UNode is found with a matching username
 // postconditions: the account with the matching discriminator is returned if it is found,
 //                 else nullptr
@@ -343,6 +728,26 @@ DNode* UNode::findDisc(int disc) {
  * @return number of users with the specified username
  */
 int UTree::numUsers(string username) {
+    if (this->_epoch) {
+        UEpochGuard guard(this->_epoch);
+        UNode *found = findPublished(username);
+        return (found) ? found->getNumUsers() : 0;
+    }
+
+    if (this->_concurrent) {
+        std::shared_lock<std::shared_mutex> shared(this->_treeLock);
+        UNode *found = (this->_filter) ? findFiltered(username) : this->_index->find(username);
+        if (!found) { return 0; }
+
+        std::lock_guard<std::mutex> guard(found->_lock);
+        return found->getNumUsers();
+    }
+
+    if (this->_filter || this->_index) {
+        UNode *found = (this->_filter) ? findFiltered(username) : this->_index->find(username);
+        return (found) ? found->getNumUsers() : 0;
+    }
+
     return this->numUsers(this->_root, username);
 }
 
@@ -363,6 +768,22 @@ int UTree::numUsers(UNode *currNode, string username) {
     return 0;
 }
 
+/**
+ * Counts the users with a username as a coroutine, see retrieveUserAsync().
+ * @param username username to match
+ * @return lookup giving what numUsers() would return
+ */
+ULookup<int> UTree::numUsersAsync(string username) {
+    if (this->_concurrent) { co_return numUsers(username); }
+
+    UEpochGuard guard(this->_epoch);
+    UNode *found = co_await findAsync(username);
+    if (!found) { co_return 0; }
+
+    co_await UPrefetch{found->_dtree, sizeof(DTree)};
+    co_return found->getNumUsers();
+}
+
 // preconditions: a UNode is found with a matching username from numUsers()
 // postconditions: the amount of accounts in this node's DTree is returned
 int UNode::getNumUsers() {
@@ -373,12 +794,21 @@ int UNode::getNumUsers() {
  * Helper for the destructor to clear dynamic memory.
  */
 void UTree::clear() {
-    // only perform this function if there is memory to deallocate
-    if (this->_root) {
+    if (this->_log) { this->_log->commit(this->_log->appendClear()); }
+
+    // readers and snapshots may still be walking the tree, so its nodes are retired
+    // like the ones a write replaces rather than freed here
+    if (this->_epoch) {
+        retireTree();
+    } else if (this->_root) {
         clear(this->_root);
     }
 
     this->_root = nullptr;
+    if (this->_index) { this->_index->clear(); }
+    if (this->_filter) { this->_filter->reset(DEFAULT_FILTER_CAPACITY); }
+    if (this->_cache) { this->_cache->clear(); }
+    if (this->_handles) { this->_handles->clear(); }
 
     return;
 }
@@ -395,6 +825,2038 @@ void UTree::clear(UNode *currNode) {
     return;
 }
 
+/**
+ * Visits, in order, every UNode whose username starts with a prefix.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching UNode and its number of users
+ * @param limit maximum number of UNodes to visit, NO_LIMIT to visit all of them
+ * @return number of UNodes visited
+ */
+int UTree::forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit) const {
+    return walkPrefix(this->_root, prefix, visitor, limit);
+}
+
+// preconditions: nothing changes the tree under root while it is walked
+// postconditions: see forEachWithPrefix()
+int UTree::walkPrefix(UNode *root, const string& prefix, const std::function<void(UNode*, int)>& visitor, int limit) {
+    UNode *stack[MAX_UTREE_DEPTH];
+    int top = 0;
+    int visited = 0;
+
+    // find the lower bound of the prefix: every node on the way down that is not
+    // smaller than the prefix still has to be visited after its left subtree
+    UNode *currNode = root;
+
+    while (currNode) {
+        if (currNode->getUsername() >= prefix) {
+            stack[top++] = currNode;
+            currNode = currNode->_left;
+        } else {
+            currNode = currNode->_right;
+        }
+    }
+
+    // walk in order from the lower bound until a username no longer matches
+    while (top > 0 && visited != limit) {
+        currNode = stack[--top];
+
+        if (currNode->getUsername().compare(0, prefix.length(), prefix) != 0) { break; }
+
+        visitor(currNode, currNode->getNumUsers());
+        visited++;
+
+        // the in order successor is the leftmost node of the right subtree, or
+        // the nearest ancestor still on the stack
+        for (UNode *next = currNode->_right; next; next = next->_left) {
+            stack[top++] = next;
+        }
+    }
+
+    return visited;
+}
+
+/**
+ * Sources a .csv file to populate Account objects and insert them into the tree.
+ * Replacing the tree's contents takes the bulk load path: every row is parsed,
+ * sorted and built into balanced trees at once instead of being inserted.
+ * @param infile path to .csv file containing database of accounts
+ * @param append true to append to an existing tree structure or false to clear before importing
+ */
+void UTree::loadData(string infile, bool append) {
+    if (append) {
+        UserIndex::loadData(infile, append);
+        return;
+    }
+
+    checkInPlace(__FUNCTION__);
+
+    MappedFile file(infile);
+    std::vector<Account> accts;
+
+    if (!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    this->clear();
+
+    // one account per line, so the vector never has to move the accounts it holds
+    size_t numLines = 1;
+    for (const char *pos = file.data(), *end = pos + file.size(); pos != end && (pos = (const char*)memchr(pos, '\n', end - pos)); pos++) {
+        numLines++;
+    }
+    accts.reserve(numLines);
+
+    parseRows(file.data(), file.data() + file.size(), [&accts](Account acct) {
+        accts.push_back(std::move(acct));
+    });
+
+    bulkLoad(accts);
+
+    // the loaded rows never went through the log, so it starts over from here
+    if (this->_log) { checkpoint(); }
+
+    return;
+}
+
+// preconditions: the tree is empty and accts holds every account to load, in file order
+// postconditions: the tree holds the same accounts insert() would have kept, with a
+//                 perfectly balanced username level and perfectly balanced DTrees
+void UTree::bulkLoad(std::vector<Account>& accts) {
+    // the accounts are sorted as indices, so none of their strings move until each
+    // is moved once, into its DNode
+    std::vector<int> order, runs;
+    sortAccounts(accts.size(), [&accts](size_t i) -> const Account& { return accts[i]; }, order, runs);
+
+    // every run of one username becomes a UNode whose DTree is built from the run
+    std::vector<UNode*> nodes;
+    nodes.reserve(runs.size() - 1);
+
+    for (size_t r = 0; r + 1 < runs.size(); r++) {
+        int *run = order.data() + runs[r];
+        int count = 0;
+
+        // repeats of an account sort by row, so keeping the first copy of each keeps
+        // the one insert() would have
+        for (int i = 0; i < runs[r + 1] - runs[r]; i++) {
+            if (count == 0 || accts[run[i]].getDiscriminator() != accts[run[count - 1]].getDiscriminator()) {
+                run[count++] = run[i];
+            }
+        }
+
+        UNode *node = new UNode();
+        node->assign(accts.data(), run, count);
+        nodes.push_back(node);
+    }
+
+    this->_root = buildBalanced(nodes.data(), nodes.size());
+
+    if (this->_index) {
+        this->_index->clear();
+        indexNodes(this->_root);
+    }
+    if (this->_filter) { rebuildFilter(); }
+
+    return;
+}
+
+/**
+ * Moves every account of another tree into this one, keeping the accounts this
+ * tree already has wherever both hold the same username and discriminator, just
+ * as inserting them one by one would. Both username levels are walked in order
+ * and each shared username's DTrees are merged linearly, so the whole merge is
+ * O(n + m) and the username level is rebuilt once.
+ * @param other tree to take the accounts of, left empty
+ */
+void UTree::mergeFrom(UTree&& other) {
+    if (&other == this) { return; }
+
+    checkInPlace(__FUNCTION__);
+    other.checkInPlace(__FUNCTION__);
+
+    std::vector<UNode*> incoming;
+    collectNodes(other._root, incoming);
+
+    // other is emptied, which its own log has to know about
+    if (other._log) { other._log->commit(other._log->appendClear()); }
+    if (other._index) { other._index->clear(); }
+    if (other._filter) { other._filter->reset(DEFAULT_FILTER_CAPACITY); }
+    if (other._cache) { other._cache->clear(); }
+    if (other._handles) { other._handles->clear(); }
+    other._root = nullptr;
+
+    mergeNodes(incoming);
+
+    return;
+}
+
+/**
+ * Merges a .csv file sorted by username and then discriminator into the tree,
+ * like loadData() with append but in O(n + m). Each username's rows are built
+ * into a DTree as they stream past and merged in with mergeFrom()'s rules; of
+ * rows repeating an account, the first is kept. A file that isn't sorted throws
+ * before the tree is touched.
+ * @param infile path to a sorted .csv file of accounts
+ */
+void UTree::mergeSorted(string infile) {
+    checkInPlace(__FUNCTION__);
+
+    MappedFile file(infile);
+    std::vector<UNode*> incoming;
+    std::vector<Account> run;
+
+    if (!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    // every run of one username becomes a UNode as soon as the next one starts
+    auto finishRun = [&incoming, &run]() {
+        if (run.empty()) { return; }
+
+        UNode *node = new UNode();
+        node->assign(run.data(), run.size());
+        incoming.push_back(node);
+        run.clear();
+    };
+
+    try {
+        parseRows(file.data(), file.data() + file.size(), [&](Account acct) {
+            if (!run.empty()) {
+                int order = acct.getUsername().compare(run.back().getUsername());
+
+                if (order < 0 || (order == 0 && acct.getDiscriminator() < run.back().getDiscriminator())) {
+                    throw std::invalid_argument("Input file is not sorted by username and discriminator");
+                }
+                if (order == 0 && acct.getDiscriminator() == run.back().getDiscriminator()) { return; }
+                if (order > 0) { finishRun(); }
+            }
+
+            run.push_back(std::move(acct));
+        });
+        finishRun();
+    } catch (...) {
+        for (UNode *node : incoming) { delete node; }
+        throw;
+    }
+
+    mergeNodes(incoming);
+
+    return;
+}
+
+// preconditions: incoming holds UNodes owned by no tree, in strictly increasing username order
+// postconditions: incoming's accounts are merged into the tree under insert()'s duplicate
+//                 rules, incoming's leftover UNodes are deleted, and the username level is
+//                 rebuilt perfectly balanced
+void UTree::mergeNodes(std::vector<UNode*>& incoming) {
+    if (incoming.empty()) { return; }
+
+    std::vector<UNode*> existing, merged;
+    collectNodes(this->_root, existing);
+    merged.reserve(existing.size() + incoming.size());
+
+    size_t i = 0, j = 0;
+    string existingName = (i < existing.size()) ? existing[i]->getUsername() : "";
+    string incomingName = incoming[j]->getUsername();
+
+    while (i < existing.size() || j < incoming.size()) {
+        int order = (i == existing.size()) ? 1 : (j == incoming.size()) ? -1 : existingName.compare(incomingName);
+
+        if (order <= 0) {
+            // a username in both trees keeps its UNode and takes in the other's accounts
+            if (order == 0) {
+                existing[i]->_dtree->merge(*incoming[j]->_dtree);
+                delete incoming[j];
+                if (++j < incoming.size()) { incomingName = incoming[j]->getUsername(); }
+            }
+
+            merged.push_back(existing[i]);
+            if (++i < existing.size()) { existingName = existing[i]->getUsername(); }
+        } else {
+            merged.push_back(incoming[j]);
+            if (++j < incoming.size()) { incomingName = incoming[j]->getUsername(); }
+        }
+    }
+
+    this->_root = buildBalanced(merged.data(), merged.size());
+
+    if (this->_index) {
+        this->_index->clear();
+        indexNodes(this->_root);
+    }
+    if (this->_filter) { rebuildFilter(); }
+
+    // the merged accounts never went through the log, so it starts over from here
+    if (this->_log) { checkpoint(); }
+
+    return;
+}
+
+/**
+ * Splits the tree at a username: every UNode from username on moves into right,
+ * replacing whatever it held, and the rest stay here. UNodes and their DTrees
+ * are relinked rather than copied, so the split costs O(log n) (plus the moved
+ * usernames when either tree has a hash index, and a checkpoint for a logged tree).
+ * @param username first username that moves to right
+ * @param right tree that receives the usernames from username on
+ */
+void UTree::split(string username, UTree& right) {
+    if (&right == this) { return; }
+
+    checkInPlace(__FUNCTION__);
+    right.checkInPlace(__FUNCTION__);
+
+    UNode *less = nullptr, *rest = nullptr;
+    splitNodes(this->_root, username, less, rest);
+    this->_root = less;
+
+    right.clear();
+    right._root = rest;
+
+    if (this->_index || right._index || this->_filter || right._filter || this->_cache || this->_handles) {
+        std::vector<UNode*> moved;
+        std::vector<string> movedNames;
+        collectNodes(rest, moved);
+
+        for (UNode *node : moved) {
+            if (this->_index) { this->_index->erase(node->getUsername()); }
+            if (this->_cache) { movedNames.push_back(node->getUsername()); }
+            if (this->_handles) { this->_handles->rebind(node->getUsername(), nullptr); }
+            if (right._index) { right._index->insert(node->getUsername(), node); }
+            if (right._filter) { right.filterAdd(node->getUsername()); }
+        }
+        if (this->_filter) { filterRemoved(moved.size()); }
+        if (this->_cache) { this->_cache->invalidateUsers(movedNames); }
+    }
+
+    // neither log saw the accounts move
+    if (this->_log) { checkpoint(); }
+    if (right._log) { right.checkpoint(); }
+
+    return;
+}
+
+/**
+ * Appends a tree whose usernames all sort after this tree's, leaving right
+ * empty. The two username levels are joined with the AVL join, in time
+ * proportional to the difference in their heights.
+ * @param right tree to take the UNodes of, left empty
+ * @throws std::invalid_argument if right holds a username not after every one here,
+ *         in which case neither tree changes
+ */
+void UTree::join(UTree&& right) {
+    if (&right == this || !right._root) { return; }
+
+    checkInPlace(__FUNCTION__);
+    right.checkInPlace(__FUNCTION__);
+
+    if (this->_root) {
+        UNode *last = this->_root, *first = right._root;
+        while (last->_right) { last = last->_right; }
+        while (first->_left) { first = first->_left; }
+
+        if (!(last->getUsername() < first->getUsername())) {
+            throw std::invalid_argument("Joined tree's usernames must all follow this tree's");
+        }
+    }
+
+    if (this->_index) { indexNodes(right._root); }
+    if (right._index) { right._index->clear(); }
+    std::vector<UNode*> incoming;
+    if (this->_filter) { collectNodes(right._root, incoming); }
+    if (right._filter) { right._filter->reset(DEFAULT_FILTER_CAPACITY); }
+    if (right._cache) { right._cache->clear(); }
+    if (right._handles) { right._handles->clear(); }
+    if (right._log) { right._log->commit(right._log->appendClear()); }
+
+    // right's smallest UNode becomes the key the two trees are joined around
+    UNode *mid = nullptr;
+    UNode *rest = removeMin(right._root, mid);
+    right._root = nullptr;
+
+    this->_root = joinNodes(this->_root, mid, rest);
+
+    // only once right's UNodes are linked in, as filterAdd() may rebuild from the tree
+    for (UNode *node : incoming) { filterAdd(node->getUsername()); }
+
+    if (this->_log) { checkpoint(); }
+
+    return;
+}
+
+// preconditions: every username in left sorts before mid's, and mid's before every one
+//                in right; left and right are AVL trees and mid is detached
+// postconditions: returns the root of an AVL tree holding all of them, built by
+//                 descending the taller tree's spine to where the other fits
+UNode* UTree::joinNodes(UNode *left, UNode *mid, UNode *right) {
+    int leftHeight = (left) ? left->getHeight() : -1;
+    int rightHeight = (right) ? right->getHeight() : -1;
+
+    if (leftHeight > rightHeight + 1) {
+        left->_right = joinNodes(left->_right, mid, right);
+        return rebalance(left);
+    }
+    if (rightHeight > leftHeight + 1) {
+        right->_left = joinNodes(left, mid, right->_left);
+        return rebalance(right);
+    }
+
+    mid->_left = left;
+    mid->_right = right;
+    mid->calcNodeHeight();
+
+    return mid;
+}
+
+// preconditions: currNode roots an AVL tree
+// postconditions: less is an AVL tree of the usernames before username, rest one of
+//                 the others; each level joins one node onto the pieces below it
+void UTree::splitNodes(UNode *currNode, const string& username, UNode *&less, UNode *&rest) {
+    if (!currNode) {
+        less = nullptr;
+        rest = nullptr;
+        return;
+    }
+
+    UNode *left = currNode->_left, *right = currNode->_right;
+
+    if (username <= currNode->getUsername()) {
+        splitNodes(left, username, less, left);
+        rest = joinNodes(left, currNode, right);
+    } else {
+        splitNodes(right, username, right, rest);
+        less = joinNodes(left, currNode, right);
+    }
+
+    return;
+}
+
+// preconditions: currNode roots a non-empty AVL tree
+// postconditions: the leftmost UNode is unlinked into min, and the root of the
+//                 remaining, rebalanced tree is returned
+UNode* UTree::removeMin(UNode *currNode, UNode *&min) {
+    if (!currNode->_left) {
+        min = currNode;
+        UNode *right = currNode->_right;
+        currNode->_right = nullptr;
+        return right;
+    }
+
+    currNode->_left = removeMin(currNode->_left, min);
+
+    return rebalance(currNode);
+}
+
+/**
+ * Loads a .csv file like loadData(), but on several threads. The file is cut into
+ * line aligned chunks that are parsed in parallel, the accounts are split into
+ * username ranges that are each built into their own subtree, and the subtrees
+ * are stitched into one balanced tree. The result holds the same accounts as
+ * loadData(), and a malformed file throws before the tree is touched.
+ * @param infile path to .csv file containing database of accounts
+ * @param numThreads threads to use, DEFAULT_LOAD_THREADS for one per hardware thread
+ * @param append true to append to an existing tree structure or false to clear before importing
+ */
+void UTree::loadDataParallel(string infile, int numThreads, bool append) {
+    checkInPlace(__FUNCTION__);
+
+    MappedFile file(infile);
+
+    if (!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << infile << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    if (numThreads <= 0) { numThreads = std::max(1u, std::thread::hardware_concurrency()); }
+
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+
+    // returns the start of the first line at or after pos
+    auto lineStart = [begin, end](const char *pos) {
+        if (pos <= begin || pos >= end || pos[-1] == '\n') { return pos; }
+        const char *newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        return newline ? newline + 1 : end;
+    };
+
+    // cut the file into one chunk of whole lines per thread
+    std::vector<const char*> bounds(numThreads + 1, end);
+    bounds[0] = begin;
+    for (int i = 1; i < numThreads; i++) {
+        bounds[i] = std::max(bounds[i - 1], lineStart(begin + file.size() * i / numThreads));
+    }
+
+    // sample usernames across the file and pick evenly spaced splitters, so that
+    // partition p holds the usernames in [splitters[p - 1], splitters[p])
+    std::vector<string> splitters;
+    int numSamples = numThreads * LOAD_SAMPLES_PER_THREAD;
+
+    for (int i = 0; i < numSamples && numThreads > 1; i++) {
+        const char *pos = lineStart(begin + file.size() * i / numSamples);
+        const char *stop = pos;
+
+        while (stop < end && *stop != ',' && *stop != '\n') { stop++; }
+        if (stop > pos) { splitters.push_back(string(pos, stop - pos)); }
+    }
+
+    std::sort(splitters.begin(), splitters.end());
+    splitters.erase(std::unique(splitters.begin(), splitters.end()), splitters.end());
+
+    if (!splitters.empty()) {
+        std::vector<string> picked;
+        for (int i = 1; i < numThreads; i++) { picked.push_back(splitters[splitters.size() * i / numThreads]); }
+        picked.erase(std::unique(picked.begin(), picked.end()), picked.end());
+        splitters.swap(picked);
+    }
+
+    int numParts = splitters.size() + 1;
+    auto partOf = [&splitters](const string& username) {
+        return int(std::upper_bound(splitters.begin(), splitters.end(), username) - splitters.begin());
+    };
+
+    // parse every chunk, keeping its accounts bucketed by partition in file order
+    std::vector<std::vector<std::vector<Account>>> rows(numThreads, std::vector<std::vector<Account>>(numParts));
+    std::vector<std::exception_ptr> errors(numThreads);
+    std::vector<std::thread> workers;
+
+    for (int c = 0; c < numThreads; c++) {
+        workers.emplace_back([&, c]() {
+            try {
+                parseRows(bounds[c], bounds[c + 1], [&](Account acct) {
+                    rows[c][partOf(acct.getUsername())].push_back(std::move(acct));
+                });
+            } catch (...) {
+                errors[c] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& worker : workers) { worker.join(); }
+    workers.clear();
+
+    // report the earliest malformed line, as the serial loader would
+    for (std::exception_ptr& error : errors) {
+        if (error) { std::rethrow_exception(error); }
+    }
+
+    // hand the nodes already in the tree to the partitions covering them
+    std::vector<UNode*> existing;
+
+    if (!append) { this->clear(); }
+    collectNodes(this->_root, existing);
+    this->_root = nullptr;
+
+    std::vector<size_t> existingBounds(numParts + 1, existing.size());
+    existingBounds[0] = 0;
+    for (int p = 1; p < numParts; p++) {
+        existingBounds[p] = std::lower_bound(existing.begin(), existing.end(), splitters[p - 1],
+            [](UNode *node, const string& username) { return node->getUsername() < username; }) - existing.begin();
+    }
+
+    // build each partition's subtree; chunks are replayed in file order so the
+    // first copy of a duplicate account wins, exactly like inserting row by row
+    std::vector<std::vector<UNode*>> parts(numParts);
+
+    for (int p = 0; p < numParts; p++) {
+        workers.emplace_back([&, p]() {
+            UTree local;
+
+            if (existingBounds[p] == existingBounds[p + 1]) {
+                // nothing to merge with, so the range can be bulk loaded
+                std::vector<Account> accts;
+
+                for (int c = 0; c < numThreads; c++) {
+                    std::move(rows[c][p].begin(), rows[c][p].end(), std::back_inserter(accts));
+                    std::vector<Account>().swap(rows[c][p]);
+                }
+
+                local.bulkLoad(accts);
+            } else {
+                local._root = buildBalanced(existing.data() + existingBounds[p], existingBounds[p + 1] - existingBounds[p]);
+                for (int c = 0; c < numThreads; c++) {
+                    for (Account& acct : rows[c][p]) { local.insert(std::move(acct)); }
+                    std::vector<Account>().swap(rows[c][p]);
+                }
+            }
+
+            collectNodes(local._root, parts[p]);
+            local._root = nullptr;
+        });
+    }
+    for (std::thread& worker : workers) { worker.join(); }
+
+    // the partitions cover increasing username ranges, so laying them end to
+    // end gives every node in order
+    std::vector<UNode*> nodes;
+    for (std::vector<UNode*>& part : parts) { nodes.insert(nodes.end(), part.begin(), part.end()); }
+
+    this->_root = buildBalanced(nodes.data(), nodes.size());
+
+    if (this->_index) {
+        this->_index->clear();
+        indexNodes(this->_root);
+    }
+    if (this->_filter) { rebuildFilter(); }
+
+    if (this->_log) { checkpoint(); }
+
+    return;
+}
+
+/**
+ * Writes every account in the tree to a binary snapshot (see snapshot.h) that
+ * loadSnapshot() can restore far faster than re-parsing a .csv file.
+ * @param path path of the snapshot, replaced only once the new one is complete
+ * @param version SNAPSHOT_VERSION_COMPRESSED, or SNAPSHOT_VERSION_PLAIN for older readers
+ * @return true if the snapshot was written, false otherwise
+ */
+bool UTree::saveSnapshot(string path, int version) const {
+    SnapshotWriter writer(path);
+    std::vector<UNode*> nodes;
+
+    if (version != SNAPSHOT_VERSION_PLAIN && version != SNAPSHOT_VERSION_COMPRESSED) {
+        throw std::invalid_argument("Unsupported snapshot version " + std::to_string(version));
+    }
+    if (!writer.isOpen()) { return false; }
+
+    collectNodes(this->_root, nodes);
+
+    writer.putBytes(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    writer.putU32(version);
+
+    if (version == SNAPSHOT_VERSION_PLAIN) { writeSnapshotPlain(writer, nodes); }
+    else { writeSnapshotCompressed(writer, nodes); }
+
+    return writer.commit();
+}
+
+/**
+ * Streams every account in the tree to a sink, through one large buffer that is
+ * handed over only when full, so a dump of millions of accounts costs a few
+ * hundred writes instead of a flush per line.
+ * @param sink where the export goes
+ * @param format EXPORT_CSV for lines loadData() reads back, EXPORT_BINARY for a
+ *               snapshot loadSnapshot() reads back
+ * @return true if the sink took everything, false otherwise
+ */
+bool UTree::exportTo(ExportSink& sink, int format) const {
+    std::vector<UNode*> nodes;
+
+    if (format != EXPORT_CSV && format != EXPORT_BINARY) {
+        throw std::invalid_argument("Unsupported export format " + std::to_string(format));
+    }
+
+    collectNodes(this->_root, nodes);
+
+    if (format == EXPORT_CSV) { return exportCsv(sink, nodes); }
+
+    SnapshotWriter writer(sink);
+
+    writer.putBytes(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    writer.putU32(SNAPSHOT_VERSION);
+    writeSnapshotCompressed(writer, nodes);
+
+    return writer.commit();
+}
+
+// preconditions: nodes holds the tree's UNodes in username order
+// postconditions: every account is written to sink as a "username,disc,nitro,badge,status"
+//                 line; returns false as soon as the sink refuses a buffer
+bool UTree::exportCsv(ExportSink& sink, const std::vector<UNode*>& nodes) {
+    std::vector<char> buffer(EXPORT_BUFFER_SIZE);
+    char *out = buffer.data();
+    char *bufferEnd = buffer.data() + buffer.size();
+    bool ok = true;
+
+    // fields are copied in without any per line bookkeeping; a field longer
+    // than what is left of the buffer is split across as many buffers as it takes
+    auto put = [&](const char *data, size_t size) {
+        while (ok && size > (size_t)(bufferEnd - out)) {
+            size_t room = bufferEnd - out;
+            memcpy(out, data, room);
+            data += room;
+            size -= room;
+            ok = sink.write(buffer.data(), buffer.size());
+            out = buffer.data();
+        }
+        if (ok) {
+            memcpy(out, data, size);
+            out += size;
+        }
+    };
+
+    for (UNode *node : nodes) {
+        node->_dtree->forEachAccount([&](const Account& acct) {
+            char number[8];
+            char *numberEnd = std::to_chars(number, number + sizeof(number), acct.getDiscriminator()).ptr;
+
+            put(acct.getUsername().data(), acct.getUsername().size());
+            put(",", 1);
+            put(number, numberEnd - number);
+            put(acct.hasNitro() ? ",1," : ",0,", 3);
+            put(acct.getBadge().data(), acct.getBadge().size());
+            put(",", 1);
+            put(acct.getStatus().data(), acct.getStatus().size());
+            put("\n", 1);
+        });
+
+        if (!ok) { return false; }
+    }
+
+    if (out != buffer.data()) { ok = sink.write(buffer.data(), out - buffer.data()); }
+
+    return ok;
+}
+
+// preconditions: the snapshot's magic and version have been written
+// postconditions: the nodes' accounts are written in the SNAPSHOT_VERSION_PLAIN layout
+void UTree::writeSnapshotPlain(SnapshotWriter& writer, const std::vector<UNode*>& nodes) {
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> strings;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> fieldIds;
+
+    // every username, badge and status is stored once in the string table and
+    // referred to by its position in it. views stay valid while the tree is unchanged
+    auto intern = [&ids, &strings](const string& str) {
+        auto found = ids.emplace(std::string_view(str), strings.size());
+        if (found.second) { strings.push_back(str); }
+        return found.first->second;
+    };
+
+    for (UNode *node : nodes) {
+        uint32_t count = 0;
+
+        node->_dtree->forEachAccount([&](const Account& acct) {
+            if (count++ == 0) { fieldIds.push_back(intern(acct.getUsername())); }
+            fieldIds.push_back(intern(acct.getBadge()));
+            fieldIds.push_back(intern(acct.getStatus()));
+        });
+
+        counts.push_back(count);
+    }
+
+    writer.putU32(strings.size());
+    writer.putU64(nodes.size());
+    writer.putU64((fieldIds.size() - nodes.size()) / 2);
+
+    for (std::string_view str : strings) {
+        writer.putU32(str.size());
+        writer.putBytes(str.data(), str.size());
+    }
+
+    uint32_t *fieldId = fieldIds.data();
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        writer.putU32(*fieldId++);
+        writer.putU32(counts[i]);
+
+        nodes[i]->_dtree->forEachAccount([&](const Account& acct) {
+            writer.putU16(acct.getDiscriminator());
+            writer.putU8(acct.hasNitro());
+            writer.putU32(*fieldId++);
+            writer.putU32(*fieldId++);
+        });
+    }
+
+    return;
+}
+
+// preconditions: the snapshot's magic and version have been written
+// postconditions: the nodes' accounts are written in the SNAPSHOT_VERSION_COMPRESSED layout
+void UTree::writeSnapshotCompressed(SnapshotWriter& writer, const std::vector<UNode*>& nodes) {
+    std::vector<std::vector<const Account*>> accounts(nodes.size());
+    std::unordered_map<std::string_view, uint64_t> uses;
+    uint64_t numAccounts = 0;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i]->_dtree->forEachAccount([&](const Account& acct) {
+            accounts[i].push_back(&acct);
+            uses[acct.getBadge()]++;
+            uses[acct.getStatus()]++;
+        });
+        numAccounts += accounts[i].size();
+    }
+
+    // badges and statuses repeat endlessly, so they are dictionary encoded with the
+    // most used values first, where their ids fit in a single varint byte
+    std::vector<std::pair<std::string_view, uint64_t>> values(uses.begin(), uses.end());
+    std::sort(values.begin(), values.end(), [](const std::pair<std::string_view, uint64_t>& a,
+                                               const std::pair<std::string_view, uint64_t>& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    });
+
+    std::unordered_map<std::string_view, uint32_t> ids;
+    for (size_t i = 0; i < values.size(); i++) { ids[values[i].first] = i; }
+
+    writer.putU64(nodes.size());
+    writer.putU64(numAccounts);
+    writer.putVarint(values.size());
+
+    for (const std::pair<std::string_view, uint64_t>& value : values) {
+        writer.putVarint(value.first.size());
+        writer.putBytes(value.first.data(), value.first.size());
+    }
+
+    std::string_view previous;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const std::vector<const Account*>& run = accounts[i];
+        std::string_view username = run.front()->getUsername();
+
+        // sorted usernames share long prefixes, so only the new suffix is stored
+        size_t shared = 0;
+        while (shared < previous.size() && shared < username.size() && previous[shared] == username[shared]) { shared++; }
+
+        writer.putVarint(shared);
+        writer.putVarint(username.size() - shared);
+        writer.putBytes(username.data() + shared, username.size() - shared);
+        previous = username;
+
+        // discriminators ascend, so each is stored as the gap from the one before
+        writer.putVarint(run.size());
+
+        int last = -1;
+        for (const Account *acct : run) {
+            writer.putVarint(acct->getDiscriminator() - last - 1);
+            last = acct->getDiscriminator();
+        }
+
+        for (size_t j = 0; j < run.size(); j += 8) {
+            uint8_t bits = 0;
+            for (size_t k = j; k < run.size() && k < j + 8; k++) { bits |= run[k]->hasNitro() << (k - j); }
+            writer.putU8(bits);
+        }
+
+        for (const Account *acct : run) { writer.putVarint(ids[acct->getBadge()]); }
+        for (const Account *acct : run) { writer.putVarint(ids[acct->getStatus()]); }
+    }
+
+    return;
+}
+
+/**
+ * Replaces the tree's contents with a snapshot written by saveSnapshot(). The
+ * snapshot is read front to back and built bottom up in linear time, and a
+ * corrupt or unsupported snapshot throws before the tree is touched.
+ * @param path path of the snapshot
+ */
+void UTree::loadSnapshot(string path) {
+    checkInPlace(__FUNCTION__);
+
+    MappedFile file(path);
+
+    if (!file.isOpen()) {
+        std::cerr << __FUNCTION__ << ": File " << path << " could not be opened or located" << endl;
+        exit(-1);
+    }
+
+    // check the whole file before believing any count in it
+    if (file.size() < SNAPSHOT_MAGIC_SIZE + SNAPSHOT_FOOTER_SIZE) {
+        throw std::invalid_argument("Malformed snapshot detected - file is too short");
+    }
+
+    size_t bodySize = file.size() - SNAPSHOT_FOOTER_SIZE;
+    SnapshotReader footer(file.data() + bodySize, SNAPSHOT_FOOTER_SIZE);
+
+    if (snapshotChecksum(file.data(), bodySize) != footer.getU64()) {
+        throw std::invalid_argument("Malformed snapshot detected - checksum mismatch");
+    }
+
+    SnapshotReader reader(file.data(), bodySize);
+
+    if (reader.getBytes(SNAPSHOT_MAGIC_SIZE) != std::string_view(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE)) {
+        throw std::invalid_argument("Malformed snapshot detected - not a snapshot file");
+    }
+
+    uint32_t version = reader.getU32();
+    if (version != SNAPSHOT_VERSION_PLAIN && version != SNAPSHOT_VERSION_COMPRESSED) {
+        throw std::invalid_argument("Unsupported snapshot version " + std::to_string(version));
+    }
+
+    // usernames and discriminators are stored sorted, so each username's accounts
+    // become a balanced DTree and the UNodes a balanced UTree without any searching
+    std::vector<UNode*> nodes;
+
+    try {
+        if (version == SNAPSHOT_VERSION_PLAIN) { readSnapshotPlain(reader, nodes); }
+        else { readSnapshotCompressed(reader, nodes); }
+
+        if (reader.remaining() != 0) {
+            throw std::invalid_argument("Malformed snapshot detected - counts do not match");
+        }
+    } catch (...) {
+        for (UNode *node : nodes) { delete node; }
+        throw;
+    }
+
+    this->clear();
+    this->_root = buildBalanced(nodes.data(), nodes.size());
+
+    if (this->_index) {
+        indexNodes(this->_root);
+    }
+    if (this->_filter) { rebuildFilter(); }
+
+    if (this->_log) { checkpoint(); }
+
+    return;
+}
+
+// preconditions: the snapshot's magic and SNAPSHOT_VERSION_PLAIN have been read
+// postconditions: a UNode is appended to nodes for each username, in order, or
+//                 std::invalid_argument is thrown
+void UTree::readSnapshotPlain(SnapshotReader& reader, std::vector<UNode*>& nodes) {
+    uint32_t numStrings = reader.getU32();
+    uint64_t numUsernames = reader.getU64();
+    uint64_t numAccounts = reader.getU64();
+    std::vector<std::string_view> strings;
+
+    // every string takes at least its length, so a bigger count can't be honest
+    if (numStrings > reader.remaining() / sizeof(uint32_t)) {
+        throw std::invalid_argument("Malformed snapshot detected - bad string count");
+    }
+
+    strings.reserve(numStrings);
+    for (uint32_t i = 0; i < numStrings; i++) {
+        strings.push_back(reader.getBytes(reader.getU32()));
+    }
+
+    auto lookup = [&strings](uint32_t id) {
+        if (id >= strings.size()) { throw std::invalid_argument("Malformed snapshot detected - bad string id"); }
+        return strings[id];
+    };
+
+    std::vector<Account> accts;
+    std::string_view previous;
+    uint64_t accountsRead = 0;
+
+    for (uint64_t i = 0; i < numUsernames; i++) {
+        std::string_view username = lookup(reader.getU32());
+        uint32_t count = reader.getU32();
+
+        if (count == 0 || (i > 0 && username <= previous)) {
+            throw std::invalid_argument("Malformed snapshot detected - usernames out of order");
+        }
+
+        accts.clear();
+        for (uint32_t j = 0; j < count; j++) {
+            int disc = reader.getU16();
+            bool nitro = reader.getU8();
+            std::string_view badge = lookup(reader.getU32());
+            std::string_view status = lookup(reader.getU32());
+
+            if (!accts.empty() && disc <= accts.back().getDiscriminator()) {
+                throw std::invalid_argument("Malformed snapshot detected - discriminators out of order");
+            }
+
+            accts.push_back(Account(username, disc, nitro, badge, status));
+        }
+
+        UNode *node = new UNode();
+        nodes.push_back(node);
+        node->assign(accts.data(), accts.size());
+        accountsRead += count;
+        previous = username;
+    }
+
+    if (accountsRead != numAccounts) {
+        throw std::invalid_argument("Malformed snapshot detected - counts do not match");
+    }
+
+    return;
+}
+
+// preconditions: the snapshot's magic and SNAPSHOT_VERSION_COMPRESSED have been read
+// postconditions: a UNode is appended to nodes for each username, in order, or
+//                 std::invalid_argument is thrown
+void UTree::readSnapshotCompressed(SnapshotReader& reader, std::vector<UNode*>& nodes) {
+    uint64_t numUsernames = reader.getU64();
+    uint64_t numAccounts = reader.getU64();
+    uint64_t numValues = reader.getVarint();
+    std::vector<std::string_view> values;
+
+    // every value takes at least its length byte, so a bigger count can't be honest
+    if (numValues > reader.remaining()) {
+        throw std::invalid_argument("Malformed snapshot detected - bad value count");
+    }
+
+    values.reserve(numValues);
+    for (uint64_t i = 0; i < numValues; i++) {
+        values.push_back(reader.getBytes(reader.getVarint()));
+    }
+
+    // each column of a username's accounts is decoded in one pass into these
+    std::vector<uint32_t> discs, badges, statuses;
+    std::vector<Account> accts;
+    string username;
+    uint64_t accountsRead = 0;
+
+    for (uint64_t i = 0; i < numUsernames; i++) {
+        uint64_t shared = reader.getVarint();
+        uint64_t suffixLength = reader.getVarint();
+
+        if (shared > username.size()) {
+            throw std::invalid_argument("Malformed snapshot detected - bad username prefix");
+        }
+
+        std::string_view suffix = reader.getBytes(suffixLength);
+        if (i > 0 && (suffix.empty() || std::string_view(username).substr(shared) >= suffix)) {
+            throw std::invalid_argument("Malformed snapshot detected - usernames out of order");
+        }
+
+        username.resize(shared);
+        username.append(suffix);
+
+        uint64_t count = reader.getVarint();
+        if (count == 0 || count > MAX_DISC - MIN_DISC + 1) {
+            throw std::invalid_argument("Malformed snapshot detected - bad account count");
+        }
+
+        discs.resize(count);
+        badges.resize(count);
+        statuses.resize(count);
+
+        reader.getVarints(discs.data(), count);
+        std::string_view nitro = reader.getBytes((count + 7) / 8);
+        reader.getVarints(badges.data(), count);
+        reader.getVarints(statuses.data(), count);
+
+        // undo the gap encoding with a running sum
+        uint64_t disc = MIN_DISC - 1;
+        for (uint64_t j = 0; j < count; j++) {
+            disc += (uint64_t)discs[j] + 1;
+            discs[j] = disc;
+        }
+        if (disc > MAX_DISC) {
+            throw std::invalid_argument("Malformed snapshot detected - discriminator out of range");
+        }
+
+        accts.clear();
+        for (uint64_t j = 0; j < count; j++) {
+            if (badges[j] >= values.size() || statuses[j] >= values.size()) {
+                throw std::invalid_argument("Malformed snapshot detected - bad value id");
+            }
+
+            bool hasNitro = (nitro[j / 8] >> (j % 8)) & 1;
+            accts.push_back(Account(username, discs[j], hasNitro, values[badges[j]], values[statuses[j]]));
+        }
+
+        UNode *node = new UNode();
+        nodes.push_back(node);
+        node->assign(accts.data(), accts.size());
+        accountsRead += count;
+    }
+
+    if (accountsRead != numAccounts) {
+        throw std::invalid_argument("Malformed snapshot detected - counts do not match");
+    }
+
+    return;
+}
+
+/**
+ * Writes the tree as an image (see uimage.h) that UImage can map and query in
+ * place without loading it.
+ * @param path path of the image, replaced only once the new one is complete
+ * @return true if the image was written, false otherwise
+ */
+bool UTree::saveImage(string path) const {
+    SnapshotWriter writer(path);
+    std::vector<UNode*> nodes;
+    std::unordered_map<std::string_view, uint64_t> offsets;
+    std::vector<std::string_view> strings;
+    uint64_t stringBytes = 0;
+    std::vector<uint32_t> counts;
+    std::vector<uint64_t> fieldOffsets;
+
+    if (!writer.isOpen()) { return false; }
+
+    // strings are stored once each and referred to by their offset in the string area
+    auto intern = [&](const string& str) {
+        auto found = offsets.emplace(std::string_view(str), stringBytes);
+        if (found.second) {
+            strings.push_back(str);
+            stringBytes += str.size();
+        }
+        return found.first->second;
+    };
+
+    collectNodes(this->_root, nodes);
+
+    for (UNode *node : nodes) {
+        uint32_t count = 0;
+
+        node->_dtree->forEachAccount([&](const Account& acct) {
+            if (count++ == 0) { fieldOffsets.push_back(intern(acct.getUsername())); }
+            fieldOffsets.push_back(intern(acct.getBadge()));
+            fieldOffsets.push_back(intern(acct.getStatus()));
+        });
+
+        counts.push_back(count);
+    }
+
+    uint64_t numAccounts = (fieldOffsets.size() - nodes.size()) / 2;
+    uint64_t nodeBase = sizeof(ImageHeader);
+    uint64_t accountBase = nodeBase + nodes.size() * sizeof(ImageUNode);
+    uint64_t stringBase = accountBase + numAccounts * sizeof(ImageAccount);
+
+    // the nodes are written in username order and linked as a perfectly balanced
+    // tree, the same shape buildBalanced() gives
+    std::vector<uint64_t> left(nodes.size(), IMAGE_NO_NODE);
+    std::vector<uint64_t> right(nodes.size(), IMAGE_NO_NODE);
+    std::function<uint64_t(size_t, size_t)> link = [&](size_t first, size_t count) -> uint64_t {
+        if (count == 0) { return IMAGE_NO_NODE; }
+
+        size_t mid = first + count / 2;
+        left[mid] = link(first, count / 2);
+        right[mid] = link(mid + 1, count - count / 2 - 1);
+
+        return nodeBase + mid * sizeof(ImageUNode);
+    };
+    uint64_t root = link(0, nodes.size());
+
+    writer.putBytes(IMAGE_MAGIC, IMAGE_MAGIC_SIZE);
+    writer.putU32(IMAGE_VERSION);
+    writer.putU32(IMAGE_BYTE_ORDER);
+    writer.putU64(nodes.size());
+    writer.putU64(numAccounts);
+    writer.putU64(root);
+    writer.putU64(stringBase + stringBytes + SNAPSHOT_FOOTER_SIZE);
+
+    uint64_t accountOffset = accountBase;
+    uint64_t *fieldOffset = fieldOffsets.data();
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        writer.putU64(left[i]);
+        writer.putU64(right[i]);
+        writer.putU64(stringBase + *fieldOffset);
+        writer.putU64(accountOffset);
+        writer.putU32(nodes[i]->getUsername().size());
+        writer.putU32(counts[i]);
+
+        fieldOffset += 1 + 2 * counts[i];
+        accountOffset += counts[i] * sizeof(ImageAccount);
+    }
+
+    fieldOffset = fieldOffsets.data();
+
+    for (UNode *node : nodes) {
+        fieldOffset++;
+
+        node->_dtree->forEachAccount([&](const Account& acct) {
+            writer.putU64(stringBase + *fieldOffset++);
+            writer.putU64(stringBase + *fieldOffset++);
+            writer.putU32(acct.getBadge().size());
+            writer.putU32(acct.getStatus().size());
+            writer.putU16(acct.getDiscriminator());
+            writer.putU8(acct.hasNitro());
+            for (size_t i = 0; i < sizeof(ImageAccount().padding); i++) { writer.putU8(0); }
+        });
+    }
+
+    for (std::string_view str : strings) {
+        writer.putBytes(str.data(), str.size());
+    }
+
+    return writer.commit();
+}
+
+// preconditions: path may or may not hold a snapshot
+// postconditions: the checksum a log following the snapshot records is returned,
+//                 LOG_NO_BASE if there is no snapshot
+static uint64_t snapshotBase(const string& path) {
+    MappedFile file(path);
+
+    if (!file.isOpen() || file.size() < SNAPSHOT_FOOTER_SIZE) { return LOG_NO_BASE; }
+
+    SnapshotReader footer(file.data() + file.size() - SNAPSHOT_FOOTER_SIZE, SNAPSHOT_FOOTER_SIZE);
+    return footer.getU64();
+}
+
+/**
+ * Replaces the tree's contents with the latest snapshot plus every mutation logged
+ * after it, then logs every insert(), removeUser() and clear() from here on.
+ * @param snapshotPath snapshot to start from (it need not exist yet), and where
+ *                     checkpoint() saves to
+ * @param logPath write-ahead log to replay and then append to
+ * @param syncPolicy LOG_SYNC_NONE, LOG_SYNC_ALWAYS or LOG_SYNC_BATCH
+ */
+void UTree::recover(string snapshotPath, string logPath, int syncPolicy) {
+    disableLog();
+
+    uint64_t base = snapshotBase(snapshotPath);
+
+    if (base != LOG_NO_BASE) { loadSnapshot(snapshotPath); }
+    else { clear(); }
+
+    // a log left over from before the snapshot was taken has a different base and
+    // is skipped; everything in it is already in the snapshot
+    ULog::replay(logPath, base, [this](int op, Account& acct) {
+        DNode *removed = nullptr;
+
+        if (op == LOG_OP_INSERT) {
+            this->insert(acct);
+        } else if (op == LOG_OP_REMOVE && this->removeUser(acct.getUsername(), acct.getDiscriminator(), removed)) {
+            delete removed;
+        } else if (op == LOG_OP_CLEAR) {
+            this->clear();
+        }
+    });
+
+    this->_snapshotPath = snapshotPath;
+    this->_log = new ULog(logPath, base, syncPolicy);
+
+    if (!this->_log->isOpen()) {
+        disableLog();
+        throw std::runtime_error("Write-ahead log " + logPath + " could not be opened");
+    }
+
+    return;
+}
+
+/**
+ * Saves a snapshot and starts a new, empty log after it, so recovery only has to
+ * replay what happens from now on.
+ * @return true if the snapshot was saved and the log restarted, false otherwise
+ */
+bool UTree::checkpoint() {
+    if (!this->_log || !saveSnapshot(this->_snapshotPath)) { return false; }
+
+    string logPath = this->_log->getPath();
+    int syncPolicy = this->_log->getSyncPolicy();
+
+    // until the new log is written, the old one is simply ignored by recover()
+    // because it follows the previous snapshot
+    disableLog();
+    this->_log = new ULog(logPath, snapshotBase(this->_snapshotPath), syncPolicy);
+
+    if (!this->_log->isOpen()) {
+        disableLog();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Makes every logged mutation durable, whatever the sync policy.
+ */
+void UTree::syncLog() {
+    if (this->_log) { this->_log->sync(); }
+
+    return;
+}
+
+/**
+ * Syncs and closes the log. Mutations are no longer logged.
+ */
+void UTree::disableLog() {
+    delete this->_log;
+    this->_log = nullptr;
+
+    return;
+}
+
+// preconditions: nodes is empty or holds the nodes of trees ordered before this one
+// postconditions: the subtree's nodes are appended to nodes in order
+void UTree::collectNodes(UNode *currNode, std::vector<UNode*>& nodes) {
+    UNode *stack[MAX_UTREE_DEPTH];
+    int top = 0;
+
+    while (currNode || top > 0) {
+        for (; currNode; currNode = currNode->_left) { stack[top++] = currNode; }
+
+        currNode = stack[--top];
+        nodes.push_back(currNode);
+        currNode = currNode->_right;
+    }
+
+    return;
+}
+
+// preconditions: nodes holds count UNodes in username order
+// postconditions: the nodes are linked into a perfectly balanced tree with correct
+//                 heights, and its root is returned
+UNode* UTree::buildBalanced(UNode **nodes, int count) {
+    if (count <= 0) { return nullptr; }
+
+    int mid = count / 2;
+    UNode *root = nodes[mid];
+
+    root->_left = buildBalanced(nodes, mid);
+    root->_right = buildBalanced(nodes + mid + 1, count - mid - 1);
+    root->calcNodeHeight();
+
+    return root;
+}
+
+/**
+ * Builds a hash index over the usernames currently in the tree. From then on
+ * retrieve(), retrieveUser() and numUsers() are answered from the index and it
+ * is kept in sync by insert() and removeUser().
+ */
+void UTree::enableHashIndex() {
+    // lock-free reads replace UNodes on every write, which the index cannot follow
+    if (this->_index || this->_epoch) { return; }
+
+    this->_index = new UHashIndex();
+    indexNodes(this->_root);
+
+    return;
+}
+
+/**
+ * Drops the hash index, returning all lookups to the tree.
+ */
+void UTree::disableHashIndex() {
+    // concurrent mode finds every UNode through the index
+    if (this->_concurrent) { return; }
+
+    delete this->_index;
+    this->_index = nullptr;
+
+    return;
+}
+
+/**
+ * Builds a Bloom filter over the usernames currently in the tree. From then on
+ * retrieve(), retrieveUser(), numUsers() and the batched and coroutine lookups
+ * return at once for most usernames that are not in the tree, and insert() and
+ * removeUser() keep the filter up to date, rebuilding it as it fills or goes stale.
+ */
+void UTree::enableFilter() {
+    // as with the hash index, lock-free writes would race with readers of the filter
+    if (this->_filter || this->_epoch) { return; }
+
+    std::unique_lock<std::shared_mutex> exclusive(this->_treeLock, std::defer_lock);
+    if (this->_concurrent) { exclusive.lock(); }
+
+    this->_filter = new UFilter();
+    rebuildFilter();
+
+    return;
+}
+
+/**
+ * Drops the Bloom filter, returning every lookup to the tree.
+ */
+void UTree::disableFilter() {
+    std::unique_lock<std::shared_mutex> exclusive(this->_treeLock, std::defer_lock);
+    if (this->_concurrent) { exclusive.lock(); }
+
+    delete this->_filter;
+    this->_filter = nullptr;
+
+    return;
+}
+
+// preconditions: the filter is enabled, and in concurrent mode the shared lock is held
+// postconditions: the UNode with a matching username is returned, else nullptr, with
+//                 the tree left unsearched if the filter rules the username out
+UNode* UTree::findFiltered(const string& username) const {
+    if (!this->_filter->mayContain(username)) { return nullptr; }
+
+    UNode *found = (this->_index) ? this->_index->find(username) : findNode(this->_root, username);
+    if (!found) { this->_filter->noteFalsePositive(); }
+
+    return found;
+}
+
+// preconditions: the filter is enabled and a UNode with this username was linked in
+// postconditions: the username is in the filter, which is rebuilt larger if it is full
+void UTree::filterAdd(const string& username) {
+    this->_filter->add(username);
+    if (this->_filter->needsRebuild()) { rebuildFilter(); }
+
+    return;
+}
+
+// preconditions: the filter is enabled and count UNodes were taken out of the tree
+// postconditions: they are counted as stale, and the filter is rebuilt once most are
+void UTree::filterRemoved(size_t count) {
+    this->_filter->noteRemoved(count);
+    if (this->_filter->needsRebuild()) { rebuildFilter(); }
+
+    return;
+}
+
+// preconditions: the filter is enabled
+// postconditions: the filter holds exactly the usernames in the tree, with room for
+//                 as many again
+void UTree::rebuildFilter() {
+    std::vector<UNode*> nodes;
+    collectNodes(this->_root, nodes);
+
+    this->_filter->reset(2 * nodes.size());
+    for (UNode *node : nodes) { this->_filter->add(node->getUsername()); }
+
+    return;
+}
+
+/**
+ * Puts a CLOCK cache of recently retrieved accounts in front of retrieveUser(), so
+ * that repeated lookups of the same hot accounts skip the UTree and DTree walks.
+ * removeUser() drops the account it vacates, batches drop the usernames whose
+ * DTrees they rebuild, split() drops the usernames it moves out, and clear() drops
+ * everything. Rebalancing, merging and findReplacement() keep every DNode but
+ * vacant ones, which are never cached. Lookups fill the cache, so it is single threaded: it is not available
+ * in concurrent mode or with lock-free reads, and switching to either drops it.
+ * @param capacity number of accounts to cache
+ */
+void UTree::enableCache(size_t capacity) {
+    if (this->_cache || this->_concurrent || this->_epoch) { return; }
+
+    this->_cache = new UCache(capacity);
+
+    return;
+}
+
+/**
+ * Drops the account cache, returning retrieveUser() to the tree.
+ */
+void UTree::disableCache() {
+    delete this->_cache;
+    this->_cache = nullptr;
+
+    return;
+}
+
+// preconditions: the cache is enabled
+// postconditions: the DNode with a matching username and discriminator is returned,
+//                 else nullptr, from the cache if it is there and otherwise from the
+//                 tree, caching what the tree had
+DNode* UTree::retrieveCached(const string& username, int disc) {
+    DNode *found = this->_cache->find(username, disc);
+    if (found) { return found; }
+
+    UNode *node = (this->_filter) ? findFiltered(username)
+                : (this->_index) ? this->_index->find(username) : findNode(this->_root, username);
+    found = (node) ? node->findDisc(disc) : nullptr;
+
+    if (found) { this->_cache->fill(username, disc, found); }
+
+    return found;
+}
+
+/**
+ * Starts handing out stable handles to accounts through getHandle(). A handle
+ * resolves through deref() in O(1) to whichever DNode holds its account, across
+ * rebalances and batches rebuilding its DTree, until the account is removed or leaves the tree; then it stays invalid, even
+ * if the account comes back. Writers repoint the handles they move, so like the
+ * cache this is single threaded: it is not available in concurrent mode or with
+ * lock-free reads, and switching to either drops every handle.
+ */
+void UTree::enableHandles() {
+    if (this->_handles || this->_concurrent || this->_epoch) { return; }
+
+    this->_handles = new UHandleTable();
+
+    return;
+}
+
+/**
+ * Drops every handle; handed out ones no longer resolve.
+ */
+void UTree::disableHandles() {
+    delete this->_handles;
+    this->_handles = nullptr;
+
+    return;
+}
+
+/**
+ * Returns the stable handle of an account, see enableHandles().
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return the account's handle, the same each time while it stays, or a handle
+ *         with generation INVALID_GENERATION if it is not in the tree
+ * @throws std::logic_error if handles are not enabled
+ */
+AccountHandle UTree::getHandle(string username, int disc) {
+    if (!this->_handles) { throw std::logic_error("Handles need enableHandles()"); }
+
+    UNode *node = (this->_index) ? this->_index->find(username) : findNode(this->_root, username);
+    DNode *found = (node) ? node->findDisc(disc) : nullptr;
+
+    return (found) ? this->_handles->acquire(username, found) : AccountHandle{0, INVALID_GENERATION};
+}
+
+// preconditions: handles are enabled and the username's DTree may have changed
+// postconditions: its handles point at its accounts' DNodes, and those of accounts
+//                 it no longer holds are retired
+void UTree::rebindHandles(const string& username) {
+    UNode *node = (this->_index) ? this->_index->find(username) : findNode(this->_root, username);
+    this->_handles->rebind(username, (node) ? node->_dtree : nullptr);
+
+    return;
+}
+
+/**
+ * Lets insert(), removeUser(), retrieve(), retrieveUser() and numUsers() be called
+ * from any number of threads at once. UNodes are found through the hash index
+ * (enabled here, and kept until concurrency is disabled) under a shared lock on
+ * the username level, and each UNode's DTree is guarded by its own lock, so work
+ * on different usernames proceeds in parallel. The username level is locked
+ * exclusively only to link in a new UNode or unlink an emptied one, along with
+ * the rotations that follow. Every other operation, and the switch itself, must
+ * not overlap with any other call. As before, a returned node stays valid only
+ * until its username is next changed.
+ */
+void UTree::enableConcurrency() {
+    disableLockFreeReads();
+    disableCache();
+    disableHandles();
+    enableHashIndex();
+    this->_concurrent = true;
+
+    return;
+}
+
+/**
+ * Returns to single threaded operation, keeping the hash index.
+ */
+void UTree::disableConcurrency() {
+    this->_concurrent = false;
+
+    return;
+}
+
+// preconditions: concurrent mode is on
+// postconditions: the account is inserted under the username's UNode lock, or under
+//                 the exclusive tree lock if the username is new; the log record is
+//                 appended under the same lock, so the log orders each username's
+//                 mutations the way they were applied, and committed after it is released
+bool UTree::insertConcurrent(Account& newAcct) {
+    uint64_t lsn = 0;
+    bool inserted = false;
+    bool done = false;
+
+    {
+        std::shared_lock<std::shared_mutex> shared(this->_treeLock);
+        UNode *found = this->_index->find(newAcct.getUsername());
+
+        if (found) {
+            std::lock_guard<std::mutex> guard(found->_lock);
+            if (this->_log) { lsn = this->_log->appendInsert(newAcct); }
+            inserted = found->insert(newAcct);
+            done = true;
+        }
+    }
+
+    // a new username changes the username level; whoever gets the exclusive lock
+    // first creates the UNode and anyone after them simply finds it
+    if (!done) {
+        std::unique_lock<std::shared_mutex> exclusive(this->_treeLock);
+        if (this->_log) { lsn = this->_log->appendInsert(newAcct); }
+        inserted = insertNode(newAcct);
+    }
+
+    if (this->_log) { this->_log->commit(lsn); }
+
+    return inserted;
+}
+
+// preconditions: concurrent mode is on
+// postconditions: the account is removed under its UNode's lock unless that would
+//                 empty the UNode, in which case it is removed under the exclusive
+//                 tree lock; the log is handled as in insertConcurrent()
+bool UTree::removeUserConcurrent(const string& username, int disc, DNode*& removed) {
+    uint64_t lsn = 0;
+    bool result = false;
+
+    {
+        std::shared_lock<std::shared_mutex> shared(this->_treeLock);
+        UNode *found = this->_index->find(username);
+
+        // nothing to remove means nothing to log either
+        if (!found) { return false; }
+
+        std::lock_guard<std::mutex> guard(found->_lock);
+        if (!found->findDisc(disc)) { return false; }
+
+        if (found->getNumUsers() > 1) {
+            if (this->_log) { lsn = this->_log->appendRemove(username, disc); }
+            result = found->remove(disc, removed);
+        }
+    }
+
+    // the last account of a username takes its UNode with it
+    if (!result) {
+        std::unique_lock<std::shared_mutex> exclusive(this->_treeLock);
+        if (this->_log) { lsn = this->_log->appendRemove(username, disc); }
+        result = removeNode(username, disc, removed);
+    }
+
+    if (this->_log) { this->_log->commit(lsn); }
+
+    return result;
+}
+
+/**
+ * Lets retrieve(), retrieveUser() and numUsers() run on any number of threads
+ * without taking a lock while one thread at a time calls insert() and removeUser().
+ * Those writes never change a node readers can reach: they copy the path down to
+ * the username and on through its DTree (rebuilding copies where a rebalance is
+ * due), rotate only copies, and publish the result with one atomic store of the
+ * root. The nodes they replace are freed through epoch based reclamation once no
+ * reader can hold them. A returned node stays valid while the caller holds a
+ * UEpochGuard on getEpoch(). clear() retires the whole tree the same way, while
+ * mergeFrom(), mergeSorted(), split(), join(), loadData() without append,
+ * loadDataParallel() and loadSnapshot(), which relink nodes in place, throw
+ * std::logic_error in this mode. Disables concurrent mode and the hash index; every
+ * other operation, and the switch itself, must not overlap with readers.
+ */
+void UTree::enableLockFreeReads() {
+    if (this->_epoch) { return; }
+
+    disableConcurrency();
+    disableHashIndex();
+    disableFilter();
+    disableCache();
+    disableHandles();
+    this->_epoch = new UEpoch();
+
+    return;
+}
+
+/**
+ * Returns writes to updating the tree in place, freeing every retired node.
+ */
+void UTree::disableLockFreeReads() {
+    disablePersistence();
+    delete this->_epoch;
+    this->_epoch = nullptr;
+
+    return;
+}
+
+/**
+ * Keeps every version insert() and removeUser() publish readable: snapshot() hands
+ * out the current one, which stays intact while writes go on, and what each write
+ * replaces is only freed once no snapshot from before it is left. Every write adds
+ * O(log n) new nodes, so that is also what a snapshot costs per write it outlives.
+ * clear() is kept the same way; the bulk operations that relink nodes in place
+ * throw, see enableLockFreeReads(). Turns on lock-free reads, which do the path copying.
+ */
+void UTree::enablePersistence() {
+    if (this->_versions) { return; }
+
+    enableLockFreeReads();
+    this->_versions = new UVersions(this->_epoch);
+
+    return;
+}
+
+/**
+ * Stops keeping versions, freeing whatever was held for snapshots. No snapshot may
+ * be alive.
+ */
+void UTree::disablePersistence() {
+    delete this->_versions;
+    this->_versions = nullptr;
+
+    return;
+}
+
+/**
+ * Takes a snapshot of the tree as it is now.
+ * @return immutable version of the tree, kept until the last reference to it is gone
+ */
+std::shared_ptr<USnapshot> UTree::snapshot() const {
+    if (!this->_versions) { throw std::logic_error("Snapshots need enablePersistence()"); }
+
+    // the root is read after registering, so it is never older than the version kept
+    uint64_t version = this->_versions->acquire();
+    UNode *root = __atomic_load_n(&this->_root, __ATOMIC_ACQUIRE);
+
+    return std::shared_ptr<USnapshot>(new USnapshot(this->_versions, root, version));
+}
+
+// preconditions: node was replaced by a copy, and no reader holds it
+// postconditions: node is deleted without its DTree, which is freed separately if at all
+static void deleteUNode(void *ptr) {
+    UNode *node = static_cast<UNode*>(ptr);
+    node->getDTree() = nullptr;
+    delete node;
+
+    return;
+}
+
+// preconditions: node was unlinked by clear(), and no reader holds it
+// postconditions: node is deleted along with its DTree and the DTree's DNodes
+static void deleteUNodeWithDTree(void *ptr) {
+    delete static_cast<UNode*>(ptr);
+
+    return;
+}
+
+// preconditions: dtree was replaced by a copy, and no reader holds it
+// postconditions: dtree is deleted without its DNodes
+static void deleteDTree(void *ptr) {
+    DTree *dtree = static_cast<DTree*>(ptr);
+    dtree->release();
+    delete dtree;
+
+    return;
+}
+
+// preconditions: node was replaced by a copy or unlinked, and no reader holds it
+// postconditions: node is deleted
+static void deleteDNode(void *ptr) {
+    delete static_cast<DNode*>(ptr);
+
+    return;
+}
+
+// preconditions: lock-free reads are on and insert() has logged the request
+// postconditions: the account is inserted into a copy of the path to its username,
+//                 which is then published; returns true if it was inserted
+bool UTree::insertPublished(Account& newAcct) {
+    PathCopy copy;
+    bool inserted = false;
+    UNode *root = copyInsert(this->_root, newAcct, inserted, copy);
+
+    if (inserted) { publish(root, copy); }
+
+    return inserted;
+}
+
+// preconditions: lock-free reads are on and removeUser() has logged the request
+// postconditions: the account is removed from a copy of the path to its username,
+//                 which is then published; returns true if an account was removed
+bool UTree::removePublished(const string& username, int disc, DNode*& removed) {
+    PathCopy copy;
+    bool result = false;
+    UNode *root = copyRemove(this->_root, username, disc, removed, result, copy);
+
+    if (result) { publish(root, copy); }
+
+    return result;
+}
+
+// preconditions: currNode is published, or nullptr
+// postconditions: if the account was inserted, the root of a copy of this subtree
+//                 holding it is returned; otherwise nothing is copied and currNode is
+//                 returned
+UNode* UTree::copyInsert(UNode *currNode, Account& newAcct, bool &inserted, PathCopy& copy) {
+    if (!currNode) {
+        UNode *node = new UNode();
+        node->insert(newAcct);
+        copy.fresh.push_back(node);
+        inserted = true;
+        return node;
+    }
+
+    const string& username = newAcct.getUsername();
+    const string& nodeName = currNode->getUsername();
+
+    if (username == nodeName) {
+        // readers may be inside the DTree, so the insertion, and any rebuild it
+        // triggers, happens in a copy of its path
+        DTree *dtree = new DTree();
+
+        if (!currNode->_dtree->insertCopy(newAcct, *dtree, copy.dnodes)) {
+            delete dtree;
+            return currNode;
+        }
+
+        inserted = true;
+        return copyNode(currNode, dtree, copy);
+    }
+
+    bool goLeft = username < nodeName;
+    UNode *child = copyInsert(goLeft ? currNode->_left : currNode->_right, newAcct, inserted, copy);
+    if (!inserted) { return currNode; }
+
+    UNode *node = ownNode(currNode, copy);
+    (goLeft ? node->_left : node->_right) = child;
+
+    return rebalanceCopy(node, copy);
+}
+
+// preconditions: currNode is published, or nullptr
+// postconditions: if an account was removed, the root of a copy of this subtree
+//                 without it is returned, along with the UNode if that emptied it;
+//                 otherwise nothing is copied and currNode is returned
+UNode* UTree::copyRemove(UNode *currNode, const string& username, int disc, DNode*& removed, bool &result, PathCopy& copy) {
+    if (!currNode) { return nullptr; }
+
+    const string& nodeName = currNode->getUsername();
+
+    if (username != nodeName) {
+        bool goLeft = username < nodeName;
+        UNode *child = copyRemove(goLeft ? currNode->_left : currNode->_right, username, disc, removed, result, copy);
+        if (!result) { return currNode; }
+
+        UNode *node = ownNode(currNode, copy);
+        (goLeft ? node->_left : node->_right) = child;
+
+        return rebalanceCopy(node, copy);
+    }
+
+    DTree *dtree = new DTree();
+
+    if (!currNode->_dtree->removeCopy(disc, removed, *dtree, copy.dnodes)) {
+        delete dtree;
+        return currNode;
+    }
+
+    result = true;
+
+    if (dtree->getNumUsers()) { return copyNode(currNode, dtree, copy); }
+
+    // the username is gone, DNodes and all; like findReplacement(), the largest
+    // username of the left subtree takes its place, here as a copy sharing its DTree
+    delete dtree;
+    copy.unodes.push_back(currNode);
+    copy.dtrees.push_back(currNode->_dtree);
+
+    if (!currNode->_left) { return currNode->_right; }
+    if (!currNode->_right) { return currNode->_left; }
+
+    UNode *max = nullptr;
+    UNode *left = copyRemoveMax(currNode->_left, max, copy);
+    UNode *node = copyNode(max, nullptr, copy);
+    node->_left = left;
+    node->_right = currNode->_right;
+
+    return rebalanceCopy(node, copy);
+}
+
+// preconditions: currNode is published and not nullptr
+// postconditions: the rightmost UNode is found but left untouched in max, and the root
+//                 of a rebalanced copy of this subtree without it is returned
+UNode* UTree::copyRemoveMax(UNode *currNode, UNode *&max, PathCopy& copy) {
+    if (!currNode->_right) {
+        max = currNode;
+        return currNode->_left;
+    }
+
+    UNode *node = ownNode(currNode, copy);
+    node->_right = copyRemoveMax(currNode->_right, max, copy);
+
+    return rebalanceCopy(node, copy);
+}
+
+// preconditions: node is published
+// postconditions: an unpublished copy of node is returned, holding dtree if given and
+//                 sharing node's DTree otherwise; node, and its DTree if replaced, are
+//                 queued to be retired
+UNode* UTree::copyNode(UNode *node, DTree *dtree, PathCopy& copy) {
+    UNode *twin = new UNode((dtree) ? dtree : node->_dtree);
+    twin->_username = node->_username;
+    twin->_height = node->_height;
+    twin->_left = node->_left;
+    twin->_right = node->_right;
+
+    copy.fresh.push_back(twin);
+    copy.unodes.push_back(node);
+    if (dtree) { copy.dtrees.push_back(node->_dtree); }
+
+    return twin;
+}
+
+// preconditions: node is published or was made by this operation
+// postconditions: node is returned if this operation made it, else a copy of it that
+//                 is safe to change
+UNode* UTree::ownNode(UNode *node, PathCopy& copy) {
+    if (std::find(copy.fresh.begin(), copy.fresh.end(), node) != copy.fresh.end()) {
+        return node;
+    }
+
+    return copyNode(node, nullptr, copy);
+}
+
+// preconditions: node was made by this operation
+// postconditions: like rebalance(), but every node a rotation changes is a copy first
+UNode* UTree::rebalanceCopy(UNode *node, PathCopy& copy) {
+    const int RIGHT_IMBALANCE_MARKER = -2;
+    const int LEFT_IMBALANCE_MARKER = 2;
+    const int HEAVY_RIGHT_CHILD = 1;
+    const int HEAVY_LEFT_CHILD = -1;
+
+    int rootImbalanceNum = checkImbalance(node);
+
+    if (rootImbalanceNum <= RIGHT_IMBALANCE_MARKER) {
+        node->_right = ownNode(node->_right, copy);
+
+        if (checkImbalance(node->_right) == HEAVY_RIGHT_CHILD) {
+            node->_right->_left = ownNode(node->_right->_left, copy);
+            node->_right = rotateRight(node->_right);
+        }
+
+        node = rotateLeft(node);
+    } else if (rootImbalanceNum >= LEFT_IMBALANCE_MARKER) {
+        node->_left = ownNode(node->_left, copy);
+
+        if (checkImbalance(node->_left) == HEAVY_LEFT_CHILD) {
+            node->_left->_right = ownNode(node->_left->_right, copy);
+            node->_left = rotateLeft(node->_left);
+        }
+
+        node = rotateRight(node);
+    }
+
+    updateHeight(node);
+
+    return node;
+}
+
+// preconditions: root is the root of the tree this operation built
+// postconditions: root is published to readers and the nodes it replaced are retired,
+//                 or held for snapshots in persistent mode
+void UTree::publish(UNode *root, PathCopy& copy) {
+    std::vector<URetired> replaced;
+    replaced.reserve(copy.unodes.size() + copy.dtrees.size() + copy.dnodes.size());
+
+    for (UNode *node : copy.unodes) { replaced.push_back({node, deleteUNode}); }
+    for (DTree *dtree : copy.dtrees) { replaced.push_back({dtree, deleteDTree}); }
+    for (DNode *node : copy.dnodes) { replaced.push_back({node, deleteDNode}); }
+
+    publish(root, replaced);
+
+    return;
+}
+
+// preconditions: lock-free reads are on and root is ready to be read
+// postconditions: root is published to readers and replaced is retired, or held for
+//                 snapshots in persistent mode
+void UTree::publish(UNode *root, std::vector<URetired>& replaced) {
+    // release: a reader that loads the new root sees every copy fully built
+    __atomic_store_n(&this->_root, root, __ATOMIC_RELEASE);
+
+    if (this->_versions) {
+        this->_versions->commit(replaced);
+    } else {
+        this->_epoch->retire(replaced);
+    }
+
+    return;
+}
+
+// preconditions: lock-free reads are on and clear() is emptying the tree
+// postconditions: an empty tree is published, and every UNode is retired along with
+//                 its DTree and DNodes, which the current version alone owns
+void UTree::retireTree() {
+    std::vector<UNode*> nodes;
+    std::vector<URetired> replaced;
+
+    collectNodes(this->_root, nodes);
+    replaced.reserve(nodes.size());
+    for (UNode *node : nodes) { replaced.push_back({node, deleteUNodeWithDTree}); }
+
+    publish(nullptr, replaced);
+
+    return;
+}
+
+// preconditions: operation is about to relink or free this tree's nodes in place
+// postconditions: std::logic_error is thrown if lock-free readers or snapshots could
+//                 still reach those nodes
+void UTree::checkInPlace(const char *operation) const {
+    if (this->_epoch) {
+        throw std::logic_error(string(operation) + "() cannot run with lock-free reads or persistence");
+    }
+
+    return;
+}
+
+// preconditions: lock-free reads are on and the calling thread is pinned
+// postconditions: the published UNode with a matching username is returned, else nullptr
+UNode* UTree::findPublished(const string& username) const {
+    // everything below a published root is immutable, so plain loads suffice
+    return findNode(__atomic_load_n(&this->_root, __ATOMIC_ACQUIRE), username);
+}
+
+// preconditions: nothing changes the subtree while it is searched
+// postconditions: the UNode with a matching username is returned, else nullptr
+UNode* UTree::findNode(UNode *currNode, const string& username) {
+    while (currNode) {
+        const string& nodeName = currNode->getUsername();
+
+        if (username < nodeName) {
+            currNode = currNode->_left;
+        } else if (username > nodeName) {
+            currNode = currNode->_right;
+        } else {
+            return currNode;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * Destructor, lets the tree free what only this snapshot kept.
+ */
+USnapshot::~USnapshot() {
+    this->_versions->release(this->_version);
+}
+
+/**
+ * Retrieves a set of users within a UNode, as of the snapshot.
+ * @param username username to match
+ * @return UNode with a matching username, nullptr otherwise
+ */
+UNode* USnapshot::retrieve(string username) const {
+    return UTree::findNode(this->_root, username);
+}
+
+/**
+ * Retrieves the specified Account within a DNode, as of the snapshot.
+ * @param username username to match
+ * @param disc discriminator to match
+ * @return DNode with a matching username and discriminator, nullptr otherwise
+ */
+DNode* USnapshot::retrieveUser(string username, int disc) const {
+    UNode *found = UTree::findNode(this->_root, username);
+
+    return (found) ? found->findDisc(disc) : nullptr;
+}
+
+/**
+ * Returns the number of users with a specific username, as of the snapshot.
+ * @param username username to match
+ * @return number of users with the specified username
+ */
+int USnapshot::numUsers(string username) const {
+    UNode *found = UTree::findNode(this->_root, username);
+
+    return (found) ? found->getNumUsers() : 0;
+}
+
+/**
+ * Visits, in order, every UNode of the snapshot whose username starts with a prefix.
+ * @param prefix prefix to match, an empty prefix matches every username
+ * @param visitor called with each matching UNode and its number of users
+ * @param limit maximum number of UNodes to visit, NO_LIMIT to visit all of them
+ * @return number of UNodes visited
+ */
+int USnapshot::forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit) const {
+    return UTree::walkPrefix(this->_root, prefix, visitor, limit);
+}
+
+/**
+ * Returns the memory overhead of the hash index.
+ * @return bytes used by the index, 0 if it is disabled
+ */
+size_t UTree::hashIndexMemory() const {
+    return (this->_index) ? this->_index->memoryUsage() : 0;
+}
+
+// preconditions: enableHashIndex() was called
+// postconditions: every UNode in this subtree is added to the hash index
+void UTree::indexNodes(UNode *currNode) {
+    if (!currNode) { return; }
+
+    indexNodes(currNode->_left);
+    this->_index->insert(currNode->getUsername(), currNode);
+    indexNodes(currNode->_right);
+
+    return;
+}
+
 /**
  * Prints all accounts' details within every DTree.
  */
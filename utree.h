@@ -10,19 +10,42 @@
 ***************************/
 #pragma once
 
-#include "dtree.h"
-#include <fstream>
-#include <sstream>
+#include "uindex.h"
+#include "uhash.h"
+#include "snapshot.h"
+#include "uimage.h"
+#include "ulog.h"
+#include "uepoch.h"
+#include "ufilter.h"
+#include "ucache.h"
+#include "uhandle.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 #define DEFAULT_HEIGHT 0
+#define MAX_UTREE_DEPTH 128     /* AVL height bound for any n that fits in memory */
+#define DEFAULT_LOAD_THREADS 0  /* one loader thread per hardware thread */
+#define LOAD_SAMPLES_PER_THREAD 64
 
 class Grader;   /* For grading purposes */
 class Tester;   /* Forward declaration for testing class */
+class USnapshot;
+
+/* A (username, discriminator) pair to look up, see UTree::retrieveUserBatch() */
+struct UserKey {
+    string username;
+    int disc;
+};
 
 class UNode {
     friend class Grader;
     friend class Tester;
     friend class UTree;
+    friend class USnapshot;
+    friend class RTree;
+    friend class BTree;
 public:
     UNode() {
         _dtree = new DTree();
@@ -31,6 +54,14 @@ public:
         _right = nullptr;
     }
 
+    /* Takes a DTree rather than making one, for path copies sharing it */
+    explicit UNode(DTree *dtree) {
+        _dtree = dtree;
+        _height = DEFAULT_HEIGHT;
+        _left = nullptr;
+        _right = nullptr;
+    }
+
     ~UNode() {
         delete _dtree;
         _dtree = nullptr;
@@ -39,16 +70,20 @@ public:
     /* Getters */
     DTree*& getDTree() {return _dtree;}
     int getHeight() const {return _height;}
-    string getUsername() const {return _dtree->getUsername();}
+    const string& getUsername() const {return _username;}
 
 private:
     DTree* _dtree;
     int _height;
     UNode* _left;
     UNode* _right;
+    string _username;   // set once the DTree gets its first account, so lookups never read the DTree
+    std::mutex _lock;   // guards the DTree in concurrent mode
 
     /* IMPLEMENT (optional): Additional helper functions */
     bool insert(Account acc);
+    void assign(Account *accts, int count);
+    void assign(Account *accts, const int *order, int count);
     bool remove(int disc, DNode *&removed);
     DNode* findDisc(int disc);
     int getNumUsers();
@@ -57,25 +92,48 @@ private:
     bool isEmpty();
 };
 
-class UTree {
+class UTree : public UserIndex {
     friend class Grader;
     friend class Tester;
+    friend class ShardedUTree;
+    friend class USnapshot;
 
 public:
-    UTree():_root(nullptr){}
+    UTree():_root(nullptr), _index(nullptr), _filter(nullptr), _cache(nullptr), _handles(nullptr), _log(nullptr), _concurrent(false), _epoch(nullptr), _versions(nullptr), _numRetraceOps(0), _numRetraced(0){}
 
     /* IMPLEMENT: destructor */
     ~UTree();
 
     /* IMPLEMENT: Basic operations */
-    void loadData(string infile, bool append = true);
-    bool insert(Account newAcct);
-    bool removeUser(string username, int disc, DNode*& removed);
-    UNode* retrieve(string username);
-    DNode* retrieveUser(string username, int disc);
-    int numUsers(string username);
-    void clear();
-    void printUsers() const;
+    bool insert(Account newAcct) override;
+    bool removeUser(string username, int disc, DNode*& removed) override;
+    std::vector<AccountOpResult> applyBatch(const std::vector<AccountOp>& ops);
+    UNode* retrieve(string username) override;
+    DNode* retrieveUser(string username, int disc) override;
+    int numUsers(string username) override;
+    void retrieveUserBatch(const UserKey *keys, int count, DNode **results);
+    ULookup<DNode*> retrieveUserAsync(string username, int disc);
+    ULookup<int> numUsersAsync(string username);
+    void clear() override;
+    void printUsers() const override;
+    int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const override;
+    void loadData(string infile, bool append = true) override;
+    void loadDataParallel(string infile, int numThreads = DEFAULT_LOAD_THREADS, bool append = true);
+    void mergeFrom(UTree&& other);
+    void mergeSorted(string infile);
+    void split(string username, UTree& right);
+    void join(UTree&& right);
+    bool saveSnapshot(string path, int version = SNAPSHOT_VERSION) const;
+    void loadSnapshot(string path);
+    bool saveImage(string path) const;
+    bool exportTo(ExportSink& sink, int format = EXPORT_CSV) const;
+
+    /* Write-ahead logging of insert(), removeUser() and clear() */
+    void recover(string snapshotPath, string logPath, int syncPolicy = LOG_SYNC_ALWAYS);
+    bool checkpoint();
+    void syncLog();
+    void disableLog();
+    bool hasLog() const {return _log != nullptr;}
     void dump() const {dump(_root);}
     void dump(UNode* node) const;
 
@@ -85,18 +143,157 @@ public:
     int checkImbalance(UNode* node);
     UNode* rebalance(UNode* node);
 
+    /* Retracing instrumentation */
+    double avgRetraced() const;
+    void resetRetraceStats();
+
+    /* Concurrent mode, see enableConcurrency() */
+    void enableConcurrency();
+    void disableConcurrency();
+    bool isConcurrent() const {return _concurrent;}
+
+    /* Lock-free reads beside a single writer, see enableLockFreeReads() */
+    void enableLockFreeReads();
+    void disableLockFreeReads();
+    bool hasLockFreeReads() const {return _epoch != nullptr;}
+    UEpoch* getEpoch() const {return _epoch;}
+
+    /* Persistent versions, see enablePersistence() */
+    void enablePersistence();
+    void disablePersistence();
+    bool isPersistent() const {return _versions != nullptr;}
+    std::shared_ptr<USnapshot> snapshot() const;
+    UVersions* getVersions() const {return _versions;}
+
+    /* Optional hash index for exact username lookups */
+    void enableHashIndex();
+    void disableHashIndex();
+    bool hasHashIndex() const {return _index != nullptr;}
+    size_t hashIndexMemory() const;
+
+    /* Optional Bloom filter ruling out usernames that are not in the tree */
+    void enableFilter();
+    void disableFilter();
+    bool hasFilter() const {return _filter != nullptr;}
+    const UFilter* getFilter() const {return _filter;}
+
+    /* Optional cache of recently retrieved accounts in front of retrieveUser() */
+    void enableCache(size_t capacity = DEFAULT_CACHE_CAPACITY);
+    void disableCache();
+    bool hasCache() const {return _cache != nullptr;}
+    const UCache* getCache() const {return _cache;}
+
+    /* Stable handles to accounts, see enableHandles() */
+    void enableHandles();
+    void disableHandles();
+    bool hasHandles() const {return _handles != nullptr;}
+    AccountHandle getHandle(string username, int disc);
+    DNode* deref(AccountHandle handle) const {return (_handles) ? _handles->get(handle) : nullptr;}
+    bool isValid(AccountHandle handle) const {return deref(handle) != nullptr;}
+    size_t numHandles() const {return (_handles) ? _handles->size() : 0;}
+
 private:
     UNode* _root;
+    UHashIndex* _index;             // nullptr unless enableHashIndex() was called
+    UFilter* _filter;               // nullptr unless enableFilter() was called
+    UCache* _cache;                 // nullptr unless enableCache() was called
+    UHandleTable* _handles;         // nullptr unless enableHandles() was called
+    ULog* _log;                     // nullptr unless recover() was called
+    string _snapshotPath;           // where checkpoint() saves to
+    bool _concurrent;               // insert(), removeUser() and lookups lock, see enableConcurrency()
+    mutable std::shared_mutex _treeLock;    // exclusive only while UNodes are linked, unlinked or rotated
+    UEpoch* _epoch;                 // nullptr unless enableLockFreeReads() was called
+    UVersions* _versions;           // nullptr unless enablePersistence() was called
+    unsigned long _numRetraceOps;   // insertions/removals that changed the username level
+    unsigned long _numRetraced;     // ancestors visited while retracing those operations
 
     /* IMPLEMENT (optional): any additional helper functions here! */
-    bool insert(UNode *currNode, Account insertMe);
-    bool remove(UNode *currNode, string username, int disc, DNode *&removed);
+    bool insertNode(Account& newAcct);
+    bool removeNode(const string& username, int disc, DNode*& removed);
+    bool insertConcurrent(Account& newAcct);
+    bool removeUserConcurrent(const string& username, int disc, DNode*& removed);
+
+    /* Path copying for lock-free reads; published UNodes and DTrees are never changed */
+    struct PathCopy {
+        std::vector<UNode*> fresh;      // copies made by this operation, not yet published
+        std::vector<UNode*> unodes;     // replaced UNodes, freed without their DTree
+        std::vector<DTree*> dtrees;     // replaced DTrees, freed without their DNodes
+        std::vector<DNode*> dnodes;     // replaced DNodes
+    };
+    bool insertPublished(Account& newAcct);
+    bool removePublished(const string& username, int disc, DNode*& removed);
+    UNode* copyInsert(UNode *currNode, Account& newAcct, bool &inserted, PathCopy& copy);
+    UNode* copyRemove(UNode *currNode, const string& username, int disc, DNode*& removed, bool &result, PathCopy& copy);
+    UNode* copyRemoveMax(UNode *currNode, UNode *&max, PathCopy& copy);
+    UNode* copyNode(UNode *node, DTree *dtree, PathCopy& copy);
+    UNode* ownNode(UNode *node, PathCopy& copy);
+    UNode* rebalanceCopy(UNode *node, PathCopy& copy);
+    void publish(UNode *root, PathCopy& copy);
+    void publish(UNode *root, std::vector<URetired>& replaced);
+    void retireTree();
+    void checkInPlace(const char *operation) const;
+    UNode* findPublished(const string& username) const;
+    static UNode* findNode(UNode *currNode, const string& username);
+    static int walkPrefix(UNode *root, const string& prefix, const std::function<void(UNode*, int)>& visitor, int limit);
     UNode* retrieve(UNode *currNode, string username);
     DNode* retrieveUser(UNode *currNode, string username, int disc);
+    void retrieveGroup(UNode *root, const UserKey *keys, int count, DNode **results);
+    ULookup<UNode*> findAsync(const string& username);
     int numUsers(UNode *currNode, string username);
     void clear(UNode *currNode);
     UNode* rotateLeft(UNode *oldRoot);
     UNode* rotateRight(UNode *oldRoot);
-    UNode* findReplacement(UNode *empty);
-    UNode* replacementTraversal(UNode *candidate);
+    void findReplacement(UNode **path[], int depth);
+    UNode* findFiltered(const string& username) const;
+    void filterAdd(const string& username);
+    void filterRemoved(size_t count);
+    void rebuildFilter();
+    DNode* retrieveCached(const string& username, int disc);
+    void rebindHandles(const string& username);
+    void applyUser(const std::vector<AccountOp>& ops, const int *order, int count, std::vector<AccountOpResult>& results);
+    static void sortBatch(const std::vector<AccountOp>& ops, std::vector<int>& order, std::vector<int>& runs);
+    void retrace(UNode **path[], int depth);
+    void indexNodes(UNode *currNode);
+    void bulkLoad(std::vector<Account>& accts);
+    void mergeNodes(std::vector<UNode*>& incoming);
+    UNode* joinNodes(UNode *left, UNode *mid, UNode *right);
+    void splitNodes(UNode *currNode, const string& username, UNode *&less, UNode *&rest);
+    UNode* removeMin(UNode *currNode, UNode *&min);
+    static bool exportCsv(ExportSink& sink, const std::vector<UNode*>& nodes);
+    static void writeSnapshotPlain(SnapshotWriter& writer, const std::vector<UNode*>& nodes);
+    static void writeSnapshotCompressed(SnapshotWriter& writer, const std::vector<UNode*>& nodes);
+    static void readSnapshotPlain(SnapshotReader& reader, std::vector<UNode*>& nodes);
+    static void readSnapshotCompressed(SnapshotReader& reader, std::vector<UNode*>& nodes);
+    static void collectNodes(UNode *currNode, std::vector<UNode*>& nodes);
+    static UNode* buildBalanced(UNode **nodes, int count);
+};
+
+/* Immutable version of a persistent UTree, see UTree::snapshot(). It shares its
+ * nodes with the tree, so taking one copies nothing, and it can be read from any
+ * number of threads for as long as it is held. The tree must outlive it. */
+class USnapshot {
+    friend class Grader;
+    friend class Tester;
+    friend class UTree;
+
+public:
+    ~USnapshot();
+    USnapshot(const USnapshot&) = delete;
+    USnapshot& operator=(const USnapshot&) = delete;
+
+    /* Basic operations, as on the tree at the time of the snapshot */
+    UNode* retrieve(string username) const;
+    DNode* retrieveUser(string username, int disc) const;
+    int numUsers(string username) const;
+    int forEachWithPrefix(string prefix, std::function<void(UNode*, int)> visitor, int limit = NO_LIMIT) const;
+
+    /* Getters */
+    uint64_t getVersion() const {return _version;}
+
+private:
+    USnapshot(UVersions *versions, UNode *root, uint64_t version): _versions(versions), _root(root), _version(version) {}
+
+    UVersions* _versions;
+    UNode* _root;
+    uint64_t _version;
 };